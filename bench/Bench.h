@@ -0,0 +1,31 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+//Minimal benchmark support, every benchmark is an executable printing one line per measurement.
+//They are not registered with ctest, run them from the build directory on the machine being sized.
+namespace Bench {
+	//best wall time in seconds of repeats runs of f, the minimum is the least noisy estimate
+	template<typename F>
+	double Seconds(F&& f, int repeats = 5) {
+		double best = 1e30;
+		for(int i = 0; i < repeats; i++) {
+			const auto start = std::chrono::steady_clock::now();
+			f();
+			const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			best = elapsed < best ? elapsed : best;
+		}
+		return best;
+	}
+	//keeps the optimizer from dropping work whose result is otherwise unused
+	inline volatile unsigned char sink;
+	template<typename T>
+	void Consume(const T& value) {
+		sink = *reinterpret_cast<const volatile unsigned char*>(&value);
+	}
+	//command line argument index as a count, fallback when absent
+	inline unsigned long Arg(int argc, char** argv, int index, unsigned long fallback) {
+		return index < argc ? std::strtoul(argv[index], nullptr, 10) : fallback;
+	}
+}
@@ -0,0 +1,68 @@
+#include "Bench.h"
+#include "Bvh.h"
+#include "JobSystem.h"
+#include <vector>
+#include <random>
+
+//Build, refit and query cost of the BVH over randomly placed boxes.
+//	BvhBench [objects] [world half size]
+//The frustum sees part of the world so culling has to reject whole subtrees; rays start anywhere inside.
+int main(int argc, char** argv) {
+	const std::size_t count = Bench::Arg(argc, argv, 1, 100000u);
+	const float world = float(Bench::Arg(argc, argv, 2, 200u));
+	std::mt19937 rng(1u);
+	std::uniform_real_distribution<float> position(-world, world);
+	std::uniform_real_distribution<float> size(0.1f, 3.0f);
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	std::vector<Bvh::Aabb> boxes(count);
+	for(auto& box : boxes) {
+		const float x = position(rng), y = position(rng), z = position(rng), s = size(rng);
+		box = { { x - s, y - s, z - s }, { x + s, y + s, z + s } };
+	}
+	//the same boxes moved a little, what Refit() is meant for
+	std::vector<Bvh::Aabb> moved = boxes;
+	for(auto& box : moved) {
+		const float dx = direction(rng);
+		box.min.x += dx;
+		box.max.x += dx;
+	}
+	JobSystem jobs;
+	std::printf("%zu objects, %u job threads\n", count, jobs.GetThreadCount());
+
+	Bvh bvh;
+	const double build = Bench::Seconds([&] { bvh.Build(boxes.data(), count); }, 3);
+	const double buildJobs = Bench::Seconds([&] { bvh.Build(boxes.data(), count, &jobs); }, 3);
+	std::printf("build       %8.2f ms\n", build * 1e3);
+	std::printf("build, jobs %8.2f ms\n", buildJobs * 1e3);
+	const double refit = Bench::Seconds([&] { bvh.Refit(moved.data()); });
+	const double refitJobs = Bench::Seconds([&] { bvh.Refit(moved.data(), &jobs); });
+	std::printf("refit       %8.2f ms\n", refit * 1e3);
+	std::printf("refit, jobs %8.2f ms\n", refitJobs * 1e3);
+
+	const auto frustum = FrustumCull::ExtractFrustum(rmath::Multiply(rmath::Translation(0.0f, 0.0f, world * 0.4f),
+		rmath::PerspectiveLH(1.0f, 0.75f, 0.5f, world * 1.2f)));
+	std::vector<Bvh::Range> ranges;
+	std::size_t visible = 0u;
+	const double cull = Bench::Seconds([&] {
+		ranges.clear();
+		visible = bvh.Cull(frustum, ranges);
+	}, 20);
+	std::printf("cull        %8.3f ms, %zu visible (%.1f%%) in %zu ranges\n", cull * 1e3, visible,
+		100.0 * double(visible) / double(count), ranges.size());
+
+	constexpr std::size_t rayCount = 200000u;
+	std::vector<Bvh::Ray> rays(rayCount);
+	for(auto& ray : rays) {
+		ray = { { position(rng), position(rng), position(rng) }, { direction(rng), direction(rng), direction(rng) }, world * 2.0f };
+	}
+	std::size_t hits = 0u;
+	const double raycast = Bench::Seconds([&] {
+		hits = 0u;
+		for(const auto& ray : rays) {
+			Bvh::Hit hit;
+			hits += bvh.Raycast(ray, hit) ? 1u : 0u;
+		}
+	}, 3);
+	std::printf("raycast     %8.2f Mrays/s, %.0f%% hit\n", double(rayCount) / raycast * 1e-6, 100.0 * double(hits) / double(rayCount));
+	return 0;
+}
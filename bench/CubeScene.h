@@ -0,0 +1,28 @@
+#pragma once
+#include "SoftwareRasterizer.h"
+#include "TestCube.h"
+#include <random>
+#include <iterator>
+
+//The same frame of randomly placed test cubes for every rasterizer benchmark.
+namespace CubeScene {
+	constexpr std::size_t trianglesPerCube = std::size(TestCube::indices) / 3u;
+
+	inline void Render(SoftwareRasterizer& rasterizer, unsigned long cubes) {
+		rasterizer.SetFaceColors(reinterpret_cast<const SoftwareRasterizer::Color*>(TestCube::faceColors.face_colors), 6u);
+		rasterizer.ClearBuffer(0.2f, 0.3f, 1.0f);
+		std::mt19937 rng(5u);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		for(unsigned long i = 0u; i < cubes; i++) {
+			const float angle = dist(rng) * 3.0f;
+			const float x = dist(rng) * 6.0f;
+			const float y = dist(rng) * 5.0f;
+			const float z = 6.0f + dist(rng) * 4.0f;
+			const auto transform = rmath::Transpose(rmath::RotationZ(angle) * rmath::RotationX(angle)
+				* rmath::Translation(x, y, z) * rmath::PerspectiveLH(1.0f, 0.75f, 0.5f, 10.0f));
+			rasterizer.DrawIndexed(TestCube::vertices, sizeof(TestCube::Vertex), std::size(TestCube::vertices),
+				TestCube::indices, std::size(TestCube::indices), transform);
+		}
+		rasterizer.Flush();
+	}
+}
@@ -0,0 +1,128 @@
+#include "Bench.h"
+#include "JobSystem.h"
+#include <thread>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+//Scheduler throughput and latency for 1 to N workers, for sizing the job pool on a render node.
+//	JobSystemBench [items] [max workers]
+//ParallelFor runs a fixed amount of hashing at a coarse and a fine grain. The chain runs jobs that each wait
+//for the one before (pure hand-off latency), the layers run waves of jobs that each wait for the whole previous
+//wave (fan-out/fan-in like a frame graph). Worker counts beyond the core count show the oversubscription cost.
+//The stolen column counts the fine grain runs. Exits with the number of worker counts whose sums or ordering were wrong.
+namespace {
+	std::uint32_t Hash(std::uint32_t x) noexcept {
+		for(int i = 0; i < 64; i++) {
+			x ^= x >> 16;
+			x *= 0x7FEB352Du;
+			x ^= x >> 15;
+		}
+		return x;
+	}
+
+	constexpr std::size_t chainLength = 1000u;
+	constexpr std::size_t layerCount = 32u;
+	constexpr std::size_t layerWidth = 64u;
+}
+
+int main(int argc, char** argv) {
+	const std::size_t items = Bench::Arg(argc, argv, 1, 1u << 18);
+	const unsigned long maxWorkers = Bench::Arg(argc, argv, 2, 64u);
+	std::printf("%zu items, %u hardware threads\n", items, std::thread::hardware_concurrency());
+
+	std::uint64_t expected = 0u;
+	for(std::size_t i = 0u; i < items; i++) {
+		expected += Hash(std::uint32_t(i));
+	}
+	int failures = 0;
+	double coarseOne = 0.0;
+	double fineOne = 0.0;
+	for(unsigned long workers = 1u; workers <= maxWorkers; workers *= 2u) {
+		JobSystem jobs((unsigned int)workers);
+
+		//ParallelFor, per chunk partial sums so the threads do not share a cache line while hashing
+		std::atomic<std::uint64_t> sum = 0u;
+		const auto hashRange = [&sum](std::size_t begin, std::size_t end) {
+			std::uint64_t partial = 0u;
+			for(std::size_t i = begin; i < end; i++) {
+				partial += Hash(std::uint32_t(i));
+			}
+			sum.fetch_add(partial, std::memory_order_relaxed);
+		};
+		const std::size_t coarseGrain = std::max<std::size_t>(items / (workers * 4u), 1u);
+		bool sumsMatch = true;
+		const double coarse = Bench::Seconds([&] {
+			sum = 0u;
+			jobs.ParallelFor(items, coarseGrain, hashRange);
+			sumsMatch = sumsMatch && sum == expected;
+		});
+		jobs.ResetStats();
+		const double fine = Bench::Seconds([&] {
+			sum = 0u;
+			jobs.ParallelFor(items, 64u, hashRange);
+			sumsMatch = sumsMatch && sum == expected;
+		});
+		const auto fineStats = jobs.GetStats();
+		if(workers == 1u) {
+			coarseOne = coarse;
+			fineOne = fine;
+		}
+
+		//chain, every job checks it runs right after its predecessor
+		std::unique_ptr<JobSystem::Counter[]> links(new JobSystem::Counter[chainLength]);
+		std::atomic<std::size_t> step = 0u;
+		bool chainInOrder = true;
+		std::atomic<bool> outOfOrder = false;
+		const double chain = Bench::Seconds([&] {
+			step = 0u;
+			for(std::size_t i = 0u; i < chainLength; i++) {
+				auto* pStep = &step;
+				auto* pOutOfOrder = &outOfOrder;
+				jobs.Run(links[i], [pStep, pOutOfOrder, i] {
+					if(pStep->load(std::memory_order_relaxed) != i) {
+						pOutOfOrder->store(true, std::memory_order_relaxed);
+					}
+					pStep->store(i + 1u, std::memory_order_relaxed);
+				}, i ? &links[i - 1u] : nullptr);
+			}
+			jobs.Wait(links[chainLength - 1u]);
+			chainInOrder = chainInOrder && step == chainLength;
+		});
+		chainInOrder = chainInOrder && !outOfOrder;
+
+		//layers, each job of a wave checks the whole previous wave finished
+		std::unique_ptr<JobSystem::Counter[]> waves(new JobSystem::Counter[layerCount]);
+		std::unique_ptr<std::atomic<std::size_t>[]> done(new std::atomic<std::size_t>[layerCount]);
+		bool layersInOrder = true;
+		const double layers = Bench::Seconds([&] {
+			for(std::size_t l = 0u; l < layerCount; l++) {
+				done[l] = 0u;
+			}
+			for(std::size_t l = 0u; l < layerCount; l++) {
+				for(std::size_t j = 0u; j < layerWidth; j++) {
+					auto* pDone = done.get();
+					auto* pOutOfOrder = &outOfOrder;
+					jobs.Run(waves[l], [pDone, pOutOfOrder, l] {
+						if(l && pDone[l - 1u].load(std::memory_order_acquire) != layerWidth) {
+							pOutOfOrder->store(true, std::memory_order_relaxed);
+						}
+						pDone[l].fetch_add(1u, std::memory_order_acq_rel);
+					}, l ? &waves[l - 1u] : nullptr);
+				}
+			}
+			jobs.Wait(waves[layerCount - 1u]);
+			layersInOrder = layersInOrder && done[layerCount - 1u] == layerWidth;
+		});
+		layersInOrder = layersInOrder && !outOfOrder;
+
+		const bool ok = sumsMatch && chainInOrder && layersInOrder;
+		failures += ok ? 0 : 1;
+		std::printf("workers %2lu: for %8.3f ms %5.2fx, fine %8.3f ms %5.2fx %6zu stolen, chain %6.2f us/job, layers %6.2f us/wave %s\n",
+			workers, coarse * 1e3, coarseOne / coarse, fine * 1e3, fineOne / fine, fineStats.stolen,
+			chain / double(chainLength) * 1e6, layers / double(layerCount) * 1e6, ok ? "ok" : "WRONG");
+	}
+	return failures;
+}
@@ -0,0 +1,83 @@
+#include "Bench.h"
+#include "MeshFile.h"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+namespace {
+	//copies every blob once, which is what CreateBuffer() does with pSysMem
+	std::size_t Upload(const MeshFile& mesh, std::vector<char>& destination) {
+		std::size_t total = 0u;
+		for(std::size_t i = 0u; i < mesh.GetStreamCount(); i++) {
+			const auto stream = mesh.GetStream(i);
+			std::memcpy(destination.data() + total, stream.pData, stream.size);
+			total += stream.size;
+		}
+		const auto indices = mesh.GetIndices();
+		std::memcpy(destination.data() + total, indices.pData, indices.count * indices.indexSize);
+		return total + indices.count * indices.indexSize;
+	}
+}
+
+//Load throughput of MeshFile for large synthetic meshes, from opening the file to the blobs handed to the upload.
+//	MeshLoadBench [vertices]
+//mapped: MeshFile(path), the upload reads straight from the mapping
+//read: the whole file read into memory first, then MeshFile(image, size), the path without a mapping
+//The best of several runs is reported, so the file is in the page cache and this measures the copies, not the disk.
+int main(int argc, char** argv) {
+	const std::size_t vertexCount = Bench::Arg(argc, argv, 1, 4000000u);
+	const std::string path = (std::filesystem::temp_directory_path() / "MeshLoadBench.mesh").string();
+	{
+		//float3 positions, normal and uv in a second stream, two triangles per vertex
+		std::vector<float> positions(vertexCount * 3u);
+		std::vector<float> attributes(vertexCount * 5u);
+		std::vector<std::uint32_t> indices(vertexCount * 6u);
+		for(std::size_t i = 0u; i < positions.size(); i++) {
+			positions[i] = float(i % 1000u) * 0.01f;
+		}
+		for(std::size_t i = 0u; i < indices.size(); i++) {
+			indices[i] = std::uint32_t((i * 2654435761u) % vertexCount);
+		}
+		MeshFile::Desc desc;
+		MeshFile::Attribute attribute = {};
+		std::strcpy(attribute.semantic, "POSITION");
+		attribute.format = MeshFile::Format::Float3;
+		desc.attributes.push_back(attribute);
+		std::strcpy(attribute.semantic, "NORMAL");
+		attribute.stream = 1u;
+		desc.attributes.push_back(attribute);
+		std::strcpy(attribute.semantic, "TEXCOORD");
+		attribute.format = MeshFile::Format::Float2;
+		attribute.offset = 12u;
+		desc.attributes.push_back(attribute);
+		desc.streams.push_back({ positions.data(), positions.size() * sizeof(float), 12u });
+		desc.streams.push_back({ attributes.data(), attributes.size() * sizeof(float), 20u });
+		desc.indices = { indices.data(), indices.size(), 4u };
+		MeshFile::Write(path, desc);
+	}
+	const std::size_t fileSize = std::filesystem::file_size(path);
+	std::vector<char> destination(fileSize);
+	std::size_t uploaded = 0u;
+
+	const double mapped = Bench::Seconds([&] {
+		const MeshFile mesh(path);
+		uploaded = Upload(mesh, destination);
+	});
+	const double read = Bench::Seconds([&] {
+		std::ifstream file(path, std::ios::binary);
+		const std::unique_ptr<char[]> pImage(new char[fileSize]);
+		file.read(pImage.get(), std::streamsize(fileSize));
+		const MeshFile mesh(pImage.get(), fileSize);
+		uploaded = Upload(mesh, destination);
+	});
+	Bench::Consume(destination[uploaded / 2u]);
+	std::filesystem::remove(path);
+
+	std::printf("%zu vertices, %.1f MB of blobs\n", vertexCount, double(uploaded) * 1e-6);
+	std::printf("mapped: %8.2f ms %6.2f GB/s\n", mapped * 1e3, double(uploaded) / mapped * 1e-9);
+	std::printf("read:   %8.2f ms %6.2f GB/s\n", read * 1e3, double(uploaded) / read * 1e-9);
+	return 0;
+}
@@ -0,0 +1,71 @@
+#include "Bench.h"
+#include "Meshlets.h"
+#include "MeshOptimizer.h"
+#include "JobSystem.h"
+#include <vector>
+#include <cmath>
+
+//Meshlet build and cull cost over a multi million triangle torus.
+//	MeshletBench [segments] [rings]
+//Builds on the calling thread and with a JobSystem (the results must be identical), then culls for a camera that
+//sees part of the torus from above and compacts the surviving meshlets into an index list on 1 and N threads.
+int main(int argc, char** argv) {
+	const std::uint32_t segments = (std::uint32_t)Bench::Arg(argc, argv, 1, 1600u);
+	const std::uint32_t rings = (std::uint32_t)Bench::Arg(argc, argv, 2, 800u);
+	std::vector<rmath::Float3> positions;
+	std::vector<std::uint32_t> indices;
+	for(std::uint32_t i = 0u; i < segments; i++) {
+		for(std::uint32_t j = 0u; j < rings; j++) {
+			const float u = 6.2831853f * float(i) / float(segments);
+			const float w = 6.2831853f * float(j) / float(rings);
+			const float r = 3.0f + 1.2f * std::cos(w);
+			positions.push_back({ r * std::cos(u), r * std::sin(u), 1.2f * std::sin(w) });
+		}
+	}
+	//clockwise seen from outside
+	for(std::uint32_t i = 0u; i < segments; i++) {
+		for(std::uint32_t j = 0u; j < rings; j++) {
+			const std::uint32_t a = i * rings + j;
+			const std::uint32_t b = (i + 1u) % segments * rings + j;
+			const std::uint32_t c = i * rings + (j + 1u) % rings;
+			const std::uint32_t d = (i + 1u) % segments * rings + (j + 1u) % rings;
+			indices.insert(indices.end(), { a, c, b, c, d, b });
+		}
+	}
+	MeshOptimizer::OptimizeVertexCache(indices.data(), indices.data(), indices.size(), positions.size());
+	const std::size_t triangles = indices.size() / 3u;
+	JobSystem jobs;
+	std::printf("%zu triangles, %zu vertices, %u threads\n", triangles, positions.size(), jobs.GetThreadCount());
+
+	Meshlets::Data data;
+	const double build = Bench::Seconds([&] {
+		data = Meshlets::Build(indices.data(), indices.size(), positions.data(), sizeof(rmath::Float3), positions.size());
+	}, 3);
+	Meshlets::Data jobData;
+	const double buildJobs = Bench::Seconds([&] {
+		jobData = Meshlets::Build(indices.data(), indices.size(), positions.data(), sizeof(rmath::Float3), positions.size(), &jobs);
+	}, 3);
+	const bool identical = data.vertices == jobData.vertices && data.triangles == jobData.triangles && data.radius == jobData.radius;
+	std::printf("build:   %8.2f ms %7.2f Mtri/s\n", build * 1e3, double(triangles) / build * 1e-6);
+	std::printf("jobs:    %8.2f ms %7.2f Mtri/s %s\n", buildJobs * 1e3, double(triangles) / buildJobs * 1e-6, identical ? "identical" : "MISMATCH");
+	std::printf("%zu meshlets, %.1f triangles each\n", data.meshlets.size(), double(triangles) / double(data.meshlets.size()));
+
+	const rmath::Mat4 transform = rmath::RotationX(0.9f) * rmath::Translation(1.5f, 0.5f, 7.0f) * rmath::PerspectiveLH(1.0f, 0.75f, 0.5f, 40.0f);
+	std::vector<std::uint32_t> visible(data.meshlets.size());
+	std::size_t visibleCount = 0u;
+	const double cull = Bench::Seconds([&] { visibleCount = Meshlets::Cull(data, transform, visible.data()); });
+	std::vector<std::uint32_t> kept;
+	kept.reserve(indices.size());
+	const double compact = Bench::Seconds([&] {
+		kept.clear();
+		Meshlets::AppendIndices(data, visible.data(), visibleCount, kept);
+	});
+	const double compactJobs = Bench::Seconds([&] {
+		kept.clear();
+		Meshlets::AppendIndices(data, visible.data(), visibleCount, kept, &jobs);
+	});
+	std::printf("cull:    %8.2f ms, %zu of %zu meshlets kept, %.1f%% of the triangles\n", cull * 1e3, visibleCount, data.meshlets.size(),
+		100.0 * double(kept.size()) / double(indices.size()));
+	std::printf("compact: %8.2f ms, %8.2f ms with jobs\n", compact * 1e3, compactJobs * 1e3);
+	return identical ? 0 : 1;
+}
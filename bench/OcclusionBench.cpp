@@ -0,0 +1,63 @@
+#include "Bench.h"
+#include "OcclusionCuller.h"
+#include "TestCube.h"
+#include <random>
+#include <vector>
+
+//Cull rate and CPU cost per frame of OcclusionCuller for a wall of occluders in front of many small boxes.
+//	OcclusionBench [objects]
+//One line per depth buffer size: how many objects were culled and where the time of a frame went
+//(rasterizing the occluders, building the pyramid, testing the bounds), best of several frames.
+int main(int argc, char** argv) {
+	const std::size_t count = Bench::Arg(argc, argv, 1, 20000u);
+	const rmath::Mat4 proj = rmath::PerspectiveLH(1.0f, 0.75f, 0.5f, 100.0f);
+	//flattened test cubes at z = 15 in a checkerboard, the gaps let part of the scene through
+	std::vector<rmath::Mat4> occluders;
+	for(int i = -2; i <= 2; i++) {
+		for(int j = -1; j <= 1; j++) {
+			if((i + j) % 2 != 0) {
+				const rmath::Mat4 scale = { { { 3.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 3.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.5f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } };
+				occluders.push_back(rmath::Transpose(scale * rmath::Translation(float(i) * 6.0f, float(j) * 6.0f, 15.0f) * proj));
+			}
+		}
+	}
+	//boxes spread over the view between z = 5 and 60
+	std::mt19937 rng(3u);
+	std::uniform_real_distribution<float> screenX(-14.0f, 14.0f);
+	std::uniform_real_distribution<float> screenY(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> depth(5.0f, 60.0f);
+	std::uniform_real_distribution<float> size(0.2f, 1.5f);
+	std::vector<float> x(count), y(count), z(count), extent(count);
+	for(std::size_t i = 0u; i < count; i++) {
+		z[i] = depth(rng);
+		x[i] = screenX(rng) * z[i] / 15.0f;
+		y[i] = screenY(rng) * z[i] / 15.0f;
+		extent[i] = size(rng);
+	}
+	const FrustumCull::Boxes boxes = { x.data(), y.data(), z.data(), extent.data(), extent.data(), extent.data(), count };
+	std::printf("%zu objects, %zu occluders\n", count, occluders.size());
+
+	const unsigned int sizes[][2] = { { 128u, 96u }, { 256u, 192u }, { 512u, 384u } };
+	std::vector<std::uint32_t> visible(count);
+	for(const auto& s : sizes) {
+		OcclusionCuller culler(s[0], s[1]);
+		OcclusionCuller::Stats best;
+		std::size_t visibleCount = 0u;
+		const double frame = Bench::Seconds([&] {
+			culler.BeginFrame(proj);
+			for(const auto& transform : occluders) {
+				culler.AddOccluder(TestCube::vertices, sizeof(TestCube::Vertex), std::size(TestCube::vertices),
+					TestCube::indices, std::size(TestCube::indices), transform);
+			}
+			visibleCount = culler.Cull(boxes, visible.data());
+			const auto& stats = culler.GetStats();
+			if(best.tested == 0u || stats.rasterizeMs + stats.pyramidMs + stats.testMs < best.rasterizeMs + best.pyramidMs + best.testMs) {
+				best = stats;
+			}
+		}, 20);
+		std::printf("%3ux%3u: %5.1f%% culled, frame %6.3f ms (rasterize %6.3f, pyramid %6.3f, test %6.3f = %5.1f ns/object)\n",
+			s[0], s[1], 100.0 * double(count - visibleCount) / double(count), frame * 1e3,
+			best.rasterizeMs, best.pyramidMs, best.testMs, best.testMs * 1e6 / double(count));
+	}
+	return 0;
+}
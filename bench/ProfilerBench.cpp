@@ -0,0 +1,53 @@
+#include "Bench.h"
+#include "Profiler.h"
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+//Cost of a Profiler::Scope on one and on several threads at once, and of draining them in EndFrame().
+//	ProfilerBench [threads]
+//The budget is 50 ns per scope; exits with 1 when the single threaded cost is over it.
+int main(int argc, char** argv) {
+	const unsigned long threads = Bench::Arg(argc, argv, 1, 4u);
+	constexpr double budgetNs = 50.0;
+
+	//first call registers the ring and calibrates the counter
+	Profiler::MeasureScopeOverhead(1000u);
+	double single = 1e30;
+	for(int i = 0; i < 5; i++) {
+		single = std::min(single, Profiler::MeasureScopeOverhead());
+	}
+	std::printf("scope, 1 thread       %6.1f ns (budget %.0f ns)\n", single, budgetNs);
+
+	//every thread records into its own ring, contention would show up as a higher per scope cost
+	//(with fewer cores than threads the time a thread spends preempted counts as well)
+	std::vector<double> perThread(threads);
+	std::vector<std::thread> workers;
+	for(unsigned long t = 0u; t < threads; t++) {
+		workers.emplace_back([&perThread, t] {
+			Profiler::MeasureScopeOverhead(1000u);
+			perThread[t] = Profiler::MeasureScopeOverhead();
+		});
+	}
+	for(auto& worker : workers) {
+		worker.join();
+	}
+	double worst = 0.0;
+	for(double ns : perThread) {
+		worst = std::max(worst, ns);
+	}
+	std::printf("scope, %lu threads      %6.1f ns worst thread\n", threads, worst);
+	Profiler::EndFrame();
+
+	//a frame of a few thousand scopes, what EndFrame() costs on the frame thread
+	constexpr int scopesPerFrame = 2000;
+	const double endFrame = Bench::Seconds([] {
+		for(int i = 0; i < scopesPerFrame; i++) {
+			PROFILE_SCOPE("Draw");
+		}
+		Profiler::EndFrame();
+	}, 20);
+	std::printf("EndFrame, %d scopes  %6.1f us\n", scopesPerFrame, endFrame * 1e6);
+	std::printf("dropped %zu\n", Profiler::GetDroppedCount());
+	return single <= budgetNs ? 0 : 1;
+}
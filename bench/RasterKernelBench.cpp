@@ -0,0 +1,45 @@
+#include "Bench.h"
+#include "CubeScene.h"
+#include <vector>
+#include <cstring>
+
+//Scan conversion kernels against the scalar reference on one thread.
+//	RasterKernelBench [cubes]
+//Kernels the CPU lacks fall back to the best available one and are reported as such.
+//The exit code is the number of kernels whose color or depth differs from the scalar reference.
+int main(int argc, char** argv) {
+	const unsigned long cubes = Bench::Arg(argc, argv, 1, 5000u);
+	const char* kernelNames[] = { "scalar", "SSE2", "AVX2" };
+	std::vector<std::uint32_t> referenceColor;
+	std::vector<float> referenceDepth;
+	double scalarSeconds = 0.0;
+	int mismatches = 0;
+	for(auto kernel : { SoftwareRasterizer::Kernel::Scalar, SoftwareRasterizer::Kernel::SSE2, SoftwareRasterizer::Kernel::AVX2 }) {
+		SoftwareRasterizer rasterizer;
+		rasterizer.SetKernel(kernel);
+		if(rasterizer.GetKernel() != kernel) {
+			std::printf("%-6s unsupported, falls back to %s\n", kernelNames[int(kernel)], kernelNames[int(rasterizer.GetKernel())]);
+			continue;
+		}
+		const double seconds = Bench::Seconds([&] {
+			rasterizer.ResetStats();
+			CubeScene::Render(rasterizer, cubes);
+		});
+		const std::size_t pixels = rasterizer.GetStats().pixelsWritten;
+		const std::uint32_t* pColor = rasterizer.GetColorBuffer();
+		const float* pDepth = rasterizer.GetDepthBuffer();
+		bool identical = true;
+		if(kernel == SoftwareRasterizer::Kernel::Scalar) {
+			referenceColor.assign(pColor, pColor + 800u * 600u);
+			referenceDepth.assign(pDepth, pDepth + 800u * 600u);
+			scalarSeconds = seconds;
+		} else {
+			identical = std::memcmp(pColor, referenceColor.data(), referenceColor.size() * 4u) == 0
+				&& std::memcmp(pDepth, referenceDepth.data(), referenceDepth.size() * 4u) == 0;
+			mismatches += identical ? 0 : 1;
+		}
+		std::printf("%-6s %8.2f ms %8.2f Mpix/s %5.2fx %s\n", kernelNames[int(kernel)], seconds * 1e3,
+			double(pixels) / seconds * 1e-6, scalarSeconds / seconds, identical ? "identical" : "MISMATCH");
+	}
+	return mismatches;
+}
@@ -0,0 +1,35 @@
+#include "Bench.h"
+#include "CubeScene.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <cstring>
+
+//Triangles per second of the tile binned rasterizer for 1 to N threads, for sizing render nodes.
+//	RasterizerBench [cubes] [max threads]
+//Every thread count renders the same frame of test cubes at 800x600 and must match the single threaded image,
+//the exit code is the number of thread counts that did not.
+int main(int argc, char** argv) {
+	const unsigned long cubes = Bench::Arg(argc, argv, 1, 20000u);
+	const unsigned long maxThreads = Bench::Arg(argc, argv, 2, std::max(4u, std::thread::hardware_concurrency()));
+	const char* kernelNames[] = { "scalar", "SSE2", "AVX2" };
+	std::printf("%lu cubes, %u hardware threads, %s kernel\n", cubes, std::thread::hardware_concurrency(),
+		kernelNames[int(SoftwareRasterizer::GetBestKernel())]);
+
+	SoftwareRasterizer reference;
+	CubeScene::Render(reference, cubes);
+	const std::vector<std::uint32_t> referenceColor(reference.GetColorBuffer(), reference.GetColorBuffer() + 800u * 600u);
+	const std::size_t triangles = std::size_t(cubes) * CubeScene::trianglesPerCube;
+	int mismatches = 0;
+
+	for(unsigned long threads = 1u; threads <= maxThreads; threads++) {
+		SoftwareRasterizer rasterizer;
+		rasterizer.SetThreadCount((unsigned int)threads);
+		const double seconds = Bench::Seconds([&] { CubeScene::Render(rasterizer, cubes); }, 3);
+		const bool identical = std::memcmp(rasterizer.GetColorBuffer(), referenceColor.data(), referenceColor.size() * 4u) == 0;
+		mismatches += identical ? 0 : 1;
+		std::printf("threads %2lu: %8.2f ms %8.2f Mtri/s %s\n", threads, seconds * 1e3,
+			double(triangles) / seconds * 1e-6, identical ? "identical" : "MISMATCH");
+	}
+	return mismatches;
+}
@@ -0,0 +1,63 @@
+#include "Bench.h"
+#include "TransformBatch.h"
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+//Batched transform stage against the per-object matrix chain it replaced.
+//	TransformBench [objects]
+//The per-object path is what DrawTestTriangle did for every cube: build and multiply four matrices
+//(the projection included) and transpose, one object at a time.
+//Returns non-zero when the batched output drifts from the scalar path or the per-object chain.
+int main(int argc, char** argv) {
+	const std::size_t count = Bench::Arg(argc, argv, 1, 10000u);
+	std::vector<float> angles(count), xs(count), ys(count), zs(count);
+	std::mt19937 rng(1u);
+	std::uniform_real_distribution<float> dist(-20.0f, 20.0f);
+	for(std::size_t i = 0u; i < count; i++) {
+		angles[i] = dist(rng);
+		xs[i] = dist(rng);
+		ys[i] = dist(rng);
+		zs[i] = dist(rng);
+	}
+	const TransformBatch::Input input = { angles.data(), xs.data(), ys.data(), zs.data(), count };
+	const rmath::Mat4 viewProj = rmath::PerspectiveLH(1.0f, 0.75f, 0.5f, 10.0f);
+	std::vector<rmath::Mat4> perObject(count), scalar(count), batched(count);
+
+	const double perObjectSeconds = Bench::Seconds([&] {
+		for(std::size_t i = 0u; i < count; i++) {
+			perObject[i] = rmath::Transpose(rmath::RotationZ(angles[i]) * rmath::RotationX(angles[i])
+				* rmath::Translation(xs[i], ys[i], zs[i]) * rmath::PerspectiveLH(1.0f, 0.75f, 0.5f, 10.0f));
+		}
+		Bench::Consume(perObject.back());
+	});
+	const double scalarSeconds = Bench::Seconds([&] {
+		TransformBatch::BuildScalar(input, viewProj, scalar.data(), sizeof(rmath::Mat4));
+		Bench::Consume(scalar.back());
+	});
+	const double batchedSeconds = Bench::Seconds([&] {
+		TransformBatch::Build(input, viewProj, batched.data(), sizeof(rmath::Mat4));
+		Bench::Consume(batched.back());
+	});
+
+	//relative difference to the per-object chain, sin/cos are approximated differently
+	float maxError = 0.0f;
+	float maxScalarError = 0.0f;
+	for(std::size_t i = 0u; i < count; i++) {
+		for(int r = 0; r < 4; r++) {
+			for(int c = 0; c < 4; c++) {
+				const float expected = perObject[i].m[r][c];
+				maxError = std::max(maxError, std::abs(batched[i].m[r][c] - expected) / (1.0f + std::abs(expected)));
+				const float reference = scalar[i].m[r][c];
+				maxScalarError = std::max(maxScalarError, std::abs(batched[i].m[r][c] - reference) / (1.0f + std::abs(reference)));
+			}
+		}
+	}
+	std::printf("%zu objects\n", count);
+	std::printf("per object %8.3f ms %7.2f ns/object\n", perObjectSeconds * 1e3, perObjectSeconds / double(count) * 1e9);
+	std::printf("scalar     %8.3f ms %7.2f ns/object %5.2fx\n", scalarSeconds * 1e3, scalarSeconds / double(count) * 1e9, perObjectSeconds / scalarSeconds);
+	std::printf("batched    %8.3f ms %7.2f ns/object %5.2fx\n", batchedSeconds * 1e3, batchedSeconds / double(count) * 1e9, perObjectSeconds / batchedSeconds);
+	std::printf("max relative difference to per object %g, to scalar %g\n", maxError, maxScalarError);
+	return maxError <= 1e-4f && maxScalarError <= 1e-5f ? 0 : 1;
+}
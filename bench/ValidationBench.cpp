@@ -0,0 +1,224 @@
+#include "Bench.h"
+#include "InfoDrain.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <exception>
+#include <cstring>
+
+//CPU cost of GraphicsThrowMacros.h per draw at every validation tier, against a mock device context.
+//	ValidationBenchOff|Light|Full [draws per frame] [frames]
+//Each executable compiles the macros at one GFX_VALIDATION level and runs every tier up to it, the way Graphics
+//clamps the tier it is asked for. FULL runs once per InfoDrain granularity, then checks that a warning the mock
+//context emits surfaces as an exception at the check point the granularity picks.
+//Graphics and DxgiInfoManager are stand ins with the members the macros use.
+typedef long HRESULT;
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+namespace {
+	//stands in for IDXGIInfoQueue
+	class FakeQueue : public InfoDrain::Source {
+	public:
+		std::uint64_t GetStoredCount() override {
+			return stored.size();
+		}
+		Message GetMessage(std::uint64_t index) override {
+			const auto& text = stored[std::size_t(index)];
+			return { 356, InfoDrain::Severity::Warning, text.c_str(), text.size() };
+		}
+		void Clear() override {
+			stored.clear();
+		}
+	public:
+		std::vector<std::string> stored;
+	};
+
+	class DxgiInfoManager {
+	public:
+		bool Check(InfoDrain::Granularity point) {
+			return drain.Check(point);
+		}
+		std::vector<std::string> GetMessages() {
+			return drain.TakeMessages();
+		}
+	public:
+		FakeQueue queue;
+		InfoDrain drain{ queue };
+	};
+
+	struct Graphics {
+		enum class Validation {
+			Off,
+			Light,
+			Full
+		};
+		class HrException : public std::exception {
+		public:
+			HrException(int, const char*, HRESULT, std::vector<std::string> messages = {})
+				: messages(std::move(messages))
+			{}
+			std::vector<std::string> messages;
+		};
+		class InfoException : public HrException {
+		public:
+			InfoException(int line, const char* file, std::vector<std::string> messages)
+				: HrException(line, file, 0, std::move(messages))
+			{}
+		};
+		class DeviceRemovedException : public HrException {
+		public:
+			using HrException::HrException;
+		};
+	};
+}
+
+#include "GraphicsThrowMacros.h"
+
+namespace {
+	//every call virtual, like COM
+	class Context {
+	public:
+		virtual ~Context() = default;
+		virtual void SetShader(int shader) = 0;
+		virtual void SetBuffer(int buffer) = 0;
+		virtual HRESULT Map(void** ppData) = 0;
+		virtual void Draw(int indexCount) = 0;
+	};
+
+	class MockContext : public Context {
+	public:
+		void SetShader(int shader) override {
+			sink = shader;
+		}
+		void SetBuffer(int buffer) override {
+			sink = buffer;
+		}
+		HRESULT Map(void** ppData) override {
+			*ppData = mapped;
+			return 0;
+		}
+		//every warnEvery-th draw leaves a warning in the queue, like a debug layer complaint
+		void Draw(int indexCount) override {
+			sink = indexCount;
+			if(pQueue && warnEvery > 0 && ++draws % warnEvery == 0) {
+				pQueue->stored.push_back("D3D11 WARNING: ID3D11DeviceContext::DrawIndexed: vertex buffer slot 1 too small");
+			}
+		}
+	public:
+		FakeQueue* pQueue = nullptr;
+		int warnEvery = 0;
+	private:
+		int draws = 0;
+		char mapped[64] = {};
+		volatile int sink = 0;
+	};
+
+	//the calls of one Graphics draw, checked like Graphics.cpp checks them
+	class Renderer {
+	public:
+		Renderer(Graphics::Validation validation, InfoDrain::Granularity granularity)
+			: pContext(&context), validation(validation)
+		{
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+			if(validation == Graphics::Validation::Full) {
+				pInfoManager = std::make_unique<DxgiInfoManager>();
+				pInfoManager->drain.SetGranularity(granularity);
+				context.pQueue = &pInfoManager->queue;
+			}
+#else
+			(void)granularity;
+#endif
+		}
+		void Draw(int i) {
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+			DxgiInfoManager* const pInfoManager = this->pInfoManager.get();
+#endif
+			HRESULT hr;
+			GFX_THROW_INFO_ONLY(pContext->SetShader(i & 3));
+			GFX_THROW_INFO_ONLY(pContext->SetShader(i & 1));
+			GFX_THROW_INFO_ONLY(pContext->SetBuffer(i & 7));
+			GFX_THROW_INFO_ONLY(pContext->SetBuffer(i & 5));
+			void* pData;
+			GFX_THROW_INFO(pContext->Map(&pData));
+			std::memcpy(pData, &i, sizeof(i));
+			//single statements at every tier, an unbraced if/else compiles
+			if(i & 1)
+				GFX_THROW_INFO_AT(Draw, pContext->Draw(36));
+			else
+				GFX_THROW_INFO_AT(Draw, pContext->Draw(36));
+		}
+		void EndFrame() {
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+			DxgiInfoManager* const pInfoManager = this->pInfoManager.get();
+#endif
+			HRESULT hr = 0;
+			GFX_CHECK_INFO(Frame);
+#if GFX_VALIDATION >= GFX_VALIDATION_LIGHT
+			//stands in for GetDeviceRemovedReason()
+			if(validation >= Graphics::Validation::Light && FAILED(hr = removedReason)) {
+				throw GFX_DEVICE_REMOVED_EXCEPT(hr);
+			}
+#endif
+			(void)hr;
+		}
+	public:
+		MockContext context;
+	private:
+		Context* pContext; //calls go through the base like they do through ID3D11DeviceContext
+		Graphics::Validation validation;
+		volatile HRESULT removedReason = 0;
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+		std::unique_ptr<DxgiInfoManager> pInfoManager;
+#endif
+	};
+}
+
+int main(int argc, char** argv) {
+	const int draws = (int)Bench::Arg(argc, argv, 1, 10000u);
+	const int frames = (int)Bench::Arg(argc, argv, 2, 100u);
+	const char* tierNames[] = { "off", "light", "full" };
+	const char* granularityNames[] = { "per call", "per draw", "per frame" };
+	std::printf("compiled at %s, %d draws of 7 calls per frame\n", tierNames[GFX_VALIDATION], draws);
+	for(int tier = 0; tier <= GFX_VALIDATION; tier++) {
+		const int granularities = tier == GFX_VALIDATION_FULL ? 3 : 1;
+		for(int g = 0; g < granularities; g++) {
+			Renderer renderer{ Graphics::Validation(tier), InfoDrain::Granularity(g) };
+			const double seconds = Bench::Seconds([&] {
+				for(int frame = 0; frame < frames; frame++) {
+					for(int i = 0; i < draws; i++) {
+						renderer.Draw(i);
+					}
+					renderer.EndFrame();
+				}
+			}, 3);
+			std::printf("%-5s %-9s: %6.2f ns per draw\n", tierNames[tier], tier == GFX_VALIDATION_FULL ? granularityNames[g] : "",
+				seconds * 1e9 / (double(frames) * double(draws)));
+		}
+	}
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+	//a warning on the third draw surfaces after it at per call and per draw checks, at the end of the frame otherwise
+	const int expected[] = { 2, 2, 10 };
+	int wrong = 0;
+	for(int g = 0; g < 3; g++) {
+		Renderer renderer(Graphics::Validation::Full, InfoDrain::Granularity(g));
+		renderer.context.warnEvery = 3;
+		int drawn = 0;
+		try {
+			for(int i = 0; i < 10; i++) {
+				renderer.Draw(i);
+				drawn++;
+			}
+			renderer.EndFrame();
+		} catch(const Graphics::InfoException& e) {
+			std::printf("%-9s: thrown after %d draws: %s\n", granularityNames[g], drawn, e.messages.empty() ? "" : e.messages[0].c_str());
+			wrong += drawn == expected[g] ? 0 : 1;
+			continue;
+		}
+		std::printf("%-9s: not thrown\n", granularityNames[g]);
+		wrong++;
+	}
+	return wrong;
+#else
+	return 0;
+#endif
+}
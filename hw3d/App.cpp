@@ -1,10 +1,37 @@
 #include "App.h"
-#include <sstream>
-#include <iomanip>
+#include "TestCube.h"
+#include "TransformBatch.h"
+#include "Profiler.h"
+#include <iterator>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cstdio>
 //using namespace std;
 
-App::App() 
-	: wnd(800, 600, "Lack of a better name") {
+namespace {
+	const Simulation::Position cubePositions[] = {
+		{ 0.0f, 0.0f, 7.0f },
+		{ 1.0f, 1.0f, 4.0f },
+	};
+	//most cubes one transform job builds, smaller scenes stay on the calling thread
+	constexpr std::size_t transformGrain = 1024u;
+	//nearest cubes rasterized as occluders every frame
+	constexpr std::size_t maxOccluders = 16u;
+}
+
+App::App(Graphics::Validation validation) 
+	: wnd(800, 600, "Lack of a better name", validation),
+	viewProj(rmath::PerspectiveLH(TestCube::projWidth, TestCube::projHeight, TestCube::nearZ, TestCube::farZ)),
+	frustum(FrustumCull::ExtractFrustum(viewProj)),
+	sim(cubePositions, std::size(cubePositions))
+{
+	//the test cube spans -1..1 on every axis, sqrt(3) encloses it at any rotation
+	cubeRadius.assign(std::size(cubePositions), 1.7320508f);
+	cubes.resize(std::size(cubePositions));
+	for(auto& cube : cubes) {
+		cube.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+	}
 }
 
 int App::Go() {
@@ -18,14 +45,123 @@ int App::Go() {
 }
 
 void App::DoFrame(){
-	const float c = sin(timer.Peek()) / 2.0f + 0.5f;
-	wnd.Gfx().ClearBuffer(c, c, 1.0f);
-	wnd.Gfx().DrawTestTriangle(timer.Peek(), 0.0f, 0.0f, 7.0f);
-	wnd.Gfx().DrawTestTriangle(timer.Peek(), 1.0f, 1.0f, 4.0f);
-	wnd.Gfx().EndFrame();
+	//newest simulation snapshot, blended to this instant so motion stays smooth whatever the tick rate
+	sim.Interpolate(sim.Acquire(), Timer::Ticks(), scene);
+	const float t = scene.time;
+	const float c = sin(t) / 2.0f + 0.5f;
+	{
+		PROFILE_SCOPE("ClearBuffer");
+		wnd.Gfx().ClearBuffer(c, c, 1.0f);
+	}
+
+	std::size_t visibleCount;
+	{
+		PROFILE_SCOPE("FrustumCull");
+		const FrustumCull::Spheres bounds = { scene.x.data(), scene.y.data(), scene.z.data(), cubeRadius.data(), scene.x.size() };
+		visible.resize(bounds.count);
+		visibleCount = FrustumCull::CullParallel(jobs, frustum, bounds, visible.data(), FrustumCull::defaultChunkSize, &wnd.Gfx().GetFrameArena());
+		//gather the survivors so only cubes that get drawn are transformed
+		drawn.angle.resize(visibleCount);
+		drawn.x.resize(visibleCount);
+		drawn.y.resize(visibleCount);
+		drawn.z.resize(visibleCount);
+		drawnRadius.resize(visibleCount);
+		for(std::size_t i = 0u; i < visibleCount; i++) {
+			const std::uint32_t j = visible[i];
+			drawn.angle[i] = scene.angle[j];
+			drawn.x[i] = scene.x[j];
+			drawn.y[i] = scene.y[j];
+			drawn.z[i] = scene.z[j];
+			drawnRadius[i] = cubeRadius[j];
+		}
+	}
+	{
+		PROFILE_SCOPE("TransformBatch");
+		//build every transform straight into the instance array, big scenes fan out over the job system
+		jobs.ParallelFor(visibleCount, transformGrain, [&](std::size_t begin, std::size_t end) {
+			const TransformBatch::Input batch = { &drawn.angle[begin], &drawn.x[begin], &drawn.y[begin], &drawn.z[begin], end - begin };
+			TransformBatch::Build(batch, viewProj, &cubes[begin].transform, sizeof(Graphics::CubeInstance));
+		});
+	}
+	{
+		PROFILE_SCOPE("OcclusionCull");
+		//the nearest cubes double as occluders, their instance transforms are already what the rasterizer takes.
+		//A cube never hides itself, its bounds reach nearer than its faces.
+		occlusion.BeginFrame(viewProj);
+		occluders.resize(visibleCount);
+		for(std::size_t i = 0u; i < visibleCount; i++) {
+			occluders[i] = std::uint32_t(i);
+		}
+		const std::size_t occluderCount = std::min(visibleCount, maxOccluders);
+		std::partial_sort(occluders.begin(), occluders.begin() + occluderCount, occluders.end(), [&](std::uint32_t a, std::uint32_t b) {
+			return drawn.z[a] < drawn.z[b];
+		});
+		for(std::size_t i = 0u; i < occluderCount; i++) {
+			rmath::Mat4 transform;
+			std::memcpy(&transform, &cubes[occluders[i]].transform, sizeof(transform));
+			occlusion.AddOccluder(TestCube::vertices, sizeof(TestCube::Vertex), std::size(TestCube::vertices),
+				TestCube::indices, std::size(TestCube::indices), transform);
+		}
+		const FrustumCull::Spheres bounds = { drawn.x.data(), drawn.y.data(), drawn.z.data(), drawnRadius.data(), visibleCount };
+		visibleCount = occlusion.Cull(bounds, visible.data());
+		//survivors are ascending, so compacting in place never overwrites one still to be moved
+		for(std::size_t i = 0u; i < visibleCount; i++) {
+			cubes[i] = cubes[visible[i]];
+		}
+	}
+	{
+		PROFILE_SCOPE("SelectLods");
+		//coarsest lod whose error stays under a pixel; there is no view matrix, so z is the view depth
+		//and the nearest point of a cube's bounds is z - radius
+		const auto& lods = wnd.Gfx().GetTestCubeLods();
+		const float lodScale = MeshFile::GetLodScale(TestCube::projHeight, TestCube::nearZ, float(wnd.Gfx().GetHeight()));
+		cubeLods.resize(visibleCount);
+		lodStarts.assign(lods.size() + 1u, 0u);
+		for(std::size_t i = 0u; i < visibleCount; i++) {
+			const std::uint32_t j = visible[i];
+			cubeLods[i] = std::uint32_t(MeshFile::SelectLod(lods.data(), lods.size(), drawn.z[j] - drawnRadius[j], lodScale));
+			lodStarts[cubeLods[i] + 1u]++;
+		}
+		//counting sort by lod
+		std::partial_sum(lodStarts.begin(), lodStarts.end(), lodStarts.begin());
+		byLod.resize(visibleCount);
+		for(std::size_t i = 0u; i < visibleCount; i++) {
+			byLod[lodStarts[cubeLods[i]]++] = cubes[i];
+		}
+		//the scatter moved every start to the next group's
+		std::rotate(lodStarts.rbegin(), lodStarts.rbegin() + 1, lodStarts.rend());
+		lodStarts[0] = 0u;
+	}
+	{
+		PROFILE_SCOPE("DrawTestCubesInstanced");
+		//one instanced draw per lod that has cubes
+		const auto& lods = wnd.Gfx().GetTestCubeLods();
+		trianglesDrawn = 0u;
+		for(std::size_t lod = 0u; lod < lods.size(); lod++) {
+			const std::size_t count = lodStarts[lod + 1u] - lodStarts[lod];
+			wnd.Gfx().DrawTestCubesInstanced(byLod.data() + lodStarts[lod], count, lod);
+			trianglesDrawn += count * (lods[lod].indexCount / 3u);
+		}
+	}
+	{
+		PROFILE_SCOPE("EndFrame");
+		wnd.Gfx().EndFrame();
+	}
+	Profiler::EndFrame();
 
-	/*const float t = timer.Peek();
-	ostringstream oss;
-	oss << "Time elapsed: " << setprecision(1) << fixed << t << "s";
-	wnd.SetTitle(oss.str());*/
+	//frame time readout, refreshed twice a second so SetTitle stays out of the numbers.
+	//Formatted on the stack and the stats are polled into a kept vector, steady state frames stay off the heap.
+	if(statsTimer.Peek() >= 0.5f) {
+		statsTimer.Mark();
+		Profiler::GetStats(frameStats);
+		for(const auto& s : frameStats) {
+			if(std::strcmp(s.name, "Frame") == 0) {
+				const auto& o = occlusion.GetStats();
+				char title[256];
+				std::snprintf(title, sizeof(title), "Frame %.2fms avg, %.2fms min, %.2fms p99, occluded %zu/%zu in %.2fms, %zu triangles",
+					s.avgMs, s.minMs, s.p99Ms, o.occluded, o.tested, o.rasterizeMs + o.pyramidMs + o.testMs, trianglesDrawn);
+				wnd.SetTitle(title);
+			}
+		}
+	}
 }
\ No newline at end of file
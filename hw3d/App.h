@@ -1,16 +1,40 @@
 #pragma once
 #include "Window.h"
 #include "Timer.h"
+#include "RasterMath.h"
+#include "Simulation.h"
+#include "JobSystem.h"
+#include "FrustumCull.h"
+#include "OcclusionCuller.h"
+#include "Profiler.h"
 #include <sstream>
+#include <vector>
 //using namespace std;
 
 class App {
 public:
-	App(); //creates window
+	App(Graphics::Validation validation = Graphics::maxValidation); //creates window
 	//Master frame/message loop
 	int Go(); //called when app starts to start game loop
 private:
 	void DoFrame();
 	Window wnd;
-	Timer timer;
+	JobSystem jobs; //the thread running App is worker 0
+	Timer statsTimer;
+	rmath::Mat4 viewProj;
+	FrustumCull::Frustum frustum; //planes of viewProj
+	OcclusionCuller occlusion;
+	Simulation sim; //animates the scene on its own thread at a fixed rate
+	Simulation::SceneState scene; //interpolated for this frame, structure of arrays
+	std::vector<float> cubeRadius; //bounding sphere per cube, centered on its position
+	std::vector<std::uint32_t> visible; //indices of the cubes that survived culling this frame
+	Simulation::SceneState drawn; //the survivors gathered, what the transform batch sees
+	std::vector<float> drawnRadius;
+	std::vector<std::uint32_t> occluders; //indices into drawn, nearest first
+	std::vector<Graphics::CubeInstance> cubes; //upload-ready instance data, rebuilt every frame
+	std::vector<std::uint32_t> cubeLods; //lod picked for every surviving cube
+	std::vector<std::size_t> lodStarts; //where each lod's cubes begin in byLod
+	std::vector<Graphics::CubeInstance> byLod; //cubes grouped by lod, one instanced draw per group
+	std::size_t trianglesDrawn = 0u; //last frame
+	std::vector<Profiler::ScopeStats> frameStats; //title readout
 };
\ No newline at end of file
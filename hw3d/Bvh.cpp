@@ -0,0 +1,702 @@
+#include "Bvh.h"
+#include "JobSystem.h"
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace {
+	constexpr float inf = std::numeric_limits<float>::infinity();
+	constexpr std::uint32_t taskThreshold = 4096u; //subtrees with more objects are built / refit as their own job
+	constexpr std::uint32_t parallelThreshold = 65536u; //nodes with more objects bin in parallel
+	constexpr std::uint32_t chunkSize = 16384u;
+	constexpr int stackSize = int(Bvh::maxDepth) + 40; //median splits below maxDepth add at most 32 levels
+
+	Bvh::Aabb EmptyBox() noexcept {
+		return { { inf, inf, inf }, { -inf, -inf, -inf } };
+	}
+	//on values: std::min/max of references into memory tends to compile to a compare and branch,
+	//which mispredicts all the time on the random boxes binning sees
+	inline float Min(float a, float b) noexcept {
+		return b < a ? b : a;
+	}
+	inline float Max(float a, float b) noexcept {
+		return a < b ? b : a;
+	}
+	inline void Grow(Bvh::Aabb& a, const Bvh::Aabb& b) noexcept {
+		a.min = { Min(a.min.x, b.min.x), Min(a.min.y, b.min.y), Min(a.min.z, b.min.z) };
+		a.max = { Max(a.max.x, b.max.x), Max(a.max.y, b.max.y), Max(a.max.z, b.max.z) };
+	}
+	inline void Grow(Bvh::Aabb& a, const rmath::Float3& p) noexcept {
+		a.min = { Min(a.min.x, p.x), Min(a.min.y, p.y), Min(a.min.z, p.z) };
+		a.max = { Max(a.max.x, p.x), Max(a.max.y, p.y), Max(a.max.z, p.z) };
+	}
+	//half the surface area, the SAH only compares ratios
+	inline float HalfArea(const Bvh::Aabb& a) noexcept {
+		const float dx = a.max.x - a.min.x;
+		const float dy = a.max.y - a.min.y;
+		const float dz = a.max.z - a.min.z;
+		if(dx < 0.0f || dy < 0.0f || dz < 0.0f) {
+			return 0.0f;
+		}
+		return dx * dy + dy * dz + dz * dx;
+	}
+	float Get(const rmath::Float3& v, int axis) noexcept {
+		return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+	}
+	//binning and partitioning both go through here so they agree on every object
+	std::uint32_t BinIndex(float c, float origin, float scale, std::uint32_t binsUsed) noexcept {
+		const int bin = static_cast<int>((c - origin) * scale);
+		return static_cast<std::uint32_t>(std::clamp(bin, 0, int(binsUsed) - 1));
+	}
+
+	enum class Overlap {
+		outside,
+		partial,
+		inside,
+	};
+	//same plane test as FrustumCull's boxes, plus whether the box is inside every plane
+	Overlap Classify(const FrustumCull::Frustum& f, float minX, float minY, float minZ, float maxX, float maxY, float maxZ) noexcept {
+		const float cx = (minX + maxX) * 0.5f;
+		const float cy = (minY + maxY) * 0.5f;
+		const float cz = (minZ + maxZ) * 0.5f;
+		const float ex = (maxX - minX) * 0.5f;
+		const float ey = (maxY - minY) * 0.5f;
+		const float ez = (maxZ - minZ) * 0.5f;
+		Overlap result = Overlap::inside;
+		for(const auto& p : f.planes) {
+			const float r = std::fabs(p.a) * ex + std::fabs(p.b) * ey + std::fabs(p.c) * ez;
+			const float d = p.a * cx + p.b * cy + p.c * cz + p.d;
+			if(d + r < 0.0f) {
+				return Overlap::outside;
+			}
+			if(d - r < 0.0f) {
+				result = Overlap::partial;
+			}
+		}
+		return result;
+	}
+	Overlap Classify(const FrustumCull::Frustum& f, const Bvh::Aabb& a) noexcept {
+		return Classify(f, a.min.x, a.min.y, a.min.z, a.max.x, a.max.y, a.max.z);
+	}
+
+	//slab test, tEnter is clamped to 0 so a ray starting inside enters at 0
+	struct RaySetup {
+		rmath::Float3 origin;
+		rmath::Float3 inverse;
+	};
+	bool Enter(const RaySetup& r, float minX, float minY, float minZ, float maxX, float maxY, float maxZ, float tLimit, float& tEnter) noexcept {
+		const float tx0 = (minX - r.origin.x) * r.inverse.x;
+		const float tx1 = (maxX - r.origin.x) * r.inverse.x;
+		const float ty0 = (minY - r.origin.y) * r.inverse.y;
+		const float ty1 = (maxY - r.origin.y) * r.inverse.y;
+		const float tz0 = (minZ - r.origin.z) * r.inverse.z;
+		const float tz1 = (maxZ - r.origin.z) * r.inverse.z;
+		const float tNear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.0f));
+		const float tFar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), tLimit));
+		tEnter = tNear;
+		return tNear <= tFar;
+	}
+	//a huge finite inverse instead of inf for axis parallel rays, 0 * inf would be NaN for an origin on a slab
+	float SafeInverse(float d) noexcept {
+		return 1.0f / (d != 0.0f ? d : 1e-30f);
+	}
+}
+
+//Builder
+struct Bvh::Builder {
+	struct Bin {
+		Aabb box;
+		std::uint32_t count;
+	};
+	struct Bins {
+		Bin bins[3][binCount];
+	};
+	struct Split {
+		bool valid;
+		int axis;
+		float origin; //BinIndex() parameters of axis
+		float scale;
+		std::uint32_t binsUsed;
+		std::uint32_t bin; //last bin on the left
+		bool sorted; //small nodes: sorted along axis and cut after leftCount instead of binned
+		float cost; //SAH relative to intersecting every object of the node
+		std::uint32_t leftCount;
+		Aabb left;
+		Aabb right;
+	};
+	//objects are moved around with their box and centroid so binning and partitioning stream through memory
+	struct Item {
+		Aabb box;
+		rmath::Float3 centroid;
+		std::uint32_t primitive;
+	};
+	Bvh& bvh;
+	JobSystem* pJobs;
+	std::vector<Item> items;
+
+	//f(begin, end, result) over [begin, end) accumulating into result; big ranges are split into chunks
+	//run as jobs, each starting from a copy of result, merged in order
+	template<typename T, typename F, typename M>
+	void Reduce(std::uint32_t begin, std::uint32_t end, T& result, const F& f, const M& merge) {
+		if(!pJobs || end - begin < parallelThreshold) {
+			f(begin, end, result);
+			return;
+		}
+		const std::size_t chunks = (std::size_t(end - begin) + chunkSize - 1u) / chunkSize;
+		std::vector<T> partial(chunks, result);
+		pJobs->ParallelFor(chunks, 1u, [&](std::size_t first, std::size_t last) {
+			for(std::size_t c = first; c < last; c++) {
+				const std::uint32_t b = begin + std::uint32_t(c) * chunkSize;
+				f(b, std::min(end, b + chunkSize), partial[c]);
+			}
+		});
+		for(const T& p : partial) {
+			merge(result, p);
+		}
+	}
+	Aabb CentroidBounds(std::uint32_t begin, std::uint32_t end) {
+		Aabb result = EmptyBox();
+		Reduce(begin, end, result, [&](std::uint32_t b, std::uint32_t e, Aabb& box) {
+			for(std::uint32_t i = b; i < e; i++) {
+				Grow(box, items[i].centroid);
+			}
+		}, [](Aabb& a, const Aabb& b) { Grow(a, b); });
+		return result;
+	}
+	Split FindSplit(std::uint32_t begin, std::uint32_t end, const Aabb& box) {
+		if(end - begin <= maxLeafSize) {
+			return SmallSplit(begin, end, box);
+		}
+		Split best = {};
+		best.cost = inf;
+		//smaller nodes get a bin per object, the sweep costs as much as binning there
+		const std::uint32_t binsUsed = std::min(binCount, end - begin);
+		const Aabb cb = CentroidBounds(begin, end);
+		float origin[3];
+		float scale[3];
+		bool splittable = false;
+		for(int a = 0; a < 3; a++) {
+			const float extent = Get(cb.max, a) - Get(cb.min, a);
+			origin[a] = Get(cb.min, a);
+			scale[a] = extent > 0.0f ? float(binsUsed) / extent : 0.0f;
+			splittable |= extent > 0.0f;
+		}
+		//every centroid in one spot, no plane separates them
+		if(!splittable) {
+			return best;
+		}
+		Bins bins;
+		for(auto& axis : bins.bins) {
+			for(std::uint32_t i = 0u; i < binsUsed; i++) {
+				axis[i] = { EmptyBox(), 0u };
+			}
+		}
+		Reduce(begin, end, bins, [&](std::uint32_t b, std::uint32_t e, Bins& out) {
+			for(std::uint32_t i = b; i < e; i++) {
+				const Item& item = items[i];
+				for(int a = 0; a < 3; a++) {
+					Bin& bin = out.bins[a][BinIndex(Get(item.centroid, a), origin[a], scale[a], binsUsed)];
+					Grow(bin.box, item.box);
+					bin.count++;
+				}
+			}
+		}, [binsUsed](Bins& a, const Bins& b) {
+			for(int axis = 0; axis < 3; axis++) {
+				for(std::uint32_t i = 0u; i < binsUsed; i++) {
+					Grow(a.bins[axis][i].box, b.bins[axis][i].box);
+					a.bins[axis][i].count += b.bins[axis][i].count;
+				}
+			}
+		});
+		//sweep: area left of every plane, then right to left evaluating the SAH; only the winner's boxes are built
+		for(int a = 0; a < 3; a++) {
+			if(scale[a] == 0.0f) {
+				continue;
+			}
+			const Bin* pBins = bins.bins[a];
+			float leftArea[binCount];
+			std::uint32_t leftCount[binCount];
+			Aabb acc = EmptyBox();
+			std::uint32_t n = 0u;
+			for(std::uint32_t i = 0u; i < binsUsed - 1u; i++) {
+				Grow(acc, pBins[i].box);
+				n += pBins[i].count;
+				leftArea[i] = HalfArea(acc);
+				leftCount[i] = n;
+			}
+			acc = EmptyBox();
+			n = 0u;
+			for(std::uint32_t i = binsUsed - 1u; i > 0u; i--) {
+				Grow(acc, pBins[i].box);
+				n += pBins[i].count;
+				if(n == 0u || leftCount[i - 1u] == 0u) {
+					continue;
+				}
+				const float cost = leftArea[i - 1u] * float(leftCount[i - 1u]) + HalfArea(acc) * float(n);
+				if(cost < best.cost) {
+					best.valid = true;
+					best.axis = a;
+					best.bin = i - 1u;
+					best.cost = cost;
+					best.leftCount = leftCount[i - 1u];
+				}
+			}
+		}
+		best.origin = origin[best.axis];
+		best.scale = scale[best.axis];
+		best.binsUsed = binsUsed;
+		best.left = EmptyBox();
+		best.right = EmptyBox();
+		for(std::uint32_t i = 0u; i < binsUsed; i++) {
+			Grow(i <= best.bin ? best.left : best.right, bins.bins[best.axis][i].box);
+		}
+		//one traversal step plus the expected objects tested
+		const float area = HalfArea(box);
+		best.cost = area > 0.0f ? 1.0f + best.cost / area : 1.0f;
+		return best;
+	}
+	//nodes that could be a leaf, most of the calls: every cut of the objects sorted along each axis
+	//is evaluated exactly, cheaper than setting up bins for a handful of objects
+	Split SmallSplit(std::uint32_t begin, std::uint32_t end, const Aabb& box) {
+		const std::uint32_t n = end - begin;
+		Split best = {};
+		best.cost = inf;
+		Item sorted[maxLeafSize];
+		for(int a = 0; a < 3; a++) {
+			SortSmall(sorted, begin, end, a);
+			float rightArea[maxLeafSize];
+			Aabb acc = EmptyBox();
+			for(std::uint32_t i = n - 1u; i > 0u; i--) {
+				Grow(acc, sorted[i].box);
+				rightArea[i] = HalfArea(acc);
+			}
+			acc = EmptyBox();
+			for(std::uint32_t i = 0u; i + 1u < n; i++) {
+				Grow(acc, sorted[i].box);
+				const float cost = HalfArea(acc) * float(i + 1u) + rightArea[i + 1u] * float(n - i - 1u);
+				if(cost < best.cost) {
+					best.valid = true;
+					best.sorted = true;
+					best.axis = a;
+					best.cost = cost;
+					best.leftCount = i + 1u;
+				}
+			}
+		}
+		if(!best.valid) {
+			return best;
+		}
+		SortSmall(sorted, begin, end, best.axis);
+		best.left = EmptyBox();
+		best.right = EmptyBox();
+		for(std::uint32_t i = 0u; i < n; i++) {
+			Grow(i < best.leftCount ? best.left : best.right, sorted[i].box);
+		}
+		const float area = HalfArea(box);
+		best.cost = area > 0.0f ? 1.0f + best.cost / area : 1.0f;
+		return best;
+	}
+	//copy of a small range sorted along axis, in the order BuildNode() leaves it after sorting the range itself
+	void SortSmall(Item* pOut, std::uint32_t begin, std::uint32_t end, int axis) const {
+		std::copy(items.begin() + begin, items.begin() + end, pOut);
+		InsertionSort(pOut, end - begin, axis);
+	}
+	//stable, and for at most maxLeafSize objects cheaper than std::sort (which also trips -Warray-bounds on
+	//the fixed size arrays SmallSplit() sorts, its unrolled paths assume at least 16 elements)
+	static void InsertionSort(Item* pItems, std::uint32_t n, int axis) noexcept {
+		for(std::uint32_t i = 1u; i < n; i++) {
+			const Item item = pItems[i];
+			const float key = Get(item.centroid, axis);
+			std::uint32_t j = i;
+			for(; j > 0u && key < Get(pItems[j - 1u].centroid, axis); j--) {
+				pItems[j] = pItems[j - 1u];
+			}
+			pItems[j] = item;
+		}
+	}
+	//half the objects on each side along the widest centroid axis, for splits the bins cannot make and too deep trees
+	Split MedianSplit(std::uint32_t begin, std::uint32_t end) {
+		const Aabb cb = CentroidBounds(begin, end);
+		const float dx = cb.max.x - cb.min.x;
+		const float dy = cb.max.y - cb.min.y;
+		const float dz = cb.max.z - cb.min.z;
+		const int axis = (dx >= dy && dx >= dz) ? 0 : (dy >= dz ? 1 : 2);
+		Item* pItems = items.data();
+		const std::uint32_t mid = begin + (end - begin) / 2u;
+		std::nth_element(pItems + begin, pItems + mid, pItems + end, [&](const Item& l, const Item& r) {
+			return Get(l.centroid, axis) < Get(r.centroid, axis);
+		});
+		Split s = {};
+		s.valid = true;
+		s.leftCount = mid - begin;
+		s.left = EmptyBox();
+		s.right = EmptyBox();
+		for(std::uint32_t i = begin; i < mid; i++) {
+			Grow(s.left, pItems[i].box);
+		}
+		for(std::uint32_t i = mid; i < end; i++) {
+			Grow(s.right, pItems[i].box);
+		}
+		return s;
+	}
+	//a few objects are kept as a leaf unless splitting them is expected to be cheaper
+	bool WorthSplitting(std::uint32_t begin, std::uint32_t end, const Aabb& box) {
+		const std::uint32_t n = end - begin;
+		if(n <= 1u) {
+			return false;
+		}
+		if(n > maxLeafSize) {
+			return true;
+		}
+		const Split s = FindSplit(begin, end, box);
+		return s.valid && s.cost < float(n);
+	}
+	void MarkUnused(std::uint32_t first, std::uint32_t last) noexcept {
+		for(std::uint32_t i = first; i < last; i++) {
+			bvh.pNodes[i].count[0] = 0u;
+			bvh.pNodes[i].count[1] = 0u;
+		}
+	}
+	//node index covers [begin, end) (at least two objects) inside box, writes it and everything below it
+	void BuildNode(std::uint32_t index, std::uint32_t begin, std::uint32_t end, const Aabb& box, unsigned int depth) {
+		Split s = depth < maxDepth ? FindSplit(begin, end, box) : Split{};
+		if(s.valid && s.sorted) {
+			//same sort SmallSplit() evaluated, so the cut after leftCount lands where it was measured
+			InsertionSort(items.data() + begin, end - begin, s.axis);
+		}
+		else if(s.valid) {
+			Item* pItems = items.data();
+			std::partition(pItems + begin, pItems + end, [&](const Item& item) {
+				return BinIndex(Get(item.centroid, s.axis), s.origin, s.scale, s.binsUsed) <= s.bin;
+			});
+		}
+		else {
+			s = MedianSplit(begin, end);
+		}
+		const std::uint32_t mid = begin + s.leftCount;
+		const bool splitLeft = WorthSplitting(begin, mid, s.left);
+		const bool splitRight = WorthSplitting(mid, end, s.right);
+
+		Node& node = bvh.pNodes[index];
+		const std::uint32_t rightIndex = index + s.leftCount;
+		//nodes reserved for a subtree that became a leaf are never used, marked empty so Refit() can walk every node
+		if(!splitLeft) {
+			MarkUnused(index + 1u, rightIndex);
+		}
+		if(!splitRight) {
+			MarkUnused(rightIndex, index + (end - begin) - 1u);
+		}
+		SetChild(node, 0, s.left);
+		SetChild(node, 1, s.right);
+		node.first[0] = begin;
+		node.first[1] = mid;
+		node.count[0] = splitLeft ? s.leftCount : (s.leftCount | leafFlag);
+		node.count[1] = splitRight ? (end - mid) : ((end - mid) | leafFlag);
+
+		//the right subtree goes to another worker when it is big, the left one is built here meanwhile
+		JobSystem::Counter counter;
+		bool spawned = false;
+		if(splitRight && pJobs && end - mid >= taskThreshold) {
+			Builder* pThis = this;
+			const Aabb rightBox = s.right;
+			pJobs->Run(counter, [pThis, rightIndex, mid, end, depth, rightBox]() {
+				pThis->BuildNode(rightIndex, mid, end, rightBox, depth + 1u);
+			});
+			spawned = true;
+		}
+		if(splitLeft) {
+			BuildNode(index + 1u, begin, mid, s.left, depth + 1u);
+		}
+		if(splitRight && !spawned) {
+			BuildNode(rightIndex, mid, end, s.right, depth + 1u);
+		}
+		if(spawned) {
+			pJobs->Wait(counter);
+		}
+	}
+};
+
+//Bvh
+void Bvh::Build(const Aabb* pBounds, std::size_t count, JobSystem* pJobs) {
+	primitives.resize(count);
+	primitiveBounds.resize(count);
+	//a binary tree over n objects has at most n - 1 inner nodes
+	nodeCount = count > 1u ? count - 1u : count;
+	if(nodeCapacity < nodeCount) {
+		pNodes.reset(new Node[nodeCount]);
+		nodeCapacity = nodeCount;
+	}
+	bounds = EmptyBox();
+	if(count == 0u) {
+		return;
+	}
+
+	Builder builder = { *this, pJobs, {} };
+	builder.items.resize(count);
+	builder.Reduce(0u, std::uint32_t(count), bounds, [&](std::uint32_t b, std::uint32_t e, Aabb& box) {
+		for(std::uint32_t i = b; i < e; i++) {
+			const Aabb& a = pBounds[i];
+			builder.items[i] = { a, { (a.min.x + a.max.x) * 0.5f, (a.min.y + a.max.y) * 0.5f, (a.min.z + a.max.z) * 0.5f }, i };
+			Grow(box, a);
+		}
+	}, [](Aabb& a, const Aabb& b) { Grow(a, b); });
+
+	if(count == 1u) {
+		Node& root = pNodes[0];
+		SetChild(root, 0, pBounds[0]);
+		SetChild(root, 1, EmptyBox());
+		root.first[0] = 0u;
+		root.first[1] = 1u;
+		root.count[0] = 1u | leafFlag;
+		root.count[1] = 0u;
+	}
+	else {
+		builder.BuildNode(0u, 0u, std::uint32_t(count), bounds, 0u);
+	}
+
+	const auto gather = [&](std::size_t b, std::size_t e) {
+		for(std::size_t i = b; i < e; i++) {
+			primitives[i] = builder.items[i].primitive;
+			primitiveBounds[i] = builder.items[i].box;
+		}
+	};
+	if(pJobs) {
+		pJobs->ParallelFor(count, chunkSize, gather);
+	}
+	else {
+		gather(0u, count);
+	}
+}
+
+void Bvh::Refit(const Aabb* pBounds, JobSystem* pJobs) {
+	if(nodeCount == 0u) {
+		return;
+	}
+	bounds = RefitSubtree(0u, std::uint32_t(primitives.size()), pBounds, pJobs);
+}
+
+Bvh::Aabb Bvh::RefitSubtree(std::uint32_t index, std::uint32_t objects, const Aabb* pBounds, JobSystem* pJobs) {
+	Node& node = pNodes[index];
+	if(!pJobs || objects < 2u * taskThreshold) {
+		RefitNodes(index, index + std::max(objects - 1u, 1u), pBounds);
+		return GetBox(node);
+	}
+	//big subtrees: the right child goes to another worker, the left one is refit here meanwhile
+	JobSystem::Counter counter;
+	bool spawned = false;
+	for(int c = 1; c >= 0; c--) {
+		const std::uint32_t count = node.count[c] & ~leafFlag;
+		const std::uint32_t child = c == 0 ? index + 1u : index + (node.count[0] & ~leafFlag);
+		if(node.count[c] & leafFlag) {
+			RefitLeaf(node, c, pBounds);
+		}
+		else if(c == 1 && count >= taskThreshold) {
+			Bvh* pThis = this;
+			pJobs->Run(counter, [pThis, index, child, count, pBounds, pJobs]() {
+				const Aabb box = pThis->RefitSubtree(child, count, pBounds, pJobs);
+				SetChild(pThis->pNodes[index], 1, box);
+			});
+			spawned = true;
+		}
+		else {
+			SetChild(node, c, RefitSubtree(child, count, pBounds, pJobs));
+		}
+	}
+	if(spawned) {
+		pJobs->Wait(counter);
+	}
+	return GetBox(node);
+}
+
+void Bvh::RefitNodes(std::uint32_t begin, std::uint32_t end, const Aabb* pBounds) noexcept {
+	//children always come after their parent: walking backwards every child is done before its parent reads it,
+	//and the nodes stream through memory instead of being revisited on the way back up a recursion
+	for(std::uint32_t i = end; i-- > begin;) {
+		Node& node = pNodes[i];
+		for(int c = 0; c < 2; c++) {
+			if(node.count[c] & leafFlag) {
+				RefitLeaf(node, c, pBounds);
+			}
+			else if(node.count[c] != 0u) {
+				SetChild(node, c, GetBox(pNodes[c == 0 ? i + 1u : i + (node.count[0] & ~leafFlag)]));
+			}
+		}
+	}
+}
+
+void Bvh::RefitLeaf(Node& node, int child, const Aabb* pBounds) noexcept {
+	const std::uint32_t first = node.first[child];
+	const std::uint32_t count = node.count[child] & ~leafFlag;
+	Aabb box = EmptyBox();
+	for(std::uint32_t i = first; i < first + count; i++) {
+		const Aabb& a = pBounds[primitives[i]];
+		primitiveBounds[i] = a;
+		Grow(box, a);
+	}
+	SetChild(node, child, box);
+}
+
+std::size_t Bvh::Cull(const FrustumCull::Frustum& frustum, std::vector<Range>& ranges) const {
+	if(nodeCount == 0u) {
+		return 0u;
+	}
+	std::size_t total = 0u;
+	const auto emit = [&](std::uint32_t first, std::uint32_t count) {
+		total += count;
+		if(!ranges.empty() && ranges.back().first + ranges.back().count == first) {
+			ranges.back().count += count;
+		}
+		else {
+			ranges.push_back({ first, count });
+		}
+	};
+	//pending (node, child) pairs, child 0 is popped before child 1 so ranges come out in ascending order
+	struct Entry {
+		std::uint32_t node;
+		int child;
+	};
+	Entry stack[stackSize * 2];
+	int top = 0;
+	stack[top++] = { 0u, 1 };
+	stack[top++] = { 0u, 0 };
+	while(top > 0) {
+		const Entry e = stack[--top];
+		const Node& node = pNodes[e.node];
+		const int c = e.child;
+		const std::uint32_t first = node.first[c];
+		const std::uint32_t count = node.count[c] & ~leafFlag;
+		if(count == 0u) {
+			continue;
+		}
+		const Overlap overlap = Classify(frustum, node.minX[c], node.minY[c], node.minZ[c], node.maxX[c], node.maxY[c], node.maxZ[c]);
+		if(overlap == Overlap::outside) {
+			continue;
+		}
+		if(overlap == Overlap::inside) {
+			emit(first, count);
+		}
+		else if(node.count[c] & leafFlag) {
+			for(std::uint32_t i = first; i < first + count; i++) {
+				if(Classify(frustum, primitiveBounds[i]) != Overlap::outside) {
+					emit(i, 1u);
+				}
+			}
+		}
+		else {
+			const std::uint32_t child = c == 0 ? e.node + 1u : e.node + (node.count[0] & ~leafFlag);
+			stack[top++] = { child, 1 };
+			stack[top++] = { child, 0 };
+		}
+	}
+	return total;
+}
+
+bool Bvh::Raycast(const Ray& ray, Hit& hit) const noexcept {
+	return Traverse(ray, hit, nullptr, nullptr);
+}
+
+bool Bvh::Traverse(const Ray& ray, Hit& hit, IntersectFunction pIntersect, const void* pUser) const {
+	if(nodeCount == 0u) {
+		return false;
+	}
+	const RaySetup r = { ray.origin, { SafeInverse(ray.direction.x), SafeInverse(ray.direction.y), SafeInverse(ray.direction.z) } };
+	float best = ray.tMax;
+	bool found = false;
+	struct Entry {
+		std::uint32_t node;
+		float t; //where the ray enters the node, skipped once something closer was hit
+	};
+	Entry stack[stackSize];
+	int top = 0;
+	stack[top++] = { 0u, 0.0f };
+	while(top > 0) {
+		const Entry e = stack[--top];
+		if(e.t > best) {
+			continue;
+		}
+		const Node& node = pNodes[e.node];
+		float tEnter[2];
+		bool entered[2];
+		for(int c = 0; c < 2; c++) {
+			entered[c] = node.count[c] != 0u
+				&& Enter(r, node.minX[c], node.minY[c], node.minZ[c], node.maxX[c], node.maxY[c], node.maxZ[c], best, tEnter[c]);
+		}
+		//nearer child first: its leaf is tested now / its subtree is popped next
+		const int near = (entered[0] && entered[1] && tEnter[1] < tEnter[0]) ? 1 : 0;
+		Entry push[2];
+		int pushCount = 0;
+		for(int k = 0; k < 2; k++) {
+			const int c = k == 0 ? near : 1 - near;
+			if(!entered[c] || tEnter[c] > best) {
+				continue;
+			}
+			if(!(node.count[c] & leafFlag)) {
+				push[pushCount++] = { c == 0 ? e.node + 1u : e.node + (node.count[0] & ~leafFlag), tEnter[c] };
+				continue;
+			}
+			const std::uint32_t first = node.first[c];
+			const std::uint32_t count = node.count[c] & ~leafFlag;
+			for(std::uint32_t i = first; i < first + count; i++) {
+				const Aabb& a = primitiveBounds[i];
+				float t;
+				if(!Enter(r, a.min.x, a.min.y, a.min.z, a.max.x, a.max.y, a.max.z, best, t)) {
+					continue;
+				}
+				if(pIntersect) {
+					t = best;
+					if(!pIntersect(pUser, primitives[i], ray, t) || !(t < best)) {
+						continue;
+					}
+				}
+				else if(found && !(t < best)) {
+					continue;
+				}
+				best = t;
+				hit = { primitives[i], t };
+				found = true;
+			}
+		}
+		//farther one below the nearer one
+		for(int k = pushCount - 1; k >= 0; k--) {
+			stack[top++] = push[k];
+		}
+	}
+	return found;
+}
+
+const std::vector<std::uint32_t>& Bvh::GetPrimitives() const noexcept {
+	return primitives;
+}
+
+std::size_t Bvh::GetPrimitiveCount() const noexcept {
+	return primitives.size();
+}
+
+std::size_t Bvh::GetNodeCount() const noexcept {
+	return nodeCount;
+}
+
+Bvh::Aabb Bvh::GetBounds() const noexcept {
+	return bounds;
+}
+
+void Bvh::SetChild(Node& node, int child, const Aabb& box) noexcept {
+	node.minX[child] = box.min.x;
+	node.minY[child] = box.min.y;
+	node.minZ[child] = box.min.z;
+	node.maxX[child] = box.max.x;
+	node.maxY[child] = box.max.y;
+	node.maxZ[child] = box.max.z;
+}
+
+Bvh::Aabb Bvh::GetBox(const Node& node) noexcept {
+	Aabb box = GetChild(node, 0);
+	if(node.count[1] != 0u) {
+		Grow(box, GetChild(node, 1));
+	}
+	return box;
+}
+
+Bvh::Aabb Bvh::GetChild(const Node& node, int child) noexcept {
+	return { { node.minX[child], node.minY[child], node.minZ[child] }, { node.maxX[child], node.maxY[child], node.maxZ[child] } };
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "RasterMath.h"
+#include "FrustumCull.h"
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+class JobSystem;
+
+//Bounding volume hierarchy over scene objects for visibility and picking queries.
+//Built top down with a binned surface area heuristic (Wald, "On fast Construction of SAH-based Bounding
+//Volume Hierarchies"), big subtrees and the binning passes of big nodes run as jobs when a JobSystem is given.
+//
+//Binary tree flattened into 64 byte nodes (one cache line) that hold the boxes of both children,
+//so every traversal step tests two children from a single line. Nodes are laid out depth first with
+//every subtree at an offset known before it is built (the left child of node i is i + 1, the right
+//one i + object count of the left child), build tasks never allocate or synchronize; nodes reserved for
+//subtrees that became leaves stay unused.
+//Every subtree covers a contiguous range of GetPrimitives(), Cull() emits a node entirely inside
+//the frustum as one range without visiting it.
+//
+//Refit() takes new boxes for the same objects and keeps the topology, fine for objects moving around
+//locally; Build() again when the scene changed a lot.
+//Does not depend on D3D or Windows.
+class Bvh {
+public:
+	struct Aabb {
+		rmath::Float3 min;
+		rmath::Float3 max;
+	};
+	//[first, first + count) of GetPrimitives()
+	struct Range {
+		std::uint32_t first;
+		std::uint32_t count;
+	};
+	struct Ray {
+		rmath::Float3 origin;
+		rmath::Float3 direction; //not necessarily normalized, t is in units of direction
+		float tMax;
+	};
+	struct Hit {
+		std::uint32_t primitive; //index into the boxes given to Build()
+		float t;
+	};
+	static constexpr std::uint32_t maxLeafSize = 4u;
+	static constexpr std::uint32_t binCount = 16u;
+	static constexpr unsigned int maxDepth = 48u; //deeper subtrees are split at the median, bounds the traversal stack
+public:
+	//one box per object, pJobs may be null to build on the calling thread
+	void Build(const Aabb* pBounds, std::size_t count, JobSystem* pJobs = nullptr);
+	//new boxes for the objects Build() got, same count and order
+	void Refit(const Aabb* pBounds, JobSystem* pJobs = nullptr);
+	//appends ranges covering every object whose box is not entirely outside a plane, adjacent ranges merged,
+	//returns the number of objects appended
+	std::size_t Cull(const FrustumCull::Frustum& frustum, std::vector<Range>& ranges) const;
+	//closest object box the ray enters in [0, tMax], t is 0 when the origin is inside it
+	bool Raycast(const Ray& ray, Hit& hit) const noexcept;
+	//closest object hit by intersect(primitive, ray, t), which is called for objects whose box the ray enters
+	//before the closest hit so far; it returns true and lowers t when the object itself is hit before t
+	template<typename F>
+	bool Raycast(const Ray& ray, Hit& hit, const F& intersect) const {
+		return Traverse(ray, hit, [](const void* pF, std::uint32_t primitive, const Ray& r, float& t) {
+			return (*static_cast<const F*>(pF))(primitive, r, t);
+		}, &intersect);
+	}
+	//object indices in leaf order, what Range refers to
+	const std::vector<std::uint32_t>& GetPrimitives() const noexcept;
+	std::size_t GetPrimitiveCount() const noexcept;
+	//node storage including the gaps left by leaves
+	std::size_t GetNodeCount() const noexcept;
+	Aabb GetBounds() const noexcept;
+private:
+	struct alignas(64) Node {
+		//boxes of child 0 and 1
+		float minX[2];
+		float minY[2];
+		float minZ[2];
+		float maxX[2];
+		float maxY[2];
+		float maxZ[2];
+		//objects under each child, a leaf when leafFlag is set in count;
+		//count 0 for no child: the second one of a one object tree, both on unused nodes
+		std::uint32_t first[2];
+		std::uint32_t count[2];
+	};
+	static_assert(sizeof(Node) == 64u, "Bvh node should fill exactly one cache line");
+	static constexpr std::uint32_t leafFlag = 0x80000000u;
+	struct Builder;
+	using IntersectFunction = bool (*)(const void* pUser, std::uint32_t primitive, const Ray& ray, float& t);
+	bool Traverse(const Ray& ray, Hit& hit, IntersectFunction pIntersect, const void* pUser) const;
+	//the nodes of a subtree with n objects are [index, index + n - 1)
+	Aabb RefitSubtree(std::uint32_t index, std::uint32_t objects, const Aabb* pBounds, JobSystem* pJobs);
+	void RefitNodes(std::uint32_t begin, std::uint32_t end, const Aabb* pBounds) noexcept;
+	void RefitLeaf(Node& node, int child, const Aabb* pBounds) noexcept;
+	static void SetChild(Node& node, int child, const Aabb& box) noexcept;
+	static Aabb GetChild(const Node& node, int child) noexcept;
+	static Aabb GetBox(const Node& node) noexcept; //both children
+private:
+	std::unique_ptr<Node[]> pNodes;
+	std::size_t nodeCount = 0u;
+	std::size_t nodeCapacity = 0u;
+	std::vector<std::uint32_t> primitives;
+	std::vector<Aabb> primitiveBounds; //in leaf order, tested in leaves
+	Aabb bounds = {};
+};
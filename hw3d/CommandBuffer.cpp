@@ -0,0 +1,172 @@
+#include "CommandBuffer.h"
+#include <cstring>
+#include <algorithm>
+
+//CountingBackend
+bool CountingBackend::Track(ResourceId& bound, ResourceId id) noexcept {
+	counts.stateCalls++;
+	if(bound == id) {
+		return false;
+	}
+	bound = id;
+	counts.stateChanges++;
+	return true;
+}
+
+void CountingBackend::SetVertexShader(ResourceId id) {
+	if(Track(vertexShader, id)) {
+		counts.shaderChanges++;
+	}
+}
+
+void CountingBackend::SetPixelShader(ResourceId id) {
+	if(Track(pixelShader, id)) {
+		counts.shaderChanges++;
+	}
+}
+
+void CountingBackend::SetInputLayout(ResourceId id) {
+	Track(inputLayout, id);
+}
+
+void CountingBackend::SetVertexBuffer(ResourceId id, std::uint32_t) {
+	Track(vertexBuffer, id);
+}
+
+void CountingBackend::SetIndexBuffer(ResourceId id, std::uint32_t) {
+	Track(indexBuffer, id);
+}
+
+void CountingBackend::SetPSConstantBuffer(ResourceId id) {
+	Track(psConstantBuffer, id);
+}
+
+void CountingBackend::SetVSConstantBuffer(ResourceId id) {
+	Track(vsConstantBuffer, id);
+}
+
+void CountingBackend::SetVSConstants(const void*, std::size_t) {
+	counts.constantUploads++;
+}
+
+void CountingBackend::SetInstanceData(const void*, std::uint32_t, std::uint32_t) {
+	counts.constantUploads++;
+}
+
+void CountingBackend::DrawIndexed(std::uint32_t, std::uint32_t instanceCount, std::uint32_t, std::int32_t) {
+	counts.draws++;
+	counts.instances += instanceCount;
+}
+
+const CountingBackend::Counts& CountingBackend::GetCounts() const noexcept {
+	return counts;
+}
+
+void CountingBackend::Reset() noexcept {
+	*this = CountingBackend();
+}
+
+//CommandBuffer
+std::uint64_t CommandBuffer::MakeKey(unsigned int layer, ResourceId vertexShader, ResourceId pixelShader,
+	ResourceId inputLayout, ResourceId vertexBuffer, float depth) noexcept
+{
+	//depth in [0, 1] quantized to 22 bits, smaller first so opaque draws go front to back
+	const float d = std::clamp(depth, 0.0f, 1.0f);
+	const std::uint64_t depthBits = static_cast<std::uint64_t>(d * float((1u << 22) - 1u));
+	return (std::uint64_t(layer & 0xFu) << 60)
+		| (std::uint64_t(vertexShader & 0x3FFu) << 50)
+		| (std::uint64_t(pixelShader & 0x3FFu) << 40)
+		| (std::uint64_t(inputLayout & 0xFFu) << 32)
+		| (std::uint64_t(vertexBuffer & 0x3FFu) << 22)
+		| depthBits;
+}
+
+std::uint32_t CommandBuffer::AddPayload(const void* pData, std::size_t size) {
+	const std::size_t offset = (payload.size() + 15u) & ~std::size_t(15u);
+	payload.resize(offset + size);
+	std::memcpy(payload.data() + offset, pData, size);
+	return static_cast<std::uint32_t>(offset);
+}
+
+void CommandBuffer::Record(const DrawCommand& command) {
+	order.push_back(static_cast<std::uint32_t>(commands.size()));
+	commands.push_back(command);
+}
+
+void CommandBuffer::Sort() {
+	const std::size_t count = order.size();
+	if(count < 2u) {
+		return;
+	}
+	keys.resize(count);
+	keysTemp.resize(count);
+	orderTemp.resize(count);
+	//all eight byte histograms in one pass over the keys
+	std::size_t histograms[8][256] = {};
+	for(std::size_t i = 0u; i < count; i++) {
+		const std::uint64_t key = commands[order[i]].key;
+		keys[i] = key;
+		for(int pass = 0; pass < 8; pass++) {
+			histograms[pass][(key >> (pass * 8)) & 0xFFu]++;
+		}
+	}
+	//LSD radix sort, a byte every key shares would be a pass that moves nothing, those are skipped
+	for(int pass = 0; pass < 8; pass++) {
+		std::size_t* const histogram = histograms[pass];
+		const int shift = pass * 8;
+		if(histogram[(keys[0] >> shift) & 0xFFu] == count) {
+			continue;
+		}
+		std::size_t sum = 0u;
+		for(int b = 0; b < 256; b++) {
+			const std::size_t n = histogram[b];
+			histogram[b] = sum;
+			sum += n;
+		}
+		for(std::size_t i = 0u; i < count; i++) {
+			const std::size_t dst = histogram[(keys[i] >> shift) & 0xFFu]++;
+			keysTemp[dst] = keys[i];
+			orderTemp[dst] = order[i];
+		}
+		keys.swap(keysTemp);
+		order.swap(orderTemp);
+	}
+}
+
+void CommandBuffer::Submit(CommandBackend& backend) const {
+	for(const std::uint32_t i : order) {
+		const DrawCommand& cmd = commands[i];
+		backend.SetVertexShader(cmd.vertexShader);
+		backend.SetPixelShader(cmd.pixelShader);
+		backend.SetInputLayout(cmd.inputLayout);
+		backend.SetVertexBuffer(cmd.vertexBuffer, cmd.vertexStride);
+		backend.SetIndexBuffer(cmd.indexBuffer, cmd.indexSize);
+		backend.SetPSConstantBuffer(cmd.psConstantBuffer);
+		backend.SetVSConstantBuffer(cmd.vsConstantBuffer);
+		if(cmd.vsConstantsSize) {
+			backend.SetVSConstants(payload.data() + cmd.vsConstantsOffset, cmd.vsConstantsSize);
+		}
+		if(cmd.instanceStride) {
+			backend.SetInstanceData(payload.data() + cmd.instanceOffset, cmd.instanceCount, cmd.instanceStride);
+		}
+		backend.DrawIndexed(cmd.indexCount, cmd.instanceCount, cmd.startIndex, cmd.baseVertex);
+	}
+}
+
+void CommandBuffer::Reset() noexcept {
+	commands.clear();
+	order.clear();
+	payload.clear();
+}
+
+std::size_t CommandBuffer::Size() const noexcept {
+	return commands.size();
+}
+
+bool CommandBuffer::Empty() const noexcept {
+	return commands.empty();
+}
+
+const CommandBuffer::DrawCommand& CommandBuffer::operator[](std::size_t i) const noexcept {
+	return commands[order[i]];
+}
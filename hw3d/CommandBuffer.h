@@ -0,0 +1,137 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+//Backend a CommandBuffer replays into. Resources are referred to by ids the backend understands
+//(Graphics uses its ResourceCache handles), CommandBuffer never looks at them except for sorting.
+class CommandBackend {
+public:
+	using ResourceId = std::uint32_t;
+	static constexpr ResourceId NoResource = 0xFFFFFFFFu;
+	virtual ~CommandBackend() = default;
+	virtual void SetVertexShader(ResourceId id) = 0;
+	virtual void SetPixelShader(ResourceId id) = 0;
+	virtual void SetInputLayout(ResourceId id) = 0;
+	virtual void SetVertexBuffer(ResourceId id, std::uint32_t stride) = 0;
+	virtual void SetIndexBuffer(ResourceId id, std::uint32_t indexSize) = 0; //2 or 4 bytes
+	virtual void SetPSConstantBuffer(ResourceId id) = 0;
+	//per-mesh constants (e.g. vertex dequantization), NoResource for none
+	virtual void SetVSConstantBuffer(ResourceId id) = 0;
+	//per-draw data carried by the command buffer itself
+	virtual void SetVSConstants(const void* pData, std::size_t size) = 0;
+	virtual void SetInstanceData(const void* pData, std::uint32_t count, std::uint32_t stride) = 0;
+	virtual void DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount, std::uint32_t startIndex, std::int32_t baseVertex) = 0;
+};
+
+//Discards everything, measures pure recording/sorting/replay cost
+class NullBackend : public CommandBackend {
+public:
+	void SetVertexShader(ResourceId) override {}
+	void SetPixelShader(ResourceId) override {}
+	void SetInputLayout(ResourceId) override {}
+	void SetVertexBuffer(ResourceId, std::uint32_t) override {}
+	void SetIndexBuffer(ResourceId, std::uint32_t) override {}
+	void SetPSConstantBuffer(ResourceId) override {}
+	void SetVSConstantBuffer(ResourceId) override {}
+	void SetVSConstants(const void*, std::size_t) override {}
+	void SetInstanceData(const void*, std::uint32_t, std::uint32_t) override {}
+	void DrawIndexed(std::uint32_t, std::uint32_t, std::uint32_t, std::int32_t) override {}
+};
+
+//Counts calls, and how many of the state calls actually changed the bound value
+class CountingBackend : public CommandBackend {
+public:
+	struct Counts {
+		std::size_t draws = 0u;
+		std::size_t instances = 0u;
+		std::size_t stateCalls = 0u; //every Set*() of a bindable resource
+		std::size_t stateChanges = 0u; //the ones binding something other than what was bound
+		std::size_t shaderChanges = 0u;
+		std::size_t constantUploads = 0u; //SetVSConstants() and SetInstanceData()
+	};
+public:
+	void SetVertexShader(ResourceId id) override;
+	void SetPixelShader(ResourceId id) override;
+	void SetInputLayout(ResourceId id) override;
+	void SetVertexBuffer(ResourceId id, std::uint32_t stride) override;
+	void SetIndexBuffer(ResourceId id, std::uint32_t indexSize) override;
+	void SetPSConstantBuffer(ResourceId id) override;
+	void SetVSConstantBuffer(ResourceId id) override;
+	void SetVSConstants(const void* pData, std::size_t size) override;
+	void SetInstanceData(const void* pData, std::uint32_t count, std::uint32_t stride) override;
+	void DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount, std::uint32_t startIndex, std::int32_t baseVertex) override;
+	const Counts& GetCounts() const noexcept;
+	//forget counts and bound state
+	void Reset() noexcept;
+private:
+	bool Track(ResourceId& bound, ResourceId id) noexcept;
+private:
+	Counts counts;
+	ResourceId vertexShader = NoResource;
+	ResourceId pixelShader = NoResource;
+	ResourceId inputLayout = NoResource;
+	ResourceId vertexBuffer = NoResource;
+	ResourceId indexBuffer = NoResource;
+	ResourceId psConstantBuffer = NoResource;
+	ResourceId vsConstantBuffer = NoResource;
+};
+
+//Draws recorded as small POD commands with a 64 bit sort key, radix sorted and replayed into a backend.
+//Draw order becomes a choice made at submission: with the default key layout draws are grouped by shaders,
+//then input layout, then geometry, then front to back within each group.
+//Per-draw data (VS constants, instance streams) is copied into the buffer's payload at record time.
+//Does not depend on D3D or Windows.
+class CommandBuffer {
+public:
+	using ResourceId = CommandBackend::ResourceId;
+	struct DrawCommand {
+		std::uint64_t key;
+		ResourceId vertexShader;
+		ResourceId pixelShader;
+		ResourceId inputLayout;
+		ResourceId vertexBuffer;
+		ResourceId indexBuffer;
+		ResourceId psConstantBuffer;
+		ResourceId vsConstantBuffer; //NoResource for none
+		std::uint32_t vertexStride;
+		std::uint32_t indexSize; //bytes per index, 2 or 4
+		std::uint32_t indexCount;
+		std::uint32_t instanceCount; //instances read from the payload when instanceStride is not 0
+		std::uint32_t startIndex;
+		std::int32_t baseVertex;
+		std::uint32_t vsConstantsOffset; //into the payload
+		std::uint32_t vsConstantsSize; //0 for none
+		std::uint32_t instanceOffset; //into the payload
+		std::uint32_t instanceStride; //0 for a non instanced draw
+	};
+	//key layout, most significant first:
+	//	layer 4 | vertex shader 10 | pixel shader 10 | input layout 8 | vertex buffer 10 | depth 22
+	//ids wider than their field wrap around, that only costs sorting quality, never correctness
+	static std::uint64_t MakeKey(unsigned int layer, ResourceId vertexShader, ResourceId pixelShader,
+		ResourceId inputLayout, ResourceId vertexBuffer, float depth) noexcept;
+public:
+	CommandBuffer() = default;
+	CommandBuffer(const CommandBuffer&) = delete;
+	CommandBuffer& operator=(const CommandBuffer&) = delete;
+	//copy size bytes into the payload (16 byte aligned), returns the offset to put in a DrawCommand
+	std::uint32_t AddPayload(const void* pData, std::size_t size);
+	void Record(const DrawCommand& command);
+	//order the commands by key, stable so equal keys keep their recording order
+	void Sort();
+	//replay every command in the current order, without Sort() that is recording order
+	void Submit(CommandBackend& backend) const;
+	//drop all commands and payload, capacity is kept for the next frame
+	void Reset() noexcept;
+	std::size_t Size() const noexcept;
+	bool Empty() const noexcept;
+	const DrawCommand& operator[](std::size_t i) const noexcept;
+private:
+	std::vector<DrawCommand> commands;
+	std::vector<std::uint32_t> order; //indices into commands, sorted by Sort()
+	std::vector<unsigned char> payload;
+	//radix sort scratch, reused between frames
+	std::vector<std::uint64_t> keys;
+	std::vector<std::uint64_t> keysTemp;
+	std::vector<std::uint32_t> orderTemp;
+};
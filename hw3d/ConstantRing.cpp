@@ -0,0 +1,65 @@
+#include "ConstantRing.h"
+
+const char* ConstantRing::Exception::GetType() const noexcept {
+	return "Uriel Constant Ring Exception [Allocation larger than ring]";
+}
+
+ConstantRing::ConstantRing(std::size_t capacity, std::size_t alignment) noexcept {
+	Resize(capacity, alignment);
+}
+
+void ConstantRing::Resize(std::size_t capacity, std::size_t alignment) noexcept {
+	this->capacity = capacity;
+	this->alignment = alignment;
+	cursor = 0u;
+	discardNext = true;
+}
+
+ConstantRing::Allocation ConstantRing::Allocate(std::size_t size) {
+	const std::size_t aligned = (size + alignment - 1u) / alignment * alignment;
+	if(aligned > capacity) {
+		throw Exception(__LINE__, __FILE__);
+	}
+	Allocation alloc;
+	alloc.size = aligned;
+	//restart at the front when the frame starts or the ring is full, DISCARD renames the buffer
+	//so data still in use by the GPU is never overwritten
+	if(discardNext || cursor + aligned > capacity) {
+		alloc.offset = 0u;
+		alloc.mode = MapMode::Discard;
+		discardNext = false;
+		discards++;
+	} else {
+		alloc.offset = cursor;
+		alloc.mode = MapMode::NoOverwrite;
+	}
+	cursor = alloc.offset + aligned;
+	allocations++;
+	frameBytes += aligned;
+	return alloc;
+}
+
+void ConstantRing::NextFrame() noexcept {
+	discardNext = true;
+	frameBytes = 0u;
+}
+
+std::size_t ConstantRing::GetCapacity() const noexcept {
+	return capacity;
+}
+
+std::size_t ConstantRing::GetAlignment() const noexcept {
+	return alignment;
+}
+
+std::size_t ConstantRing::GetAllocationCount() const noexcept {
+	return allocations;
+}
+
+std::size_t ConstantRing::GetDiscardCount() const noexcept {
+	return discards;
+}
+
+std::size_t ConstantRing::GetFrameBytes() const noexcept {
+	return frameBytes;
+}
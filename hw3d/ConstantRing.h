@@ -0,0 +1,58 @@
+#pragma once
+#include "UrielException.h"
+#include <cstddef>
+#include <cstring>
+
+//Sub-allocator for one large dynamic constant buffer.
+//Allocations are aligned (256 bytes = 16 shader constants, the granularity VSSetConstantBuffers1 needs)
+//and handed out front to back. The first allocation of a frame, or one that no longer fits, restarts at
+//offset 0 and must be mapped with DISCARD; everything else is mapped with NO_OVERWRITE.
+//Pure bookkeeping, the actual buffer is supplied by the caller so any backing store can be used.
+class ConstantRing {
+public:
+	class Exception : public UrielException {
+		using UrielException::UrielException;
+	public:
+		const char* GetType() const noexcept override;
+	};
+	enum class MapMode {
+		Discard,
+		NoOverwrite
+	};
+	struct Allocation {
+		std::size_t offset; //bytes from start of the buffer
+		std::size_t size; //aligned size
+		MapMode mode;
+	};
+public:
+	ConstantRing() = default;
+	ConstantRing(std::size_t capacity, std::size_t alignment = 256u) noexcept;
+	//change capacity/alignment, the next allocation discards
+	void Resize(std::size_t capacity, std::size_t alignment = 256u) noexcept;
+	Allocation Allocate(std::size_t size);
+	//mark frame boundary, the next allocation discards
+	void NextFrame() noexcept;
+	//map/copy/unmap through any backing that provides void* Map(MapMode) and void Unmap()
+	template<typename Backing>
+	Allocation Upload(Backing& backing, const void* pData, std::size_t size) {
+		const auto alloc = Allocate(size);
+		auto* pMapped = static_cast<char*>(backing.Map(alloc.mode));
+		std::memcpy(pMapped + alloc.offset, pData, size);
+		backing.Unmap();
+		return alloc;
+	}
+	std::size_t GetCapacity() const noexcept;
+	std::size_t GetAlignment() const noexcept;
+	std::size_t GetAllocationCount() const noexcept;
+	std::size_t GetDiscardCount() const noexcept;
+	//bytes handed out since the last NextFrame()
+	std::size_t GetFrameBytes() const noexcept;
+private:
+	std::size_t capacity = 0u;
+	std::size_t alignment = 256u;
+	std::size_t cursor = 0u;
+	bool discardNext = true;
+	std::size_t allocations = 0u;
+	std::size_t discards = 0u;
+	std::size_t frameBytes = 0u;
+};
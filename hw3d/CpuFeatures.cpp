@@ -0,0 +1,82 @@
+#include "CpuFeatures.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CPU_FEATURES_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace {
+#ifdef CPU_FEATURES_X86
+	struct Registers {
+		unsigned int eax, ebx, ecx, edx;
+	};
+
+	Registers CpuId(unsigned int leaf, unsigned int subleaf) noexcept {
+		Registers r = {};
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuidex(info, (int)leaf, (int)subleaf);
+		r = { (unsigned int)info[0], (unsigned int)info[1], (unsigned int)info[2], (unsigned int)info[3] };
+#else
+		__cpuid_count(leaf, subleaf, r.eax, r.ebx, r.ecx, r.edx);
+#endif
+		return r;
+	}
+
+	unsigned long long XGetBV() noexcept {
+#if defined(_MSC_VER)
+		return _xgetbv(0);
+#else
+		unsigned int lo, hi;
+		__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		return ((unsigned long long)hi << 32) | lo;
+#endif
+	}
+
+	struct Features {
+		bool sse2 = false;
+		bool avx2 = false;
+
+		Features() noexcept {
+			const auto maxLeaf = CpuId(0u, 0u).eax;
+			if(maxLeaf < 1u) {
+				return;
+			}
+			const auto leaf1 = CpuId(1u, 0u);
+			sse2 = (leaf1.edx & (1u << 26)) != 0u;
+			//AVX needs OSXSAVE and the OS saving XMM and YMM state
+			const bool osxsave = (leaf1.ecx & (1u << 27)) != 0u;
+			const bool avx = (leaf1.ecx & (1u << 28)) != 0u;
+			if(!osxsave || !avx || (XGetBV() & 0x6u) != 0x6u || maxLeaf < 7u) {
+				return;
+			}
+			avx2 = (CpuId(7u, 0u).ebx & (1u << 5)) != 0u;
+		}
+	};
+
+	const Features& GetFeatures() noexcept {
+		static const Features features;
+		return features;
+	}
+#endif
+}
+
+bool CpuFeatures::HasSSE2() noexcept {
+#ifdef CPU_FEATURES_X86
+	return GetFeatures().sse2;
+#else
+	return false;
+#endif
+}
+
+bool CpuFeatures::HasAVX2() noexcept {
+#ifdef CPU_FEATURES_X86
+	return GetFeatures().avx2;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+//Runtime instruction set detection (CPUID + OS support for the AVX register state)
+//so SIMD kernels can be picked at startup instead of at compile time.
+namespace CpuFeatures {
+	bool HasSSE2() noexcept;
+	bool HasAVX2() noexcept;
+}
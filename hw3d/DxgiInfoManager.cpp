@@ -7,48 +7,79 @@
 
 #pragma comment(lib, "dxguid.lib")
 
-DxgiInfoManager::DxgiInfoManager() {
-	//define finction signature of DXGIGetDebugInterface
-	typedef HRESULT(WINAPI * DXGIGetDebugInterface)(REFIID, void**);
-
-	//load the dll that contains the function DXGIGetDebugInterface
-	const auto hModDxgiDebug = LoadLibraryEx("dxgidebug.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32);
-	if(hModDxgiDebug == nullptr) {
-		throw CHWND_LAST_EXCEPT();
-	}
+namespace {
+	Microsoft::WRL::ComPtr<IDXGIInfoQueue> GetInfoQueue() {
+		//define finction signature of DXGIGetDebugInterface
+		typedef HRESULT(WINAPI * DXGIGetDebugInterface)(REFIID, void**);
+
+		//load the dll that contains the function DXGIGetDebugInterface
+		const auto hModDxgiDebug = LoadLibraryEx("dxgidebug.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32);
+		if(hModDxgiDebug == nullptr) {
+			throw CHWND_LAST_EXCEPT();
+		}
 
-	//get address of DXGIGetDebugInterface in dll
-	const auto DxgiGetDebugInterface = reinterpret_cast<DXGIGetDebugInterface>(
-		reinterpret_cast<void*>(GetProcAddress(hModDxgiDebug, "DXGIGetDebugInterface"))
-		);
-	if(DxgiGetDebugInterface == nullptr) {
-		throw CHWND_LAST_EXCEPT();
+		//get address of DXGIGetDebugInterface in dll
+		const auto DxgiGetDebugInterface = reinterpret_cast<DXGIGetDebugInterface>(
+			reinterpret_cast<void*>(GetProcAddress(hModDxgiDebug, "DXGIGetDebugInterface"))
+			);
+		if(DxgiGetDebugInterface == nullptr) {
+			throw CHWND_LAST_EXCEPT();
+		}
+
+		HRESULT hr;
+		Microsoft::WRL::ComPtr<IDXGIInfoQueue> pDxgiInfoQueue;
+		GFX_THROW_NOINFO(DxgiGetDebugInterface(__uuidof(IDXGIInfoQueue), &pDxgiInfoQueue));
+		return pDxgiInfoQueue;
 	}
+}
+
+DxgiInfoManager::DxgiInfoManager()
+	:
+	queue(GetInfoQueue()),
+	drain(queue)
+{}
 
-	//HRESULT hr;
-	GFX_EXCEPT_NOINFO(DxgiGetDebugInterface(__uuidof(IDXGIInfoQueue), &pDxgiInfoQueue));
+void DxgiInfoManager::SetGranularity(InfoDrain::Granularity granularity) noexcept {
+	drain.SetGranularity(granularity);
 }
 
+InfoDrain::Granularity DxgiInfoManager::GetGranularity() const noexcept {
+	return drain.GetGranularity();
+}
 
-void DxgiInfoManager::Set() noexcept {
-	//set the index (next) so that the next all to GetMessage() will only get errors generated after this call
-	next = pDxgiInfoQueue->GetNumStoredMessages(DXGI_DEBUG_ALL);
+std::vector<std::string> DxgiInfoManager::GetMessages() {
+	return drain.TakeMessages();
 }
 
-std::vector<std::string> DxgiInfoManager::GetMessages() const {
-	std::vector<std::string> messages;
-	const auto end = pDxgiInfoQueue->GetNumStoredMessages(DXGI_DEBUG_ALL);
-	for(auto i = next; i < end; i++) {
-		HRESULT hr;
-		SIZE_T messageLength;
-		//get the size of message 'i' in bytes
-		GFX_THROW_NOINFO(pDxgiInfoQueue->GetMessage(DXGI_DEBUG_ALL, i, nullptr, &messageLength));
-		//allocate memory for messages
-		auto bytes = std::make_unique<byte[]>(messageLength);
-		auto pMessage = reinterpret_cast<DXGI_INFO_QUEUE_MESSAGE*>(bytes.get());
-		//get the message and push its description into the vector
-		GFX_THROW_NOINFO(pDxgiInfoQueue->GetMessage(DXGI_DEBUG_ALL, i, pMessage, &messageLength));
-		messages.emplace_back(pMessage->pDescription);
+const InfoDrain::Stats& DxgiInfoManager::GetStats() const noexcept {
+	return drain.GetStats();
+}
+
+DxgiInfoManager::Queue::Queue(Microsoft::WRL::ComPtr<IDXGIInfoQueue> pDxgiInfoQueue)
+	:
+	pDxgiInfoQueue(std::move(pDxgiInfoQueue)),
+	storage(1024u / sizeof(unsigned long long))
+{}
+
+std::uint64_t DxgiInfoManager::Queue::GetStoredCount() {
+	return pDxgiInfoQueue->GetNumStoredMessages(DXGI_DEBUG_ALL);
+}
+
+InfoDrain::Source::Message DxgiInfoManager::Queue::GetMessage(std::uint64_t index) {
+	HRESULT hr;
+	//try with what the buffer already holds, ask for the size only when the message does not fit
+	SIZE_T messageLength = storage.size() * sizeof(unsigned long long);
+	if(FAILED(pDxgiInfoQueue->GetMessage(DXGI_DEBUG_ALL, index, reinterpret_cast<DXGI_INFO_QUEUE_MESSAGE*>(storage.data()), &messageLength))) {
+		GFX_THROW_NOINFO(pDxgiInfoQueue->GetMessage(DXGI_DEBUG_ALL, index, nullptr, &messageLength));
+		storage.resize((messageLength + sizeof(unsigned long long) - 1u) / sizeof(unsigned long long));
+		GFX_THROW_NOINFO(pDxgiInfoQueue->GetMessage(DXGI_DEBUG_ALL, index, reinterpret_cast<DXGI_INFO_QUEUE_MESSAGE*>(storage.data()), &messageLength));
 	}
-	return messages;
+	const auto* pMessage = reinterpret_cast<const DXGI_INFO_QUEUE_MESSAGE*>(storage.data());
+	//DescriptionByteLength counts the terminator
+	const std::size_t length = pMessage->DescriptionByteLength > 0u ? std::size_t(pMessage->DescriptionByteLength) - 1u : 0u;
+	return { pMessage->ID, static_cast<InfoDrain::Severity>(pMessage->Severity), pMessage->pDescription, length };
+}
+
+void DxgiInfoManager::Queue::Clear() {
+	pDxgiInfoQueue->ClearStoredMessages(DXGI_DEBUG_ALL);
 }
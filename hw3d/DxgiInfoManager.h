@@ -1,20 +1,42 @@
 #pragma once
 
 #include "IncludeWin.h"
+#include "InfoDrain.h"
 #include <vector>
+#include <string>
 #include <wrl.h>
 #include <dxgidebug.h>
 
+//Debug layer messages of every DXGI producer (D3D11 included), read through an InfoDrain.
+//A message is read with a single GetMessage() into a buffer that only grows, so steady state checks do not allocate.
 class DxgiInfoManager {
 public:
 	DxgiInfoManager();
 	~DxgiInfoManager() = default;
 	DxgiInfoManager(const DxgiInfoManager&) = delete;
 	DxgiInfoManager operator= (const DxgiInfoManager&) = delete;
-	void Set() noexcept;
-	std::vector<std::string> GetMessages() const;
+	//true when messages are pending after draining at this check point, see InfoDrain::Check()
+	bool Check(InfoDrain::Granularity point) {
+		return drain.Check(point);
+	}
+	void SetGranularity(InfoDrain::Granularity granularity) noexcept;
+	InfoDrain::Granularity GetGranularity() const noexcept;
+	//everything pending, repeats folded; forgets them
+	std::vector<std::string> GetMessages();
+	const InfoDrain::Stats& GetStats() const noexcept;
 private:
-	unsigned long long next = 0u;
-	//struct IDXGIInfoQueue* pDxgiInfoQueue = nullptr;
-	Microsoft::WRL::ComPtr<IDXGIInfoQueue> pDxgiInfoQueue;
-};
\ No newline at end of file
+	class Queue : public InfoDrain::Source {
+	public:
+		Queue(Microsoft::WRL::ComPtr<IDXGIInfoQueue> pDxgiInfoQueue);
+		std::uint64_t GetStoredCount() override;
+		Message GetMessage(std::uint64_t index) override;
+		void Clear() override;
+	private:
+		Microsoft::WRL::ComPtr<IDXGIInfoQueue> pDxgiInfoQueue;
+		//one DXGI_INFO_QUEUE_MESSAGE with its description behind it
+		std::vector<unsigned long long> storage;
+	};
+private:
+	Queue queue;
+	InfoDrain drain;
+};
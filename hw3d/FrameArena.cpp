@@ -0,0 +1,113 @@
+#include "FrameArena.h"
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+namespace {
+	std::atomic<std::uint64_t> nextArenaId = 1u;
+	//sub-arena the calling thread used last, trivially initialized so the hot path is a plain TLS read
+	thread_local std::uint64_t cachedArenaId = 0u;
+	thread_local void* pCachedSubArena = nullptr;
+}
+
+FrameArena::FrameArena(std::size_t blockSize)
+	:
+	blockSize(std::max<std::size_t>(blockSize, 64u)),
+	id(nextArenaId.fetch_add(1u, std::memory_order_relaxed))
+{}
+
+void* FrameArena::Allocate(std::size_t size, std::size_t alignment) {
+	return GetSubArena().Allocate(size, alignment, blockSize);
+}
+
+void FrameArena::Reset() noexcept {
+	std::lock_guard<std::mutex> lock(mtx);
+	for(auto& pSub : subArenas) {
+		pSub->Reset();
+	}
+}
+
+FrameArena::Stats FrameArena::GetStats() const noexcept {
+	std::lock_guard<std::mutex> lock(mtx);
+	Stats stats;
+	stats.threads = subArenas.size();
+	for(const auto& pSub : subArenas) {
+		stats.bytes += pSub->bytes;
+		stats.blockAllocations += pSub->blockAllocations;
+		for(const auto& block : pSub->blocks) {
+			stats.capacity += block.size;
+		}
+	}
+	return stats;
+}
+
+FrameArena::SubArena& FrameArena::GetSubArena() {
+	if(cachedArenaId == id) {
+		return *static_cast<SubArena*>(pCachedSubArena);
+	}
+	//first allocation of this thread here, or the thread switched arenas
+	std::lock_guard<std::mutex> lock(mtx);
+	const auto thread = std::this_thread::get_id();
+	SubArena* pSub = nullptr;
+	for(auto& pOld : subArenas) {
+		if(pOld->owner == thread) {
+			pSub = pOld.get();
+			break;
+		}
+	}
+	if(!pSub) {
+		subArenas.push_back(std::make_unique<SubArena>());
+		pSub = subArenas.back().get();
+		pSub->owner = thread;
+	}
+	cachedArenaId = id;
+	pCachedSubArena = pSub;
+	return *pSub;
+}
+
+void* FrameArena::SubArena::Allocate(std::size_t size, std::size_t alignment, std::size_t blockSize) {
+	for(;;) {
+		if(current < blocks.size()) {
+			Block& block = blocks[current];
+			//align the address, not the offset, blocks are only aligned for max_align_t
+			const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(block.pData.get());
+			const std::uintptr_t aligned = (base + offset + alignment - 1u) & ~std::uintptr_t(alignment - 1u);
+			const std::size_t begin = std::size_t(aligned - base);
+			if(begin <= block.size && size <= block.size - begin) {
+				bytes += begin + size - offset;
+				offset = begin + size;
+				return block.pData.get() + begin;
+			}
+			current++;
+			offset = 0u;
+			continue;
+		}
+		//chain grows geometrically so a frame that outgrew the arena takes few blocks to get through
+		std::size_t chained = 0u;
+		for(const auto& block : blocks) {
+			chained += block.size;
+		}
+		const std::size_t newSize = std::max(std::max(blockSize, chained), size + alignment);
+		blocks.push_back({ std::unique_ptr<unsigned char[]>(new unsigned char[newSize]), newSize });
+		blockAllocations++;
+	}
+}
+
+void FrameArena::SubArena::Reset() noexcept {
+	if(blocks.size() > 1u) {
+		//next frame fits in one block, merging is what stops the steady state from allocating
+		std::size_t total = 0u;
+		for(const auto& block : blocks) {
+			total += block.size;
+		}
+		auto* pMerged = new(std::nothrow) unsigned char[total];
+		if(pMerged) {
+			blocks.clear();
+			blocks.push_back({ std::unique_ptr<unsigned char[]>(pMerged), total });
+		}
+	}
+	current = 0u;
+	offset = 0u;
+	bytes = 0u;
+	blockAllocations = 0u;
+}
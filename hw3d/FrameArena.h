@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <new>
+#include <cstdint>
+#include <cstddef>
+
+//Linear allocator for data that lives until the end of the frame.
+//Allocate() bumps a pointer in the calling thread's own sub-arena, so job system workers allocate without locks
+//or sharing cache lines; only a thread's first allocation from an arena registers its sub-arena under a lock.
+//Nothing is freed on its own, Reset() rewinds every sub-arena at once (Graphics::EndFrame()).
+//A sub-arena that ran out of its block during the frame chains another one, Reset() then replaces the chain
+//with a single block the size of the whole chain, so after a few frames the arena stops touching the heap.
+//Reset() and GetStats() must not race with Allocate(), call them while no jobs are running.
+//Does not depend on D3D or Windows.
+class FrameArena {
+public:
+	struct Stats {
+		std::size_t threads = 0u; //sub-arenas registered
+		std::size_t bytes = 0u; //handed out since the last Reset(), alignment padding included
+		std::size_t capacity = 0u; //reserved over all sub-arenas
+		std::size_t blockAllocations = 0u; //heap blocks allocated since the last Reset()
+	};
+public:
+	//blockSize is the first block of every sub-arena
+	FrameArena(std::size_t blockSize = 256u * 1024u);
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+	//throws std::bad_alloc like operator new when a block cannot be allocated
+	void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+	//uninitialized storage for count objects of T
+	template<typename T>
+	T* Allocate(std::size_t count) {
+		return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+	}
+	//everything allocated before is invalid afterwards
+	void Reset() noexcept;
+	Stats GetStats() const noexcept;
+private:
+	struct Block {
+		std::unique_ptr<unsigned char[]> pData;
+		std::size_t size;
+	};
+	//one per thread that allocated from this arena
+	struct alignas(64) SubArena {
+		std::thread::id owner;
+		std::vector<Block> blocks;
+		std::size_t current = 0u; //block being bumped
+		std::size_t offset = 0u; //into the current block
+		std::size_t bytes = 0u;
+		std::size_t blockAllocations = 0u;
+		void* Allocate(std::size_t size, std::size_t alignment, std::size_t blockSize);
+		void Reset() noexcept;
+	};
+	SubArena& GetSubArena();
+private:
+	std::size_t blockSize;
+	std::uint64_t id; //tells the thread local cache which arena it belongs to, addresses can be reused
+	mutable std::mutex mtx;
+	std::vector<std::unique_ptr<SubArena>> subArenas; //never shrinks, a sub-arena outlives its thread
+};
+
+//STL allocator drawing from a FrameArena, deallocate() is a no-op. Containers using it must be gone (or
+//never touched again) before the arena resets; reserve() up front, every growth abandons the old storage.
+template<typename T>
+class FrameAllocator {
+public:
+	using value_type = T;
+public:
+	FrameAllocator(FrameArena& arena) noexcept
+		: pArena(&arena)
+	{}
+	template<typename U>
+	FrameAllocator(const FrameAllocator<U>& other) noexcept
+		: pArena(other.GetArena())
+	{}
+	T* allocate(std::size_t count) {
+		return pArena->Allocate<T>(count);
+	}
+	void deallocate(T*, std::size_t) noexcept {}
+	FrameArena* GetArena() const noexcept {
+		return pArena;
+	}
+	template<typename U>
+	bool operator==(const FrameAllocator<U>& other) const noexcept {
+		return pArena == other.GetArena();
+	}
+	template<typename U>
+	bool operator!=(const FrameAllocator<U>& other) const noexcept {
+		return pArena != other.GetArena();
+	}
+private:
+	FrameArena* pArena;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
@@ -0,0 +1,266 @@
+#include "FrustumCull.h"
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <bit>
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_CULL_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define CULL_TARGET_SSE2
+#define CULL_TARGET_AVX2
+#else
+#define CULL_TARGET_SSE2 __attribute__((target("sse2")))
+#define CULL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+	//spheres and boxes share the kernels, pRadius is used when pExtentX is null
+	struct Volumes {
+		const float* pX;
+		const float* pY;
+		const float* pZ;
+		const float* pRadius;
+		const float* pExtentX;
+		const float* pExtentY;
+		const float* pExtentZ;
+	};
+	Volumes ToVolumes(const FrustumCull::Spheres& s) noexcept {
+		return { s.pX, s.pY, s.pZ, s.pRadius, nullptr, nullptr, nullptr };
+	}
+	Volumes ToVolumes(const FrustumCull::Boxes& b) noexcept {
+		return { b.pX, b.pY, b.pZ, nullptr, b.pExtentX, b.pExtentY, b.pExtentZ };
+	}
+
+	//scalar test of one object, also used for the tails of the SIMD loops
+	bool IsVisible(const FrustumCull::Frustum& f, const Volumes& v, std::size_t i) noexcept {
+		for(const auto& p : f.planes) {
+			const float r = v.pExtentX
+				? std::fabs(p.a) * v.pExtentX[i] + std::fabs(p.b) * v.pExtentY[i] + std::fabs(p.c) * v.pExtentZ[i]
+				: v.pRadius[i];
+			if(p.a * v.pX[i] + p.b * v.pY[i] + p.c * v.pZ[i] + p.d + r < 0.0f) {
+				return false;
+			}
+		}
+		return true;
+	}
+	std::size_t CullRangeScalar(const FrustumCull::Frustum& f, const Volumes& v, std::size_t begin, std::size_t end, std::uint32_t* pOut) noexcept {
+		std::size_t n = 0u;
+		for(std::size_t i = begin; i < end; i++) {
+			if(IsVisible(f, v, i)) {
+				pOut[n++] = static_cast<std::uint32_t>(i);
+			}
+		}
+		return n;
+	}
+
+#ifdef FRUSTUM_CULL_SIMD
+	CULL_TARGET_SSE2
+	std::size_t CullRangeSSE2(const FrustumCull::Frustum& f, const Volumes& v, std::size_t begin, std::size_t end, std::uint32_t* pOut) noexcept {
+		__m128 pa[6], pb[6], pc[6], pd[6], absA[6], absB[6], absC[6];
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		for(int p = 0; p < 6; p++) {
+			pa[p] = _mm_set1_ps(f.planes[p].a);
+			pb[p] = _mm_set1_ps(f.planes[p].b);
+			pc[p] = _mm_set1_ps(f.planes[p].c);
+			pd[p] = _mm_set1_ps(f.planes[p].d);
+			absA[p] = _mm_andnot_ps(signMask, pa[p]);
+			absB[p] = _mm_andnot_ps(signMask, pb[p]);
+			absC[p] = _mm_andnot_ps(signMask, pc[p]);
+		}
+		const __m128 zero = _mm_setzero_ps();
+		std::size_t n = 0u;
+		std::size_t i = begin;
+		//8 per iteration as two 4 wide halves
+		for(; i + 8u <= end; i += 8u) {
+			unsigned int mask = 0u;
+			for(std::size_t half = 0u; half < 8u; half += 4u) {
+				const std::size_t j = i + half;
+				const __m128 x = _mm_loadu_ps(v.pX + j);
+				const __m128 y = _mm_loadu_ps(v.pY + j);
+				const __m128 z = _mm_loadu_ps(v.pZ + j);
+				__m128 ex = zero, ey = zero, ez = zero, r = zero;
+				if(v.pExtentX) {
+					ex = _mm_loadu_ps(v.pExtentX + j);
+					ey = _mm_loadu_ps(v.pExtentY + j);
+					ez = _mm_loadu_ps(v.pExtentZ + j);
+				} else {
+					r = _mm_loadu_ps(v.pRadius + j);
+				}
+				__m128 outside = _mm_setzero_ps();
+				for(int p = 0; p < 6; p++) {
+					const __m128 rp = v.pExtentX
+						? _mm_add_ps(_mm_add_ps(_mm_mul_ps(absA[p], ex), _mm_mul_ps(absB[p], ey)), _mm_mul_ps(absC[p], ez))
+						: r;
+					//same operation order as the scalar test so both agree bit for bit
+					const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(pa[p], x), _mm_mul_ps(pb[p], y)), _mm_mul_ps(pc[p], z)), pd[p]), rp);
+					outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, zero));
+				}
+				mask |= unsigned(~_mm_movemask_ps(outside) & 0xF) << half;
+			}
+			while(mask) {
+				pOut[n++] = static_cast<std::uint32_t>(i + std::countr_zero(mask));
+				mask &= mask - 1u;
+			}
+		}
+		return n + CullRangeScalar(f, v, i, end, pOut + n);
+	}
+
+	CULL_TARGET_AVX2
+	std::size_t CullRangeAVX2(const FrustumCull::Frustum& f, const Volumes& v, std::size_t begin, std::size_t end, std::uint32_t* pOut) noexcept {
+		__m256 pa[6], pb[6], pc[6], pd[6], absA[6], absB[6], absC[6];
+		const __m256 signMask = _mm256_set1_ps(-0.0f);
+		for(int p = 0; p < 6; p++) {
+			pa[p] = _mm256_set1_ps(f.planes[p].a);
+			pb[p] = _mm256_set1_ps(f.planes[p].b);
+			pc[p] = _mm256_set1_ps(f.planes[p].c);
+			pd[p] = _mm256_set1_ps(f.planes[p].d);
+			absA[p] = _mm256_andnot_ps(signMask, pa[p]);
+			absB[p] = _mm256_andnot_ps(signMask, pb[p]);
+			absC[p] = _mm256_andnot_ps(signMask, pc[p]);
+		}
+		const __m256 zero = _mm256_setzero_ps();
+		std::size_t n = 0u;
+		std::size_t i = begin;
+		for(; i + 8u <= end; i += 8u) {
+			const __m256 x = _mm256_loadu_ps(v.pX + i);
+			const __m256 y = _mm256_loadu_ps(v.pY + i);
+			const __m256 z = _mm256_loadu_ps(v.pZ + i);
+			__m256 ex = zero, ey = zero, ez = zero, r = zero;
+			if(v.pExtentX) {
+				ex = _mm256_loadu_ps(v.pExtentX + i);
+				ey = _mm256_loadu_ps(v.pExtentY + i);
+				ez = _mm256_loadu_ps(v.pExtentZ + i);
+			} else {
+				r = _mm256_loadu_ps(v.pRadius + i);
+			}
+			__m256 outside = _mm256_setzero_ps();
+			for(int p = 0; p < 6; p++) {
+				//no FMA, contraction would make results differ from the scalar test
+				const __m256 rp = v.pExtentX
+					? _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absA[p], ex), _mm256_mul_ps(absB[p], ey)), _mm256_mul_ps(absC[p], ez))
+					: r;
+				const __m256 dist = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(pa[p], x), _mm256_mul_ps(pb[p], y)), _mm256_mul_ps(pc[p], z)), pd[p]), rp);
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(dist, zero, _CMP_LT_OQ));
+			}
+			unsigned int mask = unsigned(~_mm256_movemask_ps(outside) & 0xFF);
+			while(mask) {
+				pOut[n++] = static_cast<std::uint32_t>(i + std::countr_zero(mask));
+				mask &= mask - 1u;
+			}
+		}
+		return n + CullRangeScalar(f, v, i, end, pOut + n);
+	}
+#endif
+
+	std::size_t CullRange(const FrustumCull::Frustum& f, const Volumes& v, std::size_t begin, std::size_t end, std::uint32_t* pOut) noexcept {
+#ifdef FRUSTUM_CULL_SIMD
+		static const bool avx2 = CpuFeatures::HasAVX2();
+		static const bool sse2 = CpuFeatures::HasSSE2();
+		if(avx2) {
+			return CullRangeAVX2(f, v, begin, end, pOut);
+		}
+		if(sse2) {
+			return CullRangeSSE2(f, v, begin, end, pOut);
+		}
+#endif
+		return CullRangeScalar(f, v, begin, end, pOut);
+	}
+
+	std::size_t CullChunks(JobSystem& jobs, const FrustumCull::Frustum& f, const Volumes& v, std::size_t count, std::uint32_t* pVisible, std::size_t chunkSize, FrameArena* pArena) {
+		//chunks stay multiples of 8 so only the very last one has a scalar tail
+		chunkSize = std::max<std::size_t>((chunkSize + 7u) & ~std::size_t(7u), 8u);
+		const std::size_t chunks = (count + chunkSize - 1u) / chunkSize;
+		if(chunks <= 1u) {
+			return CullRange(f, v, 0u, count, pVisible);
+		}
+		//every chunk writes its survivors at its own start, which can never overrun the next chunk
+		std::vector<std::size_t> heapSurvivors;
+		std::size_t* survivors;
+		if(pArena) {
+			survivors = pArena->Allocate<std::size_t>(chunks);
+		}
+		else {
+			heapSurvivors.resize(chunks);
+			survivors = heapSurvivors.data();
+		}
+		jobs.ParallelFor(chunks, 1u, [&](std::size_t first, std::size_t last) {
+			for(std::size_t c = first; c < last; c++) {
+				const std::size_t begin = c * chunkSize;
+				const std::size_t end = std::min(begin + chunkSize, count);
+				survivors[c] = CullRange(f, v, begin, end, pVisible + begin);
+			}
+		});
+		//slide the chunks together, destinations never pass their sources so this is safe in order
+		std::size_t n = survivors[0];
+		for(std::size_t c = 1u; c < chunks; c++) {
+			std::memmove(pVisible + n, pVisible + c * chunkSize, survivors[c] * sizeof(std::uint32_t));
+			n += survivors[c];
+		}
+		return n;
+	}
+}
+
+FrustumCull::Frustum FrustumCull::ExtractFrustum(const rmath::Mat4& viewProj) noexcept {
+	//clip = v * M, so clip.x = dot(v, column 0) and so on; a plane is a sum or difference of columns
+	const auto& m = viewProj.m;
+	auto column = [&](int c) {
+		return Plane{ m[0][c], m[1][c], m[2][c], m[3][c] };
+	};
+	auto add = [](const Plane& p, const Plane& q, float s) {
+		return Plane{ p.a + s * q.a, p.b + s * q.b, p.c + s * q.c, p.d + s * q.d };
+	};
+	const Plane x = column(0), y = column(1), z = column(2), w = column(3);
+	Frustum f = { {
+		add(w, x, 1.0f), //left    -w <= x
+		add(w, x, -1.0f), //right   x <= w
+		add(w, y, 1.0f), //bottom  -w <= y
+		add(w, y, -1.0f), //top     y <= w
+		z, //near    0 <= z
+		add(w, z, -1.0f), //far     z <= w
+	} };
+	for(auto& p : f.planes) {
+		const float length = std::sqrt(p.a * p.a + p.b * p.b + p.c * p.c);
+		if(length > 0.0f) {
+			p.a /= length;
+			p.b /= length;
+			p.c /= length;
+			p.d /= length;
+		}
+	}
+	return f;
+}
+
+std::size_t FrustumCull::Cull(const Frustum& frustum, const Spheres& spheres, std::uint32_t* pVisible) noexcept {
+	return CullRange(frustum, ToVolumes(spheres), 0u, spheres.count, pVisible);
+}
+
+std::size_t FrustumCull::Cull(const Frustum& frustum, const Boxes& boxes, std::uint32_t* pVisible) noexcept {
+	return CullRange(frustum, ToVolumes(boxes), 0u, boxes.count, pVisible);
+}
+
+std::size_t FrustumCull::CullScalar(const Frustum& frustum, const Spheres& spheres, std::uint32_t* pVisible) noexcept {
+	return CullRangeScalar(frustum, ToVolumes(spheres), 0u, spheres.count, pVisible);
+}
+
+std::size_t FrustumCull::CullScalar(const Frustum& frustum, const Boxes& boxes, std::uint32_t* pVisible) noexcept {
+	return CullRangeScalar(frustum, ToVolumes(boxes), 0u, boxes.count, pVisible);
+}
+
+std::size_t FrustumCull::CullParallel(JobSystem& jobs, const Frustum& frustum, const Spheres& spheres, std::uint32_t* pVisible,
+	std::size_t chunkSize, FrameArena* pArena)
+{
+	return CullChunks(jobs, frustum, ToVolumes(spheres), spheres.count, pVisible, chunkSize, pArena);
+}
+
+std::size_t FrustumCull::CullParallel(JobSystem& jobs, const Frustum& frustum, const Boxes& boxes, std::uint32_t* pVisible,
+	std::size_t chunkSize, FrameArena* pArena)
+{
+	return CullChunks(jobs, frustum, ToVolumes(boxes), boxes.count, pVisible, chunkSize, pArena);
+}
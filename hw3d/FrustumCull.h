@@ -0,0 +1,53 @@
+#pragma once
+#include "RasterMath.h"
+#include <cstdint>
+#include <cstddef>
+
+class JobSystem;
+class FrameArena;
+
+//View frustum culling over structure of arrays bounding volumes.
+//Planes are extracted from a row vector viewProj (DirectXMath / rmath convention, D3D clip space 0 <= z <= w),
+//so the frustum always matches what XMMatrixPerspectiveLH projects. A volume is kept unless it lies
+//entirely on the outside of one plane, which is conservative: nothing visible is ever dropped.
+//Eight objects are tested per iteration (AVX2, or two SSE halves), picked at runtime from CPUID.
+//Survivors are written as ascending indices, ready to gather into a draw list.
+namespace FrustumCull {
+	//a x + b y + c z + d >= 0 inside, normalized so the distance is in world units
+	struct Plane {
+		float a, b, c, d;
+	};
+	struct Frustum {
+		Plane planes[6]; //left, right, bottom, top, near, far
+	};
+	struct Spheres {
+		const float* pX; //centers
+		const float* pY;
+		const float* pZ;
+		const float* pRadius;
+		std::size_t count;
+	};
+	struct Boxes {
+		const float* pX; //centers
+		const float* pY;
+		const float* pZ;
+		const float* pExtentX; //half sizes
+		const float* pExtentY;
+		const float* pExtentZ;
+		std::size_t count;
+	};
+	Frustum ExtractFrustum(const rmath::Mat4& viewProj) noexcept;
+	//pVisible needs room for count indices, returns how many survived
+	std::size_t Cull(const Frustum& frustum, const Spheres& spheres, std::uint32_t* pVisible) noexcept;
+	std::size_t Cull(const Frustum& frustum, const Boxes& boxes, std::uint32_t* pVisible) noexcept;
+	//one object at a time, reference for the SIMD paths
+	std::size_t CullScalar(const Frustum& frustum, const Spheres& spheres, std::uint32_t* pVisible) noexcept;
+	std::size_t CullScalar(const Frustum& frustum, const Boxes& boxes, std::uint32_t* pVisible) noexcept;
+	constexpr std::size_t defaultChunkSize = 16384u;
+	//split into chunks culled as jobs, then compacted in order; same output as Cull().
+	//The per chunk counts come from pArena when one is given, from the heap otherwise.
+	std::size_t CullParallel(JobSystem& jobs, const Frustum& frustum, const Spheres& spheres, std::uint32_t* pVisible,
+		std::size_t chunkSize = defaultChunkSize, FrameArena* pArena = nullptr);
+	std::size_t CullParallel(JobSystem& jobs, const Frustum& frustum, const Boxes& boxes, std::uint32_t* pVisible,
+		std::size_t chunkSize = defaultChunkSize, FrameArena* pArena = nullptr);
+}
@@ -1,7 +1,12 @@
 #include "Graphics.h"
 #include "dxerr.h"
+#include "TestCube.h"
+#include "MeshFile.h"
 #include <sstream>
 #include <cmath>
+#include <filesystem>
+#include <algorithm>
+#include <cstring>
 #include <DirectXMath.h>
 #include <d3dcompiler.h>
 
@@ -11,10 +16,35 @@ namespace dx = DirectX;
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "D3DCompiler.lib")
 
+//mesh file formats are DXGI_FORMAT values
+static_assert((DXGI_FORMAT)MeshFile::Format::Float4 == DXGI_FORMAT_R32G32B32A32_FLOAT, "MeshFile::Format must match DXGI_FORMAT");
+static_assert((DXGI_FORMAT)MeshFile::Format::Float3 == DXGI_FORMAT_R32G32B32_FLOAT, "MeshFile::Format must match DXGI_FORMAT");
+static_assert((DXGI_FORMAT)MeshFile::Format::Float2 == DXGI_FORMAT_R32G32_FLOAT, "MeshFile::Format must match DXGI_FORMAT");
+static_assert((DXGI_FORMAT)MeshFile::Format::UNorm8x4 == DXGI_FORMAT_R8G8B8A8_UNORM, "MeshFile::Format must match DXGI_FORMAT");
+static_assert((DXGI_FORMAT)MeshFile::Format::Float1 == DXGI_FORMAT_R32_FLOAT, "MeshFile::Format must match DXGI_FORMAT");
+static_assert((DXGI_FORMAT)MeshFile::Format::SNorm16x4 == DXGI_FORMAT_R16G16B16A16_SNORM, "MeshFile::Format must match DXGI_FORMAT");
+static_assert((DXGI_FORMAT)MeshFile::Format::Half2 == DXGI_FORMAT_R16G16_FLOAT, "MeshFile::Format must match DXGI_FORMAT");
+static_assert((DXGI_FORMAT)MeshFile::Format::SNorm16x2 == DXGI_FORMAT_R16G16_SNORM, "MeshFile::Format must match DXGI_FORMAT");
+
+namespace {
+	//the debug layer is what fills the info queue, it only pays off when the queue is read
+	UINT DeviceFlags(Graphics::Validation validation) noexcept {
+		return validation == Graphics::Validation::Full ? D3D11_CREATE_DEVICE_DEBUG : 0u;
+	}
+}
+
 //#define GFX_THROW_FAILED(hrcall) if(FAILED(hr = (hrcall))) throw Graphics::HrException(__LINE__,__FILE__, hr);
 //#define GFX_DEVICE_REMOVED_EXCEPT(hr) Graphics::DeviceRemovedException(__LINE__,__FILE__, (hr));
 
-Graphics::Graphics(HWND hWnd){
+Graphics::Graphics(HWND hWnd, Validation requested)
+	:
+	validation(std::min(requested, maxValidation))
+{
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+	if(validation == Validation::Full) {
+		pInfoManager = std::make_unique<DxgiInfoManager>();
+	}
+#endif
 
 	//Swap chain descriptor (Desriptors are very common in D3D)
 	DXGI_SWAP_CHAIN_DESC sd = {};
@@ -34,10 +64,7 @@ Graphics::Graphics(HWND hWnd){
 	sd.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
 	sd.Flags = 0;
 
-	UINT swapCreateFlags = 0u;
-#ifndef NDEBUG
-	swapCreateFlags |= D3D11_CREATE_DEVICE_DEBUG;
-#endif
+	const UINT swapCreateFlags = DeviceFlags(validation);
 
 	HRESULT hr; //used for debug error checking
 
@@ -46,7 +73,7 @@ Graphics::Graphics(HWND hWnd){
 		nullptr,
 		D3D_DRIVER_TYPE_HARDWARE,
 		nullptr,
-		D3D11_CREATE_DEVICE_DEBUG,
+		swapCreateFlags,
 		nullptr,
 		0,
 		D3D11_SDK_VERSION,
@@ -59,10 +86,73 @@ Graphics::Graphics(HWND hWnd){
 
 	//gain access to texture subresource in swap chain(back buffer)
 	//ID3D11Resource* pBackBuffer = nullptr;
-	wrl::ComPtr<ID3D11Resource> pBackBuffer;
-	GFX_THROW_INFO(pSwap->GetBuffer(0, __uuidof(ID3D11Resource), &pBackBuffer));
+	wrl::ComPtr<ID3D11Texture2D> pBackBuffer;
+	GFX_THROW_INFO(pSwap->GetBuffer(0, __uuidof(ID3D11Texture2D), &pBackBuffer));
+	CreateTargets(pBackBuffer.Get());
+	CreateConstantRing();
+
+	//read all shader bytecode once, then build the persistent test cube resources
+	LoadShaders();
+	CreateTestCube();
+}
+
+Graphics::Graphics(unsigned int width, unsigned int height, Validation requested)
+	:
+	validation(std::min(requested, maxValidation))
+{
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+	if(validation == Validation::Full) {
+		pInfoManager = std::make_unique<DxgiInfoManager>();
+	}
+#endif
+	const UINT deviceCreateFlags = DeviceFlags(validation);
+
+	HRESULT hr;
+
+	//no window and no swap chain, just a device. Fall back to WARP on machines without a usable GPU
+	if(FAILED(hr = D3D11CreateDevice(
+		nullptr, D3D_DRIVER_TYPE_HARDWARE, nullptr, deviceCreateFlags,
+		nullptr, 0, D3D11_SDK_VERSION, &pDevice, nullptr, &pContext
+	))) {
+		GFX_THROW_INFO(D3D11CreateDevice(
+			nullptr, D3D_DRIVER_TYPE_WARP, nullptr, deviceCreateFlags,
+			nullptr, 0, D3D11_SDK_VERSION, &pDevice, nullptr, &pContext
+		));
+	}
+
+	//offscreen color target in the same format the swap chain uses
+	D3D11_TEXTURE2D_DESC td = {};
+	td.Width = width;
+	td.Height = height;
+	td.MipLevels = 1u;
+	td.ArraySize = 1u;
+	td.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+	td.SampleDesc.Count = 1u;
+	td.SampleDesc.Quality = 0u;
+	td.Usage = D3D11_USAGE_DEFAULT;
+	td.BindFlags = D3D11_BIND_RENDER_TARGET;
+	wrl::ComPtr<ID3D11Texture2D> pColorTarget;
+	GFX_THROW_INFO(pDevice->CreateTexture2D(&td, nullptr, &pColorTarget));
+	CreateTargets(pColorTarget.Get());
+	CreateConstantRing();
+
+	//read all shader bytecode once, then build the persistent test cube resources
+	LoadShaders();
+	CreateTestCube();
+}
+
+void Graphics::CreateTargets(ID3D11Texture2D* pColorTarget) {
+	HRESULT hr;
+
+	//size everything else after the color target
+	D3D11_TEXTURE2D_DESC colorDesc;
+	pColorTarget->GetDesc(&colorDesc);
+	width = colorDesc.Width;
+	height = colorDesc.Height;
+	pColorBuffer = pColorTarget;
+
 	GFX_THROW_INFO(pDevice->CreateRenderTargetView(
-		pBackBuffer.Get(),
+		pColorTarget,
 		nullptr,
 		&pTarget
 	));
@@ -75,13 +165,17 @@ Graphics::Graphics(HWND hWnd){
 	wrl::ComPtr<ID3D11DepthStencilState> pDSState;
 	GFX_THROW_INFO(pDevice->CreateDepthStencilState(&dsDesc, &pDSState));
 	//bind to pipeline
-	pContext->OMSetDepthStencilState(pDSState.Get(), 1u);
+	//new targets replace whatever the shadow state remembers
+	shadow.Invalidate();
+	if(shadow.SetDepthStencilState(pDSState.Get(), 1u)) {
+		pContext->OMSetDepthStencilState(pDSState.Get(), 1u);
+	}
 
 	//create depth stencil texture
 	wrl::ComPtr<ID3D11Texture2D> pDepthStencil;
 	D3D11_TEXTURE2D_DESC depDesc = {};
-	depDesc.Width = 800u;
-	depDesc.Height = 600u;
+	depDesc.Width = width;
+	depDesc.Height = height;
 	depDesc.MipLevels = 1u;
 	depDesc.ArraySize = 1u;
 	depDesc.Format = DXGI_FORMAT_D32_FLOAT;
@@ -99,26 +193,109 @@ Graphics::Graphics(HWND hWnd){
 	GFX_THROW_INFO(pDevice->CreateDepthStencilView(pDepthStencil.Get(), &dsvDesc, &pDSV));
 	
 	//bind depth stencil view to OM
-	pContext->OMSetRenderTargets(1u, pTarget.GetAddressOf(), pDSV.Get());
+	if(shadow.SetRenderTarget(pTarget.Get(), pDSV.Get())) {
+		pContext->OMSetRenderTargets(1u, pTarget.GetAddressOf(), pDSV.Get());
+	}
 }
 
 void Graphics::EndFrame() {
 	HRESULT hr;
 
-#ifndef NDEBUG
-	infoManager.Set();
+	FlushCommands();
+	//whatever the debug layer said during the frame and no finer check point picked up
+	GFX_CHECK_INFO(Frame);
+#if GFX_VALIDATION >= GFX_VALIDATION_LIGHT
+	//a removed device otherwise only shows up in Present(), which headless frames never call
+	if(validation >= Validation::Light && FAILED(hr = pDevice->GetDeviceRemovedReason())) {
+		throw GFX_DEVICE_REMOVED_EXCEPT(hr);
+	}
 #endif
 
+	//offscreen frames are done once the commands are issued, ReadPixels() syncs when needed
+	if(IsHeadless()) {
+		constantRing.NextFrame();
+		shadow.NextFrame();
+		frameArena.Reset();
+		return;
+	}
+
 	if(FAILED(hr = pSwap->Present(1u, 0u))) { //present frame to buffer
 		if(hr == DXGI_ERROR_DEVICE_REMOVED) {
 			throw GFX_DEVICE_REMOVED_EXCEPT(pDevice->GetDeviceRemovedReason());
 		}else {
-			GFX_EXCEPT(hr);
+			throw GFX_EXCEPT(hr);
 		}
 	}
+	//per-frame transient constants start over after present
+	constantRing.NextFrame();
+	shadow.NextFrame();
+	frameArena.Reset();
+}
+
+bool Graphics::IsHeadless() const noexcept {
+	return !pSwap;
+}
+
+unsigned int Graphics::GetWidth() const noexcept {
+	return width;
+}
+
+unsigned int Graphics::GetHeight() const noexcept {
+	return height;
+}
+
+const ShadowState::Stats& Graphics::GetStateStats() const noexcept {
+	return shadow.GetLastFrameStats();
+}
+
+FrameArena& Graphics::GetFrameArena() noexcept {
+	return frameArena;
+}
+
+Graphics::Validation Graphics::GetValidation() const noexcept {
+	return validation;
+}
+
+void Graphics::SetInfoGranularity(InfoDrain::Granularity granularity) noexcept {
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+	if(pInfoManager) {
+		pInfoManager->SetGranularity(granularity);
+	}
+#else
+	(void)granularity;
+#endif
+}
+
+void Graphics::ReadPixels(std::vector<std::uint32_t>& pixels) {
+	HRESULT hr;
+
+	FlushCommands();
+
+	//CPU readable copy of the color target, created on first use and kept for the next readback
+	if(!pReadback) {
+		D3D11_TEXTURE2D_DESC td;
+		pColorBuffer->GetDesc(&td);
+		td.Usage = D3D11_USAGE_STAGING;
+		td.BindFlags = 0u;
+		td.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+		td.MiscFlags = 0u;
+		GFX_THROW_INFO(pDevice->CreateTexture2D(&td, nullptr, &pReadback));
+	}
+	pContext->CopyResource(pReadback.Get(), pColorBuffer.Get());
+
+	//map waits for the GPU to finish the frame, rows are copied because RowPitch can be padded
+	D3D11_MAPPED_SUBRESOURCE msr;
+	GFX_THROW_INFO(pContext->Map(pReadback.Get(), 0u, D3D11_MAP_READ, 0u, &msr));
+	pixels.resize(std::size_t(width) * height);
+	for(unsigned int y = 0u; y < height; y++) {
+		std::memcpy(&pixels[std::size_t(y) * width], static_cast<const char*>(msr.pData) + std::size_t(y) * msr.RowPitch, width * sizeof(std::uint32_t));
+	}
+	pContext->Unmap(pReadback.Get(), 0u);
 }
 
-void Graphics::ClearBuffer(float red, float green, float blue) noexcept {
+void Graphics::ClearBuffer(float red, float green, float blue) {
+	//draws recorded before the clear have to land before it
+	FlushCommands();
 	const float color[] = { red, green, blue, 1.0f };
 	pContext->ClearRenderTargetView(pTarget.Get(), color);
 	pContext->ClearDepthStencilView(pDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0u);
@@ -181,194 +358,466 @@ const char* Graphics::DeviceRemovedException::GetType() const noexcept {
 	return "Uriel Graphics Exception [Device Removed] (DXGI_ERROR_DEVICE_REMOVED)";
 }
 
-void Graphics::DrawTestTriangle(float angle, float x, float y, float z) { //pDevice creates stuff and pContext issues commands
+void Graphics::CreateConstantRing() {
+	HRESULT hr;
+
+	//binding with offsets and NO_OVERWRITE maps on constant buffers need D3D 11.1 runtime support
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	const bool offsetting = SUCCEEDED(pDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))
+		&& options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer
+		&& SUCCEEDED(pContext.As(&pContext1));
+	//without it the ring degenerates to one slot, so every upload is a Map(DISCARD) of a buffer
+	//no larger than the biggest per-draw block
+	const UINT capacity = offsetting ? constantRingSize : maxDrawConstantsSize;
+	if(!offsetting) {
+		pContext1.Reset();
+	}
 
-	//dx::XMVECTOR v = dx::XMVectorSet(3.0f, 3.0f, 0.0f, 0.0f);
-	//auto result = dx::XMVector3Transform(v, dx::XMMatrixScaling(1.5f, 0.0f, 0.0f));
-	//auto xx = dx::XMVectorGetX(result);
+	D3D11_BUFFER_DESC cbd = {};
+	cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	cbd.ByteWidth = capacity;
+	cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	cbd.MiscFlags = 0u;
+	cbd.StructureByteStride = 0u;
+	cbd.Usage = D3D11_USAGE_DYNAMIC;
+	GFX_THROW_INFO(pDevice->CreateBuffer(&cbd, nullptr, &pConstantRing));
+	constantRing.Resize(capacity, offsetting ? 256u : capacity);
+}
+
+void Graphics::BindVSConstants(UINT slot, const void* pData, UINT size) {
 	HRESULT hr;
 
-	struct Vertex {
-		struct {
-			float x, y, z;
-		} pos;
-		//struct{
-		//	unsigned char r, g, b, a; 
-		//} color;
-	};
+	const auto alloc = constantRing.Allocate(size);
+	D3D11_MAPPED_SUBRESOURCE msr;
+	GFX_THROW_INFO(pContext->Map(
+		pConstantRing.Get(), 0u,
+		alloc.mode == ConstantRing::MapMode::Discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE,
+		0u, &msr
+	));
+	std::memcpy(static_cast<char*>(msr.pData) + alloc.offset, pData, size);
+	pContext->Unmap(pConstantRing.Get(), 0u);
+
+	if(pContext1) {
+		//offsets and sizes are counted in 16 byte shader constants
+		const UINT firstConstant = (UINT)(alloc.offset / 16u);
+		const UINT numConstants = (UINT)(alloc.size / 16u);
+		if(shadow.SetVSConstantBuffer(slot, pConstantRing.Get(), firstConstant, numConstants)) {
+			pContext1->VSSetConstantBuffers1(slot, 1u, pConstantRing.GetAddressOf(), &firstConstant, &numConstants);
+		}
+	} else if(shadow.SetVSConstantBuffer(slot, pConstantRing.Get())) {
+		//Map(DISCARD) renames the buffer behind the binding, it never needs rebinding
+		pContext->VSSetConstantBuffers(slot, 1u, pConstantRing.GetAddressOf());
+	}
+}
+
+void Graphics::LoadShaders() {
+	//a packed archive costs one file read, loose .cso files are the fallback during development.
+	//The post build step repacks Shaders.pak after every build, or deletes it when ShaderPack is not built,
+	//so an archive here is never older than the shaders it stands for
+	if(std::filesystem::exists("Shaders.pak")) {
+		shaders.LoadArchive("Shaders.pak");
+	}
+	//make sure shader file output path in the compiler is set to the ProjectDirectory instead of OutputDirectory
+	for(const char* name : { "VertexShader", "PixelShader", "InstanceVertexShader", "InstancePixelShader" }) {
+		if(!shaders.Contains(name)) {
+			shaders.Load(name, std::string(name) + ".cso");
+		}
+	}
+}
+
+void Graphics::CreateTestCube() { //pDevice creates stuff and pContext issues commands
+	//Everything here is immutable, so it is built once through the caches and only bound per draw
+	HRESULT hr;
+
+	//a mesh file is mapped and its blobs go to CreateBuffer() as they are, the built in arrays are the fallback during development
+	MeshFile cubeMesh;
+	MeshFile::Stream vertices = { TestCube::vertices, sizeof(TestCube::vertices), sizeof(TestCube::Vertex) };
+	MeshFile::Indices indices = { TestCube::indices, std::size(TestCube::indices), sizeof(unsigned short) };
+	MeshFile::Attribute position = { "POSITION", 0u, MeshFile::Format::Float3, 0u, 0u };
+	MeshFile::Dequantization dequantization = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+	if(std::filesystem::exists("TestCube.mesh")) {
+		cubeMesh = MeshFile("TestCube.mesh");
+		const auto* pPosition = cubeMesh.FindAttribute("POSITION");
+		//the vertex shaders take float or R16G16B16A16_SNORM positions (VertexDecode.hlsli)
+		if(pPosition == nullptr || (pPosition->format != MeshFile::Format::Float3 && pPosition->format != MeshFile::Format::SNorm16x4)) {
+			throw MeshFile::Exception(__LINE__, __FILE__, "TestCube.mesh needs a float3 or snorm16x4 POSITION");
+		}
+		position = *pPosition;
+		vertices = cubeMesh.GetStream(pPosition->stream);
+		indices = cubeMesh.GetIndices();
+		dequantization = cubeMesh.GetDequantization();
+	}
+	const DXGI_FORMAT positionFormat = (DXGI_FORMAT)position.format;
+	const std::string positionKey = "Position." + std::to_string((unsigned int)positionFormat) + "." + std::to_string(position.offset);
+
+	//dequantization constants for VertexDecode.hlsli, two float3 each padded to a register
+	testCube.dequantizationBuffer = buffers.Resolve("TestCube.Dequantization", [&]() {
+		wrl::ComPtr<ID3D11Buffer> pConstantBuffer;
+		const struct {
+			rmath::Float3 scale;
+			float pad0;
+			rmath::Float3 offset;
+			float pad1;
+		} constants = { dequantization.scale, 0.0f, dequantization.offset, 0.0f };
+		D3D11_BUFFER_DESC cbd = {};
+		cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		cbd.ByteWidth = sizeof(constants);
+		cbd.CPUAccessFlags = 0u;
+		cbd.MiscFlags = 0u;
+		cbd.StructureByteStride = 0u;
+		cbd.Usage = D3D11_USAGE_IMMUTABLE;
+		D3D11_SUBRESOURCE_DATA csd = {};
+		csd.pSysMem = &constants;
+		GFX_THROW_INFO(pDevice->CreateBuffer(&cbd, &csd, &pConstantBuffer));
+		return pConstantBuffer;
+	});
 
 	//Make a vertex buffer
-	Vertex vertices[] = {
-		{-1.0f, -1.0f, -1.0f },
-		{ 1.0f, -1.0f, -1.0f },
-		{-1.0f,  1.0f, -1.0f },
-		{ 1.0f,  1.0f, -1.0f },
-		{-1.0f, -1.0f,  1.0f },
-		{ 1.0f, -1.0f,  1.0f },
-		{-1.0f,  1.0f,  1.0f },
-		{ 1.0f,  1.0f,  1.0f },
-	};
-	//vertices[0].color.r = 0;
-	//vertices[0].color.g = 0;
-	//vertices[0].color.b = 255;
-
-	wrl::ComPtr<ID3D11Buffer> pVertextBuffer;
-	D3D11_BUFFER_DESC bd = {};
-	bd.ByteWidth = sizeof(vertices);
-	bd.StructureByteStride = sizeof(Vertex);
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	bd.CPUAccessFlags = 0u;
-	bd.MiscFlags = 0u;
-	D3D11_SUBRESOURCE_DATA sd = {};
-	sd.pSysMem = vertices;
-	//Create buffer
-	GFX_THROW_INFO(pDevice->CreateBuffer(&bd, &sd, &pVertextBuffer));
-	//bind vertex buffer to pipeline
-	const UINT stride = sizeof(Vertex);
-	const UINT offset = 0u;
-	pContext->IASetVertexBuffers(0u, 1u, pVertextBuffer.GetAddressOf(), &stride, &offset);
+	testCube.vertexBuffer = buffers.Resolve("TestCube.Vertices", [&]() {
+		wrl::ComPtr<ID3D11Buffer> pVertextBuffer;
+		D3D11_BUFFER_DESC bd = {};
+		bd.ByteWidth = (UINT)vertices.size;
+		bd.StructureByteStride = vertices.stride;
+		bd.Usage = D3D11_USAGE_IMMUTABLE;
+		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bd.CPUAccessFlags = 0u;
+		bd.MiscFlags = 0u;
+		D3D11_SUBRESOURCE_DATA sd = {};
+		sd.pSysMem = vertices.pData;
+		GFX_THROW_INFO(pDevice->CreateBuffer(&bd, &sd, &pVertextBuffer));
+		return pVertextBuffer;
+	});
+	testCube.vertexStride = vertices.stride;
 
 	//Make an index buffer
-	const unsigned short indices[] = {
-		0,2,1, 2,3,1,
-		1,3,5, 3,7,5,
-		2,6,3, 3,6,7,
-		4,5,7, 4,7,6,
-		0,4,2, 2,4,6,
-		0,1,4, 1,5,4
-	};
-	
-	wrl::ComPtr<ID3D11Buffer> pIndexBuffer;
-	D3D11_BUFFER_DESC ibd = {};
-	ibd.ByteWidth = sizeof(indices);
-	ibd.StructureByteStride = sizeof(unsigned short);
-	ibd.Usage = D3D11_USAGE_DEFAULT;
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.CPUAccessFlags = 0u;
-	ibd.MiscFlags = 0u;
-	D3D11_SUBRESOURCE_DATA isd = {};
-	isd.pSysMem = indices;
-	//Create index buffer
-	GFX_THROW_INFO(pDevice->CreateBuffer(&ibd, &isd, &pIndexBuffer));
-	//bind index buffer
-	pContext->IASetIndexBuffer(pIndexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0u);
-
-	//Make constant buffer for shape transformation
+	testCube.indexSize = indices.indexSize;
+	testCube.lods.clear();
+	for(std::size_t i = 0u; i < cubeMesh.GetLodCount(); i++) {
+		testCube.lods.push_back(cubeMesh.GetLod(i));
+	}
+	if(testCube.lods.empty()) {
+		testCube.lods.push_back({ 0u, (std::uint32_t)indices.count, 0.0f });
+	}
+	testCube.indexBuffer = buffers.Resolve("TestCube.Indices", [&]() {
+		wrl::ComPtr<ID3D11Buffer> pIndexBuffer;
+		D3D11_BUFFER_DESC ibd = {};
+		ibd.ByteWidth = (UINT)(indices.count * indices.indexSize);
+		ibd.StructureByteStride = indices.indexSize;
+		ibd.Usage = D3D11_USAGE_IMMUTABLE;
+		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		ibd.CPUAccessFlags = 0u;
+		ibd.MiscFlags = 0u;
+		D3D11_SUBRESOURCE_DATA isd = {};
+		isd.pSysMem = indices.pData;
+		GFX_THROW_INFO(pDevice->CreateBuffer(&ibd, &isd, &pIndexBuffer));
+		return pIndexBuffer;
+	});
+
+	//face colors never change so they get an immutable constant buffer
+	testCube.faceColorBuffer = buffers.Resolve("TestCube.FaceColors", [&]() {
+		wrl::ComPtr<ID3D11Buffer> pConstantBuffer2;
+		D3D11_BUFFER_DESC cbd2 = {};
+		cbd2.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		cbd2.ByteWidth = sizeof(TestCube::faceColors);
+		cbd2.CPUAccessFlags = 0u;
+		cbd2.MiscFlags = 0u;
+		cbd2.StructureByteStride = 0u;
+		cbd2.Usage = D3D11_USAGE_IMMUTABLE;
+		D3D11_SUBRESOURCE_DATA cbs2 = {};
+		cbs2.pSysMem = &TestCube::faceColors;
+		GFX_THROW_INFO(pDevice->CreateBuffer(&cbd2, &cbs2, &pConstantBuffer2));
+		return pConstantBuffer2;
+	});
+
+	//create pixel shader
+	testCube.pixelShader = pixelShaders.Resolve("PixelShader", [&]() {
+		wrl::ComPtr<ID3D11PixelShader> pPixelShader;
+		const auto bytecode = shaders.Get("PixelShader");
+		GFX_THROW_INFO(pDevice->CreatePixelShader(bytecode.pData, bytecode.size, nullptr, &pPixelShader));
+		return pPixelShader;
+	});
+
+	//create vertex shader, the bytecode is also needed for the input layout
+	const auto vsBytecode = shaders.Get("VertexShader");
+	testCube.vertexShader = vertexShaders.Resolve("VertexShader", [&]() {
+		wrl::ComPtr<ID3D11VertexShader> pVertexShader;
+		GFX_THROW_INFO(pDevice->CreateVertexShader(vsBytecode.pData, vsBytecode.size, nullptr, &pVertexShader));
+		return pVertexShader;
+	});
+
+	//input (vertex) layout (3D position only)
+	testCube.inputLayout = inputLayouts.Resolve("VertexShader." + positionKey, [&]() {
+		wrl::ComPtr<ID3D11InputLayout> pInputLayout;
+		const D3D11_INPUT_ELEMENT_DESC ied[] = {
+			{"POSITION", 0, positionFormat, 0, position.offset, D3D11_INPUT_PER_VERTEX_DATA, 0},
+			//{"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		};
+		GFX_THROW_INFO(pDevice->CreateInputLayout(
+			ied, 
+			(UINT)std::size(ied), 
+			vsBytecode.pData, 
+			vsBytecode.size, 
+			&pInputLayout
+		));
+		return pInputLayout;
+	});
+
+	//instanced pipeline, vertex slot 0 is the cube geometry and slot 1 the per-instance data
+	testCube.instancePixelShader = pixelShaders.Resolve("InstancePixelShader", [&]() {
+		wrl::ComPtr<ID3D11PixelShader> pPixelShader;
+		const auto bytecode = shaders.Get("InstancePixelShader");
+		GFX_THROW_INFO(pDevice->CreatePixelShader(bytecode.pData, bytecode.size, nullptr, &pPixelShader));
+		return pPixelShader;
+	});
+	const auto instanceVsBytecode = shaders.Get("InstanceVertexShader");
+	testCube.instanceVertexShader = vertexShaders.Resolve("InstanceVertexShader", [&]() {
+		wrl::ComPtr<ID3D11VertexShader> pVertexShader;
+		GFX_THROW_INFO(pDevice->CreateVertexShader(instanceVsBytecode.pData, instanceVsBytecode.size, nullptr, &pVertexShader));
+		return pVertexShader;
+	});
+	testCube.instanceInputLayout = inputLayouts.Resolve("InstanceVertexShader." + positionKey + ".Instance", [&]() {
+		wrl::ComPtr<ID3D11InputLayout> pInputLayout;
+		const D3D11_INPUT_ELEMENT_DESC ied[] = {
+			{"POSITION",  0, positionFormat,                     0, position.offset, D3D11_INPUT_PER_VERTEX_DATA, 0},
+			{"TRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0,  D3D11_INPUT_PER_INSTANCE_DATA, 1},
+			{"TRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+			{"TRANSFORM", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+			{"TRANSFORM", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+			{"COLOR",     0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+		};
+		static_assert(sizeof(CubeInstance) == 80u, "instance layout must match CubeInstance");
+		GFX_THROW_INFO(pDevice->CreateInputLayout(
+			ied,
+			(UINT)std::size(ied),
+			instanceVsBytecode.pData,
+			instanceVsBytecode.size,
+			&pInputLayout
+		));
+		return pInputLayout;
+	});
+}
+
+void Graphics::DrawTestCubesInstanced(const CubeInstance* pInstances, std::size_t count, std::size_t lod) {
+	if(count == 0u) {
+		return;
+	}
+	const auto& range = testCube.lods[std::min(lod, testCube.lods.size() - 1u)];
+	CommandBuffer::DrawCommand cmd = {};
+	cmd.vertexShader = (CommandBuffer::ResourceId)testCube.instanceVertexShader;
+	cmd.pixelShader = (CommandBuffer::ResourceId)testCube.instancePixelShader;
+	cmd.inputLayout = (CommandBuffer::ResourceId)testCube.instanceInputLayout;
+	cmd.vertexBuffer = (CommandBuffer::ResourceId)testCube.vertexBuffer;
+	cmd.indexBuffer = (CommandBuffer::ResourceId)testCube.indexBuffer;
+	cmd.psConstantBuffer = (CommandBuffer::ResourceId)testCube.faceColorBuffer;
+	cmd.vsConstantBuffer = (CommandBuffer::ResourceId)testCube.dequantizationBuffer;
+	cmd.vertexStride = testCube.vertexStride;
+	cmd.indexSize = testCube.indexSize;
+	cmd.indexCount = range.indexCount;
+	cmd.startIndex = range.firstIndex;
+	cmd.instanceCount = (std::uint32_t)count;
+	//instances are copied now, the caller's array is free to change before the replay
+	cmd.instanceOffset = frameCommands.AddPayload(pInstances, count * sizeof(CubeInstance));
+	cmd.instanceStride = sizeof(CubeInstance);
+	cmd.key = CommandBuffer::MakeKey(0u, cmd.vertexShader, cmd.pixelShader, cmd.inputLayout, cmd.vertexBuffer, 0.0f);
+	frameCommands.Record(cmd);
+}
+
+const std::vector<MeshFile::Lod>& Graphics::GetTestCubeLods() const noexcept {
+	return testCube.lods;
+}
+
+void Graphics::DrawTestTriangle(float angle, float x, float y, float z) {
+	//shape transformation goes through the constant ring at replay, no buffer is created per draw
 	struct ConstantBuffer {
 		dx::XMMATRIX transform;
 	};
 	const ConstantBuffer cb = {
-		{ //basic Z-rotation matrix
-			//(3.0f/4.0f)*std::cos(angle),  std::sin(angle), 0.0f,  0.0f,
-			//(3.0f/4.0f)*-std::sin(angle), std::cos(angle), 0.0f,  0.0f,
-			//0.0f,						  0.0f,		       1.0f,  0.0f,
-			//0.0f,						  0.0f,			   0.0f,  1.0f,
+		{
 			dx::XMMatrixTranspose(
 				dx::XMMatrixRotationZ(angle) *
 				dx::XMMatrixRotationX(angle) *
 				dx::XMMatrixTranslation(x, y, z) *
-				dx::XMMatrixPerspectiveLH(1.0f, 3.0f/4.0f, 0.5f, 10.0f)
+				dx::XMMatrixPerspectiveLH(TestCube::projWidth, TestCube::projHeight, TestCube::nearZ, TestCube::farZ)
 			)
 		}
 	};
-	wrl::ComPtr<ID3D11Buffer> pConstantBuffer;
-	D3D11_BUFFER_DESC cbd = {};
-	cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	cbd.ByteWidth = sizeof(cb);
-	cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	cbd.MiscFlags = 0u;
-	cbd.StructureByteStride = 0u;
-	cbd.Usage = D3D11_USAGE_DYNAMIC;
-	D3D11_SUBRESOURCE_DATA csd = {};
-	csd.pSysMem = &cb;
-	GFX_THROW_INFO(pDevice->CreateBuffer(&cbd, &csd, &pConstantBuffer));
-	//bind constant buffer
-	pContext->VSSetConstantBuffers(0u, 1u, pConstantBuffer.GetAddressOf());
-
-	struct ConstantBuffer2 {
-		struct {
-			float r, g, b, a;
-		} face_colors[6];
-	};
+	static_assert(sizeof(cb) <= maxDrawConstantsSize, "per-draw constants outgrew the fallback constant buffer");
+	CommandBuffer::DrawCommand cmd = {};
+	cmd.vertexShader = (CommandBuffer::ResourceId)testCube.vertexShader;
+	cmd.pixelShader = (CommandBuffer::ResourceId)testCube.pixelShader;
+	cmd.inputLayout = (CommandBuffer::ResourceId)testCube.inputLayout;
+	cmd.vertexBuffer = (CommandBuffer::ResourceId)testCube.vertexBuffer;
+	cmd.indexBuffer = (CommandBuffer::ResourceId)testCube.indexBuffer;
+	cmd.psConstantBuffer = (CommandBuffer::ResourceId)testCube.faceColorBuffer;
+	cmd.vsConstantBuffer = (CommandBuffer::ResourceId)testCube.dequantizationBuffer;
+	cmd.vertexStride = testCube.vertexStride;
+	cmd.indexSize = testCube.indexSize;
+	cmd.indexCount = testCube.lods[0].indexCount;
+	cmd.startIndex = testCube.lods[0].firstIndex;
+	cmd.instanceCount = 1u;
+	cmd.vsConstantsOffset = frameCommands.AddPayload(&cb, sizeof(cb));
+	cmd.vsConstantsSize = sizeof(cb);
+	//nearer cubes first so depth testing rejects more of what is behind them
+	cmd.key = CommandBuffer::MakeKey(0u, cmd.vertexShader, cmd.pixelShader, cmd.inputLayout, cmd.vertexBuffer, z / TestCube::farZ);
+	frameCommands.Record(cmd);
+}
 
-	const ConstantBuffer2 cb2 = {
-		{
-			{1.0f, 0.0f, 1.0f},
-			{1.0f, 0.0f, 0.0f},
-			{0.0f, 1.0f, 0.0f},
-			{0.0f, 0.0f, 1.0f},
-			{1.0f, 1.0f, 0.0f},
-			{0.0f, 1.0f, 1.0f},
+void Graphics::Submit(CommandBuffer& commands) {
+	FlushCommands();
+	if(commands.Empty()) {
+		return;
+	}
+	BindFixedState();
+	commands.Sort();
+	commands.Submit(backend);
+}
+
+void Graphics::FlushCommands() {
+	if(frameCommands.Empty()) {
+		return;
+	}
+	BindFixedState();
+	frameCommands.Sort();
+	frameCommands.Submit(backend);
+	frameCommands.Reset();
+}
+
+void Graphics::BindFixedState() {
+	//not carried by the commands, the shadow drops these after the first replay of a frame
+	if(shadow.SetTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST)) {
+		pContext->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	}
+	D3D11_VIEWPORT vp;
+	vp.Width = (float)width;
+	vp.Height = (float)height;
+	vp.MaxDepth = 1;
+	vp.MinDepth = 0;
+	vp.TopLeftX = 0;
+	vp.TopLeftY = 0;
+	if(shadow.SetViewport({ vp.TopLeftX, vp.TopLeftY, vp.Width, vp.Height, vp.MinDepth, vp.MaxDepth })) {
+		pContext->RSSetViewports(1u, &vp);
+	}
+}
+
+void Graphics::UploadInstances(const void* pData, std::size_t count, std::size_t stride) {
+	HRESULT hr;
+
+	const std::size_t size = count * stride;
+	//grow the instance buffer to the next power of two so resizes stop after a few frames
+	if(size > instanceCapacity) {
+		std::size_t capacity = instanceCapacity == 0u ? 64u * sizeof(CubeInstance) : instanceCapacity;
+		while(capacity < size) {
+			capacity *= 2u;
 		}
-	};
+		D3D11_BUFFER_DESC bd = {};
+		bd.ByteWidth = (UINT)capacity;
+		bd.StructureByteStride = 0u;
+		bd.Usage = D3D11_USAGE_DYNAMIC;
+		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bd.MiscFlags = 0u;
+		pInstanceBuffer.Reset();
+		GFX_THROW_INFO(pDevice->CreateBuffer(&bd, nullptr, &pInstanceBuffer));
+		instanceCapacity = capacity;
+	}
 
-	wrl::ComPtr<ID3D11Buffer> pConstantBuffer2;
-	D3D11_BUFFER_DESC cbd2;
-	cbd2.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	cbd2.ByteWidth = sizeof(cb2);
-	cbd2.CPUAccessFlags = 0u;
-	cbd2.MiscFlags = 0u;
-	cbd2.StructureByteStride = 0u;
-	cbd2.Usage = D3D11_USAGE_DEFAULT;
-	D3D11_SUBRESOURCE_DATA cbs2 = {};
-	cbs2.pSysMem = &cb2;
-	GFX_THROW_INFO(pDevice->CreateBuffer(&cbd2, &cbs2, &pConstantBuffer2));
-	//bind constant buffer 2
-	pContext->PSSetConstantBuffers(0u, 1u, pConstantBuffer2.GetAddressOf());
+	//upload all instances with a single map
+	D3D11_MAPPED_SUBRESOURCE msr;
+	GFX_THROW_INFO(pContext->Map(pInstanceBuffer.Get(), 0u, D3D11_MAP_WRITE_DISCARD, 0u, &msr));
+	std::memcpy(msr.pData, pData, size);
+	pContext->Unmap(pInstanceBuffer.Get(), 0u);
 
+	const UINT instanceStride = (UINT)stride;
+	const UINT offset = 0u;
+	if(shadow.SetVertexBuffer(1u, pInstanceBuffer.Get(), instanceStride, offset)) {
+		pContext->IASetVertexBuffers(1u, 1u, pInstanceBuffer.GetAddressOf(), &instanceStride, &offset);
+	}
+}
 
+//Command replay *******************************
+Graphics::ContextBackend::ContextBackend(Graphics& gfx) noexcept
+	: gfx(gfx)
+{}
 
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+DxgiInfoManager* Graphics::ContextBackend::GetInfoManager(Graphics& gfx) noexcept {
+	return gfx.pInfoManager.get();
+}
+#endif
 
-	//create pixel shader
-	wrl::ComPtr<ID3D11PixelShader> pPixelShader;
-	wrl::ComPtr<ID3DBlob> pBlob;
-	GFX_THROW_INFO(D3DReadFileToBlob(L"PixelShader.cso", &pBlob));
-	GFX_THROW_INFO(pDevice->CreatePixelShader(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &pPixelShader));
-	//bind pixel shader
-	pContext->PSSetShader(pPixelShader.Get(), nullptr, 0u);
-
-	//create vertex shader
-	wrl::ComPtr<ID3D11VertexShader> pVertexShader;
-	D3DReadFileToBlob(L"VertexShader.cso", &pBlob); //make sure shader file output path in the compiler is set to the ProjectDirectory instead of OutputDirectory
-	GFX_THROW_INFO(pDevice->CreateVertexShader(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &pVertexShader));
-	//bind vertex shader
-	pContext->VSSetShader(pVertexShader.Get(), nullptr, 0u); //remember that to get the single-pointer address of a ComPtr you need to use .Get()
-
-	//input (vertex) layout (2D position only)
-	wrl::ComPtr<ID3D11InputLayout> pInputLayout;
-	const D3D11_INPUT_ELEMENT_DESC ied[] = {
-		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-		//{"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
-	};
-	//create Input Layout
-	GFX_THROW_INFO(pDevice->CreateInputLayout(
-		ied, 
-		(UINT)std::size(ied), 
-		pBlob->GetBufferPointer(), 
-		pBlob->GetBufferSize(), 
-		&pInputLayout
-	));
-	//bind input layout
-	pContext->IASetInputLayout(pInputLayout.Get());
+void Graphics::ContextBackend::SetVertexShader(ResourceId id) {
+	INFOMAN(gfx);
+	ID3D11VertexShader* const pShader = gfx.vertexShaders.Get(id).Get();
+	if(gfx.shadow.SetVertexShader(pShader)) {
+		GFX_THROW_INFO_ONLY(gfx.pContext->VSSetShader(pShader, nullptr, 0u));
+	}
+}
 
-	//bind render target
-	//pContext->OMSetRenderTargets(1u, pTarget.GetAddressOf(), nullptr); //OutputMerger set render target
+void Graphics::ContextBackend::SetPixelShader(ResourceId id) {
+	INFOMAN(gfx);
+	ID3D11PixelShader* const pShader = gfx.pixelShaders.Get(id).Get();
+	if(gfx.shadow.SetPixelShader(pShader)) {
+		GFX_THROW_INFO_ONLY(gfx.pContext->PSSetShader(pShader, nullptr, 0u));
+	}
+}
 
-	//Set triangle topology list
-	pContext->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+void Graphics::ContextBackend::SetInputLayout(ResourceId id) {
+	INFOMAN(gfx);
+	ID3D11InputLayout* const pLayout = gfx.inputLayouts.Get(id).Get();
+	if(gfx.shadow.SetInputLayout(pLayout)) {
+		GFX_THROW_INFO_ONLY(gfx.pContext->IASetInputLayout(pLayout));
+	}
+}
 
-	//configure viewport
-	D3D11_VIEWPORT vp;
-	vp.Width = 800;
-	vp.Height = 600;
-	vp.MaxDepth = 1;
-	vp.MinDepth = 0;
-	vp.TopLeftX = 0;
-	vp.TopLeftY = 0;
-	pContext->RSSetViewports(1u, &vp);
+void Graphics::ContextBackend::SetVertexBuffer(ResourceId id, std::uint32_t stride) {
+	INFOMAN(gfx);
+	const UINT offset = 0u;
+	const auto& pBuffer = gfx.buffers.Get(id);
+	if(gfx.shadow.SetVertexBuffer(0u, pBuffer.Get(), stride, offset)) {
+		GFX_THROW_INFO_ONLY(gfx.pContext->IASetVertexBuffers(0u, 1u, pBuffer.GetAddressOf(), &stride, &offset));
+	}
+}
+
+void Graphics::ContextBackend::SetIndexBuffer(ResourceId id, std::uint32_t indexSize) {
+	INFOMAN(gfx);
+	ID3D11Buffer* const pBuffer = gfx.buffers.Get(id).Get();
+	const DXGI_FORMAT format = indexSize == 4u ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+	if(gfx.shadow.SetIndexBuffer(pBuffer, format, 0u)) {
+		GFX_THROW_INFO_ONLY(gfx.pContext->IASetIndexBuffer(pBuffer, format, 0u));
+	}
+}
+
+void Graphics::ContextBackend::SetPSConstantBuffer(ResourceId id) {
+	INFOMAN(gfx);
+	const auto& pBuffer = gfx.buffers.Get(id);
+	if(gfx.shadow.SetPSConstantBuffer(0u, pBuffer.Get())) {
+		GFX_THROW_INFO_ONLY(gfx.pContext->PSSetConstantBuffers(0u, 1u, pBuffer.GetAddressOf()));
+	}
+}
+
+void Graphics::ContextBackend::SetVSConstantBuffer(ResourceId id) {
+	if(id == NoResource) {
+		return;
+	}
+	INFOMAN(gfx);
+	//slot 0 belongs to the per-draw constants from the ring
+	const auto& pBuffer = gfx.buffers.Get(id);
+	if(gfx.shadow.SetVSConstantBuffer(1u, pBuffer.Get())) {
+		GFX_THROW_INFO_ONLY(gfx.pContext->VSSetConstantBuffers(1u, 1u, pBuffer.GetAddressOf()));
+	}
+}
+
+void Graphics::ContextBackend::SetVSConstants(const void* pData, std::size_t size) {
+	gfx.BindVSConstants(0u, pData, (UINT)size);
+}
+
+void Graphics::ContextBackend::SetInstanceData(const void* pData, std::uint32_t count, std::uint32_t stride) {
+	gfx.UploadInstances(pData, count, stride);
+}
 
-	GFX_THROW_INFO_ONLY(pContext->DrawIndexed((UINT)std::size(indices), 0u, 0u));
+void Graphics::ContextBackend::DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount, std::uint32_t startIndex, std::int32_t baseVertex) {
+	INFOMAN(gfx);
+	GFX_THROW_INFO_AT(Draw, gfx.pContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, 0u));
 }
 
 //Info exception stuff *******************************
@@ -3,12 +3,22 @@
 #include "UrielException.h"
 #include "GraphicsThrowMacros.h"
 #include "DxgiInfoManager.h"
+#include "ResourceCache.h"
+#include "ShaderStore.h"
+#include "ConstantRing.h"
+#include "CommandBuffer.h"
+#include "ShadowState.h"
+#include "MeshFile.h"
+#include "FrameArena.h"
 #include <sstream>
 #include <wrl.h>
 #include <vector>
 #include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
+#include <DirectXMath.h>
 #include <memory>
+#include <cstdint>
 
 
 
@@ -50,24 +60,141 @@ public:
 		std::string reason;
 	};
 
-	Graphics(HWND hWnd);
+	//per-instance data for DrawTestCubesInstanced, matches the instance stream in InstanceVertexShader.hlsl
+	struct CubeInstance {
+		DirectX::XMFLOAT4X4 transform; //transposed world * view * projection
+		DirectX::XMFLOAT4 color; //multiplied with the face colors
+	};
+
+	//validation tiers, see GraphicsThrowMacros.h; a tier above GFX_VALIDATION runs as GFX_VALIDATION
+	enum class Validation {
+		Off = GFX_VALIDATION_OFF,
+		Light = GFX_VALIDATION_LIGHT,
+		Full = GFX_VALIDATION_FULL
+	};
+	static constexpr Validation maxValidation = Validation(GFX_VALIDATION);
+
+	Graphics(HWND hWnd, Validation validation = maxValidation);
+	//headless: renders into an offscreen target of the given size, no window or swap chain involved
+	Graphics(unsigned int width, unsigned int height, Validation validation = maxValidation);
 	Graphics(const Graphics&) = delete; //delete copy constructor and assignment
 	Graphics& operator=(const Graphics&) = delete;
 	~Graphics() = default;
 	void EndFrame();
-	void ClearBuffer(float red, float green, float blue) noexcept;
+	void ClearBuffer(float red, float green, float blue);
+	//draws are recorded into the frame's command buffer and replayed state sorted on the next
+	//ClearBuffer(), EndFrame() or ReadPixels()
 	void DrawTestTriangle(float angle, float x, float y, float z);
+	//draw count test cubes at one lod of GetTestCubeLods() with one DrawIndexedInstanced call
+	void DrawTestCubesInstanced(const CubeInstance* pInstances, std::size_t count, std::size_t lod = 0u);
+	//index ranges of the test cube's lods, full detail first (just that one for the built in cube)
+	const std::vector<MeshFile::Lod>& GetTestCubeLods() const noexcept;
+	//sort and replay a command buffer recorded elsewhere (ids are this Graphics' cache handles), after anything pending
+	void Submit(CommandBuffer& commands);
+	bool IsHeadless() const noexcept;
+	unsigned int GetWidth() const noexcept;
+	unsigned int GetHeight() const noexcept;
+	//state calls sent to / dropped before the context during the last finished frame
+	const ShadowState::Stats& GetStateStats() const noexcept;
+	//copy the current color target to the CPU, B8G8R8A8 packed as 0xAARRGGBB (same as SoftwareRasterizer)
+	void ReadPixels(std::vector<std::uint32_t>& pixels);
+	//scratch memory for this frame, EndFrame() resets it
+	FrameArena& GetFrameArena() noexcept;
+	//what this Graphics was created with, after clamping to maxValidation
+	Validation GetValidation() const noexcept;
+	//how often the debug layer's messages are drained, only at Validation::Full
+	void SetInfoGranularity(InfoDrain::Granularity granularity) noexcept;
 private:
+	//replays command buffers into the immediate context, ids are handles into the resource caches
+	class ContextBackend : public CommandBackend {
+	public:
+		ContextBackend(Graphics& gfx) noexcept;
+		void SetVertexShader(ResourceId id) override;
+		void SetPixelShader(ResourceId id) override;
+		void SetInputLayout(ResourceId id) override;
+		void SetVertexBuffer(ResourceId id, std::uint32_t stride) override;
+		void SetIndexBuffer(ResourceId id, std::uint32_t indexSize) override;
+		void SetPSConstantBuffer(ResourceId id) override;
+		void SetVSConstantBuffer(ResourceId id) override;
+		void SetVSConstants(const void* pData, std::size_t size) override;
+		void SetInstanceData(const void* pData, std::uint32_t count, std::uint32_t stride) override;
+		void DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount, std::uint32_t startIndex, std::int32_t baseVertex) override;
+	private:
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+		//null unless running at Validation::Full
+		static DxgiInfoManager* GetInfoManager(Graphics& gfx) noexcept;
+#endif
+		Graphics& gfx;
+	};
+private:
+	//render target view, depth buffer and depth state for the given color target
+	void CreateTargets(ID3D11Texture2D* pColorTarget);
+	void CreateConstantRing();
+	//upload constants for this draw through the ring and bind them to a VS slot
+	void BindVSConstants(UINT slot, const void* pData, UINT size);
+	void LoadShaders();
+	void CreateTestCube();
+	//sort and replay everything recorded since the last flush
+	void FlushCommands();
+	//topology and viewport every replayed draw relies on, before each replay
+	void BindFixedState();
+	//copy instances into the per-instance stream (slot 1), growing it when needed
+	void UploadInstances(const void* pData, std::size_t count, std::size_t stride);
+private:
+	//stable handles into the resource caches for the test cube pipeline
+	struct TestCubeHandles {
+		ResourceCache<Microsoft::WRL::ComPtr<ID3D11Buffer>>::Handle vertexBuffer;
+		ResourceCache<Microsoft::WRL::ComPtr<ID3D11Buffer>>::Handle indexBuffer;
+		ResourceCache<Microsoft::WRL::ComPtr<ID3D11Buffer>>::Handle faceColorBuffer;
+		ResourceCache<Microsoft::WRL::ComPtr<ID3D11Buffer>>::Handle dequantizationBuffer;
+		ResourceCache<Microsoft::WRL::ComPtr<ID3D11VertexShader>>::Handle vertexShader;
+		ResourceCache<Microsoft::WRL::ComPtr<ID3D11PixelShader>>::Handle pixelShader;
+		ResourceCache<Microsoft::WRL::ComPtr<ID3D11InputLayout>>::Handle inputLayout;
+		ResourceCache<Microsoft::WRL::ComPtr<ID3D11VertexShader>>::Handle instanceVertexShader;
+		ResourceCache<Microsoft::WRL::ComPtr<ID3D11PixelShader>>::Handle instancePixelShader;
+		ResourceCache<Microsoft::WRL::ComPtr<ID3D11InputLayout>>::Handle instanceInputLayout;
+		UINT vertexStride;
+		UINT indexSize;
+		std::vector<MeshFile::Lod> lods;
+	};
 	//ID3D11Device* pDevice = nullptr;
 	//IDXGISwapChain* pSwap = nullptr;
 	//ID3D11DeviceContext* pContext = nullptr;
 	//ID3D11RenderTargetView* pTarget = nullptr;
-#ifndef NDEBUG
-	DxgiInfoManager infoManager;
+	Validation validation;
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+	std::unique_ptr<DxgiInfoManager> pInfoManager; //only at Validation::Full, dxgidebug.dll is not on every machine
 #endif
 	Microsoft::WRL::ComPtr<ID3D11Device> pDevice;
 	Microsoft::WRL::ComPtr<IDXGISwapChain> pSwap;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext> pContext;
 	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> pTarget;
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> pDSV;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> pColorBuffer; //back buffer or offscreen target
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> pReadback; //staging copy for ReadPixels
+	unsigned int width = 0u;
+	unsigned int height = 0u;
+	//per-draw constants are sub-allocated from one dynamic buffer
+	static constexpr UINT constantRingSize = 1024u * 1024u;
+	//largest block a single draw uploads (one transform matrix), sizes the buffer when offsets are unsupported
+	static constexpr UINT maxDrawConstantsSize = 64u;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> pContext1; //only set when constant buffer offsets are supported
+	Microsoft::WRL::ComPtr<ID3D11Buffer> pConstantRing;
+	ConstantRing constantRing;
+	//resources that are created once and reused every frame
+	ShaderStore shaders;
+	ResourceCache<Microsoft::WRL::ComPtr<ID3D11Buffer>> buffers;
+	ResourceCache<Microsoft::WRL::ComPtr<ID3D11VertexShader>> vertexShaders;
+	ResourceCache<Microsoft::WRL::ComPtr<ID3D11PixelShader>> pixelShaders;
+	ResourceCache<Microsoft::WRL::ComPtr<ID3D11InputLayout>> inputLayouts;
+	TestCubeHandles testCube = {};
+	//per-instance stream, grows on demand and is rewritten with Map(DISCARD) every instanced draw
+	Microsoft::WRL::ComPtr<ID3D11Buffer> pInstanceBuffer;
+	std::size_t instanceCapacity = 0u; //in bytes
+	//every state call goes through here first so redundant ones never reach the context
+	ShadowState shadow;
+	//draws recorded this frame
+	CommandBuffer frameCommands;
+	FrameArena frameArena;
+	ContextBackend backend{ *this };
 };
\ No newline at end of file
@@ -1,30 +1,51 @@
 #pragma once
 
-//Need HRESULT hr in each local scope(function) for these HR macros to work
-
-#pragma once
-
 // HRESULT hr should exist in the local scope for these macros to work
 
+// validation tiers, Graphics runs at the one it was created with (Graphics::Validation) but never above
+// GFX_VALIDATION, the highest tier compiled in:
+//	OFF   no debug device and no info queue, the hot path keeps only the HRESULTs it cannot go on without
+//	LIGHT same, plus device removal checked at every EndFrame() (headless frames have no Present() to report it)
+//	FULL  debug device, info queue messages drained at InfoDrain check points and attached to exceptions
+// Builds below FULL compile the info queue out entirely, debug builds default to FULL and release builds to LIGHT
+#define GFX_VALIDATION_OFF 0
+#define GFX_VALIDATION_LIGHT 1
+#define GFX_VALIDATION_FULL 2
+#ifndef GFX_VALIDATION
+#ifndef NDEBUG
+#define GFX_VALIDATION GFX_VALIDATION_FULL
+#else
+#define GFX_VALIDATION GFX_VALIDATION_LIGHT
+#endif
+#endif
+
 #define GFX_EXCEPT_NOINFO(hr) Graphics::HrException( __LINE__,__FILE__,(hr) )
 #define GFX_THROW_NOINFO(hrcall) if( FAILED( hr = (hrcall) ) ) throw Graphics::HrException( __LINE__,__FILE__,hr )
 
-#ifndef NDEBUG
-#define GFX_EXCEPT(hr) Graphics::HrException( __LINE__,__FILE__,(hr),infoManager.GetMessages() )
-#define GFX_THROW_INFO(hrcall) infoManager.Set(); if( FAILED( hr = (hrcall) ) ) throw GFX_EXCEPT(hr)
-#define GFX_DEVICE_REMOVED_EXCEPT(hr) Graphics::DeviceRemovedException( __LINE__,__FILE__,(hr),infoManager.GetMessages() )
-#define GFX_THROW_INFO_ONLY(call) infoManager.Set(); (call); {auto v = infoManager.GetMessages(); if(!v.empty()) {throw Graphics::InfoException( __LINE__,__FILE__,v);}}
+// debug layer messages are drained at check points (InfoDrain::Granularity), a failed HRESULT carries
+// every message pending since the last check. pInfoManager is null unless running at FULL
+// the check macros are single statements at every tier, so they are safe in an unbraced if/else
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+#define GFX_INFO_MESSAGES() ( pInfoManager ? pInfoManager->GetMessages() : std::vector<std::string>{} )
+#define GFX_EXCEPT(hr) Graphics::HrException( __LINE__,__FILE__,(hr),GFX_INFO_MESSAGES() )
+#define GFX_THROW_INFO(hrcall) if( FAILED( hr = (hrcall) ) ) throw GFX_EXCEPT(hr)
+#define GFX_DEVICE_REMOVED_EXCEPT(hr) Graphics::DeviceRemovedException( __LINE__,__FILE__,(hr),GFX_INFO_MESSAGES() )
+#define GFX_CHECK_INFO(point) do { if( pInfoManager && pInfoManager->Check( InfoDrain::Granularity::point ) ) {throw Graphics::InfoException( __LINE__,__FILE__,pInfoManager->GetMessages() );} } while(0)
+#define GFX_THROW_INFO_AT(point,call) do { (call); GFX_CHECK_INFO(point); } while(0)
+#define GFX_THROW_INFO_ONLY(call) GFX_THROW_INFO_AT(Call,call)
 #else
 #define GFX_EXCEPT(hr) Graphics::HrException( __LINE__,__FILE__,(hr) )
 #define GFX_THROW_INFO(hrcall) GFX_THROW_NOINFO(hrcall)
 #define GFX_DEVICE_REMOVED_EXCEPT(hr) Graphics::DeviceRemovedException( __LINE__,__FILE__,(hr) )
-#define GFX_THROW_INFO_ONLY(call) (call)
+#define GFX_CHECK_INFO(point) do {} while(0)
+#define GFX_THROW_INFO_AT(point,call) do { (call); } while(0)
+#define GFX_THROW_INFO_ONLY(call) GFX_THROW_INFO_AT(Call,call)
 #endif
 
 // macro for importing infomanager into local scope
 // this.GetInfoManager(Graphics& gfx) must exist
-#ifdef NDEBUG
-#define INFOMAN(gfx) HRESULT hr
+#if GFX_VALIDATION >= GFX_VALIDATION_FULL
+#define INFOMAN(gfx) HRESULT hr; DxgiInfoManager* const pInfoManager = GetInfoManager((gfx))
 #else
-#define INFOMAN(gfx) HRESULT hr; DxgiInfoManager& infoManager = GetInfoManager((gfx))
-#endif
\ No newline at end of file
+#define INFOMAN(gfx) HRESULT hr
+#endif
@@ -0,0 +1,115 @@
+#include "InfoDrain.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	std::size_t Hash(std::int32_t id) noexcept {
+		return std::size_t(std::uint32_t(id) * 2654435761u);
+	}
+}
+
+InfoDrain::InfoDrain(Source& source, Granularity granularity, std::size_t maxEntries, std::size_t textCapacity)
+	:
+	source(source),
+	granularity(granularity),
+	maxEntries(std::max<std::size_t>(maxEntries, 1u)),
+	pText(std::make_unique<char[]>(std::max<std::size_t>(textCapacity, 1u))),
+	textCapacity(std::max<std::size_t>(textCapacity, 1u))
+{
+	entries.reserve(this->maxEntries);
+	std::size_t slotCount = 1u;
+	while(slotCount < 2u * this->maxEntries) {
+		slotCount *= 2u;
+	}
+	slots.assign(slotCount, -1);
+}
+
+void InfoDrain::SetGranularity(Granularity granularity) noexcept {
+	this->granularity = granularity;
+}
+
+InfoDrain::Granularity InfoDrain::GetGranularity() const noexcept {
+	return granularity;
+}
+
+std::size_t InfoDrain::Drain() {
+	//the common case is an empty queue, one count query and nothing else
+	const std::uint64_t count = source.GetStoredCount();
+	if(count == 0u) {
+		return 0u;
+	}
+	for(std::uint64_t i = 0u; i < count; i++) {
+		Add(source.GetMessage(i));
+	}
+	//clearing instead of remembering where we stopped also keeps the queue below its message limit,
+	//where it would start discarding and the indices would shift
+	source.Clear();
+	stats.drains++;
+	stats.messages += std::size_t(count);
+	return std::size_t(count);
+}
+
+const std::vector<InfoDrain::Entry>& InfoDrain::GetEntries() const noexcept {
+	return entries;
+}
+
+const char* InfoDrain::GetText(const Entry& entry) const noexcept {
+	return pText.get() + entry.textOffset;
+}
+
+std::vector<std::string> InfoDrain::TakeMessages() {
+	Drain();
+	std::vector<std::string> messages;
+	messages.reserve(entries.size() + 1u);
+	//appended piece by piece, operator+ on a literal trips a false -Wrestrict in GCC 12
+	for(const auto& e : entries) {
+		messages.emplace_back(GetText(e), e.textLength);
+		if(e.count > 1u) {
+			messages.back() += " [x";
+			messages.back() += std::to_string(e.count);
+			messages.back() += ']';
+		}
+	}
+	if(pendingDropped > 0u) {
+		messages.emplace_back("[");
+		messages.back() += std::to_string(pendingDropped);
+		messages.back() += " more messages dropped]";
+	}
+	Clear();
+	return messages;
+}
+
+void InfoDrain::Clear() noexcept {
+	entries.clear();
+	std::fill(slots.begin(), slots.end(), -1);
+	textUsed = 0u;
+	pendingDropped = 0u;
+}
+
+const InfoDrain::Stats& InfoDrain::GetStats() const noexcept {
+	return stats;
+}
+
+void InfoDrain::Add(const Source::Message& message) noexcept {
+	const std::size_t mask = slots.size() - 1u;
+	std::size_t slot = Hash(message.id) & mask;
+	while(slots[slot] >= 0) {
+		Entry& e = entries[std::size_t(slots[slot])];
+		if(e.id == message.id) {
+			//same ID is the same complaint, only its first text is kept
+			e.count++;
+			stats.duplicates++;
+			return;
+		}
+		slot = (slot + 1u) & mask;
+	}
+	if(entries.size() == maxEntries || message.length > textCapacity - textUsed) {
+		pendingDropped++;
+		stats.dropped++;
+		return;
+	}
+	std::memcpy(pText.get() + textUsed, message.pText, message.length);
+	slots[slot] = std::int32_t(entries.size());
+	entries.push_back({ message.id, message.severity, 1u, textUsed, message.length });
+	textUsed += message.length;
+}
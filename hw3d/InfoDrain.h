@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+//Collects debug layer messages without allocating.
+//A Source is anything that stores messages by index until cleared (DxgiInfoManager wraps IDXGIInfoQueue with it,
+//tests can use a fake). Drain() reads everything stored in one batch, clears the source and folds the batch into
+//the messages pending since the last TakeMessages(): repeats of a message ID only count up, new text is copied
+//into a buffer allocated once. Whatever does not fit is counted as dropped.
+//Check() is what the throw macros call at their check points. Points finer than the configured granularity
+//return at once, so checking per frame costs nothing at the per call sites.
+//Does not depend on D3D or Windows.
+class InfoDrain {
+public:
+	//check points, finest first
+	enum class Granularity {
+		Call, //every wrapped API call
+		Draw, //every draw call
+		Frame //every EndFrame()
+	};
+	//same order as DXGI_INFO_QUEUE_MESSAGE_SEVERITY
+	enum class Severity {
+		Corruption,
+		Error,
+		Warning,
+		Info,
+		Message
+	};
+	class Source {
+	public:
+		struct Message {
+			std::int32_t id;
+			Severity severity;
+			const char* pText; //valid until the next call into the source
+			std::size_t length;
+		};
+	public:
+		virtual ~Source() = default;
+		virtual std::uint64_t GetStoredCount() = 0;
+		//index 0 is the oldest stored message
+		virtual Message GetMessage(std::uint64_t index) = 0;
+		virtual void Clear() = 0;
+	};
+	//one distinct message, text is textLength bytes at GetText()
+	struct Entry {
+		std::int32_t id;
+		Severity severity;
+		std::uint32_t count;
+		std::size_t textOffset;
+		std::size_t textLength;
+	};
+	struct Stats {
+		std::size_t drains = 0u; //Drain() calls that found messages
+		std::size_t messages = 0u; //read from the source
+		std::size_t duplicates = 0u; //folded into an entry that was already pending
+		std::size_t dropped = 0u; //no room left for another entry or its text
+	};
+public:
+	InfoDrain(Source& source, Granularity granularity = Granularity::Call, std::size_t maxEntries = 64u, std::size_t textCapacity = 16u * 1024u);
+	InfoDrain(const InfoDrain&) = delete;
+	InfoDrain& operator=(const InfoDrain&) = delete;
+	void SetGranularity(Granularity granularity) noexcept;
+	Granularity GetGranularity() const noexcept;
+	//drain at check point, true when messages are pending afterwards
+	bool Check(Granularity point) {
+		if(point < granularity) {
+			return false;
+		}
+		Drain();
+		return !entries.empty() || pendingDropped > 0u;
+	}
+	//read every stored message, returns how many
+	std::size_t Drain();
+	const std::vector<Entry>& GetEntries() const noexcept;
+	const char* GetText(const Entry& entry) const noexcept;
+	//pending messages as text (repeats noted with their count), then forget them; allocates, meant for exceptions
+	std::vector<std::string> TakeMessages();
+	//forget the pending messages
+	void Clear() noexcept;
+	const Stats& GetStats() const noexcept;
+private:
+	void Add(const Source::Message& message) noexcept;
+private:
+	Source& source;
+	Granularity granularity;
+	std::size_t maxEntries;
+	std::vector<Entry> entries; //pending, capacity reserved up front
+	//open addressing over entries by ID, -1 is empty; twice maxEntries rounded to a power of two
+	std::vector<std::int32_t> slots;
+	std::unique_ptr<char[]> pText;
+	std::size_t textCapacity;
+	std::size_t textUsed = 0u;
+	std::size_t pendingDropped = 0u;
+	Stats stats;
+};
@@ -0,0 +1,9 @@
+cbuffer Cbuf {
+	float4 face_colors[6];
+};
+
+//SV_PRIMITIVEID restarts at 0 for every instance, so the face lookup is the same as PixelShader.hlsl
+float4 main(float4 color : COLOR, uint tid : SV_PRIMITIVEID) : SV_TARGET
+{
+	return face_colors[(tid/2)%6] * color;
+}
@@ -0,0 +1,18 @@
+#include "VertexDecode.hlsli"
+
+struct VSOut {
+	float4 color : COLOR;
+	float4 pos : SV_POSITION;
+};
+
+//per-instance data comes from vertex buffer slot 1, the transform is stored transposed (same as the constant buffer path)
+VSOut main(float3 pos : POSITION,
+	float4 row0 : TRANSFORM0, float4 row1 : TRANSFORM1, float4 row2 : TRANSFORM2, float4 row3 : TRANSFORM3,
+	float4 color : COLOR)
+{
+	VSOut vso;
+	const matrix transform = matrix(row0, row1, row2, row3); //rows of the transposed matrix, so multiply with the vector on the right
+	vso.pos = mul(transform, float4(DecodePosition(pos), 1.0f));
+	vso.color = color;
+	return vso;
+}
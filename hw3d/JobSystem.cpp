@@ -0,0 +1,276 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+
+namespace {
+	//which system/worker the calling thread belongs to
+	thread_local const JobSystem* pCurrentSystem = nullptr;
+	thread_local int currentWorker = -1;
+	//idle rounds a worker spins through before going to sleep
+	constexpr int spinRounds = 64;
+}
+
+bool JobSystem::Deque::Push(Job* pJob) noexcept {
+	const std::int64_t b = bottom.load(std::memory_order_relaxed);
+	const std::int64_t t = top.load(std::memory_order_acquire);
+	if(b - t >= static_cast<std::int64_t>(jobPoolSize)) {
+		return false;
+	}
+	slots[b & (jobPoolSize - 1u)].store(pJob, std::memory_order_relaxed);
+	//publishes the job's contents along with the slot
+	bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+JobSystem::Job* JobSystem::Deque::Pop() noexcept {
+	const std::int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	std::int64_t t = top.load(std::memory_order_relaxed);
+	if(t > b) {
+		//empty
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	Job* pJob = slots[b & (jobPoolSize - 1u)].load(std::memory_order_relaxed);
+	if(t == b) {
+		//last one, race the thieves for it
+		if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			pJob = nullptr;
+		}
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return pJob;
+}
+
+JobSystem::Job* JobSystem::Deque::Steal() noexcept {
+	std::int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const std::int64_t b = bottom.load(std::memory_order_acquire);
+	if(t >= b) {
+		return nullptr;
+	}
+	Job* pJob = slots[t & (jobPoolSize - 1u)].load(std::memory_order_relaxed);
+	if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return nullptr;
+	}
+	return pJob;
+}
+
+JobSystem::JobSystem(unsigned int threadCount) {
+	if(threadCount == 0u) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+	for(unsigned int i = 0u; i < threadCount; i++) {
+		workers.push_back(std::make_unique<Worker>());
+		workers.back()->rng = 0x9E3779B9u * (i + 1u);
+	}
+	pCurrentSystem = this;
+	currentWorker = 0;
+	for(unsigned int i = 1u; i < threadCount; i++) {
+		threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(sleepMtx);
+		stopping.store(true);
+	}
+	sleepCv.notify_all();
+	for(auto& t : threads) {
+		t.join();
+	}
+	if(pCurrentSystem == this) {
+		pCurrentSystem = nullptr;
+		currentWorker = -1;
+	}
+}
+
+unsigned int JobSystem::GetThreadCount() const noexcept {
+	return static_cast<unsigned int>(workers.size());
+}
+
+void JobSystem::Wait(Counter& counter) noexcept {
+	const int worker = CurrentWorker();
+	int idle = 0;
+	while(!counter.IsDone()) {
+		Job* pJob = worker >= 0 ? FindJob(unsigned(worker)) : nullptr;
+		if(pJob) {
+			Execute(*pJob, unsigned(worker));
+			idle = 0;
+		}
+		else if(++idle > spinRounds) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+JobSystem::Stats JobSystem::GetStats() const noexcept {
+	Stats stats;
+	for(const auto& pWorker : workers) {
+		stats.executed += pWorker->executed.load(std::memory_order_relaxed);
+		stats.stolen += pWorker->stolen.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+void JobSystem::ResetStats() noexcept {
+	for(auto& pWorker : workers) {
+		pWorker->executed.store(0u, std::memory_order_relaxed);
+		pWorker->stolen.store(0u, std::memory_order_relaxed);
+	}
+}
+
+JobSystem::Job* JobSystem::AllocateJob() noexcept {
+	const int worker = CurrentWorker();
+	if(worker >= 0) {
+		Worker& w = *workers[worker];
+		return ClaimJob(w.pool.get(), w.nextJob);
+	}
+	std::lock_guard<std::mutex> lock(externalMtx);
+	return ClaimJob(externalPool.get(), nextExternalJob);
+}
+
+JobSystem::Job* JobSystem::ClaimJob(Job* pPool, std::size_t& next) noexcept {
+	for(std::size_t i = 0u; i < allocateProbes; i++) {
+		Job& job = pPool[next++ & (jobPoolSize - 1u)];
+		//pairs with the release in Execute(), the previous job is done with the slot
+		if(!job.inFlight.load(std::memory_order_acquire)) {
+			job.inFlight.store(true, std::memory_order_relaxed);
+			return &job;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::Submit(Job& job) noexcept {
+	const int worker = CurrentWorker();
+	if(worker >= 0) {
+		if(!workers[worker]->deque.Push(&job)) {
+			//deque full, run it right here instead
+			Execute(job, unsigned(worker));
+			return;
+		}
+	}
+	else {
+		std::lock_guard<std::mutex> lock(externalMtx);
+		externalQueue.push_back(&job);
+		hasExternal.store(true, std::memory_order_release);
+	}
+	Wake();
+}
+
+void JobSystem::Defer(Job& job, Counter& after) noexcept {
+	Job* pHead = after.pContinuations.load(std::memory_order_relaxed);
+	do {
+		job.pNext = pHead;
+	} while(!after.pContinuations.compare_exchange_weak(pHead, &job, std::memory_order_acq_rel, std::memory_order_relaxed));
+	//after may have finished before the job was linked in, then nobody else will release it
+	if(after.pending.load(std::memory_order_acquire) == 0u) {
+		ReleaseContinuations(after);
+	}
+}
+
+void JobSystem::ReleaseContinuations(Counter& counter) noexcept {
+	//whoever takes the list owns it, so every held back job is submitted exactly once
+	Job* pJob = counter.pContinuations.exchange(nullptr, std::memory_order_acq_rel);
+	while(pJob) {
+		Job* const pNext = pJob->pNext;
+		Submit(*pJob);
+		pJob = pNext;
+	}
+}
+
+void JobSystem::Execute(Job& job, unsigned int worker) noexcept {
+	Counter& counter = *job.pCounter;
+	job.pFunction(job);
+	//nothing reads the slot after this, it can be handed out again
+	job.inFlight.store(false, std::memory_order_release);
+	workers[worker]->executed.fetch_add(1u, std::memory_order_relaxed);
+	counter.finishing.fetch_add(1u, std::memory_order_relaxed);
+	if(counter.pending.fetch_sub(1u, std::memory_order_acq_rel) == 1u) {
+		ReleaseContinuations(counter);
+	}
+	//last access, the counter may go away as soon as this lands
+	counter.finishing.fetch_sub(1u, std::memory_order_release);
+}
+
+JobSystem::Job* JobSystem::FindJob(unsigned int worker) noexcept {
+	Worker& self = *workers[worker];
+	if(Job* pJob = self.deque.Pop()) {
+		return pJob;
+	}
+	if(hasExternal.load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> lock(externalMtx);
+		if(!externalQueue.empty()) {
+			Job* pJob = externalQueue.back();
+			externalQueue.pop_back();
+			hasExternal.store(!externalQueue.empty(), std::memory_order_relaxed);
+			return pJob;
+		}
+	}
+	const std::size_t count = workers.size();
+	if(count > 1u) {
+		//start at a random victim so thieves spread out
+		self.rng ^= self.rng << 13;
+		self.rng ^= self.rng >> 17;
+		self.rng ^= self.rng << 5;
+		const std::size_t start = self.rng % count;
+		for(std::size_t i = 0u; i < count; i++) {
+			const std::size_t victim = (start + i) % count;
+			if(victim == worker) {
+				continue;
+			}
+			if(Job* pJob = workers[victim]->deque.Steal()) {
+				self.stolen.fetch_add(1u, std::memory_order_relaxed);
+				return pJob;
+			}
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::WorkerLoop(unsigned int worker) {
+	pCurrentSystem = this;
+	currentWorker = static_cast<int>(worker);
+	Profiler::SetThreadName("Job worker");
+	int idle = 0;
+	while(!stopping.load(std::memory_order_relaxed)) {
+		if(Job* pJob = FindJob(worker)) {
+			Execute(*pJob, worker);
+			idle = 0;
+			continue;
+		}
+		if(++idle < spinRounds) {
+			std::this_thread::yield();
+			continue;
+		}
+		//sleep until something is submitted, the epoch catches a submit racing with falling asleep
+		const std::uint64_t seen = workEpoch.load();
+		if(Job* pJob = FindJob(worker)) {
+			Execute(*pJob, worker);
+			idle = 0;
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(sleepMtx);
+		sleepers.fetch_add(1u);
+		sleepCv.wait(lock, [&] { return workEpoch.load() != seen || stopping.load(); });
+		sleepers.fetch_sub(1u);
+		idle = 0;
+	}
+}
+
+void JobSystem::Wake() noexcept {
+	workEpoch.fetch_add(1u);
+	if(sleepers.load() != 0u) {
+		{
+			std::lock_guard<std::mutex> lock(sleepMtx);
+		}
+		sleepCv.notify_one();
+	}
+}
+
+int JobSystem::CurrentWorker() const noexcept {
+	return pCurrentSystem == this ? currentWorker : -1;
+}
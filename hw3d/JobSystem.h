@@ -0,0 +1,185 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+
+//Work stealing scheduler for per frame tasks.
+//Every worker owns a Chase-Lev deque: it pushes and pops its own end without locks, idle workers steal
+//from the other end. The thread that creates the system is worker 0 and only runs jobs while it waits
+//(Wait() / ParallelFor() help instead of blocking), the others are background threads.
+//Threads that are not workers (e.g. the simulation thread) submit through a locked queue.
+//
+//Completion is tracked with Counters: Run() adds a job to a counter, Wait() returns once all of them finished.
+//A job can also be held back until another counter is done (Run(counter, f, &after)).
+//
+//Jobs are small trivially copyable callables (lambdas capturing pointers/references), stored inline.
+//They must not throw. Job storage is recycled round robin but a slot is only reused once its job finished;
+//when the next few slots are all still in flight Run() executes the job on the spot instead.
+//Does not depend on D3D or Windows.
+class JobSystem {
+private:
+	struct Job;
+public:
+	class Counter {
+	public:
+		Counter() = default;
+		Counter(const Counter&) = delete;
+		Counter& operator=(const Counter&) = delete;
+		bool IsDone() const noexcept {
+			return pending.load(std::memory_order_acquire) == 0u && finishing.load(std::memory_order_acquire) == 0u;
+		}
+	private:
+		friend class JobSystem;
+		std::atomic<std::uint32_t> pending = 0u;
+		//workers between dropping pending to zero and their last touch of the counter, Wait() waits these out too
+		std::atomic<std::uint32_t> finishing = 0u;
+		std::atomic<Job*> pContinuations = nullptr; //jobs held back until pending reaches zero, linked through pNext
+	};
+	struct Stats {
+		std::size_t executed = 0u;
+		std::size_t stolen = 0u;
+	};
+public:
+	//0 uses one worker per hardware thread
+	JobSystem(unsigned int threadCount = 0u);
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+	~JobSystem();
+	unsigned int GetThreadCount() const noexcept;
+	//queue f() and count it on counter, if pAfter is given f() only starts once pAfter is done
+	template<typename F>
+	void Run(Counter& counter, const F& f, Counter* pAfter = nullptr) {
+		static_assert(sizeof(F) <= jobDataSize, "job callable too large, capture less or capture a pointer to it");
+		static_assert(alignof(F) <= alignof(std::max_align_t), "job callable over aligned");
+		static_assert(std::is_trivially_copyable_v<F> && std::is_trivially_destructible_v<F>, "job callable must be trivially copyable");
+		Job* const pJob = AllocateJob();
+		if(!pJob) {
+			//too many jobs in flight, overwriting one would lose it
+			if(pAfter) {
+				Wait(*pAfter);
+			}
+			f();
+			return;
+		}
+		new(pJob->data) F(f);
+		pJob->pFunction = [](Job& j) noexcept {
+			(*std::launder(reinterpret_cast<F*>(j.data)))();
+		};
+		pJob->pCounter = &counter;
+		pJob->pNext = nullptr;
+		counter.pending.fetch_add(1u, std::memory_order_relaxed);
+		if(pAfter) {
+			Defer(*pJob, *pAfter);
+		}
+		else {
+			Submit(*pJob);
+		}
+	}
+	//run jobs until counter is done, from any thread
+	void Wait(Counter& counter) noexcept;
+	//f(begin, end) over [0, count) in chunks of at most grain, returns when all of them ran.
+	//The range is split in halves so thieves take big pieces and the caller keeps working on the rest.
+	template<typename F>
+	void ParallelFor(std::size_t count, std::size_t grain, const F& f) {
+		if(grain == 0u) {
+			grain = 1u;
+		}
+		if(count <= grain) {
+			if(count) {
+				f(std::size_t(0u), count);
+			}
+			return;
+		}
+		Counter counter;
+		ForRange<F>{ this, &f, &counter, 0u, count, grain }();
+		Wait(counter);
+	}
+	//summed over all workers since the last ResetStats()
+	Stats GetStats() const noexcept;
+	void ResetStats() noexcept;
+public:
+	static constexpr std::size_t jobPoolSize = 4096u; //per worker, power of two
+	static constexpr std::size_t jobDataSize = 48u;
+	//slots AllocateJob() looks at before giving up, jobs mostly finish in the order they were allocated
+	static constexpr std::size_t allocateProbes = 16u;
+private:
+	struct Job {
+		void (*pFunction)(Job&) noexcept;
+		Counter* pCounter;
+		Job* pNext; //continuation list link
+		std::atomic<bool> inFlight = false; //from AllocateJob() until Execute() ran it
+		alignas(std::max_align_t) unsigned char data[jobDataSize];
+	};
+	//Chase-Lev deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models"), fixed capacity
+	class Deque {
+	public:
+		bool Push(Job* pJob) noexcept;
+		Job* Pop() noexcept;
+		Job* Steal() noexcept;
+	private:
+		alignas(64) std::atomic<std::int64_t> top = 0;
+		alignas(64) std::atomic<std::int64_t> bottom = 0;
+		std::unique_ptr<std::atomic<Job*>[]> slots = std::make_unique<std::atomic<Job*>[]>(jobPoolSize);
+	};
+	struct alignas(64) Worker {
+		Deque deque;
+		std::unique_ptr<Job[]> pool = std::make_unique<Job[]>(jobPoolSize);
+		std::size_t nextJob = 0u;
+		std::uint32_t rng = 0u; //victim selection
+		std::atomic<std::size_t> executed = 0u;
+		std::atomic<std::size_t> stolen = 0u;
+	};
+	template<typename F>
+	struct ForRange {
+		JobSystem* pJobs;
+		const F* pF;
+		Counter* pCounter;
+		std::size_t begin;
+		std::size_t end;
+		std::size_t grain;
+		void operator()() const {
+			std::size_t last = end;
+			while(last - begin > grain) {
+				const std::size_t mid = begin + (last - begin) / 2u;
+				pJobs->Run(*pCounter, ForRange{ pJobs, pF, pCounter, mid, last, grain });
+				last = mid;
+			}
+			(*pF)(begin, last);
+		}
+	};
+	//nullptr if the calling thread's pool has no free slot near its cursor
+	Job* AllocateJob() noexcept;
+	static Job* ClaimJob(Job* pPool, std::size_t& next) noexcept;
+	void Submit(Job& job) noexcept;
+	void Defer(Job& job, Counter& after) noexcept;
+	void ReleaseContinuations(Counter& counter) noexcept;
+	void Execute(Job& job, unsigned int worker) noexcept;
+	//own deque first, then the external queue, then steal; nullptr if there is nothing anywhere
+	Job* FindJob(unsigned int worker) noexcept;
+	void WorkerLoop(unsigned int worker);
+	void Wake() noexcept;
+	//worker index of the calling thread in this system, or -1
+	int CurrentWorker() const noexcept;
+private:
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+	//jobs from threads that are not workers
+	std::mutex externalMtx;
+	std::vector<Job*> externalQueue;
+	std::unique_ptr<Job[]> externalPool = std::make_unique<Job[]>(jobPoolSize);
+	std::size_t nextExternalJob = 0u;
+	std::atomic<bool> hasExternal = false;
+	//sleeping workers
+	std::mutex sleepMtx;
+	std::condition_variable sleepCv;
+	std::atomic<std::uint64_t> workEpoch = 0u;
+	std::atomic<unsigned int> sleepers = 0u;
+	std::atomic<bool> stopping = false;
+};
@@ -0,0 +1,389 @@
+#include "MeshFile.h"
+#include "VertexQuantization.h"
+#include <sstream>
+#include <fstream>
+#include <cstring>
+#include <utility>
+#include <limits>
+#ifdef _WIN32
+#include "IncludeWin.h"
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	std::size_t Align(std::size_t v) noexcept {
+		return (v + MeshFile::blobAlignment - 1u) & ~(MeshFile::blobAlignment - 1u);
+	}
+	bool InFile(std::uint64_t offset, std::uint64_t size, std::size_t fileSize) noexcept {
+		return offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+MeshFile::Exception::Exception(int line, const char* file, std::string note) noexcept
+	: UrielException(line, file), note(std::move(note))
+{
+}
+
+const char* MeshFile::Exception::what() const noexcept {
+	std::ostringstream oss;
+	oss << GetType() << std::endl
+		<< "[Note] " << GetNote() << std::endl
+		<< GetOriginalString();
+	whatBuffer = oss.str();
+	return whatBuffer.c_str();
+}
+
+const char* MeshFile::Exception::GetType() const noexcept {
+	return "Uriel Mesh File Exception";
+}
+
+const std::string& MeshFile::Exception::GetNote() const noexcept {
+	return note;
+}
+
+MeshFile::MeshFile(const std::string& path) {
+#ifdef _WIN32
+	const HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(hFile == INVALID_HANDLE_VALUE) {
+		throw Exception(__LINE__, __FILE__, "Failed to open mesh file: " + path);
+	}
+	LARGE_INTEGER fileSize = {};
+	if(!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(Header)) {
+		CloseHandle(hFile);
+		throw Exception(__LINE__, __FILE__, "Mesh file too small: " + path);
+	}
+	//the view keeps the mapping alive, both handles can go right away
+	const HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0u, 0u, nullptr);
+	CloseHandle(hFile);
+	if(hMapping == nullptr) {
+		throw Exception(__LINE__, __FILE__, "Failed to map mesh file: " + path);
+	}
+	pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0u, 0u, 0u);
+	CloseHandle(hMapping);
+	if(pView == nullptr) {
+		throw Exception(__LINE__, __FILE__, "Failed to map mesh file: " + path);
+	}
+	size = (std::size_t)fileSize.QuadPart;
+#else
+	const int fd = open(path.c_str(), O_RDONLY);
+	if(fd < 0) {
+		throw Exception(__LINE__, __FILE__, "Failed to open mesh file: " + path);
+	}
+	struct stat info = {};
+	if(fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(Header)) {
+		close(fd);
+		throw Exception(__LINE__, __FILE__, "Mesh file too small: " + path);
+	}
+	//the mapping outlives the descriptor
+	void* pMapped = mmap(nullptr, (std::size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(pMapped == MAP_FAILED) {
+		throw Exception(__LINE__, __FILE__, "Failed to map mesh file: " + path);
+	}
+	pView = pMapped;
+	size = (std::size_t)info.st_size;
+	//the blobs are read front to back once (upload or rasterization), start reading them in now
+	madvise(pView, size, MADV_WILLNEED);
+#endif
+	pData = static_cast<const char*>(pView);
+	try {
+		Parse(path);
+	} catch(...) {
+		Unmap();
+		throw;
+	}
+}
+
+MeshFile::MeshFile(const void* pImage, std::size_t size)
+	: size(size)
+{
+	this->pImage = std::make_unique<Line[]>((size + sizeof(Line) - 1u) / sizeof(Line));
+	std::memcpy(this->pImage.get(), pImage, size);
+	pData = reinterpret_cast<const char*>(this->pImage.get());
+	Parse("in memory image");
+}
+
+MeshFile::MeshFile(MeshFile&& other) noexcept
+	: pData(std::exchange(other.pData, nullptr)),
+	size(std::exchange(other.size, 0u)),
+	pView(std::exchange(other.pView, nullptr)),
+	pImage(std::move(other.pImage)),
+	header(other.header),
+	attributes(std::move(other.attributes)),
+	streams(std::move(other.streams)),
+	lods(std::move(other.lods))
+{
+}
+
+MeshFile& MeshFile::operator=(MeshFile&& other) noexcept {
+	if(this != &other) {
+		Unmap();
+		pData = std::exchange(other.pData, nullptr);
+		size = std::exchange(other.size, 0u);
+		pView = std::exchange(other.pView, nullptr);
+		pImage = std::move(other.pImage);
+		header = other.header;
+		attributes = std::move(other.attributes);
+		streams = std::move(other.streams);
+		lods = std::move(other.lods);
+	}
+	return *this;
+}
+
+MeshFile::~MeshFile() {
+	Unmap();
+}
+
+void MeshFile::Unmap() noexcept {
+	if(pView != nullptr) {
+#ifdef _WIN32
+		UnmapViewOfFile(pView);
+#else
+		munmap(pView, size);
+#endif
+		pView = nullptr;
+	}
+}
+
+void MeshFile::Parse(const std::string& name) {
+	if(size < sizeof(Header)) {
+		throw Exception(__LINE__, __FILE__, "Mesh file too small: " + name);
+	}
+	Header h;
+	std::memcpy(&h, pData, sizeof(h));
+	if(std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.version != version) {
+		throw Exception(__LINE__, __FILE__, "Not a mesh file or wrong version: " + name);
+	}
+	if(h.fileSize != size) {
+		throw Exception(__LINE__, __FILE__, "Mesh file size does not match its header: " + name);
+	}
+	const std::size_t attributesBegin = sizeof(Header);
+	const std::size_t streamsBegin = attributesBegin + std::size_t(h.attributeCount) * sizeof(Attribute);
+	const std::size_t lodsBegin = streamsBegin + std::size_t(h.streamCount) * sizeof(StreamEntry);
+	const std::size_t tablesEnd = lodsBegin + std::size_t(h.lodCount) * sizeof(Lod);
+	if(tablesEnd > size) {
+		throw Exception(__LINE__, __FILE__, "Mesh file tables are truncated: " + name);
+	}
+
+	//validate everything into locals first so a bad file leaves this object unchanged
+	std::vector<Attribute> a(h.attributeCount);
+	std::memcpy(a.data(), pData + attributesBegin, a.size() * sizeof(Attribute));
+	std::vector<StreamEntry> s(h.streamCount);
+	std::memcpy(s.data(), pData + streamsBegin, s.size() * sizeof(StreamEntry));
+	std::vector<Lod> l(h.lodCount);
+	std::memcpy(l.data(), pData + lodsBegin, l.size() * sizeof(Lod));
+
+	for(const auto& e : s) {
+		if(e.stride == 0u || e.offset % blobAlignment != 0u || !InFile(e.offset, e.size, size)
+			|| e.size != std::uint64_t(h.vertexCount) * e.stride) {
+			throw Exception(__LINE__, __FILE__, "Mesh file stream out of bounds: " + name);
+		}
+	}
+	for(const auto& e : a) {
+		const std::uint32_t formatSize = GetFormatSize(e.format);
+		if(std::memchr(e.semantic, '\0', sizeof(e.semantic)) == nullptr || formatSize == 0u
+			|| e.stream >= h.streamCount || std::uint64_t(e.offset) + formatSize > s[e.stream].stride) {
+			throw Exception(__LINE__, __FILE__, "Mesh file attribute is invalid: " + name);
+		}
+	}
+	if((h.indexSize != 2u && h.indexSize != 4u) || h.indexOffset % blobAlignment != 0u
+		|| !InFile(h.indexOffset, std::uint64_t(h.indexCount) * h.indexSize, size)) {
+		throw Exception(__LINE__, __FILE__, "Mesh file index buffer out of bounds: " + name);
+	}
+	for(const auto& e : l) {
+		if(e.indexCount % 3u != 0u || std::uint64_t(e.firstIndex) + e.indexCount > h.indexCount) {
+			throw Exception(__LINE__, __FILE__, "Mesh file lod out of bounds: " + name);
+		}
+	}
+	header = h;
+	attributes = std::move(a);
+	streams = std::move(s);
+	lods = std::move(l);
+}
+
+std::vector<char> MeshFile::Serialize(const Desc& desc) {
+	const auto& indices = desc.indices;
+	if(indices.indexSize != 2u && indices.indexSize != 4u) {
+		throw Exception(__LINE__, __FILE__, "Mesh indices must be 2 or 4 bytes");
+	}
+	if(indices.count % 3u != 0u || indices.count > 0xFFFFFFFFu) {
+		throw Exception(__LINE__, __FILE__, "Mesh index count must be a multiple of 3 below 2^32");
+	}
+	Header h = {};
+	std::memcpy(h.magic, magic, sizeof(magic));
+	h.version = version;
+	h.vertexCount = desc.streams.empty() || desc.streams[0].stride == 0u ? 0u
+		: (std::uint32_t)(desc.streams[0].size / desc.streams[0].stride);
+	h.attributeCount = (std::uint32_t)desc.attributes.size();
+	h.streamCount = (std::uint32_t)desc.streams.size();
+	h.indexSize = indices.indexSize;
+	h.indexCount = (std::uint32_t)indices.count;
+
+	std::vector<Lod> lodTable = desc.lods;
+	if(lodTable.empty()) {
+		lodTable.push_back({ 0u, h.indexCount, 0.0f });
+	}
+	h.lodCount = (std::uint32_t)lodTable.size();
+
+	//blob offsets
+	std::size_t cursor = Align(sizeof(Header) + desc.attributes.size() * sizeof(Attribute)
+		+ desc.streams.size() * sizeof(StreamEntry) + lodTable.size() * sizeof(Lod));
+	std::vector<StreamEntry> streamTable;
+	streamTable.reserve(desc.streams.size());
+	for(const auto& s : desc.streams) {
+		if(s.stride == 0u || s.size != std::size_t(h.vertexCount) * s.stride) {
+			throw Exception(__LINE__, __FILE__, "Mesh streams must all hold the same number of vertices");
+		}
+		streamTable.push_back({ cursor, s.size, s.stride, 0u });
+		cursor = Align(cursor + s.size);
+	}
+	h.indexOffset = cursor;
+	cursor = Align(cursor + indices.count * indices.indexSize);
+	h.fileSize = cursor;
+
+	//bounds from the (dequantized) positions, the only attribute the format knows the meaning of
+	h.dequantization = desc.dequantization;
+	const float inf = std::numeric_limits<float>::infinity();
+	h.bounds = { { inf, inf, inf }, { -inf, -inf, -inf } };
+	for(const auto& a : desc.attributes) {
+		if(std::strcmp(a.semantic, "POSITION") == 0 && a.semanticIndex == 0u && a.stream < desc.streams.size()
+			&& std::uint64_t(a.offset) + GetFormatSize(a.format) <= desc.streams[a.stream].stride) {
+			const auto& s = desc.streams[a.stream];
+			std::vector<rmath::Float4> positions(h.vertexCount);
+			VertexQuantization::Decode(s.pData, s.stride, h.vertexCount, a, h.dequantization, positions.data());
+			for(const auto& v : positions) {
+				h.bounds.min = { v.x < h.bounds.min.x ? v.x : h.bounds.min.x, v.y < h.bounds.min.y ? v.y : h.bounds.min.y, v.z < h.bounds.min.z ? v.z : h.bounds.min.z };
+				h.bounds.max = { v.x > h.bounds.max.x ? v.x : h.bounds.max.x, v.y > h.bounds.max.y ? v.y : h.bounds.max.y, v.z > h.bounds.max.z ? v.z : h.bounds.max.z };
+			}
+			break;
+		}
+	}
+	if(h.bounds.min.x > h.bounds.max.x) {
+		h.bounds = {};
+	}
+
+	std::vector<char> file(cursor, 0);
+	char* p = file.data();
+	std::memcpy(p, &h, sizeof(h));
+	p += sizeof(h);
+	std::memcpy(p, desc.attributes.data(), desc.attributes.size() * sizeof(Attribute));
+	p += desc.attributes.size() * sizeof(Attribute);
+	std::memcpy(p, streamTable.data(), streamTable.size() * sizeof(StreamEntry));
+	p += streamTable.size() * sizeof(StreamEntry);
+	std::memcpy(p, lodTable.data(), lodTable.size() * sizeof(Lod));
+	for(std::size_t i = 0u; i < desc.streams.size(); i++) {
+		std::memcpy(file.data() + streamTable[i].offset, desc.streams[i].pData, desc.streams[i].size);
+	}
+	std::memcpy(file.data() + h.indexOffset, indices.pData, indices.count * indices.indexSize);
+	return file;
+}
+
+void MeshFile::Write(const std::string& path, const Desc& desc) {
+	const auto file = Serialize(desc);
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if(!out.write(file.data(), (std::streamsize)file.size())) {
+		throw Exception(__LINE__, __FILE__, "Failed to write mesh file: " + path);
+	}
+}
+
+std::uint32_t MeshFile::GetFormatSize(Format format) noexcept {
+	switch(format) {
+	case Format::Float4:
+		return 16u;
+	case Format::Float3:
+		return 12u;
+	case Format::Float2:
+	case Format::SNorm16x4:
+		return 8u;
+	case Format::UNorm8x4:
+	case Format::Half2:
+	case Format::SNorm16x2:
+	case Format::Float1:
+		return 4u;
+	}
+	return 0u;
+}
+
+std::uint32_t MeshFile::GetVertexCount() const noexcept {
+	return header.vertexCount;
+}
+
+std::size_t MeshFile::GetAttributeCount() const noexcept {
+	return attributes.size();
+}
+
+const MeshFile::Attribute& MeshFile::GetAttribute(std::size_t i) const noexcept {
+	return attributes[i];
+}
+
+const MeshFile::Attribute* MeshFile::FindAttribute(const char* semantic, std::uint32_t semanticIndex) const noexcept {
+	for(const auto& a : attributes) {
+		if(a.semanticIndex == semanticIndex && std::strcmp(a.semantic, semantic) == 0) {
+			return &a;
+		}
+	}
+	return nullptr;
+}
+
+std::size_t MeshFile::GetStreamCount() const noexcept {
+	return streams.size();
+}
+
+MeshFile::Stream MeshFile::GetStream(std::size_t i) const noexcept {
+	const auto& s = streams[i];
+	return { pData + s.offset, std::size_t(s.size), s.stride };
+}
+
+MeshFile::Indices MeshFile::GetIndices() const noexcept {
+	return { pData + header.indexOffset, header.indexCount, header.indexSize };
+}
+
+std::size_t MeshFile::GetLodCount() const noexcept {
+	return lods.size();
+}
+
+const MeshFile::Lod& MeshFile::GetLod(std::size_t i) const noexcept {
+	return lods[i];
+}
+
+float MeshFile::GetLodScale(float projHeight, float nearZ, float viewportHeight) noexcept {
+	//clip y / w is 2 * nearZ / projHeight * y / z, and 2 units of it span the viewport
+	return viewportHeight * nearZ / projHeight;
+}
+
+std::size_t MeshFile::SelectLod(const Lod* pLods, std::size_t count, float distance, float lodScale, float maxPixels) noexcept {
+	//at or behind the eye everything is huge, keep full detail
+	if(distance <= 0.0f) {
+		return 0u;
+	}
+	std::size_t lod = 0u;
+	while(lod + 1u < count && pLods[lod + 1u].error * lodScale <= maxPixels * distance) {
+		lod++;
+	}
+	return lod;
+}
+
+std::size_t MeshFile::SelectLod(float distance, float lodScale, float maxPixels) const noexcept {
+	return SelectLod(lods.data(), lods.size(), distance, lodScale, maxPixels);
+}
+
+const MeshFile::Aabb& MeshFile::GetBounds() const noexcept {
+	return header.bounds;
+}
+
+const MeshFile::Dequantization& MeshFile::GetDequantization() const noexcept {
+	return header.dequantization;
+}
+
+const void* MeshFile::GetData() const noexcept {
+	return pData;
+}
+
+std::size_t MeshFile::GetSize() const noexcept {
+	return size;
+}
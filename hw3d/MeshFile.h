@@ -0,0 +1,162 @@
+#pragma once
+#include "UrielException.h"
+#include "RasterMath.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+//Versioned binary mesh container: vertex streams, one index buffer, bounds, LODs and the vertex layout.
+//Opening a file maps it read only, the tables are validated and copied out (a few hundred bytes) and the
+//blobs are handed out as views into the mapping, so GetStream()/GetIndices() can go straight to
+//D3D11_SUBRESOURCE_DATA::pSysMem or SoftwareRasterizer::DrawIndexed() without an intermediate copy.
+//
+//File layout:
+//	[Header][Attribute table][Stream table][Lod table][padding][stream blobs][index blob]
+//Every blob starts at a multiple of 64 bytes from the start of the file, mappings are page aligned so the
+//views are too. All values are little endian.
+//Index values are not checked against the vertex count (that would touch every index), D3D and
+//SoftwareRasterizer both handle out of range ones.
+//Does not depend on D3D; maps with MapViewOfFile on Windows and mmap everywhere else.
+class MeshFile {
+public:
+	class Exception : public UrielException {
+	public:
+		Exception(int line, const char* file, std::string note) noexcept;
+		const char* what() const noexcept override;
+		const char* GetType() const noexcept override;
+		const std::string& GetNote() const noexcept;
+	private:
+		std::string note;
+	};
+	//values are the matching DXGI_FORMAT, so the D3D side casts them (checked in Graphics.cpp)
+	//see VertexQuantization for how the compressed ones are used
+	enum class Format : std::uint32_t {
+		Float4 = 2u, //R32G32B32A32_FLOAT
+		Float3 = 6u, //R32G32B32_FLOAT
+		SNorm16x4 = 13u, //R16G16B16A16_SNORM
+		Float2 = 16u, //R32G32_FLOAT
+		UNorm8x4 = 28u, //R8G8B8A8_UNORM
+		Half2 = 34u, //R16G16_FLOAT
+		SNorm16x2 = 37u, //R16G16_SNORM
+		Float1 = 41u, //R32_FLOAT
+	};
+	//one vertex element, stored in the file as is
+	struct Attribute {
+		char semantic[16]; //null terminated
+		std::uint32_t semanticIndex;
+		Format format;
+		std::uint32_t stream;
+		std::uint32_t offset; //bytes into the stream's vertex
+	};
+	//view of one vertex stream, vertex count * stride bytes
+	struct Stream {
+		const void* pData;
+		std::size_t size;
+		std::uint32_t stride;
+	};
+	struct Indices {
+		const void* pData;
+		std::size_t count;
+		std::uint32_t indexSize; //2 or 4 bytes
+	};
+	//[firstIndex, firstIndex + indexCount) of the index buffer, stored in the file as is
+	struct Lod {
+		std::uint32_t firstIndex;
+		std::uint32_t indexCount;
+		float error; //object space, 0 for the full detail mesh
+	};
+	struct Aabb {
+		rmath::Float3 min;
+		rmath::Float3 max;
+	};
+	//POSITION as stored times scale plus offset is the object space position (identity for float positions)
+	struct Dequantization {
+		rmath::Float3 scale;
+		rmath::Float3 offset;
+	};
+	//everything Write() needs, the pointers are only read during the call
+	struct Desc {
+		std::vector<Attribute> attributes;
+		std::vector<Stream> streams;
+		Indices indices = {};
+		std::vector<Lod> lods; //empty for one lod covering every index
+		Dequantization dequantization = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+	};
+	static constexpr std::size_t blobAlignment = 64u;
+public:
+	MeshFile() = default;
+	//map path and validate it, the views stay valid for as long as this object lives
+	explicit MeshFile(const std::string& path);
+	//validate an image that is already in memory (copied once into an aligned block)
+	MeshFile(const void* pImage, std::size_t size);
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+	MeshFile(MeshFile&& other) noexcept;
+	MeshFile& operator=(MeshFile&& other) noexcept;
+	~MeshFile();
+	//lay desc out as a mesh file image, bounds are taken from the POSITION attribute when there is one
+	static std::vector<char> Serialize(const Desc& desc);
+	static void Write(const std::string& path, const Desc& desc);
+	static std::uint32_t GetFormatSize(Format format) noexcept;
+	std::uint32_t GetVertexCount() const noexcept;
+	std::size_t GetAttributeCount() const noexcept;
+	const Attribute& GetAttribute(std::size_t i) const noexcept;
+	//null when no attribute has this semantic
+	const Attribute* FindAttribute(const char* semantic, std::uint32_t semanticIndex = 0u) const noexcept;
+	std::size_t GetStreamCount() const noexcept;
+	Stream GetStream(std::size_t i) const noexcept;
+	Indices GetIndices() const noexcept;
+	std::size_t GetLodCount() const noexcept;
+	const Lod& GetLod(std::size_t i) const noexcept;
+	//pixels one unit of object space error covers one unit in front of the eye with a
+	//PerspectiveLH(projWidth, projHeight, nearZ, farZ) projection onto viewportHeight pixels
+	static float GetLodScale(float projHeight, float nearZ, float viewportHeight) noexcept;
+	//coarsest lod whose error projects to at most maxPixels at view depth distance, lods ordered by growing error
+	static std::size_t SelectLod(const Lod* pLods, std::size_t count, float distance, float lodScale, float maxPixels = 1.0f) noexcept;
+	std::size_t SelectLod(float distance, float lodScale, float maxPixels = 1.0f) const noexcept;
+	const Aabb& GetBounds() const noexcept;
+	const Dequantization& GetDequantization() const noexcept;
+	//the whole image
+	const void* GetData() const noexcept;
+	std::size_t GetSize() const noexcept;
+private:
+	static constexpr char magic[4] = { 'U', 'M', 'S', 'H' };
+	static constexpr std::uint32_t version = 2u;
+	struct Header {
+		char magic[4];
+		std::uint32_t version;
+		std::uint64_t fileSize;
+		std::uint32_t vertexCount;
+		std::uint32_t attributeCount;
+		std::uint32_t streamCount;
+		std::uint32_t lodCount;
+		std::uint32_t indexSize;
+		std::uint32_t indexCount;
+		std::uint64_t indexOffset;
+		Aabb bounds;
+		Dequantization dequantization;
+	};
+	struct StreamEntry {
+		std::uint64_t offset; //from the start of the file
+		std::uint64_t size;
+		std::uint32_t stride;
+		std::uint32_t reserved;
+	};
+	struct alignas(64) Line {
+		char bytes[64];
+	};
+	//reads the tables of the image at pData, throws without changing anything when it is malformed
+	void Parse(const std::string& name);
+	void Unmap() noexcept;
+private:
+	const char* pData = nullptr;
+	std::size_t size = 0u;
+	void* pView = nullptr; //mapping owned by this object, null for in memory images
+	std::unique_ptr<Line[]> pImage; //in memory images
+	Header header = {};
+	std::vector<Attribute> attributes;
+	std::vector<StreamEntry> streams;
+	std::vector<Lod> lods;
+};
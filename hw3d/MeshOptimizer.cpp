@@ -0,0 +1,386 @@
+#include "MeshOptimizer.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cmath>
+
+namespace {
+	constexpr std::uint32_t noVertex = 0xFFFFFFFFu;
+
+	//FIFO cache of size entries: a vertex is in the cache when fewer than size vertices were inserted after it.
+	//Keeps the insertion time per vertex instead of a queue, Flush() ages everything out at once.
+	class FifoCache {
+	public:
+		FifoCache(std::size_t vertexCount, unsigned int size)
+			: times(vertexCount, 0u), size(size), time(size + 1u)
+		{
+		}
+		//true on a miss
+		bool Access(std::uint32_t v) noexcept {
+			if(time - times[v] > size) {
+				times[v] = time++;
+				return true;
+			}
+			return false;
+		}
+		//age of v in insertions, more than the size when it is not cached
+		std::uint32_t Age(std::uint32_t v) const noexcept {
+			return time - times[v];
+		}
+		void Flush() noexcept {
+			time += size + 1u;
+		}
+	private:
+		std::vector<std::uint32_t> times;
+		std::uint32_t size;
+		std::uint32_t time;
+	};
+
+	rmath::Float3 GetPosition(const unsigned char* pPositions, std::size_t stride, std::uint32_t v) noexcept {
+		rmath::Float3 p;
+		std::memcpy(&p, pPositions + v * stride, sizeof(p));
+		return p;
+	}
+
+	MeshOptimizer::Report OptimizeValidated(MeshOptimizer::Mesh& mesh, const MeshOptimizer::Options& options) {
+		using namespace MeshOptimizer;
+		std::vector<MeshFile::Lod> ranges = mesh.lods;
+		if(ranges.empty()) {
+			ranges.push_back({ 0u, (std::uint32_t)mesh.indices.size(), 0.0f });
+		}
+		Report report = {};
+		report.vertexCountBefore = mesh.vertexCount;
+		report.before = AnalyzeVertexCache(mesh.indices.data() + ranges[0].firstIndex, ranges[0].indexCount, mesh.vertexCount, options.cacheSize);
+
+		//positions for the overdraw pass
+		const unsigned char* pPositions = nullptr;
+		std::size_t positionStride = 0u;
+		for(const auto& a : mesh.attributes) {
+			if(std::strcmp(a.semantic, "POSITION") == 0 && a.semanticIndex == 0u && a.format == MeshFile::Format::Float3 && a.stream < mesh.streams.size()) {
+				pPositions = mesh.streams[a.stream].data() + a.offset;
+				positionStride = mesh.strides[a.stream];
+				break;
+			}
+		}
+		std::vector<std::uint32_t> scratch;
+		for(const auto& range : ranges) {
+			std::uint32_t* pRange = mesh.indices.data() + range.firstIndex;
+			OptimizeVertexCache(pRange, pRange, range.indexCount, mesh.vertexCount, options.cacheSize);
+			if(options.overdrawThreshold > 0.0f && pPositions) {
+				scratch.resize(range.indexCount);
+				OptimizeOverdraw(scratch.data(), pRange, range.indexCount, pPositions, positionStride, mesh.vertexCount,
+					options.cacheSize, options.overdrawThreshold);
+				std::copy(scratch.begin(), scratch.end(), pRange);
+			}
+		}
+
+		//streams in first use order
+		std::vector<std::uint32_t> remap;
+		const std::size_t vertexCount = OptimizeVertexFetch(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount, remap);
+		for(std::size_t i = 0u; i < mesh.streams.size(); i++) {
+			const std::size_t stride = mesh.strides[i];
+			std::vector<unsigned char> stream(vertexCount * stride);
+			for(std::size_t v = 0u; v < vertexCount; v++) {
+				std::memcpy(stream.data() + v * stride, mesh.streams[i].data() + remap[v] * stride, stride);
+			}
+			mesh.streams[i] = std::move(stream);
+		}
+		mesh.vertexCount = (std::uint32_t)vertexCount;
+
+		report.after = AnalyzeVertexCache(mesh.indices.data() + ranges[0].firstIndex, ranges[0].indexCount, mesh.vertexCount, options.cacheSize);
+		report.vertexCountAfter = mesh.vertexCount;
+		report.indexSize = ChooseIndexSize(mesh.vertexCount);
+		return report;
+	}
+}
+
+MeshOptimizer::CacheStats MeshOptimizer::AnalyzeVertexCache(const std::uint32_t* pIndices, std::size_t indexCount, std::size_t vertexCount, unsigned int cacheSize) {
+	FifoCache cache(vertexCount, cacheSize);
+	std::vector<bool> referenced(vertexCount, false);
+	std::size_t referencedCount = 0u;
+	CacheStats stats = {};
+	for(std::size_t i = 0u; i < indexCount; i++) {
+		const std::uint32_t v = pIndices[i];
+		stats.transformed += cache.Access(v);
+		if(!referenced[v]) {
+			referenced[v] = true;
+			referencedCount++;
+		}
+	}
+	const std::size_t triangleCount = indexCount / 3u;
+	stats.acmr = triangleCount ? float(stats.transformed) / float(triangleCount) : 0.0f;
+	stats.atvr = referencedCount ? float(stats.transformed) / float(referencedCount) : 0.0f;
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::uint32_t* pDst, const std::uint32_t* pIndices, std::size_t indexCount, std::size_t vertexCount, unsigned int cacheSize) {
+	const std::size_t triangleCount = indexCount / 3u;
+	//triangles around every vertex, live counts the ones not emitted yet
+	std::vector<std::uint32_t> live(vertexCount, 0u);
+	for(std::size_t i = 0u; i < triangleCount * 3u; i++) {
+		live[pIndices[i]]++;
+	}
+	std::vector<std::uint32_t> offsets(vertexCount + 1u, 0u);
+	for(std::size_t v = 0u; v < vertexCount; v++) {
+		offsets[v + 1u] = offsets[v] + live[v];
+	}
+	std::vector<std::uint32_t> adjacency(triangleCount * 3u);
+	{
+		std::vector<std::uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+		for(std::size_t i = 0u; i < triangleCount * 3u; i++) {
+			adjacency[cursor[pIndices[i]]++] = std::uint32_t(i / 3u);
+		}
+	}
+
+	std::vector<std::uint32_t> result(triangleCount * 3u); //pDst may alias pIndices
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<std::uint32_t> deadEnd;
+	deadEnd.reserve(triangleCount * 3u);
+	std::vector<std::uint32_t> candidates;
+	FifoCache cache(vertexCount, cacheSize);
+	std::size_t written = 0u;
+	std::size_t scan = 0u;
+	const auto nextUnfinished = [&]() {
+		while(scan < vertexCount && live[scan] == 0u) {
+			scan++;
+		}
+		return scan < vertexCount ? std::uint32_t(scan) : noVertex;
+	};
+
+	std::uint32_t fanning = nextUnfinished();
+	while(fanning != noVertex) {
+		//emit every triangle around the fanning vertex
+		candidates.clear();
+		for(std::uint32_t k = offsets[fanning]; k < offsets[fanning + 1u]; k++) {
+			const std::uint32_t t = adjacency[k];
+			if(emitted[t]) {
+				continue;
+			}
+			emitted[t] = true;
+			for(std::size_t c = 0u; c < 3u; c++) {
+				const std::uint32_t v = pIndices[t * 3u + c];
+				result[written++] = v;
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				cache.Access(v);
+			}
+		}
+		//next: the oldest candidate that will still be cached after its remaining triangles are emitted
+		fanning = noVertex;
+		std::int64_t bestPriority = -1;
+		for(const std::uint32_t v : candidates) {
+			if(live[v] == 0u) {
+				continue;
+			}
+			std::int64_t priority = 0;
+			if(std::int64_t(cache.Age(v)) + 2 * std::int64_t(live[v]) <= std::int64_t(cacheSize)) {
+				priority = cache.Age(v);
+			}
+			if(priority > bestPriority) {
+				bestPriority = priority;
+				fanning = v;
+			}
+		}
+		//nothing useful around here, back to recently used vertices, then anything left
+		while(fanning == noVertex && !deadEnd.empty()) {
+			const std::uint32_t v = deadEnd.back();
+			deadEnd.pop_back();
+			if(live[v] > 0u) {
+				fanning = v;
+			}
+		}
+		if(fanning == noVertex) {
+			fanning = nextUnfinished();
+		}
+	}
+	std::copy(result.begin(), result.end(), pDst);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::uint32_t* pDst, const std::uint32_t* pIndices, std::size_t indexCount,
+	const void* pPositions, std::size_t stride, std::size_t vertexCount, unsigned int cacheSize, float threshold)
+{
+	const std::size_t triangleCount = indexCount / 3u;
+	if(triangleCount == 0u) {
+		return;
+	}
+	//hard boundaries where the cache order starts over anyway (all three vertices miss), then soft ones inside
+	//every hard cluster as soon as the part so far uses the cache no worse than threshold times the whole cluster
+	std::vector<std::uint32_t> clusters; //first triangle of each cluster
+	{
+		FifoCache cache(vertexCount, cacheSize);
+		std::vector<std::uint32_t> misses(triangleCount);
+		std::vector<std::uint32_t> hard;
+		for(std::size_t t = 0u; t < triangleCount; t++) {
+			misses[t] = cache.Access(pIndices[t * 3u]) + cache.Access(pIndices[t * 3u + 1u]) + cache.Access(pIndices[t * 3u + 2u]);
+			if(t == 0u || misses[t] == 3u) {
+				hard.push_back(std::uint32_t(t));
+			}
+		}
+		hard.push_back(std::uint32_t(triangleCount));
+		for(std::size_t h = 0u; h + 1u < hard.size(); h++) {
+			const std::uint32_t begin = hard[h];
+			const std::uint32_t end = hard[h + 1u];
+			std::size_t clusterMisses = 0u;
+			for(std::uint32_t t = begin; t < end; t++) {
+				clusterMisses += misses[t];
+			}
+			const float limit = threshold * float(clusterMisses) / float(end - begin);
+			//a cut costs a cold cache, simulate it so the next part is judged fairly
+			cache.Flush();
+			clusters.push_back(begin);
+			std::uint32_t start = begin;
+			std::size_t partMisses = 0u;
+			for(std::uint32_t t = begin; t < end; t++) {
+				partMisses += cache.Access(pIndices[t * 3u]) + cache.Access(pIndices[t * 3u + 1u]) + cache.Access(pIndices[t * 3u + 2u]);
+				if(t + 1u < end && float(partMisses) <= limit * float(t + 1u - start)) {
+					clusters.push_back(t + 1u);
+					start = t + 1u;
+					partMisses = 0u;
+					cache.Flush();
+				}
+			}
+		}
+		clusters.push_back(std::uint32_t(triangleCount));
+	}
+
+	//area weighted centroid and normal of every cluster
+	const auto* pBytes = static_cast<const unsigned char*>(pPositions);
+	const std::size_t clusterCount = clusters.size() - 1u;
+	std::vector<rmath::Float3> centroids(clusterCount);
+	std::vector<rmath::Float3> normals(clusterCount);
+	std::vector<float> areas(clusterCount);
+	rmath::Float3 meshCentroid = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+	for(std::size_t c = 0u; c < clusterCount; c++) {
+		rmath::Float3 centroid = { 0.0f, 0.0f, 0.0f };
+		rmath::Float3 normal = { 0.0f, 0.0f, 0.0f };
+		float area = 0.0f;
+		for(std::uint32_t t = clusters[c]; t < clusters[c + 1u]; t++) {
+			const auto p0 = GetPosition(pBytes, stride, pIndices[t * 3u]);
+			const auto p1 = GetPosition(pBytes, stride, pIndices[t * 3u + 1u]);
+			const auto p2 = GetPosition(pBytes, stride, pIndices[t * 3u + 2u]);
+			const rmath::Float3 e1 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+			const rmath::Float3 e2 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+			//clockwise front faces in a left handed space, the cross product points out of the surface
+			const rmath::Float3 n = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+			const float a = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+			centroid.x += (p0.x + p1.x + p2.x) * a;
+			centroid.y += (p0.y + p1.y + p2.y) * a;
+			centroid.z += (p0.z + p1.z + p2.z) * a;
+			normal.x += n.x;
+			normal.y += n.y;
+			normal.z += n.z;
+			area += a;
+		}
+		meshCentroid.x += centroid.x;
+		meshCentroid.y += centroid.y;
+		meshCentroid.z += centroid.z;
+		meshArea += area;
+		const float scale = area > 0.0f ? 1.0f / (3.0f * area) : 0.0f;
+		centroids[c] = { centroid.x * scale, centroid.y * scale, centroid.z * scale };
+		normals[c] = normal;
+		areas[c] = area;
+	}
+	const float meshScale = meshArea > 0.0f ? 1.0f / (3.0f * meshArea) : 0.0f;
+	meshCentroid = { meshCentroid.x * meshScale, meshCentroid.y * meshScale, meshCentroid.z * meshScale };
+
+	//how far a cluster faces away from the center, outer clusters likely hide inner ones
+	std::vector<float> keys(clusterCount);
+	for(std::size_t c = 0u; c < clusterCount; c++) {
+		const auto& n = normals[c];
+		const float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+		const rmath::Float3 d = { centroids[c].x - meshCentroid.x, centroids[c].y - meshCentroid.y, centroids[c].z - meshCentroid.z };
+		keys[c] = length > 0.0f ? (d.x * n.x + d.y * n.y + d.z * n.z) / length : 0.0f;
+	}
+	std::vector<std::uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+		return keys[a] > keys[b];
+	});
+	std::size_t written = 0u;
+	for(const std::uint32_t c : order) {
+		const std::size_t first = std::size_t(clusters[c]) * 3u;
+		const std::size_t count = std::size_t(clusters[c + 1u] - clusters[c]) * 3u;
+		std::copy(pIndices + first, pIndices + first + count, pDst + written);
+		written += count;
+	}
+}
+
+std::size_t MeshOptimizer::OptimizeVertexFetch(std::uint32_t* pIndices, std::size_t indexCount, std::size_t vertexCount, std::vector<std::uint32_t>& remap) {
+	std::vector<std::uint32_t> newIndex(vertexCount, noVertex);
+	remap.clear();
+	for(std::size_t i = 0u; i < indexCount; i++) {
+		const std::uint32_t v = pIndices[i];
+		if(newIndex[v] == noVertex) {
+			newIndex[v] = std::uint32_t(remap.size());
+			remap.push_back(v);
+		}
+		pIndices[i] = newIndex[v];
+	}
+	return remap.size();
+}
+
+std::uint32_t MeshOptimizer::ChooseIndexSize(std::size_t vertexCount) noexcept {
+	return vertexCount <= 0x10000u ? 2u : 4u;
+}
+
+void MeshOptimizer::Validate(const Mesh& mesh) {
+	if(mesh.streams.size() != mesh.strides.size()) {
+		throw MeshFile::Exception(__LINE__, __FILE__, "Mesh needs one stride per stream");
+	}
+	for(std::size_t i = 0u; i < mesh.streams.size(); i++) {
+		if(mesh.strides[i] == 0u || mesh.streams[i].size() != std::size_t(mesh.vertexCount) * mesh.strides[i]) {
+			throw MeshFile::Exception(__LINE__, __FILE__, "Mesh stream size does not match its vertex count");
+		}
+	}
+	if(mesh.indices.size() % 3u != 0u || mesh.indices.size() > 0xFFFFFFFFu) {
+		throw MeshFile::Exception(__LINE__, __FILE__, "Mesh index count must be a multiple of 3 below 2^32");
+	}
+	for(const std::uint32_t v : mesh.indices) {
+		if(v >= mesh.vertexCount) {
+			throw MeshFile::Exception(__LINE__, __FILE__, "Mesh index out of range");
+		}
+	}
+	for(const auto& lod : mesh.lods) {
+		if(lod.indexCount % 3u != 0u || std::size_t(lod.firstIndex) + lod.indexCount > mesh.indices.size()) {
+			throw MeshFile::Exception(__LINE__, __FILE__, "Mesh lod out of bounds");
+		}
+	}
+}
+
+MeshOptimizer::Report MeshOptimizer::Optimize(Mesh& mesh, const Options& options) {
+	Validate(mesh);
+	return OptimizeValidated(mesh, options);
+}
+
+void MeshOptimizer::OptimizeBatch(JobSystem& jobs, Mesh* pMeshes, Report* pReports, std::size_t count, const Options& options) {
+	//jobs must not throw, so every error is found up front
+	for(std::size_t i = 0u; i < count; i++) {
+		Validate(pMeshes[i]);
+	}
+	jobs.ParallelFor(count, 1u, [&](std::size_t begin, std::size_t end) {
+		for(std::size_t i = begin; i < end; i++) {
+			pReports[i] = OptimizeValidated(pMeshes[i], options);
+		}
+	});
+}
+
+MeshFile::Desc MeshOptimizer::MakeDesc(const Mesh& mesh, std::vector<std::uint16_t>& narrowIndices) {
+	MeshFile::Desc desc;
+	desc.attributes = mesh.attributes;
+	for(std::size_t i = 0u; i < mesh.streams.size(); i++) {
+		desc.streams.push_back({ mesh.streams[i].data(), mesh.streams[i].size(), mesh.strides[i] });
+	}
+	if(ChooseIndexSize(mesh.vertexCount) == 2u) {
+		narrowIndices.assign(mesh.indices.begin(), mesh.indices.end());
+		desc.indices = { narrowIndices.data(), narrowIndices.size(), 2u };
+	}
+	else {
+		desc.indices = { mesh.indices.data(), mesh.indices.size(), 4u };
+	}
+	desc.lods = mesh.lods;
+	desc.dequantization = mesh.dequantization;
+	return desc;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "MeshFile.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class JobSystem;
+
+//Offline mesh optimization, run before meshes are written with MeshFile:
+//	vertex cache: Tipsify (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"),
+//	linear time, fans around one vertex at a time and prefers next vertices that are still in a FIFO cache
+//	overdraw: the cache ordered list is cut into clusters that use the cache at most threshold times worse
+//	than their surroundings, then clusters facing away from the mesh center (the likely occluders) go first
+//	vertex fetch: vertices are renumbered in first use order and unreferenced ones dropped, every stream is
+//	permuted the same way so fetches walk each stream front to back
+//Cache efficiency is reported as ACMR and ATVR of a FIFO cache simulation.
+//Indices must be below the vertex count, Optimize() checks that, the single passes do not.
+//Does not depend on D3D or Windows.
+namespace MeshOptimizer {
+	struct CacheStats {
+		std::size_t transformed; //cache misses
+		float acmr; //transformed per triangle, 3 is the worst, around 0.6 is good for a regular mesh
+		float atvr; //transformed per referenced vertex, 1 is ideal
+	};
+	//owning mesh data, Optimize() rewrites it in place
+	struct Mesh {
+		std::vector<MeshFile::Attribute> attributes;
+		std::vector<std::vector<unsigned char>> streams; //vertexCount * strides[i] bytes each
+		std::vector<std::uint32_t> strides;
+		std::vector<std::uint32_t> indices;
+		std::vector<MeshFile::Lod> lods; //empty for one lod covering every index, ranges must not overlap
+		std::uint32_t vertexCount = 0u;
+		MeshFile::Dequantization dequantization = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+	};
+	struct Options {
+		unsigned int cacheSize = 16u;
+		float overdrawThreshold = 1.05f; //0 skips the overdraw pass
+	};
+	struct Report {
+		CacheStats before; //of the first lod
+		CacheStats after;
+		std::uint32_t vertexCountBefore;
+		std::uint32_t vertexCountAfter;
+		std::uint32_t indexSize; //what MakeDesc() writes
+	};
+	CacheStats AnalyzeVertexCache(const std::uint32_t* pIndices, std::size_t indexCount, std::size_t vertexCount, unsigned int cacheSize = 16u);
+	//Tipsify, pDst may be pIndices
+	void OptimizeVertexCache(std::uint32_t* pDst, const std::uint32_t* pIndices, std::size_t indexCount, std::size_t vertexCount, unsigned int cacheSize = 16u);
+	//reorders clusters of a cache optimized list, positions are float3 stride bytes apart; pDst may not be pIndices
+	void OptimizeOverdraw(std::uint32_t* pDst, const std::uint32_t* pIndices, std::size_t indexCount,
+		const void* pPositions, std::size_t stride, std::size_t vertexCount, unsigned int cacheSize = 16u, float threshold = 1.05f);
+	//renumbers pIndices in first use order, remap[new vertex] = old vertex, returns the new vertex count
+	std::size_t OptimizeVertexFetch(std::uint32_t* pIndices, std::size_t indexCount, std::size_t vertexCount, std::vector<std::uint32_t>& remap);
+	//2 when every index of a mesh with vertexCount vertices fits R16_UINT, 4 otherwise
+	std::uint32_t ChooseIndexSize(std::size_t vertexCount) noexcept;
+	//throws MeshFile::Exception for inconsistent meshes: stream sizes, index count and range, lod bounds
+	void Validate(const Mesh& mesh);
+	//every pass, each lod range reordered on its own; throws MeshFile::Exception for inconsistent meshes
+	Report Optimize(Mesh& mesh, const Options& options = {});
+	//one job per mesh, every mesh is checked before any job starts
+	void OptimizeBatch(JobSystem& jobs, Mesh* pMeshes, Report* pReports, std::size_t count, const Options& options = {});
+	//views into mesh for MeshFile::Write(), indices are narrowed into narrowIndices when they fit 16 bits
+	MeshFile::Desc MakeDesc(const Mesh& mesh, std::vector<std::uint16_t>& narrowIndices);
+}
@@ -0,0 +1,413 @@
+#include "MeshSimplifier.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cmath>
+
+namespace {
+	//weight of the planes that hold open borders in place, relative to the triangles around them
+	constexpr double borderWeight = 10.0;
+
+	//sum of weighted squared plane distances, a x^T A x + 2 b^T x + c form with A symmetric
+	struct Quadric {
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;
+	};
+	Quadric MakeQuadric(double a, double b, double c, double d, double weight) noexcept {
+		return {
+			a * a * weight, a * b * weight, a * c * weight, b * b * weight, b * c * weight, c * c * weight,
+			a * d * weight, b * d * weight, c * d * weight,
+			d * d * weight,
+			weight
+		};
+	}
+	void Accumulate(Quadric& q, const Quadric& r) noexcept {
+		q.a00 += r.a00;
+		q.a01 += r.a01;
+		q.a02 += r.a02;
+		q.a11 += r.a11;
+		q.a12 += r.a12;
+		q.a22 += r.a22;
+		q.b0 += r.b0;
+		q.b1 += r.b1;
+		q.b2 += r.b2;
+		q.c += r.c;
+		q.weight += r.weight;
+	}
+	//mean squared distance of p to the planes in q plus r
+	double Evaluate(const Quadric& q, const Quadric& r, const rmath::Float3& p) noexcept {
+		const double x = p.x, y = p.y, z = p.z;
+		const double a00 = q.a00 + r.a00, a01 = q.a01 + r.a01, a02 = q.a02 + r.a02;
+		const double a11 = q.a11 + r.a11, a12 = q.a12 + r.a12, a22 = q.a22 + r.a22;
+		const double e = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+			+ 2.0 * ((q.b0 + r.b0) * x + (q.b1 + r.b1) * y + (q.b2 + r.b2) * z) + q.c + r.c;
+		const double weight = q.weight + r.weight;
+		return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+	}
+
+	struct Positions {
+		const unsigned char* pData;
+		std::size_t stride;
+		rmath::Float3 operator[](std::uint32_t v) const noexcept {
+			rmath::Float3 p;
+			std::memcpy(&p, pData + v * stride, sizeof(p));
+			return p;
+		}
+	};
+	rmath::Float3 Sub(const rmath::Float3& a, const rmath::Float3& b) noexcept {
+		return { a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+	rmath::Float3 Cross(const rmath::Float3& a, const rmath::Float3& b) noexcept {
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+	float Dot(const rmath::Float3& a, const rmath::Float3& b) noexcept {
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+	rmath::Float3 TriangleNormal(const Positions& positions, std::uint32_t a, std::uint32_t b, std::uint32_t c) noexcept {
+		const auto pa = positions[a];
+		return Cross(Sub(positions[b], pa), Sub(positions[c], pa));
+	}
+
+	std::uint64_t EdgeKey(std::uint32_t a, std::uint32_t b) noexcept {
+		return a < b ? (std::uint64_t(a) << 32) | b : (std::uint64_t(b) << 32) | a;
+	}
+	//sorted undirected edges of the triangle list and how many triangles use each
+	void CollectEdges(const std::vector<std::uint32_t>& indices, std::vector<std::uint64_t>& edges, std::vector<std::uint32_t>& uses) {
+		edges.resize(indices.size());
+		for(std::size_t t = 0u; t < indices.size(); t += 3u) {
+			edges[t] = EdgeKey(indices[t], indices[t + 1u]);
+			edges[t + 1u] = EdgeKey(indices[t + 1u], indices[t + 2u]);
+			edges[t + 2u] = EdgeKey(indices[t + 2u], indices[t]);
+		}
+		std::sort(edges.begin(), edges.end());
+		uses.clear();
+		std::size_t n = 0u;
+		for(std::size_t i = 0u; i < edges.size(); i++) {
+			if(n > 0u && edges[n - 1u] == edges[i]) {
+				uses[n - 1u]++;
+			}
+			else {
+				edges[n++] = edges[i];
+				uses.push_back(1u);
+			}
+		}
+		edges.resize(n);
+	}
+
+	struct Collapse {
+		std::uint32_t from;
+		std::uint32_t to;
+		double error;
+	};
+
+	//collapse state of one mesh, Run() can be called again with smaller targets to continue from where it stopped
+	class Simplifier {
+	public:
+		Simplifier(const std::uint32_t* pIndices, std::size_t indexCount, const Positions& positions, std::size_t vertexCount)
+			:
+			positions(positions),
+			indices(pIndices, pIndices + indexCount),
+			locked(vertexCount, 0u),
+			border(vertexCount, 0u),
+			quadrics(vertexCount, Quadric{}),
+			offsets(vertexCount + 1u),
+			remap(vertexCount),
+			touched(vertexCount, 0u)
+		{
+			LockSeams();
+			AddTriangleQuadrics();
+			AddBorderQuadrics();
+		}
+		//collapse until at most targetIndexCount indices are left or every remaining collapse costs more than errorLimit
+		void Run(std::size_t targetIndexCount, float errorLimit) {
+			const double limit = double(errorLimit) * double(errorLimit);
+			while(indices.size() > targetIndexCount && RunPass(targetIndexCount, limit)) {
+			}
+		}
+		const std::vector<std::uint32_t>& GetIndices() const noexcept {
+			return indices;
+		}
+		//largest collapse error so far
+		float GetError() const noexcept {
+			return float(std::sqrt(reached));
+		}
+	private:
+		//vertices that share a position with another vertex sit on an attribute seam, moving them would tear it
+		void LockSeams() {
+			std::vector<std::uint32_t> order(locked.size());
+			std::iota(order.begin(), order.end(), 0u);
+			const auto less = [&](std::uint32_t a, std::uint32_t b) {
+				const auto pa = positions[a], pb = positions[b];
+				return std::memcmp(&pa, &pb, sizeof(pa)) < 0;
+			};
+			std::sort(order.begin(), order.end(), less);
+			for(std::size_t i = 1u; i < order.size(); i++) {
+				if(!less(order[i - 1u], order[i])) {
+					locked[order[i - 1u]] = 1u;
+					locked[order[i]] = 1u;
+				}
+			}
+		}
+		//planes of the triangles around every vertex, area weighted
+		void AddTriangleQuadrics() noexcept {
+			for(std::size_t t = 0u; t < indices.size(); t += 3u) {
+				const std::uint32_t a = indices[t], b = indices[t + 1u], c = indices[t + 2u];
+				const auto n = TriangleNormal(positions, a, b, c);
+				const double length = std::sqrt(double(Dot(n, n)));
+				if(length == 0.0) {
+					continue;
+				}
+				const auto p = positions[a];
+				const double nx = n.x / length, ny = n.y / length, nz = n.z / length;
+				const Quadric q = MakeQuadric(nx, ny, nz, -(nx * p.x + ny * p.y + nz * p.z), 0.5 * length);
+				Accumulate(quadrics[a], q);
+				Accumulate(quadrics[b], q);
+				Accumulate(quadrics[c], q);
+			}
+		}
+		//edges of a single triangle are open borders: a plane through the edge, perpendicular to the triangle,
+		//keeps its vertices from moving inwards
+		void AddBorderQuadrics() {
+			//every directed edge with its triangle, sorted by undirected edge
+			std::vector<std::pair<std::uint64_t, std::uint32_t>> directed(indices.size());
+			for(std::size_t i = 0u; i < indices.size(); i++) {
+				const std::size_t next = i % 3u == 2u ? i - 2u : i + 1u;
+				directed[i] = { EdgeKey(indices[i], indices[next]), std::uint32_t(i) };
+			}
+			std::sort(directed.begin(), directed.end());
+			for(std::size_t i = 0u; i < directed.size(); i++) {
+				if((i > 0u && directed[i - 1u].first == directed[i].first) || (i + 1u < directed.size() && directed[i + 1u].first == directed[i].first)) {
+					continue;
+				}
+				const std::size_t first = directed[i].second;
+				const std::size_t t = first - first % 3u;
+				const std::uint32_t a = indices[first], b = indices[first % 3u == 2u ? first - 2u : first + 1u];
+				border[a] = 1u;
+				border[b] = 1u;
+				const auto n = TriangleNormal(positions, indices[t], indices[t + 1u], indices[t + 2u]);
+				const auto pa = positions[a];
+				const auto d = Sub(positions[b], pa);
+				const auto m = Cross(d, n);
+				const double length = std::sqrt(double(Dot(m, m)));
+				if(length == 0.0) {
+					continue;
+				}
+				const double mx = m.x / length, my = m.y / length, mz = m.z / length;
+				const Quadric q = MakeQuadric(mx, my, mz, -(mx * pa.x + my * pa.y + mz * pa.z), borderWeight * double(Dot(d, d)));
+				Accumulate(quadrics[a], q);
+				Accumulate(quadrics[b], q);
+			}
+		}
+		//one independent set of collapses, false when none could be applied
+		bool RunPass(std::size_t targetIndexCount, double limit) {
+			//triangles around every vertex
+			std::fill(offsets.begin(), offsets.end(), 0u);
+			for(const std::uint32_t v : indices) {
+				offsets[v + 1u]++;
+			}
+			std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+			triangles.resize(indices.size());
+			fill.assign(offsets.begin(), offsets.end() - 1);
+			for(std::size_t i = 0u; i < indices.size(); i++) {
+				triangles[fill[indices[i]]++] = std::uint32_t(i / 3u);
+			}
+
+			//cheapest direction of every edge
+			CollectEdges(indices, edges, uses);
+			collapses.clear();
+			for(std::size_t e = 0u; e < edges.size(); e++) {
+				const auto a = std::uint32_t(edges[e] >> 32), b = std::uint32_t(edges[e]);
+				Collapse best = { 0u, 0u, -1.0 };
+				for(int direction = 0; direction < 2; direction++) {
+					const std::uint32_t from = direction ? b : a, to = direction ? a : b;
+					//border vertices may only slide along the border
+					if(locked[from] || (border[from] && uses[e] != 1u)) {
+						continue;
+					}
+					const double error = Evaluate(quadrics[from], quadrics[to], positions[to]);
+					if(best.error < 0.0 || error < best.error) {
+						best = { from, to, error };
+					}
+				}
+				if(best.error >= 0.0 && best.error <= limit) {
+					collapses.push_back(best);
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) {
+				return x.error < y.error;
+			});
+
+			//independent set: a collapse only changes the triangles of its from vertex, none of their
+			//vertices takes part in another collapse of this pass
+			std::iota(remap.begin(), remap.end(), 0u);
+			const std::size_t needed = (indices.size() - targetIndexCount + 2u) / 3u;
+			std::size_t removed = 0u;
+			std::size_t applied = 0u;
+			for(const auto& c : collapses) {
+				if(removed >= needed) {
+					break;
+				}
+				if(touched[c.from] || touched[c.to]) {
+					continue;
+				}
+				std::size_t gone = 0u;
+				if(Flips(c, gone)) {
+					continue;
+				}
+				for(std::uint32_t i = offsets[c.from]; i < offsets[c.from + 1u]; i++) {
+					const std::uint32_t* p = &indices[3u * triangles[i]];
+					touched[p[0]] = 1u;
+					touched[p[1]] = 1u;
+					touched[p[2]] = 1u;
+				}
+				remap[c.from] = c.to;
+				Accumulate(quadrics[c.to], quadrics[c.from]);
+				reached = std::max(reached, c.error);
+				removed += gone;
+				applied++;
+			}
+			//apply the pass and drop the triangles that collapsed
+			std::size_t n = 0u;
+			for(std::size_t t = 0u; t < indices.size(); t += 3u) {
+				const std::uint32_t a = remap[indices[t]], b = remap[indices[t + 1u]], c = remap[indices[t + 2u]];
+				touched[indices[t]] = touched[indices[t + 1u]] = touched[indices[t + 2u]] = 0u;
+				if(a != b && b != c && c != a) {
+					indices[n++] = a;
+					indices[n++] = b;
+					indices[n++] = c;
+				}
+			}
+			indices.resize(n);
+			return applied > 0u;
+		}
+		//true when moving from onto to turns one of from's remaining triangles over, gone counts the ones that vanish
+		bool Flips(const Collapse& c, std::size_t& gone) const noexcept {
+			const auto toPosition = positions[c.to];
+			for(std::uint32_t i = offsets[c.from]; i < offsets[c.from + 1u]; i++) {
+				const std::uint32_t* p = &indices[3u * triangles[i]];
+				if(p[0] == c.to || p[1] == c.to || p[2] == c.to) {
+					gone++;
+					continue;
+				}
+				rmath::Float3 q[3] = { positions[p[0]], positions[p[1]], positions[p[2]] };
+				const auto before = Cross(Sub(q[1], q[0]), Sub(q[2], q[0]));
+				for(int k = 0; k < 3; k++) {
+					if(p[k] == c.from) {
+						q[k] = toPosition;
+					}
+				}
+				const auto after = Cross(Sub(q[1], q[0]), Sub(q[2], q[0]));
+				if(Dot(before, before) > 0.0f && Dot(before, after) <= 0.0f) {
+					return true;
+				}
+			}
+			return false;
+		}
+	private:
+		Positions positions;
+		std::vector<std::uint32_t> indices;
+		std::vector<std::uint8_t> locked;
+		std::vector<std::uint8_t> border;
+		std::vector<Quadric> quadrics;
+		double reached = 0.0; //squared
+		//per pass scratch
+		std::vector<std::uint32_t> offsets;
+		std::vector<std::uint32_t> fill;
+		std::vector<std::uint32_t> triangles;
+		std::vector<std::uint64_t> edges;
+		std::vector<std::uint32_t> uses;
+		std::vector<Collapse> collapses;
+		std::vector<std::uint32_t> remap;
+		std::vector<std::uint8_t> touched;
+	};
+
+	const MeshFile::Attribute& FindPositions(const MeshOptimizer::Mesh& mesh) {
+		for(const auto& a : mesh.attributes) {
+			if(a.semanticIndex == 0u && std::strcmp(a.semantic, "POSITION") == 0) {
+				if(a.format != MeshFile::Format::Float3 || a.stream >= mesh.streams.size()) {
+					throw MeshFile::Exception(__LINE__, __FILE__, "Lods need float3 positions, build them before compressing the mesh");
+				}
+				return a;
+			}
+		}
+		throw MeshFile::Exception(__LINE__, __FILE__, "Lods need a POSITION attribute");
+	}
+	void ValidateForLods(const MeshOptimizer::Mesh& mesh) {
+		MeshOptimizer::Validate(mesh);
+		FindPositions(mesh);
+		if(mesh.lods.size() > 1u || (mesh.lods.size() == 1u && mesh.lods[0].indexCount != mesh.indices.size())) {
+			throw MeshFile::Exception(__LINE__, __FILE__, "Mesh already has lods");
+		}
+	}
+
+	void BuildLodsValidated(MeshOptimizer::Mesh& mesh, const MeshSimplifier::LodOptions& options) {
+		const auto& position = FindPositions(mesh);
+		const unsigned char* pPositions = mesh.streams[position.stream].data() + position.offset;
+		const std::size_t stride = mesh.strides[position.stream];
+		const Positions positions = { pPositions, stride };
+
+		//errors are given relative to the bounds, referenced vertices only
+		rmath::Float3 min = { 0.0f, 0.0f, 0.0f }, max = min;
+		for(std::size_t i = 0u; i < mesh.indices.size(); i++) {
+			const auto p = positions[mesh.indices[i]];
+			min = i ? rmath::Float3{ std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) } : p;
+			max = i ? rmath::Float3{ std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) } : p;
+		}
+		const auto diagonal = Sub(max, min);
+		const float maxError = options.maxError * std::sqrt(Dot(diagonal, diagonal));
+
+		//one simplifier continues through the chain, so every lod's error is measured against the full mesh
+		Simplifier simplifier(mesh.indices.data(), mesh.indices.size(), positions, mesh.vertexCount);
+		mesh.lods.assign(1u, { 0u, std::uint32_t(mesh.indices.size()), 0.0f });
+		std::size_t previous = mesh.indices.size();
+		while(mesh.lods.size() < options.maxLods) {
+			const std::size_t target = std::size_t(float(previous / 3u) * options.reduction) * 3u;
+			if(target < 3u * options.minTriangles) {
+				break;
+			}
+			simplifier.Run(target, maxError);
+			const auto& lod = simplifier.GetIndices();
+			//stuck at the error limit or on locked vertices, another lod would look the same
+			if(lod.size() + previous / 10u >= previous) {
+				break;
+			}
+			mesh.lods.push_back({ std::uint32_t(mesh.indices.size()), std::uint32_t(lod.size()), simplifier.GetError() });
+			mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+			previous = lod.size();
+		}
+	}
+}
+
+std::size_t MeshSimplifier::Simplify(std::uint32_t* pDst, const std::uint32_t* pIndices, std::size_t indexCount,
+	const void* pPositions, std::size_t stride, std::size_t vertexCount,
+	std::size_t targetIndexCount, float targetError, float* pError)
+{
+	Simplifier simplifier(pIndices, indexCount, { static_cast<const unsigned char*>(pPositions), stride }, vertexCount);
+	simplifier.Run(targetIndexCount, targetError);
+	const auto& indices = simplifier.GetIndices();
+	std::copy(indices.begin(), indices.end(), pDst);
+	if(pError) {
+		*pError = simplifier.GetError();
+	}
+	return indices.size();
+}
+
+void MeshSimplifier::BuildLods(MeshOptimizer::Mesh& mesh, const LodOptions& options) {
+	ValidateForLods(mesh);
+	BuildLodsValidated(mesh, options);
+}
+
+void MeshSimplifier::BuildLodsBatch(JobSystem& jobs, MeshOptimizer::Mesh* pMeshes, std::size_t count, const LodOptions& options) {
+	//jobs must not throw, so every error is found up front
+	for(std::size_t i = 0u; i < count; i++) {
+		ValidateForLods(pMeshes[i]);
+	}
+	jobs.ParallelFor(count, 1u, [&](std::size_t begin, std::size_t end) {
+		for(std::size_t i = begin; i < end; i++) {
+			BuildLodsValidated(pMeshes[i], options);
+		}
+	});
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "MeshOptimizer.h"
+#include <cstdint>
+#include <cstddef>
+
+class JobSystem;
+
+//Offline level of detail generation by edge collapse with quadric error metrics (Garland and Heckbert,
+//"Surface Simplification Using Quadric Error Metrics").
+//A vertex collapses onto one of its neighbors, so every lod indexes the original vertex buffer and a chain is
+//just more index ranges (MeshFile::Lod). Collapses are applied in passes: candidates sorted by error, then an
+//independent set of them (no two touching the same triangles) applied at once, which keeps every pass linear
+//apart from the sort.
+//Collapses that flip a triangle are skipped, open borders only slide along themselves and vertices sharing
+//their position with another vertex (attribute seams) stay put.
+//Errors are distances in the mesh's units: the root of the area weighted mean squared distance of a
+//collapsed vertex to the planes of the triangles it stands for.
+//Does not depend on D3D or Windows.
+namespace MeshSimplifier {
+	struct LodOptions {
+		std::size_t maxLods = 4u; //including the full detail one
+		float reduction = 0.5f; //triangles of a lod relative to the one before
+		float maxError = 0.05f; //relative to the diagonal of the mesh bounds, coarser lods are not built
+		std::size_t minTriangles = 8u;
+	};
+	//simplify towards targetIndexCount without going past targetError (in mesh units), returns the index count
+	//written to pDst (room for indexCount, may be pIndices); pError receives the error reached
+	std::size_t Simplify(std::uint32_t* pDst, const std::uint32_t* pIndices, std::size_t indexCount,
+		const void* pPositions, std::size_t stride, std::size_t vertexCount,
+		std::size_t targetIndexCount, float targetError, float* pError = nullptr);
+	//replaces mesh's indices with a chain: lod 0 is the mesh as it was, every further lod continues simplifying
+	//the one before and its error is measured against lod 0. Needs float3 positions, so build lods before VertexQuantization::Compress(),
+	//and run MeshOptimizer::Optimize() afterwards. Throws MeshFile::Exception for meshes it cannot handle.
+	void BuildLods(MeshOptimizer::Mesh& mesh, const LodOptions& options = {});
+	//one job per mesh, every mesh is checked before any job starts
+	void BuildLodsBatch(JobSystem& jobs, MeshOptimizer::Mesh* pMeshes, std::size_t count, const LodOptions& options = {});
+}
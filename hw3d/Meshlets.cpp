@@ -0,0 +1,435 @@
+#include "Meshlets.h"
+#include "MeshFile.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+namespace {
+	//triangles per build job, fixed so the output does not depend on the thread count
+	constexpr std::size_t chunkTriangles = 65536u;
+	//open addressing table from mesh vertex to meshlet vertex, at most half full
+	constexpr std::uint32_t tableSize = 2u * Meshlets::maxVertices;
+	constexpr std::uint32_t emptyKey = 0xFFFFFFFFu;
+	constexpr std::uint32_t noTriangle = 0xFFFFFFFFu;
+
+	rmath::Float3 Sub(const rmath::Float3& a, const rmath::Float3& b) noexcept {
+		return { a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+	rmath::Float3 Cross(const rmath::Float3& a, const rmath::Float3& b) noexcept {
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+	float Dot(const rmath::Float3& a, const rmath::Float3& b) noexcept {
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+	//0 for degenerate input
+	rmath::Float3 Normalize(const rmath::Float3& v) noexcept {
+		const float length = std::sqrt(Dot(v, v));
+		return length > 0.0f ? rmath::Float3{ v.x / length, v.y / length, v.z / length } : rmath::Float3{ 0.0f, 0.0f, 0.0f };
+	}
+	struct Positions {
+		const unsigned char* pData;
+		std::size_t stride;
+		rmath::Float3 operator[](std::uint32_t v) const noexcept {
+			rmath::Float3 p;
+			std::memcpy(&p, pData + v * stride, sizeof(p));
+			return p;
+		}
+	};
+	//outward normal of a clockwise front face
+	rmath::Float3 FaceNormal(const Positions& positions, std::uint32_t a, std::uint32_t b, std::uint32_t c) noexcept {
+		const auto pa = positions[a];
+		return Normalize(Cross(Sub(positions[b], pa), Sub(positions[c], pa)));
+	}
+
+	//triangles using each vertex, compressed rows
+	struct Adjacency {
+		std::vector<std::uint32_t> offsets;
+		std::vector<std::uint32_t> triangles;
+		Adjacency(const std::uint32_t* pIndices, std::size_t indexCount, std::size_t vertexCount)
+			:
+			offsets(vertexCount + 1u, 0u),
+			triangles(indexCount)
+		{
+			for(std::size_t i = 0u; i < indexCount; i++) {
+				offsets[pIndices[i] + 1u]++;
+			}
+			for(std::size_t v = 0u; v < vertexCount; v++) {
+				offsets[v + 1u] += offsets[v];
+			}
+			std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+			for(std::size_t i = 0u; i < indexCount; i++) {
+				triangles[fill[pIndices[i]]++] = std::uint32_t(i / 3u);
+			}
+		}
+	};
+
+	struct Chunk {
+		std::vector<Meshlets::Meshlet> meshlets;
+		std::vector<std::uint32_t> vertices;
+		std::vector<std::uint8_t> triangles;
+	};
+
+	//greedy growth over the triangles [begin, end), the only ones this job touches in emitted
+	class ChunkBuilder {
+	public:
+		ChunkBuilder(const std::uint32_t* pIndices, const Positions& positions, const Adjacency& adjacency, std::uint8_t* pEmitted,
+			std::uint32_t vertexLimit, std::uint32_t triangleLimit) noexcept
+			:
+			pIndices(pIndices),
+			positions(positions),
+			adjacency(adjacency),
+			pEmitted(pEmitted),
+			vertexLimit(vertexLimit),
+			triangleLimit(triangleLimit)
+		{
+			std::fill(std::begin(keys), std::end(keys), emptyKey);
+		}
+		void Build(std::uint32_t begin, std::uint32_t end, Chunk& out) {
+			this->begin = begin;
+			this->end = end;
+			normals.resize(end - begin);
+			for(std::uint32_t t = begin; t < end; t++) {
+				normals[t - begin] = FaceNormal(positions, pIndices[3u * t], pIndices[3u * t + 1u], pIndices[3u * t + 2u]);
+			}
+			std::uint32_t cursor = begin;
+			for(;;) {
+				std::uint32_t t = FindAdjacent();
+				if(t == noTriangle) {
+					while(cursor < end && pEmitted[cursor]) {
+						cursor++;
+					}
+					if(cursor == end) {
+						break;
+					}
+					t = cursor;
+				}
+				if(vertexCount + CountNewVertices(t) > vertexLimit || triangleCount == triangleLimit) {
+					Flush(out);
+				}
+				Add(t);
+			}
+			Flush(out);
+		}
+	private:
+		std::uint32_t Hash(std::uint32_t v) const noexcept {
+			return (v * 0x9E3779B1u) >> 25; //top 7 bits, tableSize entries
+		}
+		//meshlet vertex of v, or -1
+		int Find(std::uint32_t v) const noexcept {
+			for(std::uint32_t h = Hash(v);; h = (h + 1u) & (tableSize - 1u)) {
+				if(keys[h] == v) {
+					return slots[h];
+				}
+				if(keys[h] == emptyKey) {
+					return -1;
+				}
+			}
+		}
+		std::uint8_t Insert(std::uint32_t v) noexcept {
+			std::uint32_t h = Hash(v);
+			while(keys[h] != emptyKey) {
+				if(keys[h] == v) {
+					return slots[h];
+				}
+				h = (h + 1u) & (tableSize - 1u);
+			}
+			keys[h] = v;
+			slots[h] = std::uint8_t(vertexCount);
+			vertices[vertexCount++] = v;
+			return slots[h];
+		}
+		std::uint32_t CountNewVertices(std::uint32_t t) const noexcept {
+			const std::uint32_t* p = pIndices + 3u * t;
+			return std::uint32_t(Find(p[0]) < 0)
+				+ std::uint32_t(Find(p[1]) < 0 && p[1] != p[0])
+				+ std::uint32_t(Find(p[2]) < 0 && p[2] != p[0] && p[2] != p[1]);
+		}
+		//fewest new vertices first, then the normal closest to the meshlet's
+		void Consider(std::uint32_t vertex, std::uint32_t& best, std::uint32_t& bestNew, float& bestDot) const noexcept {
+			for(std::uint32_t i = adjacency.offsets[vertex]; i < adjacency.offsets[vertex + 1u]; i++) {
+				const std::uint32_t t = adjacency.triangles[i];
+				if(t < begin || t >= end || pEmitted[t]) {
+					continue;
+				}
+				const std::uint32_t extra = CountNewVertices(t);
+				const float dot = Dot(normals[t - begin], normalSum);
+				if(extra < bestNew || (extra == bestNew && dot > bestDot)) {
+					best = t;
+					bestNew = extra;
+					bestDot = dot;
+				}
+			}
+		}
+		std::uint32_t FindAdjacent() const noexcept {
+			if(last == noTriangle) {
+				return noTriangle;
+			}
+			std::uint32_t best = noTriangle;
+			std::uint32_t bestNew = 4u;
+			float bestDot = -std::numeric_limits<float>::infinity();
+			for(std::uint32_t k = 0u; k < 3u; k++) {
+				Consider(pIndices[3u * last + k], best, bestNew, bestDot);
+			}
+			//the last triangle is closed off, try the whole border of the meshlet
+			for(std::uint32_t v = 0u; best == noTriangle && v < vertexCount; v++) {
+				Consider(vertices[v], best, bestNew, bestDot);
+			}
+			return best;
+		}
+		void Add(std::uint32_t t) noexcept {
+			for(std::uint32_t k = 0u; k < 3u; k++) {
+				triangles[3u * triangleCount + k] = Insert(pIndices[3u * t + k]);
+			}
+			triangleCount++;
+			const auto& n = normals[t - begin];
+			normalSum = { normalSum.x + n.x, normalSum.y + n.y, normalSum.z + n.z };
+			pEmitted[t] = 1u;
+			last = t;
+		}
+		void Flush(Chunk& out) {
+			if(triangleCount == 0u) {
+				return;
+			}
+			out.meshlets.push_back({ std::uint32_t(out.vertices.size()), std::uint32_t(out.triangles.size()), vertexCount, triangleCount });
+			out.vertices.insert(out.vertices.end(), vertices, vertices + vertexCount);
+			out.triangles.insert(out.triangles.end(), triangles, triangles + 3u * triangleCount);
+			std::fill(std::begin(keys), std::end(keys), emptyKey);
+			vertexCount = 0u;
+			triangleCount = 0u;
+			normalSum = { 0.0f, 0.0f, 0.0f };
+			last = noTriangle;
+		}
+	private:
+		const std::uint32_t* pIndices;
+		Positions positions;
+		const Adjacency& adjacency;
+		std::uint8_t* pEmitted;
+		std::uint32_t vertexLimit;
+		std::uint32_t triangleLimit;
+		std::uint32_t begin = 0u;
+		std::uint32_t end = 0u;
+		std::vector<rmath::Float3> normals; //of [begin, end)
+		std::uint32_t keys[tableSize];
+		std::uint8_t slots[tableSize];
+		std::uint32_t vertices[Meshlets::maxVertices];
+		std::uint8_t triangles[3u * Meshlets::maxTriangles];
+		std::uint32_t vertexCount = 0u;
+		std::uint32_t triangleCount = 0u;
+		rmath::Float3 normalSum = { 0.0f, 0.0f, 0.0f };
+		std::uint32_t last = noTriangle;
+	};
+
+	void ComputeBounds(Meshlets::Data& data, std::size_t m, const Positions& positions) noexcept {
+		const auto& meshlet = data.meshlets[m];
+		const std::uint32_t* pVertices = data.vertices.data() + meshlet.vertexOffset;
+		const std::uint8_t* pTriangles = data.triangles.data() + meshlet.triangleOffset;
+		//sphere around the center of the box
+		rmath::Float3 min = positions[pVertices[0]];
+		rmath::Float3 max = min;
+		for(std::uint32_t v = 1u; v < meshlet.vertexCount; v++) {
+			const auto p = positions[pVertices[v]];
+			min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+			max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+		}
+		const rmath::Float3 center = { 0.5f * (min.x + max.x), 0.5f * (min.y + max.y), 0.5f * (min.z + max.z) };
+		float radius2 = 0.0f;
+		for(std::uint32_t v = 0u; v < meshlet.vertexCount; v++) {
+			const auto d = Sub(positions[pVertices[v]], center);
+			radius2 = std::max(radius2, Dot(d, d));
+		}
+		data.centerX[m] = center.x;
+		data.centerY[m] = center.y;
+		data.centerZ[m] = center.z;
+		data.radius[m] = std::sqrt(radius2);
+		//cone around the average normal, degenerate triangles are never drawn and do not count
+		rmath::Float3 normals[Meshlets::maxTriangles];
+		rmath::Float3 sum = { 0.0f, 0.0f, 0.0f };
+		for(std::uint32_t t = 0u; t < meshlet.triangleCount; t++) {
+			const std::uint8_t* p = pTriangles + 3u * t;
+			normals[t] = FaceNormal(positions, pVertices[p[0]], pVertices[p[1]], pVertices[p[2]]);
+			sum = { sum.x + normals[t].x, sum.y + normals[t].y, sum.z + normals[t].z };
+		}
+		const auto axis = Normalize(sum);
+		float minDot = 1.0f;
+		for(std::uint32_t t = 0u; t < meshlet.triangleCount; t++) {
+			if(Dot(normals[t], normals[t]) > 0.0f) {
+				minDot = std::min(minDot, Dot(normals[t], axis));
+			}
+		}
+		//past about 84 degrees the cone almost never culls, not worth the test
+		if(Dot(axis, axis) == 0.0f || minDot <= 0.1f) {
+			data.cones[m] = { { 0.0f, 0.0f, 0.0f }, 1.0f };
+		}
+		else {
+			data.cones[m] = { axis, std::sqrt(1.0f - minDot * minDot) };
+		}
+	}
+
+	//the point every clip space x = y = w = 0 comes from, false for an orthographic projection
+	bool FindEye(const rmath::Mat4& transform, rmath::Float3& eye) noexcept {
+		const auto& m = transform.m;
+		const int columns[3] = { 0, 1, 3 };
+		double a[3][3];
+		double b[3];
+		for(int r = 0; r < 3; r++) {
+			for(int i = 0; i < 3; i++) {
+				a[r][i] = m[i][columns[r]];
+			}
+			b[r] = -m[3][columns[r]];
+		}
+		const auto det3 = [](const double(&x)[3][3]) {
+			return x[0][0] * (x[1][1] * x[2][2] - x[1][2] * x[2][1])
+				- x[0][1] * (x[1][0] * x[2][2] - x[1][2] * x[2][0])
+				+ x[0][2] * (x[1][0] * x[2][1] - x[1][1] * x[2][0]);
+		};
+		const double det = det3(a);
+		if(det == 0.0) {
+			return false;
+		}
+		//Cramer's rule
+		double solution[3];
+		for(int i = 0; i < 3; i++) {
+			double replaced[3][3];
+			std::memcpy(replaced, a, sizeof(a));
+			for(int r = 0; r < 3; r++) {
+				replaced[r][i] = b[r];
+			}
+			solution[i] = det3(replaced) / det;
+		}
+		eye = { float(solution[0]), float(solution[1]), float(solution[2]) };
+		return std::isfinite(eye.x) && std::isfinite(eye.y) && std::isfinite(eye.z);
+	}
+}
+
+FrustumCull::Spheres Meshlets::Data::GetSpheres() const noexcept {
+	return { centerX.data(), centerY.data(), centerZ.data(), radius.data(), meshlets.size() };
+}
+
+Meshlets::Data Meshlets::Build(const std::uint32_t* pIndices, std::size_t indexCount, const void* pPositions, std::size_t stride, std::size_t vertexCount,
+	JobSystem* pJobs, std::uint32_t vertexLimit, std::uint32_t triangleLimit)
+{
+	if(vertexLimit < 3u || vertexLimit > maxVertices || triangleLimit == 0u || triangleLimit > maxTriangles) {
+		throw MeshFile::Exception(__LINE__, __FILE__, "Meshlet limits out of range");
+	}
+	if(indexCount % 3u || indexCount > 0xFFFFFFFFu || vertexCount > 0xFFFFFFFFu) {
+		throw MeshFile::Exception(__LINE__, __FILE__, "Mesh index count must be a multiple of 3 below 2^32");
+	}
+	for(std::size_t i = 0u; i < indexCount; i++) {
+		if(pIndices[i] >= vertexCount) {
+			throw MeshFile::Exception(__LINE__, __FILE__, "Mesh index out of range");
+		}
+	}
+	const Positions positions = { static_cast<const unsigned char*>(pPositions), stride };
+	const Adjacency adjacency(pIndices, indexCount, vertexCount);
+	const std::size_t triangleCount = indexCount / 3u;
+	std::vector<std::uint8_t> emitted(triangleCount, 0u);
+
+	const std::size_t chunkCount = (triangleCount + chunkTriangles - 1u) / chunkTriangles;
+	std::vector<Chunk> chunks(chunkCount);
+	const auto buildChunks = [&](std::size_t first, std::size_t last) {
+		for(std::size_t c = first; c < last; c++) {
+			const auto begin = std::uint32_t(c * chunkTriangles);
+			const auto end = std::uint32_t(std::min(triangleCount, (c + 1u) * chunkTriangles));
+			ChunkBuilder(pIndices, positions, adjacency, emitted.data(), vertexLimit, triangleLimit).Build(begin, end, chunks[c]);
+		}
+	};
+	if(pJobs) {
+		pJobs->ParallelFor(chunkCount, 1u, buildChunks);
+	}
+	else {
+		buildChunks(0u, chunkCount);
+	}
+
+	Data data;
+	std::size_t meshletCount = 0u, vertexTotal = 0u, triangleTotal = 0u;
+	for(const auto& c : chunks) {
+		meshletCount += c.meshlets.size();
+		vertexTotal += c.vertices.size();
+		triangleTotal += c.triangles.size();
+	}
+	data.meshlets.reserve(meshletCount);
+	data.vertices.reserve(vertexTotal);
+	data.triangles.reserve(triangleTotal);
+	for(auto& c : chunks) {
+		for(auto m : c.meshlets) {
+			m.vertexOffset += std::uint32_t(data.vertices.size());
+			m.triangleOffset += std::uint32_t(data.triangles.size());
+			data.meshlets.push_back(m);
+		}
+		data.vertices.insert(data.vertices.end(), c.vertices.begin(), c.vertices.end());
+		data.triangles.insert(data.triangles.end(), c.triangles.begin(), c.triangles.end());
+		c = {};
+	}
+
+	data.centerX.resize(meshletCount);
+	data.centerY.resize(meshletCount);
+	data.centerZ.resize(meshletCount);
+	data.radius.resize(meshletCount);
+	data.cones.resize(meshletCount);
+	const auto computeBounds = [&](std::size_t first, std::size_t last) {
+		for(std::size_t m = first; m < last; m++) {
+			ComputeBounds(data, m, positions);
+		}
+	};
+	if(pJobs) {
+		pJobs->ParallelFor(meshletCount, 1024u, computeBounds);
+	}
+	else {
+		computeBounds(0u, meshletCount);
+	}
+	return data;
+}
+
+std::size_t Meshlets::Cull(const Data& data, const rmath::Mat4& transform, std::uint32_t* pVisible) noexcept {
+	//planes of the combined transform are in mesh space, like the spheres
+	const std::size_t inFrustum = FrustumCull::Cull(FrustumCull::ExtractFrustum(transform), data.GetSpheres(), pVisible);
+	rmath::Float3 eye;
+	if(!FindEye(transform, eye)) {
+		return inFrustum;
+	}
+	std::size_t n = 0u;
+	for(std::size_t i = 0u; i < inFrustum; i++) {
+		if(!IsBackFacing(data, pVisible[i], eye)) {
+			pVisible[n++] = pVisible[i];
+		}
+	}
+	return n;
+}
+
+bool Meshlets::IsBackFacing(const Data& data, std::uint32_t meshlet, const rmath::Float3& eye) noexcept {
+	//every direction from the eye into the sphere is within the cone's spread of axis
+	const auto& cone = data.cones[meshlet];
+	const rmath::Float3 d = { data.centerX[meshlet] - eye.x, data.centerY[meshlet] - eye.y, data.centerZ[meshlet] - eye.z };
+	return Dot(d, cone.axis) >= cone.cutoff * std::sqrt(Dot(d, d)) + data.radius[meshlet];
+}
+
+std::size_t Meshlets::AppendIndices(const Data& data, const std::uint32_t* pMeshlets, std::size_t count, std::vector<std::uint32_t>& indices, JobSystem* pJobs) {
+	//where each meshlet's indices start, so the copies can run in any order
+	std::vector<std::size_t> offsets(count + 1u);
+	offsets[0] = indices.size();
+	for(std::size_t i = 0u; i < count; i++) {
+		offsets[i + 1u] = offsets[i] + 3u * data.meshlets[pMeshlets[i]].triangleCount;
+	}
+	indices.resize(offsets[count]);
+	std::uint32_t* pOut = indices.data();
+	const auto expand = [&](std::size_t first, std::size_t last) {
+		for(std::size_t i = first; i < last; i++) {
+			const auto& meshlet = data.meshlets[pMeshlets[i]];
+			const std::uint32_t* pVertices = data.vertices.data() + meshlet.vertexOffset;
+			const std::uint8_t* pTriangles = data.triangles.data() + meshlet.triangleOffset;
+			std::uint32_t* pDst = pOut + offsets[i];
+			for(std::uint32_t k = 0u; k < 3u * meshlet.triangleCount; k++) {
+				pDst[k] = pVertices[pTriangles[k]];
+			}
+		}
+	};
+	if(pJobs) {
+		pJobs->ParallelFor(count, 256u, expand);
+	}
+	else {
+		expand(0u, count);
+	}
+	return offsets[count] - offsets[0];
+}
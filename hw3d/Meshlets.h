@@ -0,0 +1,63 @@
+#pragma once
+#include "RasterMath.h"
+#include "FrustumCull.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class JobSystem;
+
+//Splits an indexed triangle list into small clusters (meshlets) that are culled on their own.
+//Each meshlet references at most maxVertices vertices and maxTriangles triangles, its triangles are 8 bit
+//indices into its own vertex list, the usual layout for mesh shaders.
+//
+//Build() grows one meshlet at a time over shared edges: the next triangle is the one adjacent to the
+//last added that needs the fewest new vertices, ties go to the one facing most like the meshlet so far
+//(tight normal cones). When no adjacent triangle is left it continues with the next unused one in index
+//order, so run MeshOptimizer first. Large inputs are split into fixed triangle ranges built as jobs,
+//the result does not depend on the thread count.
+//
+//Every meshlet gets a bounding sphere and a normal cone (Wihlidal, "Optimizing the Graphics Pipeline
+//with Compute"). Cull() drops meshlets outside the frustum (FrustumCull's SIMD sphere test) and
+//meshlets whose triangles all face away from the eye; AppendIndices() turns the survivors back into
+//an ordinary 32 bit index list for DrawIndexed.
+//Front faces are clockwise like the rest of the pipeline. Does not depend on D3D or Windows.
+namespace Meshlets {
+	constexpr std::uint32_t maxVertices = 64u;
+	constexpr std::uint32_t maxTriangles = 124u;
+	struct Meshlet {
+		std::uint32_t vertexOffset; //into Data::vertices
+		std::uint32_t triangleOffset; //into Data::triangles, 3 bytes per triangle
+		std::uint32_t vertexCount;
+		std::uint32_t triangleCount;
+	};
+	//front faces of the meshlet point within asin(cutoff) of axis; axis is 0 (and cutoff 1) when they spread too far
+	struct Cone {
+		rmath::Float3 axis;
+		float cutoff; //sine of the spread
+	};
+	struct Data {
+		std::vector<Meshlet> meshlets;
+		std::vector<std::uint32_t> vertices; //mesh vertex indices
+		std::vector<std::uint8_t> triangles; //meshlet vertex indices
+		//bounding spheres, structure of arrays for FrustumCull
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> radius;
+		std::vector<Cone> cones;
+		FrustumCull::Spheres GetSpheres() const noexcept;
+	};
+	//positions are float3 stride bytes apart; vertexLimit and triangleLimit at most maxVertices / maxTriangles,
+	//pJobs may be null to build on the calling thread; throws MeshFile::Exception for out of range indices
+	Data Build(const std::uint32_t* pIndices, std::size_t indexCount, const void* pPositions, std::size_t stride, std::size_t vertexCount,
+		JobSystem* pJobs = nullptr, std::uint32_t vertexLimit = maxVertices, std::uint32_t triangleLimit = maxTriangles);
+	//transform takes the mesh's positions to clip space (world * view * projection, row vectors), the eye is
+	//recovered from it, so orthographic projections only get the frustum test.
+	//pVisible needs room for every meshlet, returns how many survived, in ascending order
+	std::size_t Cull(const Data& data, const rmath::Mat4& transform, std::uint32_t* pVisible) noexcept;
+	//single meshlet version of Cull()'s cone test, eye in the mesh's space
+	bool IsBackFacing(const Data& data, std::uint32_t meshlet, const rmath::Float3& eye) noexcept;
+	//appends the triangles of the given meshlets as mesh vertex indices, returns how many indices were added
+	std::size_t AppendIndices(const Data& data, const std::uint32_t* pMeshlets, std::size_t count, std::vector<std::uint32_t>& indices, JobSystem* pJobs = nullptr);
+}
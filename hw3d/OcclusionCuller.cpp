@@ -0,0 +1,250 @@
+#include "OcclusionCuller.h"
+#include "Timer.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+	double MsSince(std::int64_t begin) noexcept {
+		return double(Timer::Ticks() - begin) * 1e-6;
+	}
+}
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height)
+	:
+	rasterizer(width, height),
+	viewProj(rmath::Identity()),
+	scratch(std::size_t(width) * height)
+{
+	//every level halves the one below it until a single texel is left
+	unsigned int w = width, h = height;
+	for(;;) {
+		levels.push_back({ w, h, std::vector<float>(std::size_t(w) * h, 1.0f), std::vector<float>(std::size_t(w) * h, 1.0f) });
+		if(w == 1u && h == 1u) {
+			break;
+		}
+		w = (w + 1u) / 2u;
+		h = (h + 1u) / 2u;
+	}
+	rasterizer.ClearBuffer(0.0f, 0.0f, 0.0f);
+}
+
+void OcclusionCuller::BeginFrame(const rmath::Mat4& viewProj) noexcept {
+	this->viewProj = viewProj;
+	rasterizer.ClearBuffer(0.0f, 0.0f, 0.0f);
+	pyramidDirty = true;
+	stats = {};
+}
+
+void OcclusionCuller::AddOccluder(const void* pVertices, std::size_t stride, std::size_t vertexCount,
+	const unsigned short* pIndices, std::size_t indexCount, const rmath::Mat4& transform)
+{
+	const auto begin = Timer::Ticks();
+	rasterizer.DrawIndexed(pVertices, stride, vertexCount, pIndices, indexCount, transform);
+	pyramidDirty = true;
+	stats.occluders++;
+	stats.occluderTriangles += indexCount / 3u;
+	stats.rasterizeMs += MsSince(begin);
+}
+
+void OcclusionCuller::AddOccluder(const void* pVertices, std::size_t stride, std::size_t vertexCount,
+	const std::uint32_t* pIndices, std::size_t indexCount, const rmath::Mat4& transform)
+{
+	const auto begin = Timer::Ticks();
+	rasterizer.DrawIndexed(pVertices, stride, vertexCount, pIndices, indexCount, transform);
+	pyramidDirty = true;
+	stats.occluders++;
+	stats.occluderTriangles += indexCount / 3u;
+	stats.rasterizeMs += MsSince(begin);
+}
+
+std::size_t OcclusionCuller::Cull(const FrustumCull::Spheres& spheres, std::uint32_t* pVisible) {
+	BuildPyramid();
+	const auto begin = Timer::Ticks();
+	std::size_t n = 0u;
+	for(std::size_t i = 0u; i < spheres.count; i++) {
+		const float r = spheres.pRadius[i];
+		if(!IsBoxOccluded({ spheres.pX[i], spheres.pY[i], spheres.pZ[i] }, { r, r, r })) {
+			pVisible[n++] = std::uint32_t(i);
+		}
+	}
+	stats.tested += spheres.count;
+	stats.occluded += spheres.count - n;
+	stats.testMs += MsSince(begin);
+	return n;
+}
+
+std::size_t OcclusionCuller::Cull(const FrustumCull::Boxes& boxes, std::uint32_t* pVisible) {
+	BuildPyramid();
+	const auto begin = Timer::Ticks();
+	std::size_t n = 0u;
+	for(std::size_t i = 0u; i < boxes.count; i++) {
+		if(!IsBoxOccluded({ boxes.pX[i], boxes.pY[i], boxes.pZ[i] }, { boxes.pExtentX[i], boxes.pExtentY[i], boxes.pExtentZ[i] })) {
+			pVisible[n++] = std::uint32_t(i);
+		}
+	}
+	stats.tested += boxes.count;
+	stats.occluded += boxes.count - n;
+	stats.testMs += MsSince(begin);
+	return n;
+}
+
+bool OcclusionCuller::IsOccluded(const rmath::Float3& center, const rmath::Float3& extent) {
+	BuildPyramid();
+	const auto begin = Timer::Ticks();
+	const bool occluded = IsBoxOccluded(center, extent);
+	stats.tested++;
+	stats.occluded += occluded;
+	stats.testMs += MsSince(begin);
+	return occluded;
+}
+
+const OcclusionCuller::Stats& OcclusionCuller::GetStats() const noexcept {
+	return stats;
+}
+
+unsigned int OcclusionCuller::GetWidth() const noexcept {
+	return levels[0].width;
+}
+
+unsigned int OcclusionCuller::GetHeight() const noexcept {
+	return levels[0].height;
+}
+
+std::size_t OcclusionCuller::GetLevelCount() {
+	BuildPyramid();
+	return levels.size();
+}
+
+float OcclusionCuller::GetMinDepth(std::size_t level, unsigned int x, unsigned int y) {
+	BuildPyramid();
+	return levels[level].minDepth[std::size_t(y) * levels[level].width + x];
+}
+
+float OcclusionCuller::GetMaxDepth(std::size_t level, unsigned int x, unsigned int y) {
+	BuildPyramid();
+	return levels[level].maxDepth[std::size_t(y) * levels[level].width + x];
+}
+
+void OcclusionCuller::BuildPyramid() {
+	if(!pyramidDirty) {
+		return;
+	}
+	const auto begin = Timer::Ticks();
+	//flushes whatever is still queued in the rasterizer
+	const float* pDepth = rasterizer.GetDepthBuffer();
+	Level& base = levels[0];
+	std::copy(pDepth, pDepth + base.minDepth.size(), base.minDepth.begin());
+	//the farthest of each pixel and its 8 neighbors: a pixel whose center an occluder edge just covers is
+	//only trusted when the pixels around it are covered too, which keeps the edges conservative.
+	//Rows first into scratch, then columns.
+	const unsigned int w = base.width, h = base.height;
+	for(unsigned int y = 0u; y < h; y++) {
+		const float* pRow = pDepth + std::size_t(y) * w;
+		float* pOut = scratch.data() + std::size_t(y) * w;
+		for(unsigned int x = 0u; x < w; x++) {
+			pOut[x] = std::max(std::max(pRow[x ? x - 1u : x], pRow[x]), pRow[std::min(x + 1u, w - 1u)]);
+		}
+	}
+	for(unsigned int y = 0u; y < h; y++) {
+		const float* pAbove = scratch.data() + std::size_t(y ? y - 1u : y) * w;
+		const float* pRow = scratch.data() + std::size_t(y) * w;
+		const float* pBelow = scratch.data() + std::size_t(std::min(y + 1u, h - 1u)) * w;
+		float* pOut = base.maxDepth.data() + std::size_t(y) * w;
+		for(unsigned int x = 0u; x < w; x++) {
+			pOut[x] = std::max(std::max(pAbove[x], pRow[x]), pBelow[x]);
+		}
+	}
+	for(std::size_t l = 1u; l < levels.size(); l++) {
+		const Level& src = levels[l - 1u];
+		Level& dst = levels[l];
+		for(unsigned int y = 0u; y < dst.height; y++) {
+			//an odd sized level has no second child at its far edge
+			const unsigned int y0 = 2u * y;
+			const unsigned int y1 = std::min(y0 + 1u, src.height - 1u);
+			for(unsigned int x = 0u; x < dst.width; x++) {
+				const unsigned int x0 = 2u * x;
+				const unsigned int x1 = std::min(x0 + 1u, src.width - 1u);
+				const std::size_t a = std::size_t(y0) * src.width + x0, b = std::size_t(y0) * src.width + x1;
+				const std::size_t c = std::size_t(y1) * src.width + x0, d = std::size_t(y1) * src.width + x1;
+				const std::size_t i = std::size_t(y) * dst.width + x;
+				dst.minDepth[i] = std::min(std::min(src.minDepth[a], src.minDepth[b]), std::min(src.minDepth[c], src.minDepth[d]));
+				dst.maxDepth[i] = std::max(std::max(src.maxDepth[a], src.maxDepth[b]), std::max(src.maxDepth[c], src.maxDepth[d]));
+			}
+		}
+	}
+	pyramidDirty = false;
+	stats.pyramidMs += MsSince(begin);
+}
+
+bool OcclusionCuller::IsBoxOccluded(const rmath::Float3& center, const rmath::Float3& extent) const noexcept {
+	//screen rectangle and nearest depth of the 8 corners
+	const auto& m = viewProj.m;
+	const float inf = std::numeric_limits<float>::infinity();
+	float minX = inf, minY = inf, maxX = -inf, maxY = -inf, nearest = inf;
+	for(int corner = 0; corner < 8; corner++) {
+		const float px = center.x + ((corner & 1) ? extent.x : -extent.x);
+		const float py = center.y + ((corner & 2) ? extent.y : -extent.y);
+		const float pz = center.z + ((corner & 4) ? extent.z : -extent.z);
+		const float x = px * m[0][0] + py * m[1][0] + pz * m[2][0] + m[3][0];
+		const float y = px * m[0][1] + py * m[1][1] + pz * m[2][1] + m[3][1];
+		const float z = px * m[0][2] + py * m[1][2] + pz * m[2][2] + m[3][2];
+		const float w = px * m[0][3] + py * m[1][3] + pz * m[2][3] + m[3][3];
+		if(w <= 0.0f || z < 0.0f) {
+			//in front of the near plane, the projection says nothing useful
+			return false;
+		}
+		const float invW = 1.0f / w;
+		minX = std::min(minX, x * invW);
+		maxX = std::max(maxX, x * invW);
+		minY = std::min(minY, y * invW);
+		maxY = std::max(maxY, y * invW);
+		nearest = std::min(nearest, z * invW);
+	}
+	//pixels the rectangle touches, same viewport mapping as the rasterizer (y down)
+	const Level& base = levels[0];
+	const float left = (minX + 1.0f) * 0.5f * float(base.width);
+	const float right = (maxX + 1.0f) * 0.5f * float(base.width);
+	const float top = (1.0f - maxY) * 0.5f * float(base.height);
+	const float bottom = (1.0f - minY) * 0.5f * float(base.height);
+	if(right < 0.0f || bottom < 0.0f || left >= float(base.width) || top >= float(base.height)) {
+		//off screen is the frustum test's call
+		return false;
+	}
+	const unsigned int x0 = unsigned(std::max(0.0f, std::floor(left)));
+	const unsigned int y0 = unsigned(std::max(0.0f, std::floor(top)));
+	const unsigned int x1 = unsigned(std::min(float(base.width - 1u), std::floor(right)));
+	const unsigned int y1 = unsigned(std::min(float(base.height - 1u), std::floor(bottom)));
+	std::size_t level = 0u;
+	while((x1 >> level) - (x0 >> level) > 1u || (y1 >> level) - (y0 >> level) > 1u) {
+		level++;
+	}
+	for(;;) {
+		const Level& l = levels[level];
+		bool undecided = false;
+		for(unsigned int y = y0 >> level; y <= y1 >> level; y++) {
+			for(unsigned int x = x0 >> level; x <= x1 >> level; x++) {
+				const std::size_t i = std::size_t(y) * l.width + x;
+				if(l.maxDepth[i] < nearest) {
+					continue;
+				}
+				if(l.minDepth[i] >= nearest) {
+					//every finer texel under this one is at least as far, nothing there hides the object
+					return false;
+				}
+				undecided = true;
+			}
+		}
+		if(!undecided) {
+			return true;
+		}
+		if(level == 0u) {
+			return false;
+		}
+		level--;
+		const std::size_t texels = std::size_t((x1 >> level) - (x0 >> level) + 1u) * ((y1 >> level) - (y0 >> level) + 1u);
+		if(texels > maxTexelsPerTest) {
+			return false;
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "RasterMath.h"
+#include "FrustumCull.h"
+#include "SoftwareRasterizer.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+//CPU occlusion culling against a small depth buffer, run before draws are submitted:
+//	BeginFrame(viewProj) clears the buffer
+//	AddOccluder() rasterizes big, solid geometry (walls, terrain, the nearest objects) with
+//	SoftwareRasterizer's SIMD kernels, same depth convention as the GPU (D3D z / w, LESS)
+//	Cull() builds a min/max pyramid over it (the first call after occluders changed) and keeps every
+//	object whose bounds are not entirely behind the occluders
+//An object is tested on the level where its screen rectangle covers at most 2x2 texels. A texel whose farthest
+//occluder is nearer than the object's nearest point hides it there; a texel whose nearest occluder is behind it
+//proves the object cannot be hidden; anything in between is looked at again one level finer.
+//Bounds crossing the near plane are always kept. Occluders are sampled at pixel centers like on the GPU, the max
+//levels take the farthest depth of every pixel's 3x3 neighborhood, so pixels an occluder edge only partly covers hide nothing.
+//Does not depend on D3D or Windows.
+class OcclusionCuller {
+public:
+	struct Stats {
+		std::size_t occluders = 0u; //AddOccluder() calls
+		std::size_t occluderTriangles = 0u;
+		std::size_t tested = 0u;
+		std::size_t occluded = 0u;
+		double rasterizeMs = 0.0; //AddOccluder()
+		double pyramidMs = 0.0;
+		double testMs = 0.0;
+	};
+public:
+	OcclusionCuller(unsigned int width = 256u, unsigned int height = 192u);
+	//viewProj (row vectors, like FrustumCull) is what Cull() projects bounds with, also resets the stats
+	void BeginFrame(const rmath::Mat4& viewProj) noexcept;
+	//transform takes the occluder's positions to clip space and is passed transposed like SoftwareRasterizer wants it,
+	//the layout Graphics::CubeInstance::transform already has
+	void AddOccluder(const void* pVertices, std::size_t stride, std::size_t vertexCount,
+		const unsigned short* pIndices, std::size_t indexCount, const rmath::Mat4& transform);
+	void AddOccluder(const void* pVertices, std::size_t stride, std::size_t vertexCount,
+		const std::uint32_t* pIndices, std::size_t indexCount, const rmath::Mat4& transform);
+	//world space bounds, pVisible needs room for count indices, returns how many were kept, in ascending order
+	std::size_t Cull(const FrustumCull::Spheres& spheres, std::uint32_t* pVisible);
+	std::size_t Cull(const FrustumCull::Boxes& boxes, std::uint32_t* pVisible);
+	//one box, center and half size in world space
+	bool IsOccluded(const rmath::Float3& center, const rmath::Float3& extent);
+	//this frame so far
+	const Stats& GetStats() const noexcept;
+	unsigned int GetWidth() const noexcept;
+	unsigned int GetHeight() const noexcept;
+	//level 0 is the rasterized buffer, every further level halves it (rounded up)
+	std::size_t GetLevelCount();
+	float GetMinDepth(std::size_t level, unsigned int x, unsigned int y);
+	float GetMaxDepth(std::size_t level, unsigned int x, unsigned int y);
+private:
+	struct Level {
+		unsigned int width;
+		unsigned int height;
+		std::vector<float> minDepth;
+		std::vector<float> maxDepth;
+	};
+	void BuildPyramid();
+	bool IsBoxOccluded(const rmath::Float3& center, const rmath::Float3& extent) const noexcept;
+private:
+	//finer levels are only visited while the rectangle covers at most this many texels
+	static constexpr unsigned int maxTexelsPerTest = 64u;
+	SoftwareRasterizer rasterizer;
+	rmath::Mat4 viewProj;
+	std::vector<Level> levels;
+	std::vector<float> scratch; //one level 0 sized buffer for BuildPyramid()
+	bool pyramidDirty = true;
+	Stats stats;
+};
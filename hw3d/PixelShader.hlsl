@@ -4,5 +4,6 @@ cbuffer Cbuf {
 
 float4 main(uint tid : SV_PRIMITIVEID) : SV_TARGET
 {
-	return face_colors[tid/2];
+	//meshes with more than 12 triangles cycle through the colors
+	return face_colors[(tid/2)%6];
 }
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include "Profiler.h"
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace {
+	//single producer (the owning thread), single consumer (EndFrame() under the state lock)
+	struct ThreadRing {
+		Profiler::Event events[Profiler::ringSize];
+		std::atomic<std::uint64_t> head = 0u; //next slot the owner writes
+		std::uint64_t tail = 0u; //next slot the consumer reads
+		std::uint32_t thread = 0u;
+		std::atomic<const char*> name = nullptr;
+		std::atomic<bool> retired = false; //owner exited, free to hand out once drained
+	};
+	//last historySize durations of one scope, as a ring
+	struct ScopeHistory {
+		const char* name;
+		std::vector<std::int64_t> samples;
+		std::size_t next = 0u;
+		std::size_t count = 0u;
+	};
+	struct State {
+		std::mutex mtx;
+		std::vector<std::unique_ptr<ThreadRing>> rings; //never shrinks, a ring outlives its thread
+		std::unordered_map<const char*, std::size_t> scopeIndex;
+		std::vector<ScopeHistory> scopes;
+		std::vector<Profiler::Event> drained; //scratch, reused every frame
+		std::vector<std::int64_t> sorted; //scratch for GetStats()
+		std::vector<Profiler::Event> capture;
+		bool capturing = false;
+		std::atomic<std::size_t> dropped = 0u;
+		std::int64_t lastFrame = 0;
+		double nsPerTick = 1.0;
+		State() {
+#ifdef PROFILER_USE_TSC
+			//spin for a couple of milliseconds to relate the counter to the steady clock
+			const std::int64_t ns0 = Timer::Ticks();
+			const std::int64_t tick0 = Profiler::Now();
+			std::int64_t ns1;
+			do {
+				ns1 = Timer::Ticks();
+			} while(ns1 - ns0 < 2000000);
+			const std::int64_t tick1 = Profiler::Now();
+			if(tick1 > tick0) {
+				nsPerTick = double(ns1 - ns0) / double(tick1 - tick0);
+			}
+#endif
+		}
+	};
+	State& GetState() {
+		static State state;
+		return state;
+	}
+	//hot path pointer, trivially initialized so reading it is a plain TLS access
+	thread_local ThreadRing* pThreadRing = nullptr;
+	//retires the ring when its thread exits
+	struct RingOwner {
+		ThreadRing* pRing = nullptr;
+		~RingOwner() {
+			if(pRing) {
+				pRing->retired.store(true, std::memory_order_release);
+			}
+		}
+	};
+	thread_local RingOwner ringOwner;
+
+	ThreadRing* RegisterThread() {
+		auto& state = GetState();
+		std::lock_guard<std::mutex> lock(state.mtx);
+		ThreadRing* pRing = nullptr;
+		for(auto& pOld : state.rings) {
+			if(pOld->retired.load(std::memory_order_acquire) && pOld->tail == pOld->head.load(std::memory_order_relaxed)) {
+				pRing = pOld.get();
+				pRing->name.store(nullptr, std::memory_order_relaxed);
+				pRing->retired.store(false, std::memory_order_relaxed);
+				break;
+			}
+		}
+		if(!pRing) {
+			auto pNew = std::make_unique<ThreadRing>();
+			pNew->thread = static_cast<std::uint32_t>(state.rings.size());
+			pRing = pNew.get();
+			state.rings.push_back(std::move(pNew));
+		}
+		ringOwner.pRing = pRing;
+		pThreadRing = pRing;
+		return pRing;
+	}
+	//append everything the owner published since the last drain, the state lock must be held
+	void Drain(ThreadRing& ring, std::vector<Profiler::Event>& out, std::atomic<std::size_t>& dropped) {
+		const std::uint64_t head = ring.head.load(std::memory_order_acquire);
+		std::uint64_t tail = ring.tail;
+		if(head - tail > Profiler::ringSize) {
+			dropped += static_cast<std::size_t>(head - tail - Profiler::ringSize);
+			tail = head - Profiler::ringSize;
+		}
+		const std::size_t first = out.size();
+		for(std::uint64_t i = tail; i < head; i++) {
+			out.push_back(ring.events[i & (Profiler::ringSize - 1u)]);
+		}
+		//the owner keeps writing while we copy, anything it lapped in the meantime is torn and gets thrown away
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const std::uint64_t after = ring.head.load(std::memory_order_relaxed);
+		if(after - tail > Profiler::ringSize) {
+			const std::size_t torn = static_cast<std::size_t>(std::min<std::uint64_t>(after - tail - Profiler::ringSize, head - tail));
+			out.erase(out.begin() + first, out.begin() + first + torn);
+			dropped += torn;
+		}
+		ring.tail = head;
+	}
+	void WriteJsonString(std::ostream& os, const char* s) {
+		os << '"';
+		for(; *s; s++) {
+			if(*s == '"' || *s == '\\') {
+				os << '\\';
+			}
+			os << *s;
+		}
+		os << '"';
+	}
+}
+
+double Profiler::TicksToNs(std::int64_t ticks) noexcept {
+	return double(ticks) * GetState().nsPerTick;
+}
+
+void Profiler::Record(const char* name, std::int64_t begin, std::int64_t end) noexcept {
+	ThreadRing* pRing = pThreadRing;
+	if(!pRing) {
+		try {
+			pRing = RegisterThread();
+		}
+		catch(...) {
+			GetState().dropped++;
+			return;
+		}
+	}
+	const std::uint64_t head = pRing->head.load(std::memory_order_relaxed);
+	pRing->events[head & (ringSize - 1u)] = { name, begin, end, pRing->thread };
+	pRing->head.store(head + 1u, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name) noexcept {
+	ThreadRing* pRing = pThreadRing;
+	if(!pRing) {
+		try {
+			pRing = RegisterThread();
+		}
+		catch(...) {
+			return;
+		}
+	}
+	pRing->name.store(name, std::memory_order_relaxed);
+}
+
+void Profiler::EndFrame() {
+	auto& state = GetState();
+	//the frame scope goes through the ring like any other, before taking the lock a first Record() may need
+	const std::int64_t now = Now();
+	if(state.lastFrame != 0) {
+		Record("Frame", state.lastFrame, now);
+	}
+	state.lastFrame = now;
+
+	std::lock_guard<std::mutex> lock(state.mtx);
+	state.drained.clear();
+	for(auto& pRing : state.rings) {
+		Drain(*pRing, state.drained, state.dropped);
+	}
+	for(const auto& e : state.drained) {
+		auto it = state.scopeIndex.find(e.name);
+		if(it == state.scopeIndex.end()) {
+			it = state.scopeIndex.emplace(e.name, state.scopes.size()).first;
+			state.scopes.push_back({ e.name, std::vector<std::int64_t>(historySize) });
+		}
+		auto& scope = state.scopes[it->second];
+		scope.samples[scope.next] = static_cast<std::int64_t>(double(e.end - e.begin) * state.nsPerTick);
+		scope.next = (scope.next + 1u) % historySize;
+		scope.count = std::min(scope.count + 1u, historySize);
+	}
+	if(state.capturing) {
+		const std::size_t room = maxCaptureEvents - state.capture.size();
+		const std::size_t n = std::min(room, state.drained.size());
+		state.capture.insert(state.capture.end(), state.drained.begin(), state.drained.begin() + n);
+		state.dropped += state.drained.size() - n;
+	}
+}
+
+std::vector<Profiler::ScopeStats> Profiler::GetStats() {
+	std::vector<ScopeStats> stats;
+	GetStats(stats);
+	return stats;
+}
+
+void Profiler::GetStats(std::vector<ScopeStats>& stats) {
+	auto& state = GetState();
+	std::lock_guard<std::mutex> lock(state.mtx);
+	stats.clear();
+	stats.reserve(state.scopes.size());
+	//full size from the start, growing with the sample count would allocate for the first historySize frames
+	auto& sorted = state.sorted;
+	sorted.reserve(historySize);
+	for(const auto& scope : state.scopes) {
+		sorted.assign(scope.samples.begin(), scope.samples.begin() + scope.count);
+		std::int64_t total = 0;
+		for(const auto s : sorted) {
+			total += s;
+		}
+		//nearest rank percentile
+		const std::size_t rank = (sorted.size() * 99u + 99u) / 100u - 1u;
+		std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+		const std::int64_t p99 = sorted[rank];
+		const std::int64_t min = *std::min_element(sorted.begin(), sorted.begin() + rank + 1);
+		stats.push_back({ scope.name, scope.count, min / 1e6, (double)total / (double)scope.count / 1e6, p99 / 1e6 });
+	}
+}
+
+void Profiler::SetCapture(bool enable) {
+	auto& state = GetState();
+	std::lock_guard<std::mutex> lock(state.mtx);
+	if(enable && !state.capturing) {
+		state.capture.clear();
+	}
+	state.capturing = enable;
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) {
+	auto& state = GetState();
+	std::lock_guard<std::mutex> lock(state.mtx);
+	std::ofstream file(path, std::ios::binary);
+	if(!file) {
+		return false;
+	}
+	std::int64_t base = 0;
+	if(!state.capture.empty()) {
+		base = state.capture.front().begin;
+		for(const auto& e : state.capture) {
+			base = std::min(base, e.begin);
+		}
+	}
+	//complete events ("ph":"X"), timestamps and durations in microseconds
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	for(const auto& pRing : state.rings) {
+		if(const char* name = pRing->name.load(std::memory_order_relaxed)) {
+			file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << pRing->thread << ",\"args\":{\"name\":";
+			WriteJsonString(file, name);
+			file << "}}";
+			first = false;
+		}
+	}
+	file << std::fixed << std::setprecision(3);
+	for(const auto& e : state.capture) {
+		file << (first ? "" : ",\n") << "{\"name\":";
+		WriteJsonString(file, e.name);
+		file << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.thread
+			<< ",\"ts\":" << double(e.begin - base) * state.nsPerTick / 1000.0
+			<< ",\"dur\":" << double(e.end - e.begin) * state.nsPerTick / 1000.0 << "}";
+		first = false;
+	}
+	file << "\n]}\n";
+	return bool(file);
+}
+
+std::size_t Profiler::GetDroppedCount() noexcept {
+	return GetState().dropped.load();
+}
+
+double Profiler::MeasureScopeOverhead(std::size_t iterations) {
+	//same code path as a real scope, but into a private ring so nothing shows up in the stats
+	auto pScratch = std::make_unique<ThreadRing>();
+	ThreadRing* const pOld = pThreadRing;
+	pThreadRing = pScratch.get();
+	const std::int64_t begin = Now();
+	for(std::size_t i = 0u; i < iterations; i++) {
+		Scope scope("ProfilerOverhead");
+	}
+	const std::int64_t end = Now();
+	pThreadRing = pOld;
+	return iterations ? TicksToNs(end - begin) / double(iterations) : 0.0;
+}
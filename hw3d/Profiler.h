@@ -0,0 +1,91 @@
+#pragma once
+#include "Timer.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PROFILER_USE_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+//Scoped CPU profiler.
+//Scopes are stamped with the raw time stamp counter on x86 (a steady_clock read costs about as much as the whole
+//scope budget), the counter is calibrated against Timer::Ticks() once and converted to nanoseconds when drained.
+//Other targets use Timer::Ticks() directly.
+//A Scope writes one event into a ring owned by the calling thread when it ends. There are no locks and
+//no allocations on that path, only the first scope of a new thread registers its ring.
+//EndFrame() drains every ring on the frame thread and folds the events into per scope statistics
+//(min/avg/p99 over the last historySize samples). While capturing, drained events are also kept
+//for export as Chrome trace JSON (chrome://tracing or ui.perfetto.dev).
+//
+//Scope names must be string literals (or otherwise outlive the profiler), they are keyed by pointer.
+//Does not depend on D3D or Windows.
+class Profiler {
+public:
+	struct Event {
+		const char* name;
+		std::int64_t begin; //Profiler::Now(), use TicksToNs() for nanoseconds
+		std::int64_t end;
+		std::uint32_t thread; //ring index, 0 is the first thread that profiled anything (rings of exited threads are reused)
+	};
+	struct ScopeStats {
+		const char* name;
+		std::size_t count; //samples in the window
+		double minMs;
+		double avgMs;
+		double p99Ms;
+	};
+	class Scope {
+	public:
+		Scope(const char* name) noexcept
+			: name(name), begin(Now())
+		{}
+		~Scope() {
+			Record(name, begin, Now());
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		const char* name;
+		std::int64_t begin;
+	};
+public:
+	Profiler() = delete;
+	static std::int64_t Now() noexcept {
+#ifdef PROFILER_USE_TSC
+		return static_cast<std::int64_t>(__rdtsc());
+#else
+		return Timer::Ticks();
+#endif
+	}
+	static double TicksToNs(std::int64_t ticks) noexcept;
+	static void Record(const char* name, std::int64_t begin, std::int64_t end) noexcept;
+	//label the calling thread in exported traces
+	static void SetThreadName(const char* name) noexcept;
+	//drain every thread's ring and update the statistics, also records the "Frame" scope (time since the last call)
+	static void EndFrame();
+	//statistics of every scope seen so far, in first seen order
+	static std::vector<ScopeStats> GetStats();
+	//same into stats, reusing its storage so polling it every frame does not allocate once the scope list settled
+	static void GetStats(std::vector<ScopeStats>& stats);
+	//keep drained events for WriteChromeTrace(), at most maxCaptureEvents are kept
+	static void SetCapture(bool enable);
+	static bool WriteChromeTrace(const std::string& path);
+	//events lost because a ring was full before EndFrame() drained it, or the capture was full
+	static std::size_t GetDroppedCount() noexcept;
+	//average cost of one empty Scope in nanoseconds, measured on the calling thread
+	static double MeasureScopeOverhead(std::size_t iterations = 1000000u);
+public:
+	static constexpr std::size_t ringSize = 4096u; //per thread, power of two
+	static constexpr std::size_t historySize = 1024u; //samples per scope used for the statistics
+	static constexpr std::size_t maxCaptureEvents = 1u << 20;
+};
+
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILER_CONCAT(profilerScope, __LINE__)(name)
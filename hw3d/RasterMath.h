@@ -0,0 +1,95 @@
+#pragma once
+#include <cmath>
+
+//Minimal matrix/vector math for the portable (non-D3D) code paths.
+//Conventions follow DirectXMath: row vectors, v' = v * M, left handed projection,
+//so a Mat4 built here holds the same numbers as the equivalent XMMATRIX.
+namespace rmath {
+	struct Float3 {
+		float x, y, z;
+	};
+	struct Float4 {
+		float x, y, z, w;
+	};
+	struct Mat4 {
+		float m[4][4];
+	};
+
+	inline Mat4 Identity() noexcept {
+		return { {
+			{ 1.0f, 0.0f, 0.0f, 0.0f },
+			{ 0.0f, 1.0f, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f, 0.0f },
+			{ 0.0f, 0.0f, 0.0f, 1.0f },
+		} };
+	}
+	inline Mat4 Multiply(const Mat4& a, const Mat4& b) noexcept {
+		Mat4 r;
+		for(int i = 0; i < 4; i++) {
+			for(int j = 0; j < 4; j++) {
+				r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j] + a.m[i][3] * b.m[3][j];
+			}
+		}
+		return r;
+	}
+	inline Mat4 operator*(const Mat4& a, const Mat4& b) noexcept {
+		return Multiply(a, b);
+	}
+	inline Mat4 Transpose(const Mat4& a) noexcept {
+		Mat4 r;
+		for(int i = 0; i < 4; i++) {
+			for(int j = 0; j < 4; j++) {
+				r.m[i][j] = a.m[j][i];
+			}
+		}
+		return r;
+	}
+	//same layout as XMMatrixRotationX/Z
+	inline Mat4 RotationX(float angle) noexcept {
+		const float s = std::sin(angle);
+		const float c = std::cos(angle);
+		return { {
+			{ 1.0f, 0.0f, 0.0f, 0.0f },
+			{ 0.0f,    c,    s, 0.0f },
+			{ 0.0f,   -s,    c, 0.0f },
+			{ 0.0f, 0.0f, 0.0f, 1.0f },
+		} };
+	}
+	inline Mat4 RotationZ(float angle) noexcept {
+		const float s = std::sin(angle);
+		const float c = std::cos(angle);
+		return { {
+			{    c,    s, 0.0f, 0.0f },
+			{   -s,    c, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f, 0.0f },
+			{ 0.0f, 0.0f, 0.0f, 1.0f },
+		} };
+	}
+	inline Mat4 Translation(float x, float y, float z) noexcept {
+		return { {
+			{ 1.0f, 0.0f, 0.0f, 0.0f },
+			{ 0.0f, 1.0f, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f, 0.0f },
+			{    x,    y,    z, 1.0f },
+		} };
+	}
+	//same as XMMatrixPerspectiveLH(width, height, nearZ, farZ)
+	inline Mat4 PerspectiveLH(float width, float height, float nearZ, float farZ) noexcept {
+		const float range = farZ / (farZ - nearZ);
+		return { {
+			{ 2.0f * nearZ / width, 0.0f, 0.0f, 0.0f },
+			{ 0.0f, 2.0f * nearZ / height, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, range, 1.0f },
+			{ 0.0f, 0.0f, -range * nearZ, 0.0f },
+		} };
+	}
+	//v * M for a point (w = 1)
+	inline Float4 TransformPoint(const Float3& v, const Mat4& m) noexcept {
+		return {
+			v.x * m.m[0][0] + v.y * m.m[1][0] + v.z * m.m[2][0] + m.m[3][0],
+			v.x * m.m[0][1] + v.y * m.m[1][1] + v.z * m.m[2][1] + m.m[3][1],
+			v.x * m.m[0][2] + v.y * m.m[1][2] + v.z * m.m[2][2] + m.m[3][2],
+			v.x * m.m[0][3] + v.y * m.m[1][3] + v.z * m.m[2][3] + m.m[3][3],
+		};
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+
+//Keyed store for device objects (buffers, shaders, layouts...)
+//Each key is created once through the factory passed to Resolve() and handed out as a stable handle afterwards,
+//so draw code only pays for a vector index instead of a Create*() call.
+//Has no D3D dependency, T can be a ComPtr or any mock resource type.
+template<typename T>
+class ResourceCache {
+public:
+	using Handle = std::size_t;
+	static constexpr Handle InvalidHandle = static_cast<Handle>(-1);
+
+	ResourceCache() = default;
+	ResourceCache(const ResourceCache&) = delete;
+	ResourceCache& operator=(const ResourceCache&) = delete;
+
+	//return the handle for key, calling create() only if the key has never been seen
+	template<typename F>
+	Handle Resolve(const std::string& key, F&& create) {
+		if(const auto it = lookup.find(key); it != lookup.end()) {
+			reuseCount++;
+			return it->second;
+		}
+		//create before inserting so a throwing factory leaves the cache untouched
+		T resource = create();
+		resources.push_back(std::move(resource));
+		const Handle handle = resources.size() - 1;
+		lookup.emplace(key, handle);
+		createCount++;
+		return handle;
+	}
+	Handle Find(const std::string& key) const noexcept {
+		const auto it = lookup.find(key);
+		return it == lookup.end() ? InvalidHandle : it->second;
+	}
+	const T& Get(Handle handle) const noexcept {
+		return resources[handle];
+	}
+	T& Get(Handle handle) noexcept {
+		return resources[handle];
+	}
+	std::size_t Size() const noexcept {
+		return resources.size();
+	}
+	//number of times a factory actually ran
+	std::size_t GetCreateCount() const noexcept {
+		return createCount;
+	}
+	//number of Resolve() calls served from the cache
+	std::size_t GetReuseCount() const noexcept {
+		return reuseCount;
+	}
+	//drop everything (e.g. after device removal), handles become invalid and the counters start over
+	void Clear() noexcept {
+		resources.clear();
+		lookup.clear();
+		createCount = 0u;
+		reuseCount = 0u;
+	}
+private:
+	std::vector<T> resources;
+	std::unordered_map<std::string, Handle> lookup;
+	std::size_t createCount = 0u;
+	std::size_t reuseCount = 0u;
+};
@@ -0,0 +1,210 @@
+#include "ShaderStore.h"
+#include <sstream>
+#include <fstream>
+#include <cstring>
+
+ShaderStore::Exception::Exception(int line, const char* file, std::string note) noexcept
+	: UrielException(line, file), note(std::move(note))
+{
+}
+
+const char* ShaderStore::Exception::what() const noexcept {
+	std::ostringstream oss;
+	oss << GetType() << std::endl
+		<< "[Note] " << GetNote() << std::endl
+		<< GetOriginalString();
+	whatBuffer = oss.str();
+	return whatBuffer.c_str();
+}
+
+const char* ShaderStore::Exception::GetType() const noexcept {
+	return "Uriel Shader Store Exception";
+}
+
+const std::string& ShaderStore::Exception::GetNote() const noexcept {
+	return note;
+}
+
+void ShaderStore::Load(const std::string& name, const std::string& path) {
+	std::size_t size = 0u;
+	auto pBlock = ReadFile(path, size);
+	const auto hash = Hash(pBlock.get(), size);
+	//same bytecode already stored under another name, share it and drop the new block
+	if(const Entry* pShared = FindShared(pBlock.get(), size, hash)) {
+		entries[name] = *pShared;
+		return;
+	}
+	blocks.push_back(std::move(pBlock));
+	Insert(name, blocks.back().get(), size, hash);
+}
+
+void ShaderStore::Add(const std::string& name, const void* pData, std::size_t size) {
+	const auto hash = Hash(pData, size);
+	if(const Entry* pShared = FindShared(static_cast<const char*>(pData), size, hash)) {
+		entries[name] = *pShared;
+		return;
+	}
+	auto pBlock = std::make_unique<char[]>(size);
+	std::memcpy(pBlock.get(), pData, size);
+	blocks.push_back(std::move(pBlock));
+	Insert(name, blocks.back().get(), size, hash);
+}
+
+void ShaderStore::LoadArchive(const std::string& path) {
+	std::size_t fileSize = 0u;
+	auto pBlock = ReadFile(path, fileSize);
+	const char* pFile = pBlock.get();
+
+	ArchiveHeader header;
+	if(fileSize < sizeof(header)) {
+		throw Exception(__LINE__, __FILE__, "Shader archive too small: " + path);
+	}
+	std::memcpy(&header, pFile, sizeof(header));
+	if(std::memcmp(header.magic, archiveMagic, sizeof(archiveMagic)) != 0 || header.version != archiveVersion) {
+		throw Exception(__LINE__, __FILE__, "Not a shader archive or wrong version: " + path);
+	}
+	const std::size_t tableEnd = sizeof(header) + std::size_t(header.count) * sizeof(ArchiveEntry);
+	const std::size_t namesEnd = tableEnd + header.namesSize;
+	if(namesEnd > fileSize) {
+		throw Exception(__LINE__, __FILE__, "Shader archive table is truncated: " + path);
+	}
+	const char* pNames = pFile + tableEnd;
+
+	//validate every entry before touching the store so a bad archive leaves it unchanged
+	std::vector<ArchiveEntry> table(header.count);
+	for(std::uint32_t i = 0u; i < header.count; i++) {
+		auto& e = table[i];
+		std::memcpy(&e, pFile + sizeof(header) + i * sizeof(ArchiveEntry), sizeof(e));
+		if(std::size_t(e.nameOffset) + e.nameLength > header.namesSize
+			|| e.offset > fileSize || e.size > fileSize - e.offset) {
+			throw Exception(__LINE__, __FILE__, "Shader archive entry out of bounds: " + path);
+		}
+		if(Hash(pFile + e.offset, std::size_t(e.size)) != e.hash) {
+			throw Exception(__LINE__, __FILE__, "Shader archive entry is corrupt: " + path);
+		}
+		//throws when the store already holds other bytecode under this hash
+		FindShared(pFile + e.offset, std::size_t(e.size), e.hash);
+	}
+	blocks.push_back(std::move(pBlock));
+	for(const auto& e : table) {
+		Insert(std::string(pNames + e.nameOffset, e.nameLength), pFile + e.offset, std::size_t(e.size), e.hash);
+	}
+}
+
+void ShaderStore::SaveArchive(const std::string& path) const {
+	//names block
+	std::string names;
+	std::vector<ArchiveEntry> table;
+	table.reserve(entries.size());
+	for(const auto& [name, entry] : entries) {
+		ArchiveEntry e = {};
+		e.hash = entry.hash;
+		e.size = entry.size;
+		e.nameOffset = (std::uint32_t)names.size();
+		e.nameLength = (std::uint32_t)name.size();
+		names += name;
+		table.push_back(e);
+	}
+	const auto align = [](std::size_t v) { return (v + 15u) & ~std::size_t(15u); };
+
+	//lay out blobs after the names, shared bytecode is written once
+	std::unordered_map<std::uint64_t, std::uint64_t> blobOffsets;
+	std::vector<const Entry*> blobs;
+	std::size_t cursor = align(sizeof(ArchiveHeader) + table.size() * sizeof(ArchiveEntry) + names.size());
+	for(auto& e : table) {
+		const auto& entry = byHash.at(e.hash);
+		if(const auto it = blobOffsets.find(e.hash); it != blobOffsets.end()) {
+			e.offset = it->second;
+			continue;
+		}
+		e.offset = cursor;
+		blobOffsets.emplace(e.hash, cursor);
+		blobs.push_back(&entry);
+		cursor = align(cursor + entry.size);
+	}
+
+	std::vector<char> file(cursor, 0);
+	ArchiveHeader header = {};
+	std::memcpy(header.magic, archiveMagic, sizeof(archiveMagic));
+	header.version = archiveVersion;
+	header.count = (std::uint32_t)table.size();
+	header.namesSize = (std::uint32_t)names.size();
+	std::memcpy(file.data(), &header, sizeof(header));
+	std::memcpy(file.data() + sizeof(header), table.data(), table.size() * sizeof(ArchiveEntry));
+	std::memcpy(file.data() + sizeof(header) + table.size() * sizeof(ArchiveEntry), names.data(), names.size());
+	for(const auto* pBlob : blobs) {
+		std::memcpy(file.data() + blobOffsets.at(pBlob->hash), pBlob->pData, pBlob->size);
+	}
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if(!out.write(file.data(), (std::streamsize)file.size())) {
+		throw Exception(__LINE__, __FILE__, "Failed to write shader archive: " + path);
+	}
+}
+
+bool ShaderStore::Contains(const std::string& name) const noexcept {
+	return entries.find(name) != entries.end();
+}
+
+ShaderStore::Bytecode ShaderStore::Get(const std::string& name) const {
+	const auto it = entries.find(name);
+	if(it == entries.end()) {
+		throw Exception(__LINE__, __FILE__, "Shader not in store: " + name);
+	}
+	return { it->second.pData, it->second.size, it->second.hash };
+}
+
+std::size_t ShaderStore::Size() const noexcept {
+	return entries.size();
+}
+
+std::size_t ShaderStore::GetFileReadCount() const noexcept {
+	return fileReads;
+}
+
+std::uint64_t ShaderStore::Hash(const void* pData, std::size_t size) noexcept {
+	//64-bit FNV-1a, good enough to key a handful of shaders
+	const auto* p = static_cast<const unsigned char*>(pData);
+	std::uint64_t hash = 14695981039346656037ull;
+	for(std::size_t i = 0u; i < size; i++) {
+		hash ^= p[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::unique_ptr<char[]> ShaderStore::ReadFile(const std::string& path, std::size_t& size) {
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	if(!in) {
+		throw Exception(__LINE__, __FILE__, "Failed to open shader file: " + path);
+	}
+	size = (std::size_t)in.tellg();
+	in.seekg(0, std::ios::beg);
+	auto pBlock = std::make_unique<char[]>(size);
+	if(!in.read(pBlock.get(), (std::streamsize)size)) {
+		throw Exception(__LINE__, __FILE__, "Failed to read shader file: " + path);
+	}
+	fileReads++;
+	return pBlock;
+}
+
+const ShaderStore::Entry* ShaderStore::FindShared(const char* pData, std::size_t size, std::uint64_t hash) const {
+	const auto it = byHash.find(hash);
+	if(it == byHash.end()) {
+		return nullptr;
+	}
+	//the archive keys blobs by hash alone, two different blobs under one hash cannot be stored
+	if(it->second.size != size || std::memcmp(it->second.pData, pData, size) != 0) {
+		std::ostringstream oss;
+		oss << "Different shader bytecode with the same hash 0x" << std::hex << hash;
+		throw Exception(__LINE__, __FILE__, oss.str());
+	}
+	return &it->second;
+}
+
+void ShaderStore::Insert(const std::string& name, const char* pData, std::size_t size, std::uint64_t hash) {
+	//callers went through FindShared() first, an existing hash here always has the same contents
+	const Entry entry = { pData, size, hash };
+	entries[name] = entry;
+	byHash.emplace(hash, entry);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "UrielException.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+//Holds compiled shader bytecode (.cso) in memory so it is read from disk once at startup.
+//Entries are keyed by name and by content hash, identical bytecode is only stored once.
+//Get() hands out views into the store, no copies are made when creating shaders/layouts.
+//
+//Archive mode packs every entry into one file so a cold start costs a single read:
+//	[Header][Entry table (count * ArchiveEntry)][names][padding][bytecode blobs (16 byte aligned)]
+//All values are little endian.
+class ShaderStore {
+public:
+	class Exception : public UrielException {
+	public:
+		Exception(int line, const char* file, std::string note) noexcept;
+		const char* what() const noexcept override;
+		const char* GetType() const noexcept override;
+		const std::string& GetNote() const noexcept;
+	private:
+		std::string note;
+	};
+	//view of bytecode owned by the store, valid for as long as the store lives
+	struct Bytecode {
+		const void* pData;
+		std::size_t size;
+		std::uint64_t hash;
+	};
+public:
+	ShaderStore() = default;
+	ShaderStore(const ShaderStore&) = delete;
+	ShaderStore& operator=(const ShaderStore&) = delete;
+	//read one .cso file and store it under name
+	void Load(const std::string& name, const std::string& path);
+	//store bytecode that is already in memory (copied once into the store)
+	void Add(const std::string& name, const void* pData, std::size_t size);
+	//read a packed archive with a single file read
+	void LoadArchive(const std::string& path);
+	//pack every entry of the store into an archive file
+	void SaveArchive(const std::string& path) const;
+	bool Contains(const std::string& name) const noexcept;
+	Bytecode Get(const std::string& name) const;
+	std::size_t Size() const noexcept;
+	//number of files read from disk so far
+	std::size_t GetFileReadCount() const noexcept;
+	static std::uint64_t Hash(const void* pData, std::size_t size) noexcept;
+private:
+	struct Entry {
+		const char* pData;
+		std::size_t size;
+		std::uint64_t hash;
+	};
+	std::unique_ptr<char[]> ReadFile(const std::string& path, std::size_t& size);
+	//entry already holding this bytecode, nullptr if the hash is new; throws if the hash is taken by other bytecode
+	const Entry* FindShared(const char* pData, std::size_t size, std::uint64_t hash) const;
+	void Insert(const std::string& name, const char* pData, std::size_t size, std::uint64_t hash);
+private:
+	static constexpr char archiveMagic[4] = { 'U', 'S', 'H', 'A' };
+	static constexpr std::uint32_t archiveVersion = 1u;
+	struct ArchiveHeader {
+		char magic[4];
+		std::uint32_t version;
+		std::uint32_t count;
+		std::uint32_t namesSize;
+	};
+	struct ArchiveEntry {
+		std::uint64_t hash;
+		std::uint64_t offset; //from the start of the file
+		std::uint64_t size;
+		std::uint32_t nameOffset; //into the names block
+		std::uint32_t nameLength;
+	};
+	//storage blocks, each file/archive read lives in one block that never moves
+	std::vector<std::unique_ptr<char[]>> blocks;
+	std::unordered_map<std::string, Entry> entries;
+	std::unordered_map<std::uint64_t, Entry> byHash;
+	std::size_t fileReads = 0u;
+};
@@ -0,0 +1,99 @@
+#include "ShadowState.h"
+#include <cstring>
+
+template<typename T>
+bool ShadowState::Update(T& bound, bool& valid, const T& value) noexcept {
+	//bytewise so structs compare without operator==, every member is a pointer/uint/float without padding
+	if(valid && std::memcmp(&bound, &value, sizeof(T)) == 0) {
+		frame.elided++;
+		return false;
+	}
+	bound = value;
+	valid = true;
+	frame.issued++;
+	return true;
+}
+
+bool ShadowState::UpdateSlot(Binding* pBindings, bool* pValid, unsigned int slotCount, unsigned int slot, const Binding& value) noexcept {
+	//slots past what is shadowed are never filtered
+	if(slot >= slotCount) {
+		frame.issued++;
+		return true;
+	}
+	return Update(pBindings[slot], pValid[slot], value);
+}
+
+bool ShadowState::SetInputLayout(const void* pLayout) noexcept {
+	return Update(pInputLayout, inputLayoutValid, pLayout);
+}
+
+bool ShadowState::SetTopology(unsigned int value) noexcept {
+	return Update(topology, topologyValid, value);
+}
+
+bool ShadowState::SetVertexBuffer(unsigned int slot, const void* pBuffer, unsigned int stride, unsigned int offset) noexcept {
+	return UpdateSlot(vertexBuffers, vertexBuffersValid, vertexBufferSlots, slot, { pBuffer, stride, offset });
+}
+
+bool ShadowState::SetIndexBuffer(const void* pBuffer, unsigned int format, unsigned int offset) noexcept {
+	return Update(indexBuffer, indexBufferValid, Binding{ pBuffer, format, offset });
+}
+
+bool ShadowState::SetVertexShader(const void* pShader) noexcept {
+	return Update(pVertexShader, vertexShaderValid, pShader);
+}
+
+bool ShadowState::SetPixelShader(const void* pShader) noexcept {
+	return Update(pPixelShader, pixelShaderValid, pShader);
+}
+
+bool ShadowState::SetVSConstantBuffer(unsigned int slot, const void* pBuffer, unsigned int firstConstant, unsigned int numConstants) noexcept {
+	return UpdateSlot(vsConstants, vsConstantsValid, constantBufferSlots, slot, { pBuffer, firstConstant, numConstants });
+}
+
+bool ShadowState::SetPSConstantBuffer(unsigned int slot, const void* pBuffer, unsigned int firstConstant, unsigned int numConstants) noexcept {
+	return UpdateSlot(psConstants, psConstantsValid, constantBufferSlots, slot, { pBuffer, firstConstant, numConstants });
+}
+
+bool ShadowState::SetViewport(const Viewport& value) noexcept {
+	return Update(viewport, viewportValid, value);
+}
+
+bool ShadowState::SetRenderTarget(const void* pTarget, const void* pDepthStencil) noexcept {
+	return Update(targets, targetsValid, Targets{ pTarget, pDepthStencil });
+}
+
+bool ShadowState::SetDepthStencilState(const void* pState, unsigned int stencilRef) noexcept {
+	return Update(depthStencilState, depthStencilStateValid, Binding{ pState, stencilRef, 0u });
+}
+
+void ShadowState::Invalidate() noexcept {
+	inputLayoutValid = false;
+	topologyValid = false;
+	for(auto& v : vertexBuffersValid) {
+		v = false;
+	}
+	indexBufferValid = false;
+	vertexShaderValid = false;
+	pixelShaderValid = false;
+	for(unsigned int i = 0u; i < constantBufferSlots; i++) {
+		vsConstantsValid[i] = false;
+		psConstantsValid[i] = false;
+	}
+	viewportValid = false;
+	targetsValid = false;
+	depthStencilStateValid = false;
+}
+
+void ShadowState::NextFrame() noexcept {
+	lastFrame = frame;
+	frame = {};
+}
+
+const ShadowState::Stats& ShadowState::GetFrameStats() const noexcept {
+	return frame;
+}
+
+const ShadowState::Stats& ShadowState::GetLastFrameStats() const noexcept {
+	return lastFrame;
+}
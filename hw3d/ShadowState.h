@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+//Shadow copy of what is bound on the device context, used to drop redundant state calls.
+//Every Set*() returns true when the call has to reach the context (and remembers the new value),
+//false when the same thing is already bound. Objects are compared by pointer, the context holds a
+//reference to everything bound so a live binding's address cannot be reused by another object.
+//Counts issued and elided calls per frame.
+//Does not depend on D3D or Windows, resources are opaque pointers.
+class ShadowState {
+public:
+	struct Stats {
+		std::size_t issued = 0u;
+		std::size_t elided = 0u;
+	};
+	struct Viewport {
+		float x, y, width, height, minDepth, maxDepth;
+	};
+	static constexpr unsigned int vertexBufferSlots = 16u;
+	static constexpr unsigned int constantBufferSlots = 14u; //D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT
+public:
+	//IA
+	bool SetInputLayout(const void* pLayout) noexcept;
+	bool SetTopology(unsigned int topology) noexcept;
+	bool SetVertexBuffer(unsigned int slot, const void* pBuffer, unsigned int stride, unsigned int offset) noexcept;
+	bool SetIndexBuffer(const void* pBuffer, unsigned int format, unsigned int offset) noexcept;
+	//VS / PS, firstConstant/numConstants are the 11.1 offsets (0, 0 for whole buffer binds)
+	bool SetVertexShader(const void* pShader) noexcept;
+	bool SetPixelShader(const void* pShader) noexcept;
+	bool SetVSConstantBuffer(unsigned int slot, const void* pBuffer, unsigned int firstConstant = 0u, unsigned int numConstants = 0u) noexcept;
+	bool SetPSConstantBuffer(unsigned int slot, const void* pBuffer, unsigned int firstConstant = 0u, unsigned int numConstants = 0u) noexcept;
+	//RS
+	bool SetViewport(const Viewport& viewport) noexcept;
+	//OM
+	bool SetRenderTarget(const void* pTarget, const void* pDepthStencil) noexcept;
+	bool SetDepthStencilState(const void* pState, unsigned int stencilRef) noexcept;
+	//forget everything, the next call of every kind is issued (after ClearState or anything bound behind our back)
+	void Invalidate() noexcept;
+	//start counting a new frame, GetLastFrameStats() then reports the finished one
+	void NextFrame() noexcept;
+	const Stats& GetFrameStats() const noexcept;
+	const Stats& GetLastFrameStats() const noexcept;
+private:
+	//an object plus up to two parameters of its bind call (stride/offset, format/offset, first/num constants, stencil ref)
+	struct Binding {
+		const void* pObject;
+		unsigned int a;
+		unsigned int b;
+	};
+	struct Targets {
+		const void* pTarget;
+		const void* pDepthStencil;
+	};
+	//counts the call and stores value if it differs, returns whether it has to be issued
+	template<typename T>
+	bool Update(T& bound, bool& valid, const T& value) noexcept;
+	bool UpdateSlot(Binding* pBindings, bool* pValid, unsigned int slotCount, unsigned int slot, const Binding& value) noexcept;
+private:
+	Stats frame;
+	Stats lastFrame;
+	const void* pInputLayout = nullptr;
+	bool inputLayoutValid = false;
+	unsigned int topology = 0u;
+	bool topologyValid = false;
+	Binding vertexBuffers[vertexBufferSlots] = {};
+	bool vertexBuffersValid[vertexBufferSlots] = {};
+	Binding indexBuffer = {};
+	bool indexBufferValid = false;
+	const void* pVertexShader = nullptr;
+	bool vertexShaderValid = false;
+	const void* pPixelShader = nullptr;
+	bool pixelShaderValid = false;
+	Binding vsConstants[constantBufferSlots] = {};
+	bool vsConstantsValid[constantBufferSlots] = {};
+	Binding psConstants[constantBufferSlots] = {};
+	bool psConstantsValid[constantBufferSlots] = {};
+	Viewport viewport = {};
+	bool viewportValid = false;
+	Targets targets = {};
+	bool targetsValid = false;
+	Binding depthStencilState = {};
+	bool depthStencilStateValid = false;
+};
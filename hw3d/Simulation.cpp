@@ -0,0 +1,112 @@
+#include "Simulation.h"
+#include "Timer.h"
+#include "Profiler.h"
+#include <algorithm>
+
+Simulation::Simulation(const Position* pPositions, std::size_t count, float tickRate)
+	: tickNs(static_cast<std::int64_t>(1e9 / tickRate))
+{
+	for(std::size_t i = 0u; i < count; i++) {
+		current.x.push_back(pPositions[i].x);
+		current.y.push_back(pPositions[i].y);
+		current.z.push_back(pPositions[i].z);
+	}
+	current.angle.resize(count);
+	previous = current;
+	//the render thread always finds a snapshot, even before the first tick
+	PublishSnapshot(Timer::Ticks());
+	thread = std::thread(&Simulation::Run, this);
+}
+
+Simulation::~Simulation() {
+	stopping.store(true, std::memory_order_relaxed);
+	thread.join();
+}
+
+const Simulation::Snapshot& Simulation::Acquire() noexcept {
+	return snapshots.Acquire();
+}
+
+void Simulation::Interpolate(const Snapshot& snapshot, std::int64_t now, SceneState& out) const {
+	//current belongs to tickTime, previous to one tick earlier; rendering lags one tick behind so
+	//there is always a state on either side and alpha stays in [0, 1] as long as ticks keep coming
+	const float alpha = std::clamp(float(now - snapshot.tickTime) / float(tickNs), 0.0f, 1.0f);
+	const SceneState& a = snapshot.previous;
+	const SceneState& b = snapshot.current;
+	const std::size_t count = b.angle.size();
+	out.angle.resize(count);
+	out.x.resize(count);
+	out.y.resize(count);
+	out.z.resize(count);
+	out.time = a.time + (b.time - a.time) * alpha;
+	for(std::size_t i = 0u; i < count; i++) {
+		out.angle[i] = a.angle[i] + (b.angle[i] - a.angle[i]) * alpha;
+		out.x[i] = a.x[i] + (b.x[i] - a.x[i]) * alpha;
+		out.y[i] = a.y[i] + (b.y[i] - a.y[i]) * alpha;
+		out.z[i] = a.z[i] + (b.z[i] - a.z[i]) * alpha;
+	}
+}
+
+float Simulation::GetTickSeconds() const noexcept {
+	return float(tickNs) / 1e9f;
+}
+
+std::uint64_t Simulation::GetTickCount() const noexcept {
+	return ticks.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Simulation::GetDroppedTicks() const noexcept {
+	return droppedTicks.load(std::memory_order_relaxed);
+}
+
+void Simulation::Run() {
+	Profiler::SetThreadName("Simulation");
+	std::int64_t nextTick = Timer::Ticks() + tickNs;
+	while(!stopping.load(std::memory_order_relaxed)) {
+		const std::int64_t now = Timer::Ticks();
+		if(now < nextTick) {
+			std::this_thread::sleep_for(std::chrono::nanoseconds(nextTick - now));
+			continue;
+		}
+		//catch up on missed ticks, but never spiral: past maxCatchUp the simulation just slows down
+		unsigned int steps = 0u;
+		while(nextTick <= now && steps < maxCatchUp) {
+			PROFILE_SCOPE("SimulationTick");
+			Step();
+			nextTick += tickNs;
+			steps++;
+		}
+		if(nextTick <= now) {
+			const std::int64_t behind = (now - nextTick) / tickNs + 1;
+			droppedTicks.fetch_add(static_cast<std::uint64_t>(behind), std::memory_order_relaxed);
+			nextTick += behind * tickNs;
+		}
+		PublishSnapshot(nextTick - tickNs);
+	}
+}
+
+void Simulation::Step() noexcept {
+	std::swap(previous, current);
+	//current still holds the state from two ticks ago, overwrite it from previous
+	const float dt = GetTickSeconds();
+	const std::size_t count = previous.angle.size();
+	current.time = previous.time + dt;
+	for(std::size_t i = 0u; i < count; i++) {
+		//same animation the cubes always had, angle = elapsed seconds
+		current.angle[i] = previous.angle[i] + dt;
+		current.x[i] = previous.x[i];
+		current.y[i] = previous.y[i];
+		current.z[i] = previous.z[i];
+	}
+	ticks.fetch_add(1u, std::memory_order_relaxed);
+}
+
+void Simulation::PublishSnapshot(std::int64_t tickTime) {
+	auto& snapshot = snapshots.Back();
+	//vectors keep their capacity across reuse, after the first few ticks this does not allocate
+	snapshot.previous = previous;
+	snapshot.current = current;
+	snapshot.tick = ticks.load(std::memory_order_relaxed);
+	snapshot.tickTime = tickTime;
+	snapshots.Publish();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "SnapshotExchange.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+//Fixed timestep scene update running on its own thread, independent of how fast frames are presented.
+//Every tick publishes an immutable snapshot holding the previous and the current tick's state,
+//so the render thread can interpolate to any point in between without touching the simulation.
+//Does not depend on D3D or Windows.
+class Simulation {
+public:
+	//per cube state, structure of arrays like the transform batch wants it
+	struct SceneState {
+		float time = 0.0f; //simulated seconds
+		std::vector<float> angle;
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> z;
+	};
+	struct Snapshot {
+		SceneState previous;
+		SceneState current;
+		std::uint64_t tick = 0u;
+		std::int64_t tickTime = 0; //Timer::Ticks() the current state belongs to
+	};
+	struct Position {
+		float x, y, z;
+	};
+public:
+	Simulation(const Position* pPositions, std::size_t count, float tickRate = 120.0f);
+	Simulation(const Simulation&) = delete;
+	Simulation& operator=(const Simulation&) = delete;
+	~Simulation();
+	//newest snapshot, stays valid and unchanged until the next Acquire() (render thread only)
+	const Snapshot& Acquire() noexcept;
+	//interpolated state at Timer::Ticks() time now, written into out
+	//out is only resized the first time (keep it around between frames), that is the one call that can throw
+	void Interpolate(const Snapshot& snapshot, std::int64_t now, SceneState& out) const;
+	float GetTickSeconds() const noexcept;
+	std::uint64_t GetTickCount() const noexcept;
+	//ticks skipped because the thread fell more than maxCatchUp ticks behind
+	std::uint64_t GetDroppedTicks() const noexcept;
+private:
+	void Run();
+	void Step() noexcept;
+	void PublishSnapshot(std::int64_t tickTime);
+private:
+	static constexpr unsigned int maxCatchUp = 8u;
+	const std::int64_t tickNs;
+	SceneState previous; //owned by the simulation thread
+	SceneState current;
+	SnapshotExchange<Snapshot> snapshots;
+	std::atomic<std::uint64_t> ticks = 0u;
+	std::atomic<std::uint64_t> droppedTicks = 0u;
+	std::atomic<bool> stopping = false;
+	std::thread thread;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+
+//Lock-free hand off of whole snapshots from one producer thread to one consumer thread (triple buffer).
+//The producer fills Back() and calls Publish(), the consumer calls Acquire() and reads the returned snapshot
+//until its next Acquire(). Neither side ever waits: the producer always has a slot of its own to write,
+//the consumer always keeps the newest published one, older unread snapshots are simply replaced.
+//Slots are reused, after Publish() Back() holds an old snapshot that has to be fully rewritten.
+template<typename T>
+class SnapshotExchange {
+public:
+	SnapshotExchange() = default;
+	SnapshotExchange(const SnapshotExchange&) = delete;
+	SnapshotExchange& operator=(const SnapshotExchange&) = delete;
+	//producer side
+	T& Back() noexcept {
+		return slots[back];
+	}
+	void Publish() noexcept {
+		//hand the finished slot over and take whatever the consumer is not holding
+		back = middle.exchange(back | freshBit, std::memory_order_acq_rel) & indexMask;
+	}
+	//consumer side, returns the newest published snapshot (or the last one again if nothing new arrived)
+	const T& Acquire() noexcept {
+		if(middle.load(std::memory_order_relaxed) & freshBit) {
+			front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+		}
+		return slots[front];
+	}
+	//true if Acquire() would return a snapshot the consumer has not seen yet
+	bool HasFresh() const noexcept {
+		return (middle.load(std::memory_order_relaxed) & freshBit) != 0u;
+	}
+private:
+	static constexpr unsigned int indexMask = 3u;
+	static constexpr unsigned int freshBit = 4u;
+	T slots[3] = {};
+	//slot owned by each side, the third one sits in middle waiting to be swapped
+	unsigned int back = 0u;
+	alignas(64) unsigned int front = 1u;
+	alignas(64) std::atomic<unsigned int> middle = 2u;
+};
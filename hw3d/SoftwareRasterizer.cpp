@@ -0,0 +1,618 @@
+#include "SoftwareRasterizer.h"
+#include "VertexQuantization.h"
+#include "CpuFeatures.h"
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+SoftwareRasterizer::Exception::Exception(int line, const char* file, std::string note) noexcept
+	: UrielException(line, file), note(std::move(note))
+{
+}
+
+const char* SoftwareRasterizer::Exception::what() const noexcept {
+	std::ostringstream oss;
+	oss << GetType() << std::endl
+		<< "[Note] " << GetNote() << std::endl
+		<< GetOriginalString();
+	whatBuffer = oss.str();
+	return whatBuffer.c_str();
+}
+
+const char* SoftwareRasterizer::Exception::GetType() const noexcept {
+	return "Uriel Software Rasterizer Exception";
+}
+
+const std::string& SoftwareRasterizer::Exception::GetNote() const noexcept {
+	return note;
+}
+
+SoftwareRasterizer::SoftwareRasterizer(unsigned int width, unsigned int height)
+	: width(width), height(height), color(std::size_t(width) * height), depth(std::size_t(width) * height)
+{
+	if(width == 0u || height == 0u || width > 16384u || height > 16384u) {
+		throw Exception(__LINE__, __FILE__, "Render target size must be between 1 and 16384");
+	}
+	kernel = GetBestKernel();
+	tilesX = (int(width) + tileSize - 1) / tileSize;
+	tilesY = (int(height) + tileSize - 1) / tileSize;
+	ClearBuffer(0.0f, 0.0f, 0.0f);
+}
+
+SoftwareRasterizer::~SoftwareRasterizer() {
+	StopWorkers();
+}
+
+void SoftwareRasterizer::SetThreadCount(unsigned int count) {
+	Flush();
+	StopWorkers();
+	threadCount = std::max(1u, count);
+	if(threadCount == 1u) {
+		return;
+	}
+	bins.resize(std::size_t(tilesX) * tilesY);
+	tileRanges = std::make_unique<std::atomic<std::uint64_t>[]>(threadCount);
+	tileColor.assign(threadCount, std::vector<std::uint32_t>(tileSize * tileSize));
+	tileDepth.assign(threadCount, std::vector<float>(tileSize * tileSize));
+	workerPixels.assign(threadCount, 0u);
+	stopping = false;
+	//worker 0 is whichever thread calls Flush()
+	for(unsigned int i = 1u; i < threadCount; i++) {
+		workers.emplace_back(&SoftwareRasterizer::WorkerLoop, this, i, generation);
+	}
+}
+
+unsigned int SoftwareRasterizer::GetThreadCount() const noexcept {
+	return threadCount;
+}
+
+void SoftwareRasterizer::Flush() {
+	if(triangles.empty()) {
+		return;
+	}
+	stats.trianglesRasterized += triangles.size();
+	if(threadCount == 1u) {
+		const Target target = { color.data(), depth.data(), width, 0, 0, int(width) - 1, int(height) - 1 };
+		for(const auto& tri : triangles) {
+			stats.pixelsWritten += RasterizeTriangle(tri, target);
+		}
+		triangles.clear();
+		return;
+	}
+
+	BinTriangles();
+	//hand every worker a contiguous range of tiles
+	const std::uint64_t tileCount = bins.size();
+	for(unsigned int i = 0u; i < threadCount; i++) {
+		const std::uint64_t begin = tileCount * i / threadCount;
+		const std::uint64_t end = tileCount * (i + 1u) / threadCount;
+		tileRanges[i].store((begin << 32) | end, std::memory_order_relaxed);
+		workerPixels[i] = 0u;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		pendingWorkers = threadCount - 1u;
+		generation++;
+	}
+	startCv.notify_all();
+	workerPixels[0] = RunTiles(0u);
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		doneCv.wait(lock, [this]() { return pendingWorkers == 0u; });
+	}
+	for(const auto pixels : workerPixels) {
+		stats.pixelsWritten += pixels;
+	}
+	for(auto& bin : bins) {
+		bin.clear();
+	}
+	triangles.clear();
+}
+
+void SoftwareRasterizer::ClearBuffer(float red, float green, float blue) noexcept {
+	//anything still queued is overwritten anyway
+	triangles.clear();
+	for(auto& bin : bins) {
+		bin.clear();
+	}
+	std::fill(color.begin(), color.end(), PackColor(red, green, blue, 1.0f));
+	std::fill(depth.begin(), depth.end(), 1.0f);
+}
+
+void SoftwareRasterizer::SetFaceColors(const Color* pColors, std::size_t count) {
+	faceColors.assign(pColors, pColors + count);
+}
+
+void SoftwareRasterizer::DrawIndexed(const void* pVertices, std::size_t stride, std::size_t vertexCount,
+	const unsigned short* pIndices, std::size_t indexCount, const rmath::Mat4& transform, const Color& tint)
+{
+	DrawIndexedImpl(pVertices, stride, vertexCount, pIndices, indexCount, transform, tint);
+}
+
+void SoftwareRasterizer::DrawIndexed(const void* pVertices, std::size_t stride, std::size_t vertexCount,
+	const std::uint32_t* pIndices, std::size_t indexCount, const rmath::Mat4& transform, const Color& tint)
+{
+	DrawIndexedImpl(pVertices, stride, vertexCount, pIndices, indexCount, transform, tint);
+}
+
+void SoftwareRasterizer::DrawMesh(const MeshFile& mesh, std::size_t lod, const rmath::Mat4& transform, const Color& tint) {
+	const auto* pPosition = mesh.FindAttribute("POSITION");
+	if(pPosition == nullptr) {
+		throw Exception(__LINE__, __FILE__, "Mesh has no POSITION attribute");
+	}
+	if(lod >= mesh.GetLodCount()) {
+		throw Exception(__LINE__, __FILE__, "Mesh lod out of range");
+	}
+	const auto stream = mesh.GetStream(pPosition->stream);
+	const auto indices = mesh.GetIndices();
+	const auto& range = mesh.GetLod(lod);
+	const auto& dq = mesh.GetDequantization();
+	const void* pVertices = static_cast<const char*>(stream.pData) + pPosition->offset;
+	std::size_t stride = stream.stride;
+	if(pPosition->format != MeshFile::Format::Float3 || dq.scale.x != 1.0f || dq.scale.y != 1.0f || dq.scale.z != 1.0f
+		|| dq.offset.x != 0.0f || dq.offset.y != 0.0f || dq.offset.z != 0.0f)
+	{
+		//what the vertex shader computes before the transform
+		decodedPositions.resize(mesh.GetVertexCount());
+		VertexQuantization::Decode(stream.pData, stream.stride, mesh.GetVertexCount(), *pPosition, dq, decodedPositions.data());
+		pVertices = decodedPositions.data();
+		stride = sizeof(rmath::Float4);
+	}
+	if(indices.indexSize == 2u) {
+		DrawIndexedImpl(pVertices, stride, mesh.GetVertexCount(),
+			static_cast<const unsigned short*>(indices.pData) + range.firstIndex, range.indexCount, transform, tint);
+	} else {
+		DrawIndexedImpl(pVertices, stride, mesh.GetVertexCount(),
+			static_cast<const std::uint32_t*>(indices.pData) + range.firstIndex, range.indexCount, transform, tint);
+	}
+}
+
+template<typename Index>
+void SoftwareRasterizer::DrawIndexedImpl(const void* pVertices, std::size_t stride, std::size_t vertexCount,
+	const Index* pIndices, std::size_t indexCount, const rmath::Mat4& transform, const Color& tint)
+{
+	//vertex shader: mul(float4(pos, 1.0f), transform) with transform stored transposed, i.e. dot with each row
+	const auto& t = transform.m;
+	clipVertices.resize(vertexCount);
+	const auto* pBytes = static_cast<const unsigned char*>(pVertices);
+	for(std::size_t i = 0u; i < vertexCount; i++) {
+		float p[3];
+		std::memcpy(p, pBytes + i * stride, sizeof(p));
+		auto& v = clipVertices[i];
+		v.x = t[0][0] * p[0] + t[0][1] * p[1] + t[0][2] * p[2] + t[0][3];
+		v.y = t[1][0] * p[0] + t[1][1] * p[1] + t[1][2] * p[2] + t[1][3];
+		v.z = t[2][0] * p[0] + t[2][1] * p[1] + t[2][2] * p[2] + t[2][3];
+		v.w = t[3][0] * p[0] + t[3][1] * p[1] + t[3][2] * p[2] + t[3][3];
+	}
+
+	//primitive assembly and setup, the results queue up until they are rasterized
+	const std::size_t triangleCount = indexCount / 3u;
+	for(std::size_t prim = 0u; prim < triangleCount; prim++) {
+		const Index i0 = pIndices[prim * 3u];
+		const Index i1 = pIndices[prim * 3u + 1u];
+		const Index i2 = pIndices[prim * 3u + 2u];
+		stats.trianglesIn++;
+		//out of range indices fetch nothing, skip the primitive
+		if(i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount) {
+			stats.trianglesCulled++;
+			continue;
+		}
+		//pixel shader: face_colors[(SV_PrimitiveID / 2) % count] is constant over the triangle
+		const Color fc = faceColors.empty() ? Color{ 0.0f, 0.0f, 0.0f, 0.0f } : faceColors[prim / 2u % faceColors.size()];
+		const std::uint32_t c = PackColor(fc.r * tint.r, fc.g * tint.g, fc.b * tint.b, fc.a * tint.a);
+		const ClipVertex tri[3] = { clipVertices[i0], clipVertices[i1], clipVertices[i2] };
+		const auto before = triangles.size();
+		SetupTriangles(tri, c, triangles);
+		if(triangles.size() == before) {
+			stats.trianglesCulled++;
+		}
+	}
+
+	//single threaded draws go out immediately, the tiled path waits for more work to amortize the wake up
+	if(threadCount == 1u) {
+		Flush();
+	}
+}
+
+void SoftwareRasterizer::SetupTriangles(const ClipVertex* pTri, std::uint32_t color, std::vector<SetupTriangle>& out) {
+	//clip planes as dot(plane, v) >= 0: near (z >= 0), far (z <= w) and the guard band in x/y
+	const auto distance = [](int plane, const ClipVertex& v) {
+		switch(plane) {
+		case 0: return v.z;
+		case 1: return v.w - v.z;
+		case 2: return guardBand * v.w - v.x;
+		case 3: return guardBand * v.w + v.x;
+		case 4: return guardBand * v.w - v.y;
+		default: return guardBand * v.w + v.y;
+		}
+	};
+	constexpr int planeCount = 6;
+
+	//outcodes: reject if all vertices are outside one plane, skip clipping if all are inside every plane
+	unsigned int outAll = ~0u;
+	unsigned int outAny = 0u;
+	for(int i = 0; i < 3; i++) {
+		unsigned int code = 0u;
+		for(int p = 0; p < planeCount; p++) {
+			if(distance(p, pTri[i]) < 0.0f) {
+				code |= 1u << p;
+			}
+		}
+		outAll &= code;
+		outAny |= code;
+	}
+	if(outAll != 0u) {
+		return;
+	}
+
+	SetupTriangle tri;
+	if(outAny == 0u) {
+		if(SetupScreenTriangle(pTri[0], pTri[1], pTri[2], color, tri)) {
+			out.push_back(tri);
+		}
+		return;
+	}
+
+	//Sutherland-Hodgman in homogeneous space, a triangle gains at most one vertex per plane
+	ClipVertex bufferA[3 + planeCount];
+	ClipVertex bufferB[3 + planeCount];
+	ClipVertex* pIn = bufferA;
+	ClipVertex* pOut = bufferB;
+	int count = 3;
+	std::copy(pTri, pTri + 3, pIn);
+	for(int p = 0; p < planeCount && count > 0; p++) {
+		if(!(outAny & (1u << p))) {
+			continue;
+		}
+		int outCount = 0;
+		for(int i = 0; i < count; i++) {
+			const ClipVertex& a = pIn[i];
+			const ClipVertex& b = pIn[(i + 1) % count];
+			const float da = distance(p, a);
+			const float db = distance(p, b);
+			if(da >= 0.0f) {
+				pOut[outCount++] = a;
+			}
+			if((da >= 0.0f) != (db >= 0.0f)) {
+				const float t = da / (da - db);
+				pOut[outCount++] = {
+					a.x + (b.x - a.x) * t,
+					a.y + (b.y - a.y) * t,
+					a.z + (b.z - a.z) * t,
+					a.w + (b.w - a.w) * t,
+				};
+			}
+		}
+		std::swap(pIn, pOut);
+		count = outCount;
+	}
+	//fan out the convex polygon, every piece keeps the primitive's color
+	for(int i = 1; i + 1 < count; i++) {
+		if(SetupScreenTriangle(pIn[0], pIn[i], pIn[i + 1], color, tri)) {
+			out.push_back(tri);
+		}
+	}
+}
+
+bool SoftwareRasterizer::SetupScreenTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, std::uint32_t color, SetupTriangle& tri) const noexcept {
+	//perspective divide and viewport transform (TopLeft 0,0, depth range 0..1), y points down on screen
+	const ClipVertex* v[3] = { &a, &b, &c };
+	float sx[3], sy[3], sz[3];
+	for(int i = 0; i < 3; i++) {
+		const float invW = 1.0f / v[i]->w;
+		sx[i] = (v[i]->x * invW + 1.0f) * 0.5f * float(width);
+		sy[i] = (1.0f - v[i]->y * invW) * 0.5f * float(height);
+		sz[i] = v[i]->z * invW;
+		tri.x[i] = (std::int32_t)std::floor(sx[i] * float(subpixelScale) + 0.5f);
+		tri.y[i] = (std::int32_t)std::floor(sy[i] * float(subpixelScale) + 0.5f);
+	}
+
+	//cull back faces and degenerates on the snapped positions, front faces are clockwise (positive area with y down)
+	const std::int64_t area =
+		std::int64_t(tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) -
+		std::int64_t(tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+	if(area <= 0) {
+		return false;
+	}
+
+	//pixel bounds, a pixel is covered when its center (x + 0.5) is inside
+	const std::int32_t minX = std::min({ tri.x[0], tri.x[1], tri.x[2] });
+	const std::int32_t maxX = std::max({ tri.x[0], tri.x[1], tri.x[2] });
+	const std::int32_t minY = std::min({ tri.y[0], tri.y[1], tri.y[2] });
+	const std::int32_t maxY = std::max({ tri.y[0], tri.y[1], tri.y[2] });
+	tri.minX = std::max(0, (minX - subpixelScale / 2 + subpixelScale - 1) >> subpixelBits);
+	tri.minY = std::max(0, (minY - subpixelScale / 2 + subpixelScale - 1) >> subpixelBits);
+	tri.maxX = std::min(int(width) - 1, (maxX - subpixelScale / 2) >> subpixelBits);
+	tri.maxY = std::min(int(height) - 1, (maxY - subpixelScale / 2) >> subpixelBits);
+	if(tri.minX > tri.maxX || tri.minY > tri.maxY) {
+		return false;
+	}
+
+	//depth plane from the snapped positions, z = z0 + dzdx * (px - x0) + dzdy * (py - y0)
+	const double fx[3] = { tri.x[0] / double(subpixelScale), tri.x[1] / double(subpixelScale), tri.x[2] / double(subpixelScale) };
+	const double fy[3] = { tri.y[0] / double(subpixelScale), tri.y[1] / double(subpixelScale), tri.y[2] / double(subpixelScale) };
+	const double dx1 = fx[1] - fx[0], dy1 = fy[1] - fy[0], dz1 = double(sz[1]) - sz[0];
+	const double dx2 = fx[2] - fx[0], dy2 = fy[2] - fy[0], dz2 = double(sz[2]) - sz[0];
+	const double det = dx1 * dy2 - dy1 * dx2;
+	tri.x0 = float(fx[0]);
+	tri.y0 = float(fy[0]);
+	tri.z0 = sz[0];
+	tri.dzdx = float((dz1 * dy2 - dz2 * dy1) / det);
+	tri.dzdy = float((dx1 * dz2 - dx2 * dz1) / det);
+	tri.color = color;
+	return true;
+}
+
+void SoftwareRasterizer::SetKernel(Kernel kernel) noexcept {
+	const Kernel best = GetBestKernel();
+	this->kernel = int(kernel) <= int(best) ? kernel : best;
+}
+
+SoftwareRasterizer::Kernel SoftwareRasterizer::GetKernel() const noexcept {
+	return kernel;
+}
+
+SoftwareRasterizer::Kernel SoftwareRasterizer::GetBestKernel() noexcept {
+	if(CpuFeatures::HasAVX2()) {
+		return Kernel::AVX2;
+	}
+	if(CpuFeatures::HasSSE2()) {
+		return Kernel::SSE2;
+	}
+	return Kernel::Scalar;
+}
+
+std::size_t SoftwareRasterizer::RasterizeTriangle(const SetupTriangle& tri, const Target& target) const noexcept {
+	if(kernel != Kernel::Scalar && FitsSimdKernel(tri)) {
+		return kernel == Kernel::AVX2 ? RasterizeTriangleAVX2(tri, target) : RasterizeTriangleSSE2(tri, target);
+	}
+	return RasterizeTriangleScalar(tri, target);
+}
+
+bool SoftwareRasterizer::FitsSimdKernel(const SetupTriangle& tri) noexcept {
+	//an 8 pixel block moves an edge value by 8 * dy * subpixelScale
+	for(int i = 0; i < 3; i++) {
+		const std::int64_t dy = std::int64_t(tri.y[(i + 1) % 3]) - tri.y[i];
+		if((dy < 0 ? -dy : dy) * subpixelScale * 8 >= simdEdgeClamp) {
+			return false;
+		}
+	}
+	return true;
+}
+
+std::size_t SoftwareRasterizer::RasterizeTriangleScalar(const SetupTriangle& tri, const Target& target) noexcept {
+	const int minX = std::max(tri.minX, target.x0);
+	const int maxX = std::min(tri.maxX, target.x1);
+	const int minY = std::max(tri.minY, target.y0);
+	const int maxY = std::min(tri.maxY, target.y1);
+	if(minX > maxX || minY > maxY) {
+		return 0u;
+	}
+
+	//edge i runs from vertex i to vertex i + 1, inside is E >= 0
+	//E(p) = dx * (p.y - y_i) - dy * (p.x - x_i)
+	std::int64_t edgeDx[3], edgeDy[3], rowStart[3], bias[3];
+	const std::int64_t px = std::int64_t(minX) * subpixelScale + subpixelScale / 2;
+	const std::int64_t py = std::int64_t(minY) * subpixelScale + subpixelScale / 2;
+	for(int i = 0; i < 3; i++) {
+		const int j = (i + 1) % 3;
+		edgeDx[i] = std::int64_t(tri.x[j]) - tri.x[i];
+		edgeDy[i] = std::int64_t(tri.y[j]) - tri.y[i];
+		rowStart[i] = edgeDx[i] * (py - tri.y[i]) - edgeDy[i] * (px - tri.x[i]);
+		//top-left rule: pixels exactly on a top or left edge are inside, on other edges they are not
+		const bool topLeft = edgeDy[i] < 0 || (edgeDy[i] == 0 && edgeDx[i] > 0);
+		bias[i] = topLeft ? 0 : 1;
+	}
+
+	std::size_t written = 0u;
+	for(int y = minY; y <= maxY; y++) {
+		std::int64_t e0 = rowStart[0];
+		std::int64_t e1 = rowStart[1];
+		std::int64_t e2 = rowStart[2];
+		const float pyc = float(y) + 0.5f;
+		//rows of the target, indexed with x relative to the target origin
+		std::uint32_t* pColor = target.pColor + std::size_t(y - target.y0) * target.pitch - target.x0;
+		float* pDepth = target.pDepth + std::size_t(y - target.y0) * target.pitch - target.x0;
+		for(int x = minX; x <= maxX; x++) {
+			if(e0 - bias[0] >= 0 && e1 - bias[1] >= 0 && e2 - bias[2] >= 0) {
+				const float pxc = float(x) + 0.5f;
+				float z = tri.z0 + tri.dzdx * (pxc - tri.x0) + tri.dzdy * (pyc - tri.y0);
+				//depth is clamped to the viewport range before the test
+				z = std::min(std::max(z, 0.0f), 1.0f);
+				if(z < pDepth[x]) {
+					pDepth[x] = z;
+					pColor[x] = tri.color;
+					written++;
+				}
+			}
+			e0 -= edgeDy[0] * subpixelScale;
+			e1 -= edgeDy[1] * subpixelScale;
+			e2 -= edgeDy[2] * subpixelScale;
+		}
+		for(int i = 0; i < 3; i++) {
+			rowStart[i] += edgeDx[i] * subpixelScale;
+		}
+	}
+	return written;
+}
+
+void SoftwareRasterizer::BinTriangles() {
+	//append each triangle to every tile its bounds touch, order within a bin is submission order
+	for(std::size_t i = 0u; i < triangles.size(); i++) {
+		const auto& tri = triangles[i];
+		const int tx0 = tri.minX / tileSize;
+		const int tx1 = tri.maxX / tileSize;
+		const int ty0 = tri.minY / tileSize;
+		const int ty1 = tri.maxY / tileSize;
+		for(int ty = ty0; ty <= ty1; ty++) {
+			for(int tx = tx0; tx <= tx1; tx++) {
+				bins[std::size_t(ty) * tilesX + tx].push_back((std::uint32_t)i);
+			}
+		}
+	}
+}
+
+std::size_t SoftwareRasterizer::RunTiles(unsigned int worker) noexcept {
+	std::size_t written = 0u;
+	//own range first, taken from the front
+	auto& own = tileRanges[worker];
+	std::uint64_t range = own.load(std::memory_order_acquire);
+	while(true) {
+		const std::uint64_t begin = range >> 32;
+		const std::uint64_t end = range & 0xFFFFFFFFu;
+		if(begin >= end) {
+			break;
+		}
+		if(own.compare_exchange_weak(range, ((begin + 1u) << 32) | end, std::memory_order_acq_rel)) {
+			written += RasterizeTile(std::size_t(begin), worker);
+			range = own.load(std::memory_order_acquire);
+		}
+	}
+	//then steal from the back of the others
+	for(unsigned int n = 1u; n < threadCount; n++) {
+		auto& victim = tileRanges[(worker + n) % threadCount];
+		range = victim.load(std::memory_order_acquire);
+		while(true) {
+			const std::uint64_t begin = range >> 32;
+			const std::uint64_t end = range & 0xFFFFFFFFu;
+			if(begin >= end) {
+				break;
+			}
+			if(victim.compare_exchange_weak(range, (begin << 32) | (end - 1u), std::memory_order_acq_rel)) {
+				written += RasterizeTile(std::size_t(end - 1u), worker);
+				range = victim.load(std::memory_order_acquire);
+			}
+		}
+	}
+	return written;
+}
+
+std::size_t SoftwareRasterizer::RasterizeTile(std::size_t tile, unsigned int worker) noexcept {
+	const auto& bin = bins[tile];
+	if(bin.empty()) {
+		return 0u;
+	}
+	const int x0 = int(tile % tilesX) * tileSize;
+	const int y0 = int(tile / tilesX) * tileSize;
+	const int x1 = std::min(x0 + tileSize, int(width)) - 1;
+	const int y1 = std::min(y0 + tileSize, int(height)) - 1;
+	const std::size_t rowLength = std::size_t(x1 - x0 + 1);
+
+	//work on a tile-local copy so the hot loop stays in this core's cache
+	auto* pColor = tileColor[worker].data();
+	auto* pDepth = tileDepth[worker].data();
+	for(int y = y0; y <= y1; y++) {
+		const std::size_t src = std::size_t(y) * width + x0;
+		const std::size_t dst = std::size_t(y - y0) * tileSize;
+		std::copy_n(&color[src], rowLength, pColor + dst);
+		std::copy_n(&depth[src], rowLength, pDepth + dst);
+	}
+	const Target target = { pColor, pDepth, std::size_t(tileSize), x0, y0, x1, y1 };
+	std::size_t written = 0u;
+	for(const auto i : bin) {
+		written += RasterizeTriangle(triangles[i], target);
+	}
+	for(int y = y0; y <= y1; y++) {
+		const std::size_t dst = std::size_t(y) * width + x0;
+		const std::size_t src = std::size_t(y - y0) * tileSize;
+		std::copy_n(pColor + src, rowLength, &color[dst]);
+		std::copy_n(pDepth + src, rowLength, &depth[dst]);
+	}
+	return written;
+}
+
+void SoftwareRasterizer::WorkerLoop(unsigned int worker, unsigned long long seen) {
+	while(true) {
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			startCv.wait(lock, [&]() { return stopping || generation != seen; });
+			if(stopping) {
+				return;
+			}
+			seen = generation;
+		}
+		workerPixels[worker] = RunTiles(worker);
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			pendingWorkers--;
+		}
+		doneCv.notify_one();
+	}
+}
+
+void SoftwareRasterizer::StopWorkers() noexcept {
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		stopping = true;
+	}
+	startCv.notify_all();
+	for(auto& w : workers) {
+		w.join();
+	}
+	workers.clear();
+}
+
+unsigned int SoftwareRasterizer::GetWidth() const noexcept {
+	return width;
+}
+
+unsigned int SoftwareRasterizer::GetHeight() const noexcept {
+	return height;
+}
+
+const std::uint32_t* SoftwareRasterizer::GetColorBuffer() {
+	Flush();
+	return color.data();
+}
+
+const float* SoftwareRasterizer::GetDepthBuffer() {
+	Flush();
+	return depth.data();
+}
+
+std::uint32_t SoftwareRasterizer::GetPixel(unsigned int x, unsigned int y) {
+	Flush();
+	return color[std::size_t(y) * width + x];
+}
+
+void SoftwareRasterizer::SavePPM(const std::string& path) {
+	Flush();
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if(!out) {
+		throw Exception(__LINE__, __FILE__, "Failed to open " + path);
+	}
+	out << "P6\n" << width << " " << height << "\n255\n";
+	std::vector<unsigned char> row(std::size_t(width) * 3u);
+	for(unsigned int y = 0u; y < height; y++) {
+		for(unsigned int x = 0u; x < width; x++) {
+			const std::uint32_t c = color[std::size_t(y) * width + x];
+			row[x * 3u + 0u] = (unsigned char)(c >> 16);
+			row[x * 3u + 1u] = (unsigned char)(c >> 8);
+			row[x * 3u + 2u] = (unsigned char)(c);
+		}
+		out.write(reinterpret_cast<const char*>(row.data()), (std::streamsize)row.size());
+	}
+	if(!out) {
+		throw Exception(__LINE__, __FILE__, "Failed to write " + path);
+	}
+}
+
+const SoftwareRasterizer::Stats& SoftwareRasterizer::GetStats() {
+	Flush();
+	return stats;
+}
+
+void SoftwareRasterizer::ResetStats() noexcept {
+	stats = {};
+}
+
+std::uint32_t SoftwareRasterizer::PackColor(float r, float g, float b, float a) noexcept {
+	//float -> UNORM8: clamp, scale, round to nearest
+	const auto unorm = [](float v) {
+		v = std::min(std::max(v, 0.0f), 1.0f);
+		return std::uint32_t(v * 255.0f + 0.5f);
+	};
+	return (unorm(a) << 24) | (unorm(r) << 16) | (unorm(g) << 8) | unorm(b);
+}
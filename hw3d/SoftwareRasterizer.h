@@ -0,0 +1,163 @@
+#pragma once
+#include "UrielException.h"
+#include "RasterMath.h"
+#include "MeshFile.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+//CPU reference implementation of the pipeline Graphics sets up, used as ground truth where no GPU is available:
+//	VS: clip = float4(pos, 1) * transform (transform is passed transposed, exactly like the constant buffer)
+//	RS: triangle list, cull back (front faces clockwise), depth clip, 8 bit subpixel snapping, top-left fill rule
+//	PS: face_colors[(SV_PrimitiveID / 2) % count] (times an optional tint, like InstancePixelShader)
+//	OM: D32_FLOAT depth with LESS compare and depth write, B8G8R8A8_UNORM color
+//Does not depend on D3D or Windows.
+//
+//With more than one thread, set up triangles are queued and binned into 64x64 screen tiles on Flush().
+//Tiles are rasterized in parallel (each worker owns a range of tiles and steals from the others when it runs dry)
+//into tile-local color/depth copies. Every tile still sees its triangles in submission order,
+//so the output is bit-identical to the single threaded path.
+//
+//Scan conversion uses an AVX2 (8x1 pixel blocks) or SSE2 (4x1) kernel picked at runtime from CPUID.
+//Edge functions stay exact integers, so coverage matches the scalar reference kernel pixel for pixel.
+class SoftwareRasterizer {
+public:
+	class Exception : public UrielException {
+	public:
+		Exception(int line, const char* file, std::string note) noexcept;
+		const char* what() const noexcept override;
+		const char* GetType() const noexcept override;
+		const std::string& GetNote() const noexcept;
+	private:
+		std::string note;
+	};
+	struct Color {
+		float r, g, b, a;
+	};
+	enum class Kernel {
+		Scalar,
+		SSE2,
+		AVX2
+	};
+	struct Stats {
+		std::size_t trianglesIn = 0u;
+		std::size_t trianglesCulled = 0u; //back facing, degenerate or clipped away
+		std::size_t trianglesRasterized = 0u; //after clipping, one input triangle can become several
+		std::size_t pixelsWritten = 0u;
+	};
+public:
+	SoftwareRasterizer(unsigned int width = 800u, unsigned int height = 600u);
+	SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+	SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+	~SoftwareRasterizer();
+	//1 rasterizes every draw immediately on the calling thread, more spins up workers (the caller counts as one)
+	void SetThreadCount(unsigned int count);
+	unsigned int GetThreadCount() const noexcept;
+	//rasterize everything queued so far, the accessors below flush on their own
+	void Flush();
+	//force a scan conversion kernel, unsupported ones fall back to the best available
+	void SetKernel(Kernel kernel) noexcept;
+	Kernel GetKernel() const noexcept;
+	static Kernel GetBestKernel() noexcept;
+	//clears color to (r, g, b, 1) and depth to 1, same as Graphics::ClearBuffer
+	void ClearBuffer(float red, float green, float blue) noexcept;
+	//contents of the pixel shader constant buffer, the pixel shaders cycle through them for larger meshes
+	void SetFaceColors(const Color* pColors, std::size_t count);
+	//pVertices: POSITION (float3) at offset 0 of every vertex, stride in bytes like IASetVertexBuffers
+	void DrawIndexed(const void* pVertices, std::size_t stride, std::size_t vertexCount,
+		const unsigned short* pIndices, std::size_t indexCount, const rmath::Mat4& transform, const Color& tint = { 1.0f, 1.0f, 1.0f, 1.0f });
+	void DrawIndexed(const void* pVertices, std::size_t stride, std::size_t vertexCount,
+		const std::uint32_t* pIndices, std::size_t indexCount, const rmath::Mat4& transform, const Color& tint = { 1.0f, 1.0f, 1.0f, 1.0f });
+	//one lod of a mesh file, float3 positions are read straight from the mapping, compressed ones decoded first
+	void DrawMesh(const MeshFile& mesh, std::size_t lod, const rmath::Mat4& transform, const Color& tint = { 1.0f, 1.0f, 1.0f, 1.0f });
+	unsigned int GetWidth() const noexcept;
+	unsigned int GetHeight() const noexcept;
+	//B8G8R8A8 pixels, packed as 0xAARRGGBB
+	const std::uint32_t* GetColorBuffer();
+	const float* GetDepthBuffer();
+	std::uint32_t GetPixel(unsigned int x, unsigned int y);
+	//binary PPM (P6), alpha is dropped
+	void SavePPM(const std::string& path);
+	const Stats& GetStats();
+	void ResetStats() noexcept;
+private:
+	struct ClipVertex {
+		float x, y, z, w;
+	};
+	//triangle after clipping, projection, snapping and culling, ready for scan conversion
+	struct SetupTriangle {
+		std::int32_t x[3], y[3]; //screen position, 8 bit subpixel fixed point
+		float x0, y0, z0; //first vertex in pixels, origin of the depth plane
+		float dzdx, dzdy;
+		std::uint32_t color;
+		int minX, minY, maxX, maxY; //inclusive pixel bounds, clamped to the viewport
+	};
+	template<typename Index>
+	void DrawIndexedImpl(const void* pVertices, std::size_t stride, std::size_t vertexCount,
+		const Index* pIndices, std::size_t indexCount, const rmath::Mat4& transform, const Color& tint);
+	//clip one clip space triangle and append the resulting screen triangles
+	void SetupTriangles(const ClipVertex* pTri, std::uint32_t color, std::vector<SetupTriangle>& out);
+	bool SetupScreenTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, std::uint32_t color, SetupTriangle& tri) const noexcept;
+	//pixel rectangle [x0, x1] x [y0, y1] of the render target, pColor/pDepth point at pixel (x0, y0)
+	struct Target {
+		std::uint32_t* pColor;
+		float* pDepth;
+		std::size_t pitch; //in pixels
+		int x0, y0, x1, y1;
+	};
+	//scan convert the part of tri inside the target rectangle with the selected kernel
+	std::size_t RasterizeTriangle(const SetupTriangle& tri, const Target& target) const noexcept;
+	static std::size_t RasterizeTriangleScalar(const SetupTriangle& tri, const Target& target) noexcept;
+	static std::size_t RasterizeTriangleSSE2(const SetupTriangle& tri, const Target& target) noexcept;
+	static std::size_t RasterizeTriangleAVX2(const SetupTriangle& tri, const Target& target) noexcept;
+	//SIMD kernels step edges in 32 bit lanes, which is exact as long as a block's edge step fits
+	static bool FitsSimdKernel(const SetupTriangle& tri) noexcept;
+	void BinTriangles();
+	//rasterize tiles until none are left to own or steal, returns pixels written
+	std::size_t RunTiles(unsigned int worker) noexcept;
+	std::size_t RasterizeTile(std::size_t tile, unsigned int worker) noexcept;
+	//seen is the generation at start up, the worker wakes for every later one
+	void WorkerLoop(unsigned int worker, unsigned long long seen);
+	void StopWorkers() noexcept;
+	static std::uint32_t PackColor(float r, float g, float b, float a) noexcept;
+private:
+	static constexpr int subpixelBits = 8;
+	static constexpr int subpixelScale = 1 << subpixelBits;
+	//clip planes are pushed out to guardBand * w in x and y so snapped coordinates stay well inside int32
+	static constexpr float guardBand = 8.0f;
+	//SIMD lanes start from the block's edge value clamped to +-simdEdgeClamp, a block may change it by less than that
+	static constexpr std::int64_t simdEdgeClamp = std::int64_t(1) << 30;
+	Kernel kernel = Kernel::Scalar;
+	unsigned int width;
+	unsigned int height;
+	std::vector<std::uint32_t> color;
+	std::vector<float> depth;
+	std::vector<Color> faceColors;
+	std::vector<ClipVertex> clipVertices; //scratch, reused between draws
+	std::vector<rmath::Float4> decodedPositions; //DrawMesh() scratch for compressed positions
+	std::vector<SetupTriangle> triangles; //queued for rasterization, reused between draws
+	Stats stats;
+	//tiled multithreaded path
+	static constexpr int tileSize = 64;
+	unsigned int threadCount = 1u;
+	int tilesX = 0;
+	int tilesY = 0;
+	std::vector<std::vector<std::uint32_t>> bins; //triangle indices per tile, in submission order
+	std::unique_ptr<std::atomic<std::uint64_t>[]> tileRanges; //per worker [begin, end) of tiles, begin in the high half
+	std::vector<std::vector<std::uint32_t>> tileColor; //per worker tile-local color
+	std::vector<std::vector<float>> tileDepth; //per worker tile-local depth
+	std::vector<std::size_t> workerPixels;
+	std::vector<std::thread> workers;
+	std::mutex mtx;
+	std::condition_variable startCv;
+	std::condition_variable doneCv;
+	unsigned long long generation = 0u;
+	unsigned int pendingWorkers = 0u;
+	bool stopping = false;
+};
@@ -0,0 +1,214 @@
+#include "SoftwareRasterizer.h"
+#include <algorithm>
+#include <bit>
+
+//SIMD scan conversion kernels for SoftwareRasterizer.
+//Same math as RasterizeTriangleScalar: edge values are exact integers (64 bit per block, 32 bit within a block)
+//and depth uses the same float expression in the same order, so results match the scalar kernel.
+//Only the block interiors are vectorized, the last < block width pixels of a row go through the scalar test.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#define RASTER_TARGET_SSE2
+#define RASTER_TARGET_AVX2
+#else
+#define RASTER_TARGET_SSE2 __attribute__((target("sse2")))
+#define RASTER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+RASTER_TARGET_SSE2
+std::size_t SoftwareRasterizer::RasterizeTriangleSSE2(const SetupTriangle& tri, const Target& target) noexcept {
+	const int minX = std::max(tri.minX, target.x0);
+	const int maxX = std::min(tri.maxX, target.x1);
+	const int minY = std::max(tri.minY, target.y0);
+	const int maxY = std::min(tri.maxY, target.y1);
+	if(minX > maxX || minY > maxY) {
+		return 0u;
+	}
+
+	std::int64_t edgeDx[3], edgeDy[3], rowStart[3], bias[3];
+	const std::int64_t px = std::int64_t(minX) * subpixelScale + subpixelScale / 2;
+	const std::int64_t py = std::int64_t(minY) * subpixelScale + subpixelScale / 2;
+	__m128i laneStep[3], biasMinusOne[3];
+	for(int i = 0; i < 3; i++) {
+		const int j = (i + 1) % 3;
+		edgeDx[i] = std::int64_t(tri.x[j]) - tri.x[i];
+		edgeDy[i] = std::int64_t(tri.y[j]) - tri.y[i];
+		rowStart[i] = edgeDx[i] * (py - tri.y[i]) - edgeDy[i] * (px - tri.x[i]);
+		const bool topLeft = edgeDy[i] < 0 || (edgeDy[i] == 0 && edgeDx[i] > 0);
+		bias[i] = topLeft ? 0 : 1;
+		//edge value of lane k relative to the block start
+		const std::int32_t step = std::int32_t(-edgeDy[i] * subpixelScale);
+		laneStep[i] = _mm_setr_epi32(0, step, step * 2, step * 3);
+		biasMinusOne[i] = _mm_set1_epi32(std::int32_t(bias[i] - 1));
+	}
+	const __m128 laneOffset = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 z0 = _mm_set1_ps(tri.z0);
+	const __m128 x0 = _mm_set1_ps(tri.x0);
+	const __m128 dzdx = _mm_set1_ps(tri.dzdx);
+	const __m128i triColor = _mm_set1_epi32((int)tri.color);
+
+	std::size_t written = 0u;
+	for(int y = minY; y <= maxY; y++) {
+		std::int64_t e[3] = { rowStart[0], rowStart[1], rowStart[2] };
+		const float pyc = float(y) + 0.5f;
+		const __m128 rowTerm = _mm_set1_ps(tri.dzdy * (pyc - tri.y0));
+		std::uint32_t* pColor = target.pColor + std::size_t(y - target.y0) * target.pitch - target.x0;
+		float* pDepth = target.pDepth + std::size_t(y - target.y0) * target.pitch - target.x0;
+		int x = minX;
+		for(; x + 3 <= maxX; x += 4) {
+			__m128i inside = _mm_set1_epi32(-1);
+			for(int i = 0; i < 3; i++) {
+				const std::int32_t start = std::int32_t(std::clamp(e[i], -simdEdgeClamp, simdEdgeClamp));
+				const __m128i ev = _mm_add_epi32(_mm_set1_epi32(start), laneStep[i]);
+				inside = _mm_and_si128(inside, _mm_cmpgt_epi32(ev, biasMinusOne[i]));
+				e[i] -= edgeDy[i] * subpixelScale * 4;
+			}
+			if(_mm_movemask_epi8(inside) == 0) {
+				continue;
+			}
+			const __m128 pxc = _mm_add_ps(_mm_set1_ps(float(x)), laneOffset);
+			__m128 z = _mm_add_ps(_mm_add_ps(z0, _mm_mul_ps(dzdx, _mm_sub_ps(pxc, x0))), rowTerm);
+			z = _mm_min_ps(_mm_max_ps(z, zero), one);
+			const __m128 oldZ = _mm_loadu_ps(pDepth + x);
+			const __m128 pass = _mm_and_ps(_mm_castsi128_ps(inside), _mm_cmplt_ps(z, oldZ));
+			const int passBits = _mm_movemask_ps(pass);
+			if(passBits == 0) {
+				continue;
+			}
+			_mm_storeu_ps(pDepth + x, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, oldZ)));
+			const __m128i passI = _mm_castps_si128(pass);
+			const __m128i oldColor = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pColor + x));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pColor + x),
+				_mm_or_si128(_mm_and_si128(passI, triColor), _mm_andnot_si128(passI, oldColor)));
+			written += std::popcount((unsigned int)passBits);
+		}
+		//row tail, same test as the scalar kernel
+		for(; x <= maxX; x++) {
+			if(e[0] - bias[0] >= 0 && e[1] - bias[1] >= 0 && e[2] - bias[2] >= 0) {
+				const float pxc = float(x) + 0.5f;
+				float z = tri.z0 + tri.dzdx * (pxc - tri.x0) + tri.dzdy * (pyc - tri.y0);
+				z = std::min(std::max(z, 0.0f), 1.0f);
+				if(z < pDepth[x]) {
+					pDepth[x] = z;
+					pColor[x] = tri.color;
+					written++;
+				}
+			}
+			for(int i = 0; i < 3; i++) {
+				e[i] -= edgeDy[i] * subpixelScale;
+			}
+		}
+		for(int i = 0; i < 3; i++) {
+			rowStart[i] += edgeDx[i] * subpixelScale;
+		}
+	}
+	return written;
+}
+
+RASTER_TARGET_AVX2
+std::size_t SoftwareRasterizer::RasterizeTriangleAVX2(const SetupTriangle& tri, const Target& target) noexcept {
+	const int minX = std::max(tri.minX, target.x0);
+	const int maxX = std::min(tri.maxX, target.x1);
+	const int minY = std::max(tri.minY, target.y0);
+	const int maxY = std::min(tri.maxY, target.y1);
+	if(minX > maxX || minY > maxY) {
+		return 0u;
+	}
+
+	std::int64_t edgeDx[3], edgeDy[3], rowStart[3], bias[3];
+	const std::int64_t px = std::int64_t(minX) * subpixelScale + subpixelScale / 2;
+	const std::int64_t py = std::int64_t(minY) * subpixelScale + subpixelScale / 2;
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i laneStep[3], biasMinusOne[3];
+	for(int i = 0; i < 3; i++) {
+		const int j = (i + 1) % 3;
+		edgeDx[i] = std::int64_t(tri.x[j]) - tri.x[i];
+		edgeDy[i] = std::int64_t(tri.y[j]) - tri.y[i];
+		rowStart[i] = edgeDx[i] * (py - tri.y[i]) - edgeDy[i] * (px - tri.x[i]);
+		const bool topLeft = edgeDy[i] < 0 || (edgeDy[i] == 0 && edgeDx[i] > 0);
+		bias[i] = topLeft ? 0 : 1;
+		laneStep[i] = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(std::int32_t(-edgeDy[i] * subpixelScale)));
+		biasMinusOne[i] = _mm256_set1_epi32(std::int32_t(bias[i] - 1));
+	}
+	const __m256 laneOffset = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 z0 = _mm256_set1_ps(tri.z0);
+	const __m256 x0 = _mm256_set1_ps(tri.x0);
+	const __m256 dzdx = _mm256_set1_ps(tri.dzdx);
+	const __m256i triColor = _mm256_set1_epi32((int)tri.color);
+
+	std::size_t written = 0u;
+	for(int y = minY; y <= maxY; y++) {
+		std::int64_t e[3] = { rowStart[0], rowStart[1], rowStart[2] };
+		const float pyc = float(y) + 0.5f;
+		const __m256 rowTerm = _mm256_set1_ps(tri.dzdy * (pyc - tri.y0));
+		std::uint32_t* pColor = target.pColor + std::size_t(y - target.y0) * target.pitch - target.x0;
+		float* pDepth = target.pDepth + std::size_t(y - target.y0) * target.pitch - target.x0;
+		int x = minX;
+		for(; x + 7 <= maxX; x += 8) {
+			__m256i inside = _mm256_set1_epi32(-1);
+			for(int i = 0; i < 3; i++) {
+				const std::int32_t start = std::int32_t(std::clamp(e[i], -simdEdgeClamp, simdEdgeClamp));
+				const __m256i ev = _mm256_add_epi32(_mm256_set1_epi32(start), laneStep[i]);
+				inside = _mm256_and_si256(inside, _mm256_cmpgt_epi32(ev, biasMinusOne[i]));
+				e[i] -= edgeDy[i] * subpixelScale * 8;
+			}
+			if(_mm256_testz_si256(inside, inside)) {
+				continue;
+			}
+			const __m256 pxc = _mm256_add_ps(_mm256_set1_ps(float(x)), laneOffset);
+			__m256 z = _mm256_add_ps(_mm256_add_ps(z0, _mm256_mul_ps(dzdx, _mm256_sub_ps(pxc, x0))), rowTerm);
+			z = _mm256_min_ps(_mm256_max_ps(z, zero), one);
+			const __m256 oldZ = _mm256_loadu_ps(pDepth + x);
+			const __m256 pass = _mm256_and_ps(_mm256_castsi256_ps(inside), _mm256_cmp_ps(z, oldZ, _CMP_LT_OQ));
+			const int passBits = _mm256_movemask_ps(pass);
+			if(passBits == 0) {
+				continue;
+			}
+			_mm256_storeu_ps(pDepth + x, _mm256_blendv_ps(oldZ, z, pass));
+			const __m256i oldColor = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pColor + x));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pColor + x),
+				_mm256_blendv_epi8(oldColor, triColor, _mm256_castps_si256(pass)));
+			written += std::popcount((unsigned int)passBits);
+		}
+		//row tail, same test as the scalar kernel
+		for(; x <= maxX; x++) {
+			if(e[0] - bias[0] >= 0 && e[1] - bias[1] >= 0 && e[2] - bias[2] >= 0) {
+				const float pxc = float(x) + 0.5f;
+				float z = tri.z0 + tri.dzdx * (pxc - tri.x0) + tri.dzdy * (pyc - tri.y0);
+				z = std::min(std::max(z, 0.0f), 1.0f);
+				if(z < pDepth[x]) {
+					pDepth[x] = z;
+					pColor[x] = tri.color;
+					written++;
+				}
+			}
+			for(int i = 0; i < 3; i++) {
+				e[i] -= edgeDy[i] * subpixelScale;
+			}
+		}
+		for(int i = 0; i < 3; i++) {
+			rowStart[i] += edgeDx[i] * subpixelScale;
+		}
+	}
+	return written;
+}
+
+#else
+
+//no x86 SIMD on this target, GetBestKernel() never selects these
+std::size_t SoftwareRasterizer::RasterizeTriangleSSE2(const SetupTriangle& tri, const Target& target) noexcept {
+	return RasterizeTriangleScalar(tri, target);
+}
+
+std::size_t SoftwareRasterizer::RasterizeTriangleAVX2(const SetupTriangle& tri, const Target& target) noexcept {
+	return RasterizeTriangleScalar(tri, target);
+}
+
+#endif
@@ -0,0 +1,60 @@
+#pragma once
+
+//Geometry and colors of the test cube, shared by the D3D pipeline in Graphics and the software rasterizer.
+//Front faces are clockwise, the index order puts the two triangles of each face next to each other
+//so PixelShader.hlsl can pick the color with SV_PrimitiveID / 2.
+//TestCube.mesh (tools/MeshTool.cpp) is a denser rounded cube reordered by MeshOptimizer, with it the colors
+//follow triangle pairs in cache order instead of faces and repeat every 12 triangles.
+namespace TestCube {
+	struct Vertex {
+		struct {
+			float x, y, z;
+		} pos;
+		//struct{
+		//	unsigned char r, g, b, a; 
+		//} color;
+	};
+
+	constexpr Vertex vertices[] = {
+		{-1.0f, -1.0f, -1.0f },
+		{ 1.0f, -1.0f, -1.0f },
+		{-1.0f,  1.0f, -1.0f },
+		{ 1.0f,  1.0f, -1.0f },
+		{-1.0f, -1.0f,  1.0f },
+		{ 1.0f, -1.0f,  1.0f },
+		{-1.0f,  1.0f,  1.0f },
+		{ 1.0f,  1.0f,  1.0f },
+	};
+
+	constexpr unsigned short indices[] = {
+		0,2,1, 2,3,1,
+		1,3,5, 3,7,5,
+		2,6,3, 3,6,7,
+		4,5,7, 4,7,6,
+		0,4,2, 2,4,6,
+		0,1,4, 1,5,4
+	};
+
+	//face_colors[6] of the pixel shader constant buffer
+	struct FaceColors {
+		struct {
+			float r, g, b, a;
+		} face_colors[6];
+	};
+	constexpr FaceColors faceColors = {
+		{
+			{1.0f, 0.0f, 1.0f},
+			{1.0f, 0.0f, 0.0f},
+			{0.0f, 1.0f, 0.0f},
+			{0.0f, 0.0f, 1.0f},
+			{1.0f, 1.0f, 0.0f},
+			{0.0f, 1.0f, 1.0f},
+		}
+	};
+
+	//projection used by every test cube draw
+	constexpr float projWidth = 1.0f;
+	constexpr float projHeight = 3.0f / 4.0f;
+	constexpr float nearZ = 0.5f;
+	constexpr float farZ = 10.0f;
+}
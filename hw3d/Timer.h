@@ -1,5 +1,6 @@
 #pragma once
 #include <chrono>
+#include <cstdint>
 using namespace std;
 
 class Timer {
@@ -7,6 +8,10 @@ public:
 	Timer();
 	float Mark();
 	float Peek() const;
+	//raw steady clock reading in nanoseconds, cheap enough to take for every profiler scope
+	static std::int64_t Ticks() noexcept {
+		return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+	}
 private:
 	std::chrono::steady_clock::time_point last;
 };
\ No newline at end of file
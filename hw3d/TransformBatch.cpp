@@ -0,0 +1,134 @@
+#include "TransformBatch.h"
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_BATCH_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+	constexpr float pi = 3.141592654f;
+	constexpr float twoPi = 6.283185307f;
+	constexpr float oneDivTwoPi = 0.159154943f;
+	constexpr float piDivTwo = 1.570796327f;
+
+	//world * viewProj for RotationZ(a) * RotationX(a) * Translation(x, y, z), written transposed
+	//R = RZ * RX = | c    s*c  s*s |
+	//              | -s   c*c  c*s |
+	//              | 0    -s   c   |
+	void WriteScalar(float s, float c, float x, float y, float z, const rmath::Mat4& vp, float* pOut) noexcept {
+		const float r[3][3] = {
+			{ c, s * c, s * s },
+			{ -s, c * c, c * s },
+			{ 0.0f, -s, c },
+		};
+		for(int j = 0; j < 4; j++) {
+			for(int i = 0; i < 3; i++) {
+				pOut[j * 4 + i] = r[i][0] * vp.m[0][j] + r[i][1] * vp.m[1][j] + r[i][2] * vp.m[2][j];
+			}
+			pOut[j * 4 + 3] = x * vp.m[0][j] + y * vp.m[1][j] + z * vp.m[2][j] + vp.m[3][j];
+		}
+	}
+}
+
+void TransformBatch::SinCos(float angle, float& s, float& c) noexcept {
+	//reduce to [-pi, pi], then fold into [-pi/2, pi/2] where the polynomials are accurate
+	float y = angle - twoPi * std::nearbyint(angle * oneDivTwoPi);
+	float sign = 1.0f;
+	if(y > piDivTwo) {
+		y = pi - y;
+		sign = -1.0f;
+	} else if(y < -piDivTwo) {
+		y = -pi - y;
+		sign = -1.0f;
+	}
+	const float y2 = y * y;
+	s = (((((-2.3889859e-08f * y2 + 2.7525562e-06f) * y2 - 0.00019840874f) * y2 + 0.0083333310f) * y2 - 0.16666667f) * y2 + 1.0f) * y;
+	c = sign * ((((((-2.6051615e-07f * y2 + 2.4760495e-05f) * y2 - 0.0013888378f) * y2 + 0.041666638f) * y2 - 0.5f) * y2 + 1.0f));
+}
+
+void TransformBatch::BuildScalar(const Input& input, const rmath::Mat4& viewProj, void* pOut, std::size_t stride) noexcept {
+	auto* pBytes = static_cast<unsigned char*>(pOut);
+	for(std::size_t i = 0u; i < input.count; i++) {
+		float s, c;
+		SinCos(input.pAngle[i], s, c);
+		float m[16];
+		WriteScalar(s, c, input.pX[i], input.pY[i], input.pZ[i], viewProj, m);
+		std::memcpy(pBytes + i * stride, m, sizeof(m));
+	}
+}
+
+void TransformBatch::Build(const Input& input, const rmath::Mat4& viewProj, void* pOut, std::size_t stride) noexcept {
+#ifdef TRANSFORM_BATCH_SSE
+	auto* pBytes = static_cast<unsigned char*>(pOut);
+	const rmath::Mat4& vp = viewProj;
+	//broadcast viewProj once for the whole batch
+	__m128 v[4][4];
+	for(int r = 0; r < 4; r++) {
+		for(int c = 0; c < 4; c++) {
+			v[r][c] = _mm_set1_ps(vp.m[r][c]);
+		}
+	}
+	const __m128 vPi = _mm_set1_ps(pi);
+	const __m128 vNegPi = _mm_set1_ps(-pi);
+	const __m128 vPiDivTwo = _mm_set1_ps(piDivTwo);
+	const __m128 vNegPiDivTwo = _mm_set1_ps(-piDivTwo);
+	const __m128 vOne = _mm_set1_ps(1.0f);
+	const __m128 vNegOne = _mm_set1_ps(-1.0f);
+
+	std::size_t i = 0u;
+	for(; i + 4u <= input.count; i += 4u) {
+		const __m128 angle = _mm_loadu_ps(input.pAngle + i);
+		const __m128 x = _mm_loadu_ps(input.pX + i);
+		const __m128 y = _mm_loadu_ps(input.pY + i);
+		const __m128 z = _mm_loadu_ps(input.pZ + i);
+
+		//four SinCos at once, same steps as the scalar version
+		const __m128 quotient = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(oneDivTwoPi))));
+		__m128 a = _mm_sub_ps(angle, _mm_mul_ps(_mm_set1_ps(twoPi), quotient));
+		const __m128 above = _mm_cmpgt_ps(a, vPiDivTwo);
+		const __m128 below = _mm_cmplt_ps(a, vNegPiDivTwo);
+		a = _mm_or_ps(_mm_and_ps(above, _mm_sub_ps(vPi, a)), _mm_andnot_ps(above, a));
+		a = _mm_or_ps(_mm_and_ps(below, _mm_sub_ps(vNegPi, a)), _mm_andnot_ps(below, a));
+		const __m128 flip = _mm_or_ps(above, below);
+		const __m128 sign = _mm_or_ps(_mm_and_ps(flip, vNegOne), _mm_andnot_ps(flip, vOne));
+		const __m128 a2 = _mm_mul_ps(a, a);
+		__m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-2.3889859e-08f), a2), _mm_set1_ps(2.7525562e-06f));
+		s = _mm_sub_ps(_mm_mul_ps(s, a2), _mm_set1_ps(0.00019840874f));
+		s = _mm_add_ps(_mm_mul_ps(s, a2), _mm_set1_ps(0.0083333310f));
+		s = _mm_sub_ps(_mm_mul_ps(s, a2), _mm_set1_ps(0.16666667f));
+		s = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(s, a2), vOne), a);
+		__m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-2.6051615e-07f), a2), _mm_set1_ps(2.4760495e-05f));
+		c = _mm_sub_ps(_mm_mul_ps(c, a2), _mm_set1_ps(0.0013888378f));
+		c = _mm_add_ps(_mm_mul_ps(c, a2), _mm_set1_ps(0.041666638f));
+		c = _mm_sub_ps(_mm_mul_ps(c, a2), _mm_set1_ps(0.5f));
+		c = _mm_mul_ps(sign, _mm_add_ps(_mm_mul_ps(c, a2), vOne));
+
+		//rotation part, one register per matrix element for four objects
+		const __m128 r[3][3] = {
+			{ c, _mm_mul_ps(s, c), _mm_mul_ps(s, s) },
+			{ _mm_sub_ps(_mm_setzero_ps(), s), _mm_mul_ps(c, c), _mm_mul_ps(c, s) },
+			{ _mm_setzero_ps(), _mm_sub_ps(_mm_setzero_ps(), s), c },
+		};
+		//transposed result: out[j][i] = (world * vp)[i][j]
+		for(int j = 0; j < 4; j++) {
+			__m128 col[4];
+			for(int k = 0; k < 3; k++) {
+				col[k] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r[k][0], v[0][j]), _mm_mul_ps(r[k][1], v[1][j])), _mm_mul_ps(r[k][2], v[2][j]));
+			}
+			col[3] = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, v[0][j]), _mm_mul_ps(y, v[1][j])), _mm_mul_ps(z, v[2][j])), v[3][j]);
+			//SoA -> AoS: after the transpose col[n] holds row j of object i + n
+			_MM_TRANSPOSE4_PS(col[0], col[1], col[2], col[3]);
+			for(int n = 0; n < 4; n++) {
+				_mm_storeu_ps(reinterpret_cast<float*>(pBytes + (i + n) * stride) + j * 4, col[n]);
+			}
+		}
+	}
+	//leftover objects
+	const Input tail = { input.pAngle + i, input.pX + i, input.pY + i, input.pZ + i, input.count - i };
+	BuildScalar(tail, viewProj, pBytes + i * stride, stride);
+#else
+	BuildScalar(input, viewProj, pOut, stride);
+#endif
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "RasterMath.h"
+#include <cstddef>
+
+//Batched transform stage for objects animated like the test cubes:
+//	out = transpose(RotationZ(angle) * RotationX(angle) * Translation(x, y, z) * viewProj)
+//Input is structure of arrays, the shared viewProj is hoisted out of the loop and four objects are
+//built per SSE iteration (scalar fallback elsewhere). Every output is 16 floats in the layout the
+//constant buffer / instance stream expects, written at pOut + i * stride so it can land straight in
+//an array of Graphics::CubeInstance.
+namespace TransformBatch {
+	struct Input {
+		const float* pAngle;
+		const float* pX;
+		const float* pY;
+		const float* pZ;
+		std::size_t count;
+	};
+	void Build(const Input& input, const rmath::Mat4& viewProj, void* pOut, std::size_t stride) noexcept;
+	//one object at a time, same math, reference for the SIMD path
+	void BuildScalar(const Input& input, const rmath::Mat4& viewProj, void* pOut, std::size_t stride) noexcept;
+	//sin/cos with the polynomial both paths use (same as DirectXMath's XMScalarSinCos)
+	void SinCos(float angle, float& s, float& c) noexcept;
+}
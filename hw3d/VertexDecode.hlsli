@@ -0,0 +1,20 @@
+//Decode of the compressed vertex formats written by VertexQuantization, the CPU twins live in VertexQuantization.cpp
+
+//per-mesh constants, b0 holds the per-draw constants
+cbuffer Dequantization : register(b1) {
+	float3 dequant_scale;
+	float3 dequant_offset;
+};
+
+//R16G16B16A16_SNORM positions arrive in [-1, 1], float ones come with scale 1 and offset 0
+float3 DecodePosition(float3 pos) {
+	return pos * dequant_scale + dequant_offset;
+}
+
+//R16G16_SNORM octahedral normal
+float3 DecodeOctahedral(float2 e) {
+	float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+	const float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0f ? -t : t;
+	return normalize(n);
+}
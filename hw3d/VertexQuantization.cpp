@@ -0,0 +1,277 @@
+#include "VertexQuantization.h"
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+namespace {
+	struct Float2 {
+		float x, y;
+	};
+	float SignNotZero(float v) noexcept {
+		return v >= 0.0f ? 1.0f : -1.0f;
+	}
+	bool Is(const MeshFile::Attribute& a, const char* semantic, MeshFile::Format format) noexcept {
+		return a.semanticIndex == 0u && a.format == format && std::strcmp(a.semantic, semantic) == 0;
+	}
+	template<typename T>
+	T Read(const unsigned char* p) noexcept {
+		T v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+}
+
+std::int16_t VertexQuantization::EncodeSNorm16(float v) noexcept {
+	const float c = v > 1.0f ? 1.0f : (v < -1.0f ? -1.0f : v);
+	return (std::int16_t)std::lround(c * 32767.0f);
+}
+
+float VertexQuantization::DecodeSNorm16(std::int16_t v) noexcept {
+	//-32768 and -32767 both map to -1
+	const float f = float(v) / 32767.0f;
+	return f < -1.0f ? -1.0f : f;
+}
+
+std::uint16_t VertexQuantization::EncodeHalf(float v) noexcept {
+	std::uint32_t f;
+	std::memcpy(&f, &v, sizeof(f));
+	const std::uint16_t sign = std::uint16_t((f >> 16) & 0x8000u);
+	f &= 0x7FFFFFFFu;
+	if(f >= 0x7F800000u) {
+		//infinity stays infinity, NaN stays a (quiet) NaN
+		return sign | 0x7C00u | (f > 0x7F800000u ? 0x0200u : 0u);
+	}
+	if(f >= 0x477FF000u) {
+		//rounds to 65520 or more, past the largest half
+		return sign | 0x7C00u;
+	}
+	if(f < 0x38800000u) {
+		//below the smallest normal half, v * 2^24 is exact and the default rounding mode is to nearest even
+		float a;
+		std::memcpy(&a, &f, sizeof(a));
+		return sign | std::uint16_t(std::nearbyint(a * 16777216.0f));
+	}
+	//rebias the exponent and round the mantissa to 10 bits, a carry correctly bumps the exponent
+	f += 0xC8000FFFu + ((f >> 13) & 1u);
+	return sign | std::uint16_t(f >> 13);
+}
+
+float VertexQuantization::DecodeHalf(std::uint16_t v) noexcept {
+	const std::uint32_t sign = std::uint32_t(v & 0x8000u) << 16;
+	const std::uint32_t exponent = (v >> 10) & 0x1Fu;
+	const std::uint32_t mantissa = v & 0x3FFu;
+	if(exponent == 0u) {
+		const float f = float(mantissa) * (1.0f / 16777216.0f);
+		return sign ? -f : f;
+	}
+	const std::uint32_t bits = exponent == 0x1Fu
+		? sign | 0x7F800000u | (mantissa << 13)
+		: sign | ((exponent + 112u) << 23) | (mantissa << 13);
+	float f;
+	std::memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+void VertexQuantization::EncodeOctahedral(const rmath::Float3& n, std::int16_t* pEncoded) noexcept {
+	//project onto the octahedron |x| + |y| + |z| = 1, fold the lower half over the diagonals
+	const float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+	if(l1 == 0.0f) {
+		pEncoded[0] = 0;
+		pEncoded[1] = 0;
+		return;
+	}
+	float x = n.x / l1;
+	float y = n.y / l1;
+	if(n.z < 0.0f) {
+		const float fx = (1.0f - std::fabs(y)) * SignNotZero(x);
+		const float fy = (1.0f - std::fabs(x)) * SignNotZero(y);
+		x = fx;
+		y = fy;
+	}
+	pEncoded[0] = EncodeSNorm16(x);
+	pEncoded[1] = EncodeSNorm16(y);
+}
+
+rmath::Float3 VertexQuantization::DecodeOctahedral(std::int16_t ex, std::int16_t ey) noexcept {
+	//same steps as DecodeOctahedral() in VertexDecode.hlsli
+	float x = DecodeSNorm16(ex);
+	float y = DecodeSNorm16(ey);
+	const float z = 1.0f - std::fabs(x) - std::fabs(y);
+	const float t = z < 0.0f ? -z : 0.0f;
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+	const float length = std::sqrt(x * x + y * y + z * z);
+	return { x / length, y / length, z / length };
+}
+
+MeshFile::Dequantization VertexQuantization::MakeDequantization(const MeshFile::Aabb& bounds) noexcept {
+	//a flat axis keeps scale 1, every position on it encodes as 0
+	const auto scale = [](float min, float max) {
+		const float half = 0.5f * (max - min);
+		return half > 0.0f ? half : 1.0f;
+	};
+	return {
+		{ scale(bounds.min.x, bounds.max.x), scale(bounds.min.y, bounds.max.y), scale(bounds.min.z, bounds.max.z) },
+		{ 0.5f * (bounds.min.x + bounds.max.x), 0.5f * (bounds.min.y + bounds.max.y), 0.5f * (bounds.min.z + bounds.max.z) }
+	};
+}
+
+MeshOptimizer::Mesh VertexQuantization::Compress(const MeshOptimizer::Mesh& mesh) {
+	using Format = MeshFile::Format;
+	MeshOptimizer::Mesh result;
+	result.indices = mesh.indices;
+	result.lods = mesh.lods;
+	result.vertexCount = mesh.vertexCount;
+
+	//new layout, each attribute 4 byte aligned in one interleaved stream
+	std::uint32_t stride = 0u;
+	for(const auto& a : mesh.attributes) {
+		if(a.stream >= mesh.streams.size()) {
+			throw MeshFile::Exception(__LINE__, __FILE__, "Mesh attribute refers to a missing stream");
+		}
+		auto packed = a;
+		if(Is(a, "POSITION", Format::Float3)) {
+			packed.format = Format::SNorm16x4;
+		}
+		else if(Is(a, "NORMAL", Format::Float3)) {
+			packed.format = Format::SNorm16x2;
+		}
+		else if(std::strcmp(a.semantic, "TEXCOORD") == 0 && a.format == Format::Float2) {
+			packed.format = Format::Half2;
+		}
+		packed.stream = 0u;
+		packed.offset = stride;
+		stride += (MeshFile::GetFormatSize(packed.format) + 3u) & ~3u;
+		result.attributes.push_back(packed);
+	}
+	result.strides.push_back(stride);
+	result.streams.emplace_back(std::size_t(mesh.vertexCount) * stride, (unsigned char)0u);
+
+	//dequantization from the bounds of the float positions
+	result.dequantization = mesh.dequantization;
+	for(const auto& a : mesh.attributes) {
+		if(Is(a, "POSITION", Format::Float3)) {
+			const float inf = std::numeric_limits<float>::infinity();
+			MeshFile::Aabb bounds = { { inf, inf, inf }, { -inf, -inf, -inf } };
+			const unsigned char* p = mesh.streams[a.stream].data() + a.offset;
+			for(std::uint32_t v = 0u; v < mesh.vertexCount; v++, p += mesh.strides[a.stream]) {
+				const auto pos = Read<rmath::Float3>(p);
+				bounds.min = { std::fmin(bounds.min.x, pos.x), std::fmin(bounds.min.y, pos.y), std::fmin(bounds.min.z, pos.z) };
+				bounds.max = { std::fmax(bounds.max.x, pos.x), std::fmax(bounds.max.y, pos.y), std::fmax(bounds.max.z, pos.z) };
+			}
+			result.dequantization = mesh.vertexCount ? MakeDequantization(bounds) : MeshFile::Dequantization{ { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+			break;
+		}
+	}
+	const auto& dq = result.dequantization;
+
+	for(std::size_t i = 0u; i < mesh.attributes.size(); i++) {
+		const auto& a = mesh.attributes[i];
+		const auto& packed = result.attributes[i];
+		const std::size_t srcStride = mesh.strides[a.stream];
+		const unsigned char* pSrc = mesh.streams[a.stream].data() + a.offset;
+		unsigned char* pDst = result.streams[0].data() + packed.offset;
+		for(std::uint32_t v = 0u; v < mesh.vertexCount; v++, pSrc += srcStride, pDst += stride) {
+			if(packed.format == a.format) {
+				std::memcpy(pDst, pSrc, MeshFile::GetFormatSize(a.format));
+			}
+			else if(packed.format == Format::SNorm16x4) {
+				const auto pos = Read<rmath::Float3>(pSrc);
+				const std::int16_t q[4] = {
+					EncodeSNorm16((pos.x - dq.offset.x) / dq.scale.x),
+					EncodeSNorm16((pos.y - dq.offset.y) / dq.scale.y),
+					EncodeSNorm16((pos.z - dq.offset.z) / dq.scale.z),
+					32767
+				};
+				std::memcpy(pDst, q, sizeof(q));
+			}
+			else if(packed.format == Format::SNorm16x2) {
+				std::int16_t q[2];
+				EncodeOctahedral(Read<rmath::Float3>(pSrc), q);
+				std::memcpy(pDst, q, sizeof(q));
+			}
+			else {
+				const auto uv = Read<Float2>(pSrc);
+				const std::uint16_t h[2] = { EncodeHalf(uv.x), EncodeHalf(uv.y) };
+				std::memcpy(pDst, h, sizeof(h));
+			}
+		}
+	}
+	return result;
+}
+
+void VertexQuantization::Decode(const void* pVertices, std::size_t stride, std::size_t count, const MeshFile::Attribute& a,
+	const MeshFile::Dequantization& dequantization, rmath::Float4* pDecoded) noexcept
+{
+	using Format = MeshFile::Format;
+	const bool position = std::strcmp(a.semantic, "POSITION") == 0;
+	const bool octahedral = a.format == Format::SNorm16x2 && std::strcmp(a.semantic, "NORMAL") == 0;
+	const auto* p = static_cast<const unsigned char*>(pVertices) + a.offset;
+	for(std::size_t v = 0u; v < count; v++, p += stride) {
+		rmath::Float4 d = { 0.0f, 0.0f, 0.0f, position ? 1.0f : 0.0f };
+		switch(a.format) {
+		case Format::Float4:
+			d = Read<rmath::Float4>(p);
+			break;
+		case Format::Float3:
+		{
+			const auto f = Read<rmath::Float3>(p);
+			d.x = f.x;
+			d.y = f.y;
+			d.z = f.z;
+			break;
+		}
+		case Format::Float2:
+		{
+			const auto f = Read<Float2>(p);
+			d.x = f.x;
+			d.y = f.y;
+			break;
+		}
+		case Format::Float1:
+			d.x = Read<float>(p);
+			break;
+		case Format::UNorm8x4:
+			d = { p[0] / 255.0f, p[1] / 255.0f, p[2] / 255.0f, p[3] / 255.0f };
+			break;
+		case Format::SNorm16x4:
+		{
+			std::int16_t q[4];
+			std::memcpy(q, p, sizeof(q));
+			d = { DecodeSNorm16(q[0]), DecodeSNorm16(q[1]), DecodeSNorm16(q[2]), DecodeSNorm16(q[3]) };
+			break;
+		}
+		case Format::SNorm16x2:
+		{
+			std::int16_t q[2];
+			std::memcpy(q, p, sizeof(q));
+			if(octahedral) {
+				const auto n = DecodeOctahedral(q[0], q[1]);
+				d.x = n.x;
+				d.y = n.y;
+				d.z = n.z;
+			}
+			else {
+				d.x = DecodeSNorm16(q[0]);
+				d.y = DecodeSNorm16(q[1]);
+			}
+			break;
+		}
+		case Format::Half2:
+		{
+			std::uint16_t h[2];
+			std::memcpy(h, p, sizeof(h));
+			d.x = DecodeHalf(h[0]);
+			d.y = DecodeHalf(h[1]);
+			break;
+		}
+		}
+		if(position) {
+			d.x = d.x * dequantization.scale.x + dequantization.offset.x;
+			d.y = d.y * dequantization.scale.y + dequantization.offset.y;
+			d.z = d.z * dequantization.scale.z + dequantization.offset.z;
+			d.w = 1.0f;
+		}
+		pDecoded[v] = d;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "RasterMath.h"
+#include <cstdint>
+#include <cstddef>
+
+//Compressed vertex attributes, 32 bytes of float position/normal/uv become 16:
+//	POSITION float3 -> SNorm16x4 relative to the mesh bounds, decoded with the mesh's
+//	MeshFile::Dequantization (q * scale + offset), one MAD in VertexDecode.hlsli
+//	NORMAL float3 -> SNorm16x2 octahedral map (Cigolle et al., "A Survey of Efficient Representations
+//	for Independent Unit Vectors"), unfolded in VertexDecode.hlsli
+//	TEXCOORD float2 -> Half2, the input assembler converts it back
+//The CPU decode follows the D3D conversion rules (SNORM: max(q / 32767, -1), halves exactly),
+//so it computes what the vertex shader sees.
+//Does not depend on D3D or Windows.
+namespace VertexQuantization {
+	//round to nearest, clamped to [-1, 1]
+	std::int16_t EncodeSNorm16(float v) noexcept;
+	float DecodeSNorm16(std::int16_t v) noexcept;
+	//round to nearest even, out of range values become infinity
+	std::uint16_t EncodeHalf(float v) noexcept;
+	float DecodeHalf(std::uint16_t v) noexcept;
+	//n does not need to be normalized, the decoded vector is
+	void EncodeOctahedral(const rmath::Float3& n, std::int16_t* pEncoded) noexcept;
+	rmath::Float3 DecodeOctahedral(std::int16_t x, std::int16_t y) noexcept;
+	//maps the box onto [-1, 1] on every axis
+	MeshFile::Dequantization MakeDequantization(const MeshFile::Aabb& bounds) noexcept;
+	//copy of mesh with the float attributes above compressed and everything interleaved into one stream,
+	//other attributes are copied as they are
+	MeshOptimizer::Mesh Compress(const MeshOptimizer::Mesh& mesh);
+	//attribute a of count vertices as float4, missing components are 0 (w of a position is 1);
+	//positions are dequantized and a NORMAL stored as SNorm16x2 is unfolded
+	void Decode(const void* pVertices, std::size_t stride, std::size_t count, const MeshFile::Attribute& a,
+		const MeshFile::Dequantization& dequantization, rmath::Float4* pDecoded) noexcept;
+}
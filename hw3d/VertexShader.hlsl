@@ -1,3 +1,5 @@
+#include "VertexDecode.hlsli"
+
 /*struct VSOut {
 	float3 color : COLOR;
 	float4 pos : SV_POSITION;
@@ -14,5 +16,5 @@ float4 main(/*float3 color : COLOR,*/ float3 pos : POSITION /*input semantic*/ )
 																//to create the roation transform
 	//vso.color = color; //set the colorl of struct object
 	//return vso; //return the output object
-	return mul(float4(pos, 1.0f), transform);
+	return mul(float4(DecodePosition(pos), 1.0f), transform);
 }
\ No newline at end of file
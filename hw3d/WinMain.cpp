@@ -2,12 +2,48 @@
 #include "Window.h"
 #include "IncludeWin.h"
 #include "App.h"
+#include <string_view>
+#include <algorithm>
 
+namespace {
+	//--validation=off|light|full picks the graphics validation tier; without it, or with a value it does not
+	//know, the highest tier compiled in
+	Graphics::Validation ParseValidation(const char* pCmdLine) noexcept {
+		constexpr std::string_view option = "--validation=";
+		std::string_view line = pCmdLine ? pCmdLine : "";
+		//whole tokens only, separated by blanks
+		while(!line.empty()) {
+			const std::size_t begin = line.find_first_not_of(" \t");
+			if(begin == std::string_view::npos) {
+				break;
+			}
+			line.remove_prefix(begin);
+			const std::size_t end = std::min(line.find_first_of(" \t"), line.size());
+			const std::string_view token = line.substr(0u, end);
+			line.remove_prefix(end);
+			if(token.substr(0u, option.size()) != option) {
+				continue;
+			}
+			const std::string_view value = token.substr(option.size());
+			if(value == "off") {
+				return Graphics::Validation::Off;
+			}
+			if(value == "light") {
+				return Graphics::Validation::Light;
+			}
+			if(value == "full") {
+				return Graphics::Validation::Full;
+			}
+			break;
+		}
+		return Graphics::maxValidation;
+	}
+}
 
 //User created procedure
 int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
 	try{
-		return App{}.Go();
+		return App{ ParseValidation(lpCmdLine) }.Go();
 	} catch(const UrielException& e){
 		MessageBox(nullptr, e.what(),e.GetType(), MB_OK | MB_ICONEXCLAMATION);
 	} catch(const exception& e) {
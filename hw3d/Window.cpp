@@ -87,7 +87,7 @@ const char* Window::NoGfxException::GetType() const noexcept {
 }
 
 //Window class functions *******************************************
-Window::Window(int width, int height, const char* name) /*noexcept*/ {
+Window::Window(int width, int height, const char* name, Graphics::Validation validation) /*noexcept*/ {
 	//calculate window size based on desired client region(CR) size
 	RECT wr;
 	wr.left = 100;
@@ -116,7 +116,7 @@ Window::Window(int width, int height, const char* name) /*noexcept*/ {
 	ShowWindow(hWnd, SW_SHOWDEFAULT);
 
 	//Create graphics object
-	pGfx = std::make_unique<Graphics>(hWnd);
+	pGfx = std::make_unique<Graphics>(hWnd, validation);
 }
 
 Window::~Window() {
@@ -124,7 +124,11 @@ Window::~Window() {
 }
 
 void Window::SetTitle(const std::string& title) {
-	if(SetWindowText(hWnd, title.c_str()) == 0) {
+	SetTitle(title.c_str());
+}
+
+void Window::SetTitle(const char* title) {
+	if(SetWindowText(hWnd, title) == 0) {
 		throw CHWND_LAST_EXCEPT();
 	}
 }
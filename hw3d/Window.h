@@ -53,12 +53,13 @@ private:
 	};
 
 public:
-	Window(int width, int length, const char* name) /*noexcept*/;
+	Window(int width, int length, const char* name, Graphics::Validation validation = Graphics::maxValidation) /*noexcept*/;
 	~Window();
 	//Copy constuctor and assingment operator can remain public, but must be deleted if public to prevent cloning***********
 	Window(const Window&) = delete; //copy constructor
 	Window& operator=(const Window&) = delete; //copy assingment operator
 	void SetTitle(const std::string& title);
+	void SetTitle(const char* title);
 	static std::optional<int> ProcessMessages();
 	Graphics& Gfx(); //graphics accessor
 
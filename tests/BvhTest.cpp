@@ -0,0 +1,264 @@
+#include "Check.h"
+#include "Bvh.h"
+#include "JobSystem.h"
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	const rmath::Mat4 viewProj = rmath::Translation(0.0f, 0.0f, 20.0f) * rmath::PerspectiveLH(1.0f, 0.75f, 0.5f, 60.0f);
+
+	//the plane test FrustumCull applies to boxes
+	bool OutsideFrustum(const FrustumCull::Frustum& f, const Bvh::Aabb& a) {
+		const float cx = (a.min.x + a.max.x) * 0.5f, cy = (a.min.y + a.max.y) * 0.5f, cz = (a.min.z + a.max.z) * 0.5f;
+		const float ex = (a.max.x - a.min.x) * 0.5f, ey = (a.max.y - a.min.y) * 0.5f, ez = (a.max.z - a.min.z) * 0.5f;
+		for(const auto& p : f.planes) {
+			if(p.a * cx + p.b * cy + p.c * cz + p.d + std::fabs(p.a) * ex + std::fabs(p.b) * ey + std::fabs(p.c) * ez < 0.0f) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//slab test written like the traversal's, so both agree to the last bit; -1 for a miss
+	float EnterBox(const Bvh::Ray& ray, const Bvh::Aabb& a) {
+		const auto inverse = [](float d) { return 1.0f / (d != 0.0f ? d : 1e-30f); };
+		const float ix = inverse(ray.direction.x), iy = inverse(ray.direction.y), iz = inverse(ray.direction.z);
+		const float tx0 = (a.min.x - ray.origin.x) * ix, tx1 = (a.max.x - ray.origin.x) * ix;
+		const float ty0 = (a.min.y - ray.origin.y) * iy, ty1 = (a.max.y - ray.origin.y) * iy;
+		const float tz0 = (a.min.z - ray.origin.z) * iz, tz1 = (a.max.z - ray.origin.z) * iz;
+		const float tNear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.0f));
+		const float tFar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), ray.tMax));
+		return tNear <= tFar ? tNear : -1.0f;
+	}
+
+	//sphere inscribed in the box, for the custom intersection overload; -1 for a miss
+	float EnterSphere(const Bvh::Ray& ray, const Bvh::Aabb& a) {
+		const float cx = (a.min.x + a.max.x) * 0.5f, cy = (a.min.y + a.max.y) * 0.5f, cz = (a.min.z + a.max.z) * 0.5f;
+		const float r = std::min({ a.max.x - a.min.x, a.max.y - a.min.y, a.max.z - a.min.z }) * 0.5f;
+		const float ox = ray.origin.x - cx, oy = ray.origin.y - cy, oz = ray.origin.z - cz;
+		const float dd = ray.direction.x * ray.direction.x + ray.direction.y * ray.direction.y + ray.direction.z * ray.direction.z;
+		const float od = ox * ray.direction.x + oy * ray.direction.y + oz * ray.direction.z;
+		const float oo = ox * ox + oy * oy + oz * oz - r * r;
+		const float disc = od * od - dd * oo;
+		if(disc < 0.0f) {
+			return -1.0f;
+		}
+		const float t = oo <= 0.0f ? 0.0f : (-od - std::sqrt(disc)) / dd;
+		return t >= 0.0f ? t : -1.0f;
+	}
+
+	float& Axis(rmath::Float3& v, int axis) {
+		return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+	}
+
+	std::vector<Bvh::Aabb> RandomBoxes(std::size_t count, unsigned int seed, float world) {
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-world, world);
+		std::uniform_real_distribution<float> size(0.05f, 2.0f);
+		std::vector<Bvh::Aabb> boxes(count);
+		for(auto& box : boxes) {
+			const float x = position(rng), y = position(rng), z = position(rng);
+			box = { { x - size(rng), y - size(rng), z - size(rng) }, { x + size(rng), y + size(rng), z + size(rng) } };
+		}
+		return boxes;
+	}
+
+	std::vector<Bvh::Ray> RandomRays(std::size_t count, unsigned int seed, float world) {
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> position(-world, world);
+		std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+		std::vector<Bvh::Ray> rays(count);
+		for(std::size_t i = 0u; i < count; i++) {
+			rays[i] = { { position(rng), position(rng), position(rng) }, { direction(rng), direction(rng), direction(rng) }, world * 3.0f };
+			//some axis parallel, those run into the slab inverse of a zero component
+			if(i % 7u == 0u) {
+				rays[i].direction = { i % 2u ? 1.0f : -1.0f, 0.0f, 0.0f };
+			}
+		}
+		return rays;
+	}
+
+	//Cull() and both Raycast() overloads against a scan over every box
+	void MatchesBruteForce(const Bvh& bvh, const std::vector<Bvh::Aabb>& boxes, const std::vector<Bvh::Ray>& rays) {
+		CHECK_EQ(bvh.GetPrimitiveCount(), boxes.size());
+		//every object exactly once in leaf order
+		std::vector<std::uint32_t> sorted = bvh.GetPrimitives();
+		std::sort(sorted.begin(), sorted.end());
+		bool permutation = sorted.size() == boxes.size();
+		for(std::size_t i = 0u; permutation && i < sorted.size(); i++) {
+			permutation = sorted[i] == i;
+		}
+		CHECK(permutation);
+
+		for(const auto& vp : { viewProj, rmath::RotationX(1.2f) * viewProj, rmath::Translation(0.0f, 0.0f, -100.0f) * viewProj }) {
+			const auto frustum = FrustumCull::ExtractFrustum(vp);
+			std::vector<Bvh::Range> ranges;
+			const std::size_t total = bvh.Cull(frustum, ranges);
+			std::vector<bool> culled(boxes.size(), true);
+			std::size_t sum = 0u;
+			int duplicates = 0;
+			for(std::size_t r = 0u; r < ranges.size(); r++) {
+				sum += ranges[r].count;
+				//merged, in ascending order
+				if(r > 0u) {
+					CHECK(ranges[r - 1u].first + ranges[r - 1u].count < ranges[r].first);
+				}
+				for(std::uint32_t i = ranges[r].first; i < ranges[r].first + ranges[r].count; i++) {
+					const std::uint32_t object = bvh.GetPrimitives()[i];
+					duplicates += culled[object] ? 0 : 1;
+					culled[object] = false;
+				}
+			}
+			CHECK_EQ(sum, total);
+			CHECK_EQ(duplicates, 0);
+			int wrong = 0;
+			for(std::size_t i = 0u; i < boxes.size(); i++) {
+				wrong += culled[i] == OutsideFrustum(frustum, boxes[i]) ? 0 : 1;
+			}
+			CHECK_EQ(wrong, 0);
+		}
+
+		int wrongBox = 0;
+		int wrongSphere = 0;
+		int hits = 0;
+		for(const auto& ray : rays) {
+			float closest = -1.0f;
+			float closestSphere = -1.0f;
+			for(const auto& box : boxes) {
+				const float t = EnterBox(ray, box);
+				if(t >= 0.0f && (closest < 0.0f || t < closest)) {
+					closest = t;
+				}
+				const float ts = EnterSphere(ray, box);
+				if(ts >= 0.0f && ts <= ray.tMax && (closestSphere < 0.0f || ts < closestSphere)) {
+					closestSphere = ts;
+				}
+			}
+			Bvh::Hit hit = {};
+			const bool found = bvh.Raycast(ray, hit);
+			//ties between objects may resolve either way, the distance and the object's own distance may not
+			if(found != (closest >= 0.0f) || (found && (hit.t != closest || EnterBox(ray, boxes[hit.primitive]) != closest))) {
+				wrongBox++;
+			}
+			hits += found ? 1 : 0;
+			Bvh::Hit sphereHit = {};
+			const bool foundSphere = bvh.Raycast(ray, sphereHit, [&](std::uint32_t primitive, const Bvh::Ray& r, float& t) {
+				const float ts = EnterSphere(r, boxes[primitive]);
+				if(ts >= 0.0f && ts < t) {
+					t = ts;
+					return true;
+				}
+				return false;
+			});
+			if(foundSphere != (closestSphere >= 0.0f) || (foundSphere && sphereHit.t != closestSphere)) {
+				wrongSphere++;
+			}
+		}
+		CHECK_EQ(wrongBox, 0);
+		CHECK_EQ(wrongSphere, 0);
+		if(boxes.size() > 100u) {
+			CHECK(hits > 0);
+		}
+	}
+
+	void RandomScene() {
+		JobSystem jobs(4u);
+		auto boxes = RandomBoxes(3000u, 1u, 40.0f);
+		const auto rays = RandomRays(2000u, 2u, 40.0f);
+		Bvh bvh;
+		bvh.Build(boxes.data(), boxes.size());
+		MatchesBruteForce(bvh, boxes, rays);
+		//moved around locally, the topology stays
+		std::mt19937 rng(3u);
+		std::uniform_real_distribution<float> offset(-3.0f, 3.0f);
+		for(auto& box : boxes) {
+			const float dx = offset(rng), dy = offset(rng), dz = offset(rng);
+			box = { { box.min.x + dx, box.min.y + dy, box.min.z + dz }, { box.max.x + dx, box.max.y + dy, box.max.z + dz } };
+		}
+		bvh.Refit(boxes.data());
+		MatchesBruteForce(bvh, boxes, rays);
+		for(auto& box : boxes) {
+			box.max.y += 1.0f;
+		}
+		bvh.Refit(boxes.data(), &jobs);
+		MatchesBruteForce(bvh, boxes, rays);
+		//the job system build, big enough that subtrees and binning passes become jobs
+		const auto many = RandomBoxes(60000u, 4u, 150.0f);
+		Bvh parallel;
+		parallel.Build(many.data(), many.size(), &jobs);
+		MatchesBruteForce(parallel, many, RandomRays(200u, 5u, 150.0f));
+		//a second build reuses the node storage
+		parallel.Build(boxes.data(), boxes.size(), &jobs);
+		MatchesBruteForce(parallel, boxes, rays);
+	}
+
+	void DegenerateInputs() {
+		JobSystem jobs(2u);
+		//nothing at all
+		Bvh empty;
+		empty.Build(nullptr, 0u);
+		std::vector<Bvh::Range> ranges;
+		CHECK_EQ(empty.Cull(FrustumCull::ExtractFrustum(viewProj), ranges), 0u);
+		Bvh::Hit hit;
+		CHECK(!empty.Raycast({ { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, 100.0f }, hit));
+
+		//one object
+		const std::vector<Bvh::Aabb> one = { { { -1.0f, -1.0f, 4.0f }, { 1.0f, 1.0f, 6.0f } } };
+		Bvh single;
+		single.Build(one.data(), one.size());
+		MatchesBruteForce(single, one, RandomRays(500u, 6u, 8.0f));
+
+		//every centroid in the same spot, the binning has nothing to split on
+		std::vector<Bvh::Aabb> stacked(700u);
+		for(std::size_t i = 0u; i < stacked.size(); i++) {
+			const float s = 0.01f + float(i % 37u) * 0.1f;
+			stacked[i] = { { 2.0f - s, 1.0f - s * 0.5f, 3.0f - s }, { 2.0f + s, 1.0f + s * 0.5f, 3.0f + s } };
+		}
+		Bvh coincident;
+		coincident.Build(stacked.data(), stacked.size(), &jobs);
+		MatchesBruteForce(coincident, stacked, RandomRays(300u, 7u, 10.0f));
+
+		//three chains of objects running away from the origin along x, y and z, each one twice as far out as
+		//the one before: the binned heuristic can only peel the few outermost objects of one chain per level,
+		//so the tree wants to be far deeper than maxDepth
+		std::vector<Bvh::Aabb> chain;
+		std::vector<Bvh::Ray> deepRays;
+		for(int axis = 0; axis < 3; axis++) {
+			for(int e = -60; e <= 55; e++) {
+				const float c = std::ldexp(1.0f, e);
+				const float h = c * 0.25f;
+				rmath::Float3 min = { -h, -h, -h };
+				rmath::Float3 max = { h, h, h };
+				Axis(min, axis) = c - h;
+				Axis(max, axis) = c + h;
+				chain.push_back({ min, max });
+			}
+			//rays down each chain from beyond its far end, and across it
+			for(int e = -58; e <= 54; e += 4) {
+				rmath::Float3 origin = { 0.0f, 0.0f, 0.0f };
+				rmath::Float3 direction = { 0.0f, 0.0f, 0.0f };
+				Axis(origin, axis) = std::ldexp(1.0f, 57);
+				Axis(direction, axis) = -1.0f;
+				deepRays.push_back({ origin, direction, 1e38f });
+				origin = { std::ldexp(1.0f, e), std::ldexp(1.0f, e), std::ldexp(1.0f, e) };
+				Axis(origin, axis) *= 1.1f;
+				direction = { -1.0f, -1.0f, -1.0f };
+				deepRays.push_back({ origin, direction, 1e38f });
+			}
+		}
+		Bvh deep;
+		deep.Build(chain.data(), chain.size());
+		MatchesBruteForce(deep, chain, deepRays);
+		Bvh deepParallel;
+		deepParallel.Build(chain.data(), chain.size(), &jobs);
+		MatchesBruteForce(deepParallel, chain, deepRays);
+	}
+}
+
+int main() {
+	RandomScene();
+	DegenerateInputs();
+	return Check::Report("BvhTest");
+}
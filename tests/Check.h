@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdio>
+
+//Minimal test support, every test is an executable that returns the number of failed checks.
+//CHECK keeps going after a failure so one run reports everything that is wrong.
+namespace Check {
+	inline int failures = 0;
+	inline int Report(const char* name) {
+		if(failures == 0) {
+			std::printf("%s: passed\n", name);
+		} else {
+			std::printf("%s: %d check(s) failed\n", name, failures);
+		}
+		return failures;
+	}
+}
+
+#define CHECK(expr) do { if(!(expr)) { std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #expr); Check::failures++; } } while(0)
+#define CHECK_EQ(a,b) do { const auto check_a_ = (a); const auto check_b_ = (b); if(!(check_a_ == check_b_)) { std::printf("%s(%d): CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, (long long)check_a_, (long long)check_b_); Check::failures++; } } while(0)
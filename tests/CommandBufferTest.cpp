@@ -0,0 +1,180 @@
+#include "Check.h"
+#include "CommandBuffer.h"
+#include <vector>
+#include <random>
+#include <cstring>
+
+namespace {
+	//counts like CountingBackend and also remembers what every draw saw bound
+	class RecordingBackend : public CountingBackend {
+	public:
+		struct Draw {
+			ResourceId vertexShader;
+			ResourceId vertexBuffer;
+			std::uint32_t indexCount;
+			float constant; //first float of the VS constants, or -1
+		};
+	public:
+		void SetVertexShader(ResourceId id) override {
+			CountingBackend::SetVertexShader(id);
+			vertexShader = id;
+		}
+		void SetVertexBuffer(ResourceId id, std::uint32_t stride) override {
+			CountingBackend::SetVertexBuffer(id, stride);
+			vertexBuffer = id;
+		}
+		void SetVSConstants(const void* pData, std::size_t size) override {
+			CountingBackend::SetVSConstants(pData, size);
+			std::memcpy(&constant, pData, sizeof(constant));
+		}
+		void DrawIndexed(std::uint32_t indexCount, std::uint32_t instanceCount, std::uint32_t startIndex, std::int32_t baseVertex) override {
+			CountingBackend::DrawIndexed(indexCount, instanceCount, startIndex, baseVertex);
+			draws.push_back({ vertexShader, vertexBuffer, indexCount, constant });
+			constant = -1.0f;
+		}
+	public:
+		std::vector<Draw> draws;
+	private:
+		ResourceId vertexShader = NoResource;
+		ResourceId vertexBuffer = NoResource;
+		float constant = -1.0f;
+	};
+
+	CommandBuffer::DrawCommand MakeDraw(CommandBuffer& buffer, CommandBackend::ResourceId vertexShader,
+		CommandBackend::ResourceId vertexBuffer, float depth, std::uint32_t indexCount)
+	{
+		CommandBuffer::DrawCommand cmd = {};
+		cmd.vertexShader = vertexShader;
+		cmd.pixelShader = 0u;
+		cmd.inputLayout = 0u;
+		cmd.vertexBuffer = vertexBuffer;
+		cmd.indexBuffer = vertexBuffer;
+		cmd.psConstantBuffer = 0u;
+		cmd.vsConstantBuffer = CommandBackend::NoResource;
+		cmd.vertexStride = 12u;
+		cmd.indexSize = 2u;
+		cmd.indexCount = indexCount;
+		cmd.instanceCount = 1u;
+		cmd.vsConstantsOffset = buffer.AddPayload(&depth, sizeof(depth));
+		cmd.vsConstantsSize = sizeof(depth);
+		cmd.key = CommandBuffer::MakeKey(0u, vertexShader, 0u, 0u, vertexBuffer, depth);
+		return cmd;
+	}
+
+	void ReplayKeepsRecordingOrderWithoutSort() {
+		CommandBuffer buffer;
+		const float depths[] = { 0.9f, 0.1f, 0.5f };
+		for(std::uint32_t i = 0u; i < 3u; i++) {
+			buffer.Record(MakeDraw(buffer, 2u - i, i, depths[i], 3u * (i + 1u)));
+		}
+		RecordingBackend backend;
+		buffer.Submit(backend);
+		CHECK_EQ(backend.draws.size(), 3u);
+		for(std::uint32_t i = 0u; i < 3u; i++) {
+			CHECK_EQ(backend.draws[i].indexCount, 3u * (i + 1u));
+			//payload travels with its command
+			CHECK(backend.draws[i].constant == depths[i]);
+		}
+	}
+
+	void SortGroupsStateThenDepth() {
+		CommandBuffer buffer;
+		std::mt19937 rng(3u);
+		std::uniform_int_distribution<std::uint32_t> shader(0u, 2u);
+		std::uniform_int_distribution<std::uint32_t> geometry(0u, 3u);
+		std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+		constexpr std::size_t count = 1000u;
+		for(std::size_t i = 0u; i < count; i++) {
+			buffer.Record(MakeDraw(buffer, shader(rng), geometry(rng), depth(rng), 36u));
+		}
+		RecordingBackend unsorted;
+		buffer.Submit(unsorted);
+		buffer.Sort();
+		RecordingBackend sorted;
+		buffer.Submit(sorted);
+		CHECK_EQ(sorted.draws.size(), count);
+		std::size_t outOfOrder = 0u;
+		for(std::size_t i = 1u; i < count; i++) {
+			const auto& a = sorted.draws[i - 1u];
+			const auto& b = sorted.draws[i];
+			if(a.vertexShader != b.vertexShader) {
+				outOfOrder += a.vertexShader > b.vertexShader ? 1u : 0u;
+			} else if(a.vertexBuffer != b.vertexBuffer) {
+				outOfOrder += a.vertexBuffer > b.vertexBuffer ? 1u : 0u;
+			} else {
+				//front to back within a group, the payload depth came along with the command
+				outOfOrder += a.constant > b.constant ? 1u : 0u;
+			}
+		}
+		CHECK_EQ(outOfOrder, 0u);
+		for(std::size_t i = 1u; i < buffer.Size(); i++) {
+			CHECK(buffer[i - 1u].key <= buffer[i].key);
+		}
+		//same draws, same state calls, far fewer of them change anything
+		const auto& before = unsorted.GetCounts();
+		const auto& after = sorted.GetCounts();
+		CHECK_EQ(after.draws, before.draws);
+		CHECK_EQ(after.stateCalls, before.stateCalls);
+		CHECK_EQ(after.constantUploads, count);
+		//three vertex shaders and the one pixel shader, each bound once
+		CHECK_EQ(after.shaderChanges, 4u);
+		CHECK(after.stateChanges < before.stateChanges / 10u);
+	}
+
+	void SortIsStableForEqualKeys() {
+		CommandBuffer buffer;
+		for(std::uint32_t i = 0u; i < 100u; i++) {
+			auto cmd = MakeDraw(buffer, i % 2u, 0u, 0.5f, i + 1u);
+			buffer.Record(cmd);
+		}
+		buffer.Sort();
+		RecordingBackend backend;
+		buffer.Submit(backend);
+		for(std::size_t i = 1u; i < backend.draws.size(); i++) {
+			const auto& a = backend.draws[i - 1u];
+			const auto& b = backend.draws[i];
+			CHECK(a.vertexShader < b.vertexShader || (a.vertexShader == b.vertexShader && a.indexCount < b.indexCount));
+		}
+	}
+
+	void ResetKeepsNothing() {
+		CommandBuffer buffer;
+		buffer.Record(MakeDraw(buffer, 0u, 0u, 0.5f, 3u));
+		buffer.Reset();
+		CHECK(buffer.Empty());
+		NullBackend null;
+		buffer.Sort();
+		buffer.Submit(null);
+		CountingBackend counting;
+		buffer.Submit(counting);
+		CHECK_EQ(counting.GetCounts().draws, 0u);
+		//reused after a reset, payload offsets start over
+		const auto cmd = MakeDraw(buffer, 0u, 0u, 0.25f, 3u);
+		CHECK_EQ(cmd.vsConstantsOffset, 0u);
+		buffer.Record(cmd);
+		buffer.Submit(counting);
+		CHECK_EQ(counting.GetCounts().draws, 1u);
+		counting.Reset();
+		CHECK_EQ(counting.GetCounts().draws, 0u);
+	}
+
+	void KeyLayout() {
+		//layer beats everything, depth only breaks ties
+		CHECK(CommandBuffer::MakeKey(1u, 0u, 0u, 0u, 0u, 0.0f) > CommandBuffer::MakeKey(0u, 1023u, 1023u, 255u, 1023u, 1.0f));
+		CHECK(CommandBuffer::MakeKey(0u, 1u, 0u, 0u, 0u, 0.0f) > CommandBuffer::MakeKey(0u, 0u, 1u, 0u, 0u, 1.0f));
+		CHECK(CommandBuffer::MakeKey(0u, 0u, 0u, 0u, 1u, 0.0f) > CommandBuffer::MakeKey(0u, 0u, 0u, 0u, 0u, 1.0f));
+		CHECK(CommandBuffer::MakeKey(0u, 0u, 0u, 0u, 0u, 0.5f) > CommandBuffer::MakeKey(0u, 0u, 0u, 0u, 0u, 0.25f));
+		//out of range depth is clamped instead of spilling into the geometry bits
+		CHECK_EQ(CommandBuffer::MakeKey(0u, 0u, 0u, 0u, 0u, 2.0f), CommandBuffer::MakeKey(0u, 0u, 0u, 0u, 0u, 1.0f));
+		CHECK_EQ(CommandBuffer::MakeKey(0u, 0u, 0u, 0u, 0u, -1.0f), 0u);
+	}
+}
+
+int main() {
+	ReplayKeepsRecordingOrderWithoutSort();
+	SortGroupsStateThenDepth();
+	SortIsStableForEqualKeys();
+	ResetKeepsNothing();
+	KeyLayout();
+	return Check::Report("CommandBufferTest");
+}
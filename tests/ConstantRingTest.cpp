@@ -0,0 +1,125 @@
+#include "Check.h"
+#include "ConstantRing.h"
+#include <vector>
+#include <cstring>
+
+namespace {
+	//stands in for the dynamic constant buffer, Map(DISCARD) hands out a fresh copy like a renamed D3D buffer
+	struct FakeBacking {
+		std::vector<char> memory;
+		std::vector<ConstantRing::MapMode> maps;
+		int renames = 0;
+		bool mapped = false;
+		explicit FakeBacking(std::size_t size)
+			: memory(size, 0)
+		{}
+		void* Map(ConstantRing::MapMode mode) {
+			CHECK(!mapped);
+			mapped = true;
+			maps.push_back(mode);
+			if(mode == ConstantRing::MapMode::Discard) {
+				renames++;
+				std::fill(memory.begin(), memory.end(), char(0xCD));
+			}
+			return memory.data();
+		}
+		void Unmap() {
+			CHECK(mapped);
+			mapped = false;
+		}
+	};
+
+	void AllocationsAreAligned() {
+		ConstantRing ring(4096u);
+		for(std::size_t size : { 1u, 64u, 255u, 256u, 257u, 100u }) {
+			const auto alloc = ring.Allocate(size);
+			CHECK_EQ(alloc.offset % 256u, 0u);
+			CHECK_EQ(alloc.size % 256u, 0u);
+			CHECK(alloc.size >= size && alloc.size < size + 256u);
+		}
+		CHECK_EQ(ring.GetFrameBytes(), 256u + 256u + 256u + 256u + 512u + 256u);
+		ConstantRing small(1024u, 16u);
+		CHECK_EQ(small.Allocate(20u).size, 32u);
+		CHECK_EQ(small.Allocate(20u).offset, 32u);
+	}
+
+	void DiscardOnlyWhenRequired() {
+		ConstantRing ring(1024u);
+		//first allocation of the frame discards, the rest append behind it
+		CHECK(ring.Allocate(64u).mode == ConstantRing::MapMode::Discard);
+		auto alloc = ring.Allocate(64u);
+		CHECK(alloc.mode == ConstantRing::MapMode::NoOverwrite);
+		CHECK_EQ(alloc.offset, 256u);
+		CHECK(ring.Allocate(64u).mode == ConstantRing::MapMode::NoOverwrite);
+		CHECK(ring.Allocate(64u).mode == ConstantRing::MapMode::NoOverwrite);
+		//full, wraps to the front with DISCARD
+		alloc = ring.Allocate(64u);
+		CHECK(alloc.mode == ConstantRing::MapMode::Discard);
+		CHECK_EQ(alloc.offset, 0u);
+		alloc = ring.Allocate(512u);
+		CHECK(alloc.mode == ConstantRing::MapMode::NoOverwrite);
+		CHECK_EQ(alloc.offset, 256u);
+		//512 more bytes do not fit behind offset 768
+		alloc = ring.Allocate(512u);
+		CHECK(alloc.mode == ConstantRing::MapMode::Discard);
+		CHECK_EQ(alloc.offset, 0u);
+		//a new frame discards even with room left
+		ring.NextFrame();
+		CHECK_EQ(ring.GetFrameBytes(), 0u);
+		CHECK(ring.Allocate(16u).mode == ConstantRing::MapMode::Discard);
+		CHECK_EQ(ring.GetAllocationCount(), 8u);
+		CHECK_EQ(ring.GetDiscardCount(), 4u);
+		//a resize discards as well
+		ring.Resize(2048u);
+		CHECK(ring.Allocate(16u).mode == ConstantRing::MapMode::Discard);
+	}
+
+	void OversizedAllocationThrows() {
+		ConstantRing ring(1024u);
+		bool threw = false;
+		try {
+			ring.Allocate(1025u);
+		} catch(const ConstantRing::Exception&) {
+			threw = true;
+		}
+		CHECK(threw);
+		CHECK_EQ(ring.GetAllocationCount(), 0u);
+		CHECK_EQ(ring.Allocate(1024u).size, 1024u);
+	}
+
+	void UploadWritesThroughBacking() {
+		ConstantRing ring(1024u);
+		FakeBacking backing(1024u);
+		//three frames of five 64 byte transforms each, the fifth wraps within the frame
+		for(int frame = 0; frame < 3; frame++) {
+			ring.NextFrame();
+			const int renamesBefore = backing.renames;
+			for(int draw = 0; draw < 5; draw++) {
+				float transform[16];
+				for(int i = 0; i < 16; i++) {
+					transform[i] = float(frame * 100 + draw * 16 + i);
+				}
+				const auto alloc = ring.Upload(backing, transform, sizeof(transform));
+				CHECK(!backing.mapped);
+				CHECK(alloc.mode == backing.maps.back());
+				CHECK(std::memcmp(backing.memory.data() + alloc.offset, transform, sizeof(transform)) == 0);
+				//NO_OVERWRITE must leave earlier draws of the frame intact
+				if(alloc.mode == ConstantRing::MapMode::NoOverwrite) {
+					float previous[16];
+					std::memcpy(previous, backing.memory.data() + alloc.offset - 256u, sizeof(previous));
+					CHECK(previous[0] == float(frame * 100 + (draw - 1) * 16));
+				}
+			}
+			CHECK_EQ(backing.renames - renamesBefore, 2);
+		}
+		CHECK_EQ(backing.maps.size(), 15u);
+	}
+}
+
+int main() {
+	AllocationsAreAligned();
+	DiscardOnlyWhenRequired();
+	OversizedAllocationThrows();
+	UploadWritesThroughBacking();
+	return Check::Report("ConstantRingTest");
+}
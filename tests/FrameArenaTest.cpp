@@ -0,0 +1,317 @@
+#include "Check.h"
+#include "FrameArena.h"
+#include "FrustumCull.h"
+#include "JobSystem.h"
+#include "TransformBatch.h"
+#include "OcclusionCuller.h"
+#include "MeshFile.h"
+#include "Profiler.h"
+#include "TestCube.h"
+#include <atomic>
+#include <barrier>
+#include <thread>
+#include <vector>
+#include <random>
+#include <iterator>
+#include <algorithm>
+#include <numeric>
+#include <new>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+
+//every heap allocation of the process goes through here, so a frame that touches the heap shows up
+namespace {
+	std::atomic<std::size_t> heapAllocations = 0u;
+}
+
+void* operator new(std::size_t size) {
+	heapAllocations.fetch_add(1u, std::memory_order_relaxed);
+	if(void* p = std::malloc(size ? size : 1u)) {
+		return p;
+	}
+	throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	heapAllocations.fetch_add(1u, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1u);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+	return operator new(size, tag);
+}
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+void operator delete[](void* p) noexcept {
+	std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+void operator delete[](void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+namespace {
+	void AlignmentAndVectors() {
+		FrameArena arena(4096u);
+		const auto* pChars = arena.Allocate<char>(3u);
+		const auto* pDoubles = arena.Allocate<double>(5u);
+		const void* pAligned = arena.Allocate(100u, 256u);
+		CHECK(reinterpret_cast<std::uintptr_t>(pDoubles) % alignof(double) == 0u);
+		CHECK(reinterpret_cast<std::uintptr_t>(pAligned) % 256u == 0u);
+		CHECK(reinterpret_cast<const char*>(pDoubles) >= pChars + 3);
+		//more than the first block, the sub-arena chains another one
+		FrameVector<int> values{ FrameAllocator<int>(arena) };
+		values.reserve(10000u);
+		for(int i = 0; i < 10000; i++) {
+			values.push_back(i);
+		}
+		long long sum = 0;
+		for(const int v : values) {
+			sum += v;
+		}
+		CHECK_EQ(sum, 10000ll * 9999ll / 2ll);
+		const auto stats = arena.GetStats();
+		CHECK_EQ(stats.threads, 1u);
+		CHECK(stats.bytes >= 3u + 5u * sizeof(double) + 100u + 10000u * sizeof(int));
+		CHECK(stats.blockAllocations >= 2u);
+		//the chain becomes one block of the same size, the next frame of the same size needs nothing new
+		arena.Reset();
+		CHECK_EQ(arena.GetStats().capacity, stats.capacity);
+		CHECK_EQ(arena.GetStats().bytes, 0u);
+		values = FrameVector<int>{ FrameAllocator<int>(arena) };
+		values.reserve(10000u);
+		CHECK_EQ(arena.GetStats().blockAllocations, 0u);
+	}
+
+	//four threads and the main thread run frames in lockstep, every thread drawing scratch of its own changing
+	//size while the main thread fills a FrameVector, then the main thread resets the arena. Once every thread
+	//has been through its largest frame nothing in a frame may touch the heap. Threads are used instead of
+	//JobSystem workers because how much work a worker steals changes from run to run.
+	void SteadyStateFramesDoNotAllocate() {
+		FrameArena arena(4096u);
+		constexpr std::uint32_t threadCount = 4u;
+		constexpr std::uint32_t frames = 60u;
+		constexpr std::uint32_t warmFrames = 10u;
+		std::barrier sync(threadCount + 1u);
+		std::atomic<std::size_t> wrong = 0u;
+		std::vector<std::thread> threads;
+		for(std::uint32_t t = 0u; t < threadCount; t++) {
+			threads.emplace_back([&arena, &sync, &wrong, t] {
+				for(std::uint32_t frame = 0u; frame < frames; frame++) {
+					const std::uint32_t size = 100u * (1u + (frame + t) % 5u);
+					for(std::uint32_t i = 0u; i < 20u; i++) {
+						float* pScratch = arena.Allocate<float>(size);
+						for(std::uint32_t k = 0u; k < size; k++) {
+							pScratch[k] = float(frame + k);
+						}
+						for(std::uint32_t k = 0u; k < size; k++) {
+							wrong.fetch_add(pScratch[k] == float(frame + k) ? 0u : 1u, std::memory_order_relaxed);
+						}
+					}
+					//frame done, then wait for the reset
+					sync.arrive_and_wait();
+					sync.arrive_and_wait();
+				}
+			});
+		}
+		std::size_t warmAllocations = 0u;
+		for(std::uint32_t frame = 0u; frame < frames; frame++) {
+			const std::size_t before = heapAllocations.load();
+			FrameVector<std::uint32_t> visible{ FrameAllocator<std::uint32_t>(arena) };
+			visible.reserve(5000u * (1u + frame % 3u));
+			for(std::uint32_t i = 0u; i < visible.capacity(); i++) {
+				visible.push_back(i);
+			}
+			sync.arrive_and_wait();
+			CHECK_EQ(arena.GetStats().threads, threadCount + 1u);
+			arena.Reset();
+			warmAllocations += frame >= warmFrames ? heapAllocations.load() - before : 0u;
+			sync.arrive_and_wait();
+		}
+		for(auto& thread : threads) {
+			thread.join();
+		}
+		CHECK_EQ(wrong.load(), 0u);
+		CHECK_EQ(warmAllocations, 0u);
+	}
+
+	//App::DoFrame() without the window and the D3D calls: FrustumCull::CullParallel with the frame arena, the
+	//survivors gathered into kept vectors, TransformBatch through JobSystem::ParallelFor straight into the
+	//instances, the nearest cubes rasterized by OcclusionCuller and the rest culled against them, lod selection
+	//and the Profiler stats polled into a kept vector for the title. The camera cycles through five positions so
+	//the visible counts change; once every vector has seen its largest frame nothing may touch the heap.
+	void PortableFramePathDoesNotAllocate() {
+		struct Instance {
+			rmath::Mat4 transform;
+			float color[4];
+		};
+		constexpr std::size_t cubeCount = 4000u;
+		constexpr std::size_t maxOccluders = 16u;
+		constexpr std::uint32_t frames = 40u;
+		constexpr std::uint32_t warmFrames = 10u;
+		const MeshFile::Lod lods[] = { { 0u, 36u, 0.0f }, { 36u, 24u, 0.01f }, { 60u, 12u, 0.05f } };
+		const float lodScale = MeshFile::GetLodScale(TestCube::projHeight, TestCube::nearZ, 600.0f);
+
+		std::mt19937 rng(5u);
+		std::uniform_real_distribution<float> lateral(-6.0f, 6.0f);
+		std::uniform_real_distribution<float> depth(2.0f, 12.0f);
+		std::uniform_real_distribution<float> turn(-3.0f, 3.0f);
+		std::vector<float> angle(cubeCount), x(cubeCount), y(cubeCount), z(cubeCount), radius(cubeCount, 1.7320508f);
+		for(std::size_t i = 0u; i < cubeCount; i++) {
+			angle[i] = turn(rng);
+			x[i] = lateral(rng);
+			y[i] = lateral(rng);
+			z[i] = depth(rng);
+		}
+
+		JobSystem jobs(3u);
+		FrameArena arena(4096u);
+		OcclusionCuller occlusion;
+		std::vector<std::uint32_t> visible, occluders, cubeLods, lodStarts;
+		std::vector<float> drawnAngle, drawnX, drawnY, drawnZ, drawnRadius;
+		std::vector<Instance> cubes, byLod;
+		std::vector<Profiler::ScopeStats> frameStats;
+		std::size_t warmAllocations = 0u;
+		std::size_t drawnTotal = 0u;
+		std::size_t occludedTotal = 0u;
+		for(std::uint32_t frame = 0u; frame < frames; frame++) {
+			const std::size_t before = heapAllocations.load();
+			const auto viewProj = rmath::Translation(float(frame % 5u) - 2.0f, 0.0f, 0.5f * float(frame % 5u))
+				* rmath::PerspectiveLH(TestCube::projWidth, TestCube::projHeight, TestCube::nearZ, TestCube::farZ);
+			const auto frustum = FrustumCull::ExtractFrustum(viewProj);
+			std::size_t visibleCount;
+			{
+				PROFILE_SCOPE("Frame");
+				{
+					PROFILE_SCOPE("FrustumCull");
+					const FrustumCull::Spheres bounds = { x.data(), y.data(), z.data(), radius.data(), cubeCount };
+					visible.resize(cubeCount);
+					//chunks smaller than the default so this scene takes the arena path
+					visibleCount = FrustumCull::CullParallel(jobs, frustum, bounds, visible.data(), 512u, &arena);
+					drawnAngle.resize(visibleCount);
+					drawnX.resize(visibleCount);
+					drawnY.resize(visibleCount);
+					drawnZ.resize(visibleCount);
+					drawnRadius.resize(visibleCount);
+					for(std::size_t i = 0u; i < visibleCount; i++) {
+						const std::uint32_t j = visible[i];
+						drawnAngle[i] = angle[j];
+						drawnX[i] = x[j];
+						drawnY[i] = y[j];
+						drawnZ[i] = z[j];
+						drawnRadius[i] = radius[j];
+					}
+				}
+				{
+					PROFILE_SCOPE("TransformBatch");
+					cubes.resize(visibleCount);
+					jobs.ParallelFor(visibleCount, 256u, [&](std::size_t begin, std::size_t end) {
+						const TransformBatch::Input batch = { &drawnAngle[begin], &drawnX[begin], &drawnY[begin], &drawnZ[begin], end - begin };
+						TransformBatch::Build(batch, viewProj, &cubes[begin].transform, sizeof(Instance));
+					});
+				}
+				{
+					PROFILE_SCOPE("OcclusionCull");
+					occlusion.BeginFrame(viewProj);
+					occluders.resize(visibleCount);
+					std::iota(occluders.begin(), occluders.end(), 0u);
+					const std::size_t occluderCount = std::min(visibleCount, maxOccluders);
+					std::partial_sort(occluders.begin(), occluders.begin() + occluderCount, occluders.end(), [&](std::uint32_t a, std::uint32_t b) {
+						return drawnZ[a] < drawnZ[b];
+					});
+					for(std::size_t i = 0u; i < occluderCount; i++) {
+						occlusion.AddOccluder(TestCube::vertices, sizeof(TestCube::Vertex), std::size(TestCube::vertices),
+							TestCube::indices, std::size(TestCube::indices), cubes[occluders[i]].transform);
+					}
+					const FrustumCull::Spheres bounds = { drawnX.data(), drawnY.data(), drawnZ.data(), drawnRadius.data(), visibleCount };
+					const std::size_t survivors = occlusion.Cull(bounds, visible.data());
+					occludedTotal += visibleCount - survivors;
+					visibleCount = survivors;
+					for(std::size_t i = 0u; i < visibleCount; i++) {
+						cubes[i] = cubes[visible[i]];
+					}
+				}
+				{
+					PROFILE_SCOPE("SelectLods");
+					cubeLods.resize(visibleCount);
+					lodStarts.assign(std::size(lods) + 1u, 0u);
+					for(std::size_t i = 0u; i < visibleCount; i++) {
+						const std::uint32_t j = visible[i];
+						cubeLods[i] = std::uint32_t(MeshFile::SelectLod(lods, std::size(lods), drawnZ[j] - drawnRadius[j], lodScale));
+						lodStarts[cubeLods[i] + 1u]++;
+					}
+					std::partial_sum(lodStarts.begin(), lodStarts.end(), lodStarts.begin());
+					byLod.resize(visibleCount);
+					for(std::size_t i = 0u; i < visibleCount; i++) {
+						byLod[lodStarts[cubeLods[i]]++] = cubes[i];
+					}
+				}
+			}
+			Profiler::EndFrame();
+			Profiler::GetStats(frameStats);
+			char title[256];
+			std::snprintf(title, sizeof(title), "%zu scopes, %zu cubes", frameStats.size(), visibleCount);
+			drawnTotal += visibleCount;
+			arena.Reset();
+			warmAllocations += frame >= warmFrames ? heapAllocations.load() - before : 0u;
+		}
+		//the path did real work: cubes survived both culls and the occluders hid some
+		CHECK(drawnTotal > frames * 100u);
+		CHECK(occludedTotal > 0u);
+		CHECK(!frameStats.empty());
+		CHECK_EQ(warmAllocations, 0u);
+	}
+
+	//every thread gets their own sub-arena, the memory they get never overlaps
+	void ThreadsGetTheirOwnSubArenas() {
+		FrameArena arena(1024u);
+		constexpr std::uint32_t threadCount = 4u;
+		for(int frame = 0; frame < 6; frame++) {
+			std::vector<std::vector<std::uint32_t*>> allocations(threadCount);
+			std::vector<std::thread> threads;
+			for(std::uint32_t t = 0u; t < threadCount; t++) {
+				threads.emplace_back([&arena, &allocations, t] {
+					for(std::uint32_t i = 0u; i < 200u; i++) {
+						const std::uint32_t size = 50u + t * 10u;
+						std::uint32_t* p = arena.Allocate<std::uint32_t>(size);
+						for(std::uint32_t k = 0u; k < size; k++) {
+							p[k] = (t << 24u) | (i << 12u) | k;
+						}
+						allocations[t].push_back(p);
+					}
+				});
+			}
+			for(auto& thread : threads) {
+				thread.join();
+			}
+			//checked after every thread is done, a block shared by two of them would have been overwritten
+			std::size_t wrong = 0u;
+			for(std::uint32_t t = 0u; t < threadCount; t++) {
+				for(std::uint32_t i = 0u; i < 200u; i++) {
+					for(std::uint32_t k = 0u; k < 50u + t * 10u; k++) {
+						wrong += allocations[t][i][k] == ((t << 24u) | (i << 12u) | k) ? 0u : 1u;
+					}
+				}
+			}
+			CHECK_EQ(wrong, 0u);
+			const auto stats = arena.GetStats();
+			CHECK(stats.threads >= threadCount);
+			CHECK(stats.bytes >= 200u * (4u * 50u + 60u) * sizeof(std::uint32_t));
+			arena.Reset();
+		}
+	}
+}
+
+int main() {
+	AlignmentAndVectors();
+	SteadyStateFramesDoNotAllocate();
+	ThreadsGetTheirOwnSubArenas();
+	PortableFramePathDoesNotAllocate();
+	return Check::Report("FrameArenaTest");
+}
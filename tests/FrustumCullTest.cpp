@@ -0,0 +1,132 @@
+#include "Check.h"
+#include "FrustumCull.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	//a camera a little off the origin looking down +z, so no plane passes through the world origin
+	const rmath::Mat4 viewProj = rmath::Translation(-1.5f, 0.5f, 2.0f) * rmath::RotationZ(0.3f)
+		* rmath::PerspectiveLH(1.0f, 0.75f, 0.5f, 40.0f);
+
+	//structure of arrays scene, boxes and spheres share the centers
+	struct Scene {
+		std::vector<float> x, y, z, radius, ex, ey, ez;
+		explicit Scene(std::size_t count) {
+			std::mt19937 rng(unsigned(count) * 7u + 1u);
+			std::uniform_real_distribution<float> lateral(-30.0f, 30.0f);
+			std::uniform_real_distribution<float> depth(-10.0f, 50.0f);
+			std::uniform_real_distribution<float> size(0.0f, 3.0f);
+			for(std::size_t i = 0u; i < count; i++) {
+				x.push_back(lateral(rng));
+				y.push_back(lateral(rng));
+				z.push_back(depth(rng));
+				radius.push_back(size(rng));
+				ex.push_back(size(rng));
+				ey.push_back(size(rng));
+				ez.push_back(size(rng));
+			}
+		}
+		FrustumCull::Spheres Spheres() const {
+			return { x.data(), y.data(), z.data(), radius.data(), x.size() };
+		}
+		FrustumCull::Boxes Boxes() const {
+			return { x.data(), y.data(), z.data(), ex.data(), ey.data(), ez.data(), x.size() };
+		}
+	};
+
+	template<typename Volumes, typename F>
+	std::vector<std::uint32_t> Visible(const Volumes& volumes, F&& cull) {
+		//one sentinel past the end, nothing may write beyond count
+		std::vector<std::uint32_t> visible(volumes.count + 1u, 0xFFFFFFFFu);
+		const std::size_t n = cull(visible.data());
+		CHECK(n <= volumes.count);
+		CHECK_EQ(visible[volumes.count], 0xFFFFFFFFu);
+		visible.resize(std::min(n, volumes.count));
+		return visible;
+	}
+
+	//clip space test of a point, margin keeps it away from the planes
+	bool InsideClip(float x, float y, float z, float margin) {
+		const auto c = rmath::TransformPoint({ x, y, z }, viewProj);
+		return c.w > 0.0f && std::abs(c.x) < c.w * (1.0f - margin) && std::abs(c.y) < c.w * (1.0f - margin)
+			&& c.z > c.w * margin && c.z < c.w * (1.0f - margin);
+	}
+	bool OutsideClip(float x, float y, float z, float margin) {
+		const auto c = rmath::TransformPoint({ x, y, z }, viewProj);
+		return c.w <= 0.0f || std::abs(c.x) > c.w * (1.0f + margin) || std::abs(c.y) > c.w * (1.0f + margin)
+			|| c.z < -c.w * margin || c.z > c.w * (1.0f + margin);
+	}
+
+	template<typename Volumes>
+	void AllPathsAgree(const FrustumCull::Frustum& frustum, const Volumes& volumes, JobSystem& jobs, FrameArena& arena) {
+		const auto reference = Visible(volumes, [&](std::uint32_t* p) { return FrustumCull::CullScalar(frustum, volumes, p); });
+		CHECK(std::is_sorted(reference.begin(), reference.end()));
+		CHECK(Visible(volumes, [&](std::uint32_t* p) { return FrustumCull::Cull(frustum, volumes, p); }) == reference);
+		for(std::size_t chunk : { std::size_t(1u), std::size_t(7u), std::size_t(13u), std::size_t(1000u), FrustumCull::defaultChunkSize }) {
+			CHECK(Visible(volumes, [&](std::uint32_t* p) { return FrustumCull::CullParallel(jobs, frustum, volumes, p, chunk); }) == reference);
+			CHECK(Visible(volumes, [&](std::uint32_t* p) { return FrustumCull::CullParallel(jobs, frustum, volumes, p, chunk, &arena); }) == reference);
+			arena.Reset();
+		}
+	}
+
+	void PathsMatchScalar() {
+		const auto frustum = FrustumCull::ExtractFrustum(viewProj);
+		JobSystem jobs(3u);
+		FrameArena arena(1024u);
+		//empty, shorter than one SIMD iteration, every tail of the 8 wide loop, and enough for many chunks
+		for(std::size_t count : { 0u, 1u, 5u, 7u, 8u, 9u, 15u, 16u, 17u, 1001u, 20003u }) {
+			const Scene scene(count);
+			AllPathsAgree(frustum, scene.Spheres(), jobs, arena);
+			AllPathsAgree(frustum, scene.Boxes(), jobs, arena);
+		}
+	}
+
+	void MatchesClipSpace() {
+		const auto frustum = FrustumCull::ExtractFrustum(viewProj);
+		const Scene scene(5000u);
+		//points are spheres of radius 0, kept exactly when they project into the clip volume
+		const std::vector<float> zeros(scene.x.size(), 0.0f);
+		const FrustumCull::Spheres points = { scene.x.data(), scene.y.data(), scene.z.data(), zeros.data(), scene.x.size() };
+		auto visible = Visible(points, [&](std::uint32_t* p) { return FrustumCull::Cull(frustum, points, p); });
+		std::size_t inside = 0u;
+		int wrong = 0;
+		for(std::size_t i = 0u; i < points.count; i++) {
+			const bool kept = std::binary_search(visible.begin(), visible.end(), std::uint32_t(i));
+			if(InsideClip(scene.x[i], scene.y[i], scene.z[i], 1e-4f)) {
+				inside++;
+				wrong += kept ? 0 : 1;
+			}
+			else if(OutsideClip(scene.x[i], scene.y[i], scene.z[i], 1e-4f)) {
+				wrong += kept ? 1 : 0;
+			}
+		}
+		CHECK_EQ(wrong, 0);
+		CHECK(inside > 100u);
+
+		//conservative: a box with any corner in view is never culled
+		const auto boxes = scene.Boxes();
+		visible = Visible(boxes, [&](std::uint32_t* p) { return FrustumCull::Cull(frustum, boxes, p); });
+		wrong = 0;
+		for(std::size_t i = 0u; i < boxes.count; i++) {
+			bool cornerInside = false;
+			for(int c = 0; c < 8; c++) {
+				cornerInside = cornerInside || InsideClip(scene.x[i] + (c & 1 ? scene.ex[i] : -scene.ex[i]),
+					scene.y[i] + (c & 2 ? scene.ey[i] : -scene.ey[i]), scene.z[i] + (c & 4 ? scene.ez[i] : -scene.ez[i]), 0.0f);
+			}
+			if(cornerInside && !std::binary_search(visible.begin(), visible.end(), std::uint32_t(i))) {
+				wrong++;
+			}
+		}
+		CHECK_EQ(wrong, 0);
+	}
+}
+
+int main() {
+	PathsMatchScalar();
+	MatchesClipSpace();
+	return Check::Report("FrustumCullTest");
+}
@@ -0,0 +1,149 @@
+#include "Check.h"
+#include "InfoDrain.h"
+#include <string>
+#include <vector>
+
+namespace {
+	//stands in for IDXGIInfoQueue, counts every call that reaches it
+	class FakeQueue : public InfoDrain::Source {
+	public:
+		void Emit(std::int32_t id, const std::string& text, InfoDrain::Severity severity = InfoDrain::Severity::Warning) {
+			stored.push_back({ id, severity, text });
+		}
+		std::uint64_t GetStoredCount() override {
+			calls++;
+			return stored.size();
+		}
+		Message GetMessage(std::uint64_t index) override {
+			calls++;
+			const auto& s = stored[std::size_t(index)];
+			return { s.id, s.severity, s.text.data(), s.text.size() };
+		}
+		void Clear() override {
+			calls++;
+			stored.clear();
+		}
+	public:
+		struct Stored {
+			std::int32_t id;
+			InfoDrain::Severity severity;
+			std::string text;
+		};
+		std::vector<Stored> stored;
+		std::size_t calls = 0u;
+	};
+
+	const std::string warning = "D3D11 WARNING: ID3D11DeviceContext::DrawIndexed: vertex buffer too small";
+
+	void RepeatsOnlyCount() {
+		FakeQueue queue;
+		InfoDrain drain(queue);
+		for(int i = 0; i < 100; i++) {
+			queue.Emit(342, warning);
+		}
+		queue.Emit(7, "D3D11 ERROR: something else", InfoDrain::Severity::Error);
+		CHECK_EQ(drain.Drain(), 101u);
+		CHECK(queue.stored.empty());
+		CHECK_EQ(drain.GetEntries().size(), 2u);
+		const auto& first = drain.GetEntries()[0];
+		CHECK_EQ(first.id, 342);
+		CHECK_EQ(first.count, 100u);
+		CHECK(std::string(drain.GetText(first), first.textLength) == warning);
+		CHECK(drain.GetEntries()[1].severity == InfoDrain::Severity::Error);
+		//repeats in later drains fold into the pending entry too
+		queue.Emit(342, warning);
+		drain.Drain();
+		CHECK_EQ(drain.GetEntries()[0].count, 101u);
+		CHECK_EQ(drain.GetStats().drains, 2u);
+		CHECK_EQ(drain.GetStats().messages, 102u);
+		CHECK_EQ(drain.GetStats().duplicates, 100u);
+		CHECK_EQ(drain.GetStats().dropped, 0u);
+		const auto messages = drain.TakeMessages();
+		CHECK_EQ(messages.size(), 2u);
+		CHECK(messages.size() == 2u && messages[0] == warning + " [x101]" && messages[1] == "D3D11 ERROR: something else");
+		CHECK(drain.GetEntries().empty());
+		CHECK(drain.TakeMessages().empty());
+	}
+
+	void WhatDoesNotFitIsDropped() {
+		FakeQueue queue;
+		//room for four entries and 64 bytes of text: three 20 byte texts fit, the fourth does not
+		InfoDrain drain(queue, InfoDrain::Granularity::Call, 4u, 64u);
+		for(std::int32_t i = 0; i < 10; i++) {
+			queue.Emit(i, "0123456789abcdef0123");
+		}
+		drain.Drain();
+		CHECK_EQ(drain.GetEntries().size(), 3u);
+		CHECK_EQ(drain.GetStats().dropped, 7u);
+		//a repeat of a kept message still counts when everything is full
+		queue.Emit(1, "0123456789abcdef0123");
+		drain.Drain();
+		CHECK_EQ(drain.GetEntries()[1].count, 2u);
+		CHECK_EQ(drain.GetStats().dropped, 7u);
+		auto messages = drain.TakeMessages();
+		CHECK_EQ(messages.size(), 4u);
+		CHECK(messages.size() == 4u && messages[1] == "0123456789abcdef0123 [x2]" && messages[3] == "[7 more messages dropped]");
+		//the entry limit, with text to spare
+		for(std::int32_t i = 0; i < 6; i++) {
+			queue.Emit(100 + i, "short");
+		}
+		drain.Drain();
+		CHECK_EQ(drain.GetEntries().size(), 4u);
+		CHECK_EQ(drain.GetStats().dropped, 9u);
+		messages = drain.TakeMessages();
+		CHECK(messages.size() == 5u && messages[4] == "[2 more messages dropped]");
+		//taking the messages starts over with the full capacity
+		queue.Emit(1, "0123456789abcdef0123");
+		CHECK(drain.TakeMessages().size() == 1u);
+	}
+
+	void ChecksFinerThanTheGranularityDoNothing() {
+		FakeQueue queue;
+		InfoDrain drain(queue, InfoDrain::Granularity::Frame);
+		queue.Emit(342, warning);
+		CHECK(!drain.Check(InfoDrain::Granularity::Call));
+		CHECK(!drain.Check(InfoDrain::Granularity::Draw));
+		CHECK_EQ(queue.calls, 0u);
+		CHECK_EQ(queue.stored.size(), 1u);
+		CHECK(drain.Check(InfoDrain::Granularity::Frame));
+		CHECK(queue.stored.empty());
+		drain.Clear();
+		//an empty queue costs one count query
+		queue.calls = 0u;
+		CHECK(!drain.Check(InfoDrain::Granularity::Frame));
+		CHECK_EQ(queue.calls, 1u);
+		CHECK_EQ(drain.GetStats().drains, 1u);
+
+		drain.SetGranularity(InfoDrain::Granularity::Draw);
+		CHECK(drain.GetGranularity() == InfoDrain::Granularity::Draw);
+		queue.Emit(342, warning);
+		CHECK(!drain.Check(InfoDrain::Granularity::Call));
+		CHECK(drain.Check(InfoDrain::Granularity::Draw));
+		drain.Clear();
+		drain.SetGranularity(InfoDrain::Granularity::Call);
+		queue.Emit(342, warning);
+		CHECK(drain.Check(InfoDrain::Granularity::Call));
+		//still pending at the next check point until taken
+		CHECK(drain.Check(InfoDrain::Granularity::Frame));
+		drain.TakeMessages();
+		CHECK(!drain.Check(InfoDrain::Granularity::Frame));
+	}
+
+	void DroppedAloneIsPending() {
+		FakeQueue queue;
+		InfoDrain drain(queue, InfoDrain::Granularity::Call, 1u, 4u);
+		queue.Emit(1, "too long for the text buffer");
+		CHECK(drain.Check(InfoDrain::Granularity::Call));
+		CHECK(drain.GetEntries().empty());
+		const auto messages = drain.TakeMessages();
+		CHECK(messages.size() == 1u && messages[0] == "[1 more messages dropped]");
+	}
+}
+
+int main() {
+	RepeatsOnlyCount();
+	WhatDoesNotFitIsDropped();
+	ChecksFinerThanTheGranularityDoNothing();
+	DroppedAloneIsPending();
+	return Check::Report("InfoDrainTest");
+}
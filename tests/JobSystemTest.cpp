@@ -0,0 +1,107 @@
+#include "Check.h"
+#include "JobSystem.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+namespace {
+	//more jobs than the pool holds, submitted without waiting in between; a recycled slot still in flight
+	//would run some jobs twice and others never
+	void OverflowingThePool() {
+		JobSystem jobs(4u);
+		for(int round = 0; round < 20; round++) {
+			std::atomic<std::uint64_t> sum = 0u;
+			std::atomic<std::uint32_t> runs = 0u;
+			JobSystem::Counter counter;
+			constexpr std::uint64_t count = 10000u;
+			for(std::uint64_t i = 0u; i < count; i++) {
+				jobs.Run(counter, [&sum, &runs, i] {
+					sum.fetch_add(i, std::memory_order_relaxed);
+					runs.fetch_add(1u, std::memory_order_relaxed);
+				});
+			}
+			jobs.Wait(counter);
+			CHECK_EQ(sum.load(), count * (count - 1u) / 2u);
+			CHECK_EQ(runs.load(), count);
+		}
+	}
+
+	//same from threads that are not workers, through the external pool
+	void OverflowingFromOtherThreads() {
+		JobSystem jobs(3u);
+		std::atomic<std::uint64_t> sum = 0u;
+		constexpr std::uint64_t perThread = 6000u;
+		std::vector<std::thread> producers;
+		for(std::uint64_t t = 0u; t < 2u; t++) {
+			producers.emplace_back([&jobs, &sum, t] {
+				JobSystem::Counter counter;
+				for(std::uint64_t i = 0u; i < perThread; i++) {
+					const std::uint64_t value = t * perThread + i;
+					jobs.Run(counter, [&sum, value] { sum.fetch_add(value, std::memory_order_relaxed); });
+				}
+				jobs.Wait(counter);
+			});
+		}
+		for(auto& producer : producers) {
+			producer.join();
+		}
+		const std::uint64_t count = 2u * perThread;
+		CHECK_EQ(sum.load(), count * (count - 1u) / 2u);
+	}
+
+	//jobs spawning jobs and continuations held back on a counter, with the pool overflowing underneath
+	void NestedAndContinuations() {
+		JobSystem jobs(4u);
+		for(int round = 0; round < 10; round++) {
+			std::atomic<std::uint32_t> first = 0u;
+			std::atomic<std::uint32_t> second = 0u;
+			std::atomic<std::uint32_t> early = 0u;
+			JobSystem::Counter firstDone;
+			JobSystem::Counter secondDone;
+			JobSystem* pJobs = &jobs;
+			JobSystem::Counter* pFirstDone = &firstDone;
+			std::atomic<std::uint32_t>* pFirst = &first;
+			for(int i = 0; i < 100; i++) {
+				jobs.Run(firstDone, [pJobs, pFirstDone, pFirst] {
+					for(int j = 0; j < 60; j++) {
+						pJobs->Run(*pFirstDone, [pFirst] { pFirst->fetch_add(1u, std::memory_order_relaxed); });
+					}
+				});
+			}
+			for(int i = 0; i < 5000; i++) {
+				jobs.Run(secondDone, [&] {
+					early.fetch_add(first.load(std::memory_order_relaxed) != 6000u ? 1u : 0u, std::memory_order_relaxed);
+					second.fetch_add(1u, std::memory_order_relaxed);
+				}, &firstDone);
+			}
+			jobs.Wait(secondDone);
+			CHECK_EQ(first.load(), 6000u);
+			CHECK_EQ(second.load(), 5000u);
+			CHECK_EQ(early.load(), 0u);
+		}
+	}
+
+	void ParallelForCoversRangeOnce() {
+		JobSystem jobs(4u);
+		std::vector<std::atomic<std::uint8_t>> hits(100000u);
+		jobs.ParallelFor(hits.size(), 16u, [&](std::size_t begin, std::size_t end) {
+			for(std::size_t i = begin; i < end; i++) {
+				hits[i].fetch_add(1u, std::memory_order_relaxed);
+			}
+		});
+		std::size_t wrong = 0u;
+		for(const auto& hit : hits) {
+			wrong += hit.load() == 1u ? 0u : 1u;
+		}
+		CHECK_EQ(wrong, 0u);
+	}
+}
+
+int main() {
+	OverflowingThePool();
+	OverflowingFromOtherThreads();
+	NestedAndContinuations();
+	ParallelForCoversRangeOnce();
+	return Check::Report("JobSystemTest");
+}
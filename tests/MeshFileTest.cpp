@@ -0,0 +1,255 @@
+#include "Check.h"
+#include "MeshFile.h"
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <functional>
+#include <cstring>
+
+namespace {
+	//byte offsets of the on disk layout documented in MeshFile.h
+	constexpr std::size_t versionOffset = 4u;
+	constexpr std::size_t fileSizeOffset = 8u;
+	constexpr std::size_t indexSizeOffset = 32u;
+	constexpr std::size_t indexCountOffset = 36u;
+	constexpr std::size_t indexOffsetOffset = 40u;
+	constexpr std::size_t headerSize = 96u;
+	constexpr std::size_t attributeSize = 32u;
+	constexpr std::size_t streamEntrySize = 24u;
+	constexpr std::size_t lodSize = 12u;
+
+	struct Position {
+		float x, y, z;
+	};
+	struct Extra {
+		std::uint8_t color[4];
+		std::int16_t uv[2];
+	};
+
+	//a quad fan with two streams and two lods, enough to exercise every table
+	struct TestMesh {
+		std::vector<Position> positions = { { -1.0f, -2.0f, 0.5f }, { 1.0f, -2.0f, 0.5f }, { 1.0f, 2.0f, 0.5f }, { -1.0f, 2.0f, 3.0f }, { 0.0f, 0.0f, -4.0f } };
+		std::vector<Extra> extras;
+		std::vector<std::uint16_t> indices16 = { 0, 1, 2, 0, 2, 3, 4, 0, 3, 4, 3, 2 };
+		std::vector<std::uint32_t> indices32 = { 0, 1, 2, 0, 2, 3, 4, 0, 3, 4, 3, 2 };
+		MeshFile::Desc desc;
+		explicit TestMesh(std::uint32_t indexSize) {
+			for(std::size_t i = 0u; i < positions.size(); i++) {
+				extras.push_back({ { std::uint8_t(i), 2u, 3u, 255u }, { std::int16_t(i * 100), std::int16_t(-100) } });
+			}
+			desc.attributes = {
+				{ "POSITION", 0u, MeshFile::Format::Float3, 0u, 0u },
+				{ "COLOR", 0u, MeshFile::Format::UNorm8x4, 1u, 0u },
+				{ "TEXCOORD", 1u, MeshFile::Format::SNorm16x2, 1u, 4u },
+			};
+			desc.streams = {
+				{ positions.data(), positions.size() * sizeof(Position), sizeof(Position) },
+				{ extras.data(), extras.size() * sizeof(Extra), sizeof(Extra) },
+			};
+			if(indexSize == 2u) {
+				desc.indices = { indices16.data(), indices16.size(), 2u };
+			} else {
+				desc.indices = { indices32.data(), indices32.size(), 4u };
+			}
+			desc.lods = { { 0u, 12u, 0.0f }, { 3u, 6u, 0.25f } };
+		}
+	};
+
+	template<typename T>
+	T Read(const std::vector<char>& image, std::size_t offset) {
+		T value;
+		std::memcpy(&value, image.data() + offset, sizeof(T));
+		return value;
+	}
+	template<typename T>
+	void Write(std::vector<char>& image, std::size_t offset, T value) {
+		std::memcpy(image.data() + offset, &value, sizeof(T));
+	}
+
+	bool Throws(const std::vector<char>& image, std::size_t size) {
+		try {
+			MeshFile mesh(image.data(), size);
+		}
+		catch(const MeshFile::Exception&) {
+			return true;
+		}
+		return false;
+	}
+	bool Throws(const std::vector<char>& image) {
+		return Throws(image, image.size());
+	}
+
+	void CheckMatches(const MeshFile& mesh, const TestMesh& source) {
+		const auto& desc = source.desc;
+		CHECK_EQ(mesh.GetVertexCount(), source.positions.size());
+		CHECK_EQ(mesh.GetAttributeCount(), desc.attributes.size());
+		for(std::size_t i = 0u; i < desc.attributes.size(); i++) {
+			CHECK(std::memcmp(&mesh.GetAttribute(i), &desc.attributes[i], sizeof(MeshFile::Attribute)) == 0);
+		}
+		CHECK(mesh.FindAttribute("TEXCOORD", 1u) == &mesh.GetAttribute(2u));
+		CHECK(mesh.FindAttribute("TEXCOORD") == nullptr);
+		CHECK(mesh.FindAttribute("NORMAL") == nullptr);
+		CHECK_EQ(mesh.GetStreamCount(), desc.streams.size());
+		for(std::size_t i = 0u; i < desc.streams.size(); i++) {
+			const auto stream = mesh.GetStream(i);
+			CHECK_EQ(stream.size, desc.streams[i].size);
+			CHECK_EQ(stream.stride, desc.streams[i].stride);
+			CHECK(std::memcmp(stream.pData, desc.streams[i].pData, stream.size) == 0);
+			//views into the image keep the blob alignment
+			CHECK_EQ(reinterpret_cast<std::uintptr_t>(stream.pData) % MeshFile::blobAlignment, 0u);
+		}
+		const auto indices = mesh.GetIndices();
+		CHECK_EQ(indices.count, desc.indices.count);
+		CHECK_EQ(indices.indexSize, desc.indices.indexSize);
+		CHECK(std::memcmp(indices.pData, desc.indices.pData, indices.count * indices.indexSize) == 0);
+		CHECK_EQ(reinterpret_cast<std::uintptr_t>(indices.pData) % MeshFile::blobAlignment, 0u);
+		CHECK_EQ(mesh.GetLodCount(), desc.lods.size());
+		for(std::size_t i = 0u; i < desc.lods.size(); i++) {
+			CHECK_EQ(mesh.GetLod(i).firstIndex, desc.lods[i].firstIndex);
+			CHECK_EQ(mesh.GetLod(i).indexCount, desc.lods[i].indexCount);
+			CHECK(mesh.GetLod(i).error == desc.lods[i].error);
+		}
+		const auto& bounds = mesh.GetBounds();
+		CHECK(bounds.min.x == -1.0f && bounds.min.y == -2.0f && bounds.min.z == -4.0f);
+		CHECK(bounds.max.x == 1.0f && bounds.max.y == 2.0f && bounds.max.z == 3.0f);
+	}
+
+	void RoundTrip() {
+		for(std::uint32_t indexSize : { 2u, 4u }) {
+			const TestMesh source(indexSize);
+			const auto image = MeshFile::Serialize(source.desc);
+			CHECK_EQ(image.size() % MeshFile::blobAlignment, 0u);
+			CHECK_EQ(Read<std::uint64_t>(image, fileSizeOffset), image.size());
+			MeshFile mesh(image.data(), image.size());
+			CHECK_EQ(mesh.GetSize(), image.size());
+			CHECK(std::memcmp(mesh.GetData(), image.data(), image.size()) == 0);
+			CheckMatches(mesh, source);
+
+			//through a file and the mapping
+			const std::string path = (std::filesystem::temp_directory_path() / "hw3d_MeshFileTest.mesh").string();
+			MeshFile::Write(path, source.desc);
+			{
+				MeshFile mapped(path);
+				CheckMatches(mapped, source);
+				//moving hands the mapping over
+				MeshFile moved(std::move(mapped));
+				CheckMatches(moved, source);
+				MeshFile assigned;
+				assigned = std::move(moved);
+				CheckMatches(assigned, source);
+			}
+			std::filesystem::remove(path);
+		}
+
+		//without lods the file gets one covering every index, and the dequantization is kept
+		TestMesh plain(2u);
+		plain.desc.lods.clear();
+		plain.desc.dequantization = { { 0.5f, 2.0f, 1.0f }, { 1.0f, 0.0f, -1.0f } };
+		const auto image = MeshFile::Serialize(plain.desc);
+		MeshFile mesh(image.data(), image.size());
+		CHECK_EQ(mesh.GetLodCount(), 1u);
+		CHECK_EQ(mesh.GetLod(0u).firstIndex, 0u);
+		CHECK_EQ(mesh.GetLod(0u).indexCount, 12u);
+		CHECK(mesh.GetDequantization().scale.x == 0.5f && mesh.GetDequantization().offset.z == -1.0f);
+		CHECK(mesh.GetBounds().min.x == 0.5f && mesh.GetBounds().max.y == 4.0f);
+	}
+
+	void RejectsMalformedImages() {
+		const TestMesh source(2u);
+		const auto good = MeshFile::Serialize(source.desc);
+		CHECK(!Throws(good));
+		const std::size_t attributesBegin = headerSize;
+		const std::size_t streamsBegin = attributesBegin + 3u * attributeSize;
+		const std::size_t lodsBegin = streamsBegin + 2u * streamEntrySize;
+		//the offsets below really point at the fields they are meant to break
+		CHECK_EQ(Read<std::uint32_t>(good, indexSizeOffset), 2u);
+		CHECK_EQ(Read<std::uint32_t>(good, indexCountOffset), 12u);
+		CHECK_EQ(Read<std::uint32_t>(good, attributesBegin + 2u * attributeSize + 16u), 1u);
+		CHECK_EQ(Read<std::uint32_t>(good, attributesBegin + 2u * attributeSize + 28u), 4u);
+		CHECK_EQ(Read<std::uint32_t>(good, streamsBegin + 16u), 12u);
+		CHECK_EQ(Read<std::uint32_t>(good, streamsBegin + streamEntrySize + 16u), 8u);
+		CHECK_EQ(Read<std::uint32_t>(good, lodsBegin + lodSize), 3u);
+		CHECK_EQ(Read<std::uint32_t>(good, lodsBegin + lodSize + 4u), 6u);
+		const auto corrupt = [&](const std::function<void(std::vector<char>&)>& change) {
+			auto image = good;
+			change(image);
+			return Throws(image);
+		};
+
+		//header
+		CHECK(Throws(good, headerSize - 1u));
+		CHECK(corrupt([](std::vector<char>& i) { i[0] = 'X'; }));
+		CHECK(corrupt([](std::vector<char>& i) { Write<std::uint32_t>(i, versionOffset, 1u); }));
+		CHECK(corrupt([](std::vector<char>& i) { Write<std::uint32_t>(i, versionOffset, 3u); }));
+		CHECK(corrupt([](std::vector<char>& i) { Write<std::uint64_t>(i, fileSizeOffset, i.size() + 64u); }));
+		CHECK(corrupt([](std::vector<char>& i) { Write<std::uint64_t>(i, fileSizeOffset, i.size() - 1u); }));
+		//a truncated file no longer matches the size it declares
+		CHECK(Throws(good, good.size() - MeshFile::blobAlignment));
+		//table counts pointing past the end of the file
+		CHECK(corrupt([](std::vector<char>& i) { Write<std::uint32_t>(i, 20u, 0x10000000u); }));
+		CHECK(corrupt([](std::vector<char>& i) { Write<std::uint32_t>(i, 28u, 0x10000000u); }));
+
+		//streams
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint64_t>(i, streamsBegin, Read<std::uint64_t>(i, streamsBegin) + 1u); }));
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint64_t>(i, streamsBegin, i.size()); }));
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint64_t>(i, streamsBegin + 8u, Read<std::uint64_t>(i, streamsBegin + 8u) + 12u); }));
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint64_t>(i, streamsBegin + streamEntrySize + 8u, ~std::uint64_t(0u)); }));
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint32_t>(i, streamsBegin + 16u, 0u); }));
+		//the vertex count has to agree with every stream
+		CHECK(corrupt([](std::vector<char>& i) { Write<std::uint32_t>(i, 16u, Read<std::uint32_t>(i, 16u) + 1u); }));
+
+		//attributes: semantic[16], semanticIndex, format, stream, offset
+		CHECK(corrupt([&](std::vector<char>& i) { std::memset(i.data() + attributesBegin, 'A', 16u); }));
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint32_t>(i, attributesBegin + 20u, 3u); }));
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint32_t>(i, attributesBegin + attributeSize + 24u, 2u); }));
+		//TEXCOORD is 4 bytes at offset 4 of an 8 byte vertex, one more byte overruns the stride
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint32_t>(i, attributesBegin + 2u * attributeSize + 28u, 5u); }));
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint32_t>(i, attributesBegin + 28u, 1u); }));
+		//a float4 position no longer fits the 12 byte stride
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint32_t>(i, attributesBegin + 20u, std::uint32_t(MeshFile::Format::Float4)); }));
+
+		//indices
+		CHECK(corrupt([](std::vector<char>& i) { Write<std::uint32_t>(i, indexSizeOffset, 3u); }));
+		CHECK(corrupt([](std::vector<char>& i) { Write<std::uint32_t>(i, indexCountOffset, 0x40000000u); }));
+		CHECK(corrupt([](std::vector<char>& i) { Write<std::uint64_t>(i, indexOffsetOffset, Read<std::uint64_t>(i, indexOffsetOffset) + 2u); }));
+		CHECK(corrupt([](std::vector<char>& i) { Write<std::uint64_t>(i, indexOffsetOffset, i.size()); }));
+
+		//lods: firstIndex, indexCount, error
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint32_t>(i, lodsBegin + lodSize, 9u); }));
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint32_t>(i, lodsBegin + lodSize + 4u, 4u); }));
+		CHECK(corrupt([&](std::vector<char>& i) { Write<std::uint32_t>(i, lodsBegin, 0xFFFFFFFFu); }));
+
+		//in range edits are still accepted
+		CHECK(!corrupt([&](std::vector<char>& i) { Write<std::uint32_t>(i, lodsBegin + lodSize, 6u); }));
+		CHECK(!corrupt([&](std::vector<char>& i) { Write<std::uint32_t>(i, attributesBegin + 2u * attributeSize + 28u, 0u); }));
+	}
+
+	void SerializeRejectsBadDescs() {
+		const auto throws = [](const MeshFile::Desc& desc) {
+			try {
+				MeshFile::Serialize(desc);
+			}
+			catch(const MeshFile::Exception&) {
+				return true;
+			}
+			return false;
+		};
+		TestMesh mesh(2u);
+		auto desc = mesh.desc;
+		desc.indices.indexSize = 1u;
+		CHECK(throws(desc));
+		desc = mesh.desc;
+		desc.indices.count = 11u;
+		CHECK(throws(desc));
+		desc = mesh.desc;
+		desc.streams[1].size -= sizeof(Extra);
+		CHECK(throws(desc));
+	}
+}
+
+int main() {
+	RoundTrip();
+	RejectsMalformedImages();
+	SerializeRejectsBadDescs();
+	return Check::Report("MeshFileTest");
+}
@@ -0,0 +1,273 @@
+#include "Check.h"
+#include "MeshOptimizer.h"
+#include "JobSystem.h"
+#include <vector>
+#include <array>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	using Triangle = std::array<std::uint32_t, 3>;
+
+	//rotated so the smallest index comes first, which keeps the winding: (a b c) and (a c b) stay different
+	Triangle Canonical(std::uint32_t a, std::uint32_t b, std::uint32_t c) {
+		if(b < a && b < c) {
+			return { b, c, a };
+		}
+		if(c < a && c < b) {
+			return { c, a, b };
+		}
+		return { a, b, c };
+	}
+
+	//UV sphere with positions in stream 0 and each vertex's original number in stream 1, so the
+	//triangles can be traced back through any renumbering. Triangles are shuffled and rotated to
+	//start from a poor cache order, and a few unreferenced vertices are appended.
+	MeshOptimizer::Mesh MakeSphere(std::uint32_t rings, std::uint32_t segments, unsigned int seed) {
+		MeshOptimizer::Mesh mesh;
+		std::vector<rmath::Float3> positions;
+		for(std::uint32_t r = 0u; r <= rings; r++) {
+			const float theta = 3.14159265f * float(r) / float(rings);
+			for(std::uint32_t s = 0u; s < segments; s++) {
+				const float phi = 6.2831853f * float(s) / float(segments);
+				positions.push_back({ std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) });
+			}
+		}
+		for(std::uint32_t r = 0u; r < rings; r++) {
+			for(std::uint32_t s = 0u; s < segments; s++) {
+				const std::uint32_t a = r * segments + s;
+				const std::uint32_t b = r * segments + (s + 1u) % segments;
+				const std::uint32_t c = a + segments;
+				const std::uint32_t d = b + segments;
+				mesh.indices.insert(mesh.indices.end(), { a, b, c, b, d, c });
+			}
+		}
+		for(int i = 0; i < 5; i++) {
+			positions.push_back({ 9.0f, 9.0f, float(i) });
+		}
+		std::mt19937 rng(seed);
+		std::vector<Triangle> triangles;
+		for(std::size_t i = 0u; i < mesh.indices.size(); i += 3u) {
+			const std::uint32_t* t = &mesh.indices[i];
+			const int rotation = int(rng() % 3u);
+			triangles.push_back({ t[rotation], t[(rotation + 1) % 3], t[(rotation + 2) % 3] });
+		}
+		std::shuffle(triangles.begin(), triangles.end(), rng);
+		mesh.indices.clear();
+		for(const auto& t : triangles) {
+			mesh.indices.insert(mesh.indices.end(), t.begin(), t.end());
+		}
+		mesh.vertexCount = (std::uint32_t)positions.size();
+		mesh.attributes = {
+			{ "POSITION", 0u, MeshFile::Format::Float3, 0u, 0u },
+			{ "BLENDINDICES", 0u, MeshFile::Format::Float1, 1u, 0u },
+		};
+		mesh.strides = { sizeof(rmath::Float3), sizeof(std::uint32_t) };
+		mesh.streams.resize(2u);
+		mesh.streams[0].resize(positions.size() * sizeof(rmath::Float3));
+		std::memcpy(mesh.streams[0].data(), positions.data(), mesh.streams[0].size());
+		for(std::uint32_t v = 0u; v < mesh.vertexCount; v++) {
+			const auto* p = reinterpret_cast<const unsigned char*>(&v);
+			mesh.streams[1].insert(mesh.streams[1].end(), p, p + sizeof(v));
+		}
+		return mesh;
+	}
+
+	std::uint32_t OriginalVertex(const MeshOptimizer::Mesh& mesh, std::uint32_t v) {
+		std::uint32_t id;
+		std::memcpy(&id, mesh.streams[1].data() + v * sizeof(std::uint32_t), sizeof(id));
+		return id;
+	}
+
+	//triangles of [first, first + count) in original vertex numbers, sorted
+	std::vector<Triangle> TriangleSet(const MeshOptimizer::Mesh& mesh, std::size_t first, std::size_t count, bool mapped) {
+		std::vector<Triangle> set;
+		for(std::size_t i = first; i < first + count; i += 3u) {
+			std::uint32_t v[3];
+			for(int k = 0; k < 3; k++) {
+				v[k] = mapped ? OriginalVertex(mesh, mesh.indices[i + k]) : mesh.indices[i + k];
+			}
+			set.push_back(Canonical(v[0], v[1], v[2]));
+		}
+		std::sort(set.begin(), set.end());
+		return set;
+	}
+
+	//every stream was permuted together: the positions still belong to the vertex they were numbered for
+	bool StreamsConsistent(const MeshOptimizer::Mesh& optimized, const MeshOptimizer::Mesh& original) {
+		for(std::uint32_t v = 0u; v < optimized.vertexCount; v++) {
+			const std::uint32_t id = OriginalVertex(optimized, v);
+			if(id >= original.vertexCount || std::memcmp(optimized.streams[0].data() + v * sizeof(rmath::Float3),
+				original.streams[0].data() + id * sizeof(rmath::Float3), sizeof(rmath::Float3)) != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void PreservesTrianglesAndWinding() {
+		for(const MeshOptimizer::Options& options : { MeshOptimizer::Options{}, MeshOptimizer::Options{ 16u, 0.0f }, MeshOptimizer::Options{ 32u, 1.2f } }) {
+			const auto original = MakeSphere(24u, 40u, 1u);
+			auto mesh = original;
+			const auto report = MeshOptimizer::Optimize(mesh, options);
+			CHECK(TriangleSet(mesh, 0u, mesh.indices.size(), true) == TriangleSet(original, 0u, original.indices.size(), false));
+			CHECK(StreamsConsistent(mesh, original));
+			//the unreferenced vertices are gone, the rest come in first use order
+			CHECK_EQ(report.vertexCountBefore, original.vertexCount);
+			CHECK_EQ(report.vertexCountAfter, original.vertexCount - 5u);
+			CHECK_EQ(mesh.vertexCount, report.vertexCountAfter);
+			CHECK_EQ(mesh.streams[0].size(), mesh.vertexCount * sizeof(rmath::Float3));
+			std::uint32_t next = 0u;
+			bool firstUseOrder = true;
+			for(const std::uint32_t v : mesh.indices) {
+				firstUseOrder = firstUseOrder && v <= next;
+				next = std::max(next, v + 1u);
+			}
+			CHECK(firstUseOrder);
+
+			//the report is what a simulation of the result says, and never worse than the input
+			const auto after = MeshOptimizer::AnalyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount, options.cacheSize);
+			CHECK_EQ(report.after.transformed, after.transformed);
+			CHECK(report.after.acmr == after.acmr);
+			CHECK(report.after.acmr <= report.before.acmr);
+			CHECK(report.after.atvr <= report.before.atvr);
+			//shuffled input is near the worst case, a sphere grid optimized by Tipsify is well below 1
+			CHECK(report.before.acmr > 2.0f);
+			CHECK(report.after.acmr < 0.9f);
+			CHECK(report.after.atvr >= 1.0f);
+		}
+
+		//optimizing an optimized mesh does not make it worse
+		auto mesh = MakeSphere(16u, 16u, 2u);
+		MeshOptimizer::Optimize(mesh);
+		const auto again = MeshOptimizer::Optimize(mesh);
+		CHECK(again.after.acmr <= again.before.acmr);
+	}
+
+	void LodRangesStayApart() {
+		//two spheres in one index buffer, the second one a coarser lod
+		const auto fine = MakeSphere(20u, 24u, 3u);
+		const auto coarse = MakeSphere(8u, 10u, 4u);
+		MeshOptimizer::Mesh original = fine;
+		for(const std::uint32_t v : coarse.indices) {
+			//the coarse sphere reuses the first vertices of the fine one, which is fine for this test
+			original.indices.push_back(v);
+		}
+		original.lods = { { 0u, (std::uint32_t)fine.indices.size(), 0.0f }, { (std::uint32_t)fine.indices.size(), (std::uint32_t)coarse.indices.size(), 0.1f } };
+		auto mesh = original;
+		MeshOptimizer::Optimize(mesh);
+		for(const auto& lod : original.lods) {
+			CHECK(TriangleSet(mesh, lod.firstIndex, lod.indexCount, true) == TriangleSet(original, lod.firstIndex, lod.indexCount, false));
+		}
+		CHECK(StreamsConsistent(mesh, original));
+	}
+
+	void BatchMatchesSingle() {
+		JobSystem jobs(3u);
+		std::vector<MeshOptimizer::Mesh> meshes;
+		for(unsigned int i = 0u; i < 7u; i++) {
+			meshes.push_back(MakeSphere(6u + i * 3u, 8u + i * 2u, 10u + i));
+		}
+		auto batch = meshes;
+		std::vector<MeshOptimizer::Report> reports(batch.size());
+		MeshOptimizer::OptimizeBatch(jobs, batch.data(), reports.data(), batch.size());
+		for(std::size_t i = 0u; i < meshes.size(); i++) {
+			auto single = meshes[i];
+			const auto report = MeshOptimizer::Optimize(single);
+			CHECK(batch[i].indices == single.indices);
+			CHECK(batch[i].streams == single.streams);
+			CHECK_EQ(reports[i].after.transformed, report.after.transformed);
+			CHECK_EQ(reports[i].vertexCountAfter, report.vertexCountAfter);
+		}
+
+		//one bad mesh rejects the batch before anything is touched
+		auto bad = meshes;
+		bad[4].indices[7] = bad[4].vertexCount;
+		bool threw = false;
+		try {
+			MeshOptimizer::OptimizeBatch(jobs, bad.data(), reports.data(), bad.size());
+		}
+		catch(const MeshFile::Exception&) {
+			threw = true;
+		}
+		CHECK(threw);
+		CHECK(bad[0].indices == meshes[0].indices);
+		CHECK(bad[6].streams == meshes[6].streams);
+	}
+
+	void ValidateRejectsInconsistentMeshes() {
+		const auto good = MakeSphere(4u, 6u, 5u);
+		const auto throws = [](MeshOptimizer::Mesh mesh) {
+			try {
+				MeshOptimizer::Optimize(mesh);
+			}
+			catch(const MeshFile::Exception&) {
+				return true;
+			}
+			return false;
+		};
+		CHECK(!throws(good));
+		auto mesh = good;
+		mesh.indices[0] = mesh.vertexCount;
+		CHECK(throws(mesh));
+		mesh = good;
+		mesh.indices.pop_back();
+		CHECK(throws(mesh));
+		mesh = good;
+		mesh.streams[1].pop_back();
+		CHECK(throws(mesh));
+		mesh = good;
+		mesh.strides.pop_back();
+		CHECK(throws(mesh));
+		mesh = good;
+		mesh.lods = { { 3u, (std::uint32_t)mesh.indices.size(), 0.0f } };
+		CHECK(throws(mesh));
+		mesh = good;
+		mesh.lods = { { 0u, 4u, 0.0f } };
+		CHECK(throws(mesh));
+	}
+
+	void IndexSizeFitsVertexCount() {
+		//R16_UINT holds indices up to 0xFFFF, so up to 0x10000 vertices
+		CHECK_EQ(MeshOptimizer::ChooseIndexSize(0u), 2u);
+		CHECK_EQ(MeshOptimizer::ChooseIndexSize(1u), 2u);
+		CHECK_EQ(MeshOptimizer::ChooseIndexSize(0xFFFFu), 2u);
+		CHECK_EQ(MeshOptimizer::ChooseIndexSize(0x10000u), 2u);
+		CHECK_EQ(MeshOptimizer::ChooseIndexSize(0x10001u), 4u);
+		CHECK_EQ(MeshOptimizer::ChooseIndexSize(0x100000u), 4u);
+
+		//MakeDesc narrows exactly at that boundary and keeps every index value
+		for(std::uint32_t vertexCount : { 0x10000u, 0x10001u }) {
+			MeshOptimizer::Mesh mesh;
+			mesh.vertexCount = vertexCount;
+			mesh.attributes = { { "POSITION", 0u, MeshFile::Format::Float1, 0u, 0u } };
+			mesh.strides = { 4u };
+			mesh.streams = { std::vector<unsigned char>(std::size_t(vertexCount) * 4u) };
+			mesh.indices = { 0u, 1u, vertexCount - 1u, vertexCount - 1u, 1u, 0x8000u };
+			std::vector<std::uint16_t> narrow;
+			const auto desc = MeshOptimizer::MakeDesc(mesh, narrow);
+			CHECK_EQ(desc.indices.indexSize, vertexCount <= 0x10000u ? 2u : 4u);
+			CHECK_EQ(desc.indices.count, mesh.indices.size());
+			bool same = true;
+			for(std::size_t i = 0u; i < mesh.indices.size(); i++) {
+				const std::uint32_t value = desc.indices.indexSize == 2u
+					? static_cast<const std::uint16_t*>(desc.indices.pData)[i]
+					: static_cast<const std::uint32_t*>(desc.indices.pData)[i];
+				same = same && value == mesh.indices[i];
+			}
+			CHECK(same);
+		}
+	}
+}
+
+int main() {
+	PreservesTrianglesAndWinding();
+	LodRangesStayApart();
+	BatchMatchesSingle();
+	ValidateRejectsInconsistentMeshes();
+	IndexSizeFitsVertexCount();
+	return Check::Report("MeshOptimizerTest");
+}
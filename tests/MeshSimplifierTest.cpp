@@ -0,0 +1,348 @@
+#include "Check.h"
+#include "MeshSimplifier.h"
+#include "JobSystem.h"
+#include <vector>
+#include <map>
+#include <set>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+	MeshOptimizer::Mesh MakeMesh(const std::vector<rmath::Float3>& positions, std::vector<std::uint32_t> indices) {
+		MeshOptimizer::Mesh mesh;
+		mesh.attributes = { { "POSITION", 0u, MeshFile::Format::Float3, 0u, 0u } };
+		mesh.strides = { sizeof(rmath::Float3) };
+		mesh.streams.resize(1u);
+		mesh.streams[0].resize(positions.size() * sizeof(rmath::Float3));
+		std::memcpy(mesh.streams[0].data(), positions.data(), mesh.streams[0].size());
+		mesh.indices = std::move(indices);
+		mesh.vertexCount = std::uint32_t(positions.size());
+		return mesh;
+	}
+
+	rmath::Float3 Position(const MeshOptimizer::Mesh& mesh, std::uint32_t v) {
+		rmath::Float3 p;
+		std::memcpy(&p, mesh.streams[0].data() + v * sizeof(rmath::Float3), sizeof(p));
+		return p;
+	}
+
+	//closed unit sphere, clockwise from outside
+	MeshOptimizer::Mesh MakeSphere(std::uint32_t rings, std::uint32_t segments) {
+		std::vector<rmath::Float3> positions = { { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f } };
+		for(std::uint32_t r = 1u; r < rings; r++) {
+			const float theta = 3.14159265f * float(r) / float(rings);
+			for(std::uint32_t s = 0u; s < segments; s++) {
+				const float phi = 6.2831853f * float(s) / float(segments);
+				positions.push_back({ std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) });
+			}
+		}
+		const auto ring = [segments](std::uint32_t r, std::uint32_t s) { return 2u + (r - 1u) * segments + s % segments; };
+		std::vector<std::uint32_t> indices;
+		for(std::uint32_t s = 0u; s < segments; s++) {
+			indices.insert(indices.end(), { 0u, ring(1u, s), ring(1u, s + 1u) });
+			indices.insert(indices.end(), { 1u, ring(rings - 1u, s + 1u), ring(rings - 1u, s) });
+			for(std::uint32_t r = 1u; r + 1u < rings; r++) {
+				indices.insert(indices.end(), { ring(r, s), ring(r + 1u, s), ring(r + 1u, s + 1u) });
+				indices.insert(indices.end(), { ring(r, s), ring(r + 1u, s + 1u), ring(r, s + 1u) });
+			}
+		}
+		return MakeMesh(positions, std::move(indices));
+	}
+
+	//flat square [-1, 1] in xy with an open border, split at x = 0 into two halves that each have their own
+	//copy of the middle column, like a uv seam
+	constexpr std::uint32_t gridSize = 32u;
+	MeshOptimizer::Mesh MakeSeamedGrid() {
+		std::vector<rmath::Float3> positions;
+		std::vector<std::uint32_t> indices;
+		const std::uint32_t half = gridSize / 2u;
+		for(std::uint32_t side = 0u; side < 2u; side++) {
+			const std::uint32_t base = std::uint32_t(positions.size());
+			for(std::uint32_t y = 0u; y <= gridSize; y++) {
+				for(std::uint32_t x = 0u; x <= half; x++) {
+					const std::uint32_t column = side * half + x;
+					positions.push_back({ float(column) / float(half) - 1.0f, float(y) / float(half) - 1.0f, 0.0f });
+				}
+			}
+			for(std::uint32_t y = 0u; y < gridSize; y++) {
+				for(std::uint32_t x = 0u; x < half; x++) {
+					const std::uint32_t a = base + y * (half + 1u) + x;
+					const std::uint32_t c = a + half + 1u;
+					indices.insert(indices.end(), { a, c, a + 1u, a + 1u, c, c + 1u });
+				}
+			}
+		}
+		return MakeMesh(positions, std::move(indices));
+	}
+
+	//twice the area in xy, positive when clockwise seen from +z (y up)
+	float ClockwiseArea(const MeshOptimizer::Mesh& mesh, const std::uint32_t* t) {
+		const auto a = Position(mesh, t[0]);
+		const auto b = Position(mesh, t[1]);
+		const auto c = Position(mesh, t[2]);
+		return (c.x - a.x) * (b.y - a.y) - (c.y - a.y) * (b.x - a.x);
+	}
+
+	void CheckLodChain(const MeshOptimizer::Mesh& mesh, std::size_t originalIndexCount, float maxError) {
+		CHECK(mesh.lods.size() >= 2u);
+		CHECK_EQ(mesh.lods[0].firstIndex, 0u);
+		CHECK_EQ(mesh.lods[0].indexCount, originalIndexCount);
+		CHECK(mesh.lods[0].error == 0.0f);
+		std::size_t end = 0u;
+		int wrong = 0;
+		for(std::size_t l = 0u; l < mesh.lods.size(); l++) {
+			const auto& lod = mesh.lods[l];
+			wrong += lod.firstIndex != end || lod.indexCount % 3u ? 1 : 0;
+			end = lod.firstIndex + lod.indexCount;
+			if(l) {
+				wrong += lod.indexCount >= mesh.lods[l - 1u].indexCount ? 1 : 0;
+				wrong += lod.error < mesh.lods[l - 1u].error || lod.error > maxError ? 1 : 0;
+			}
+			for(std::size_t i = lod.firstIndex; i < end; i += 3u) {
+				const std::uint32_t* t = &mesh.indices[i];
+				wrong += t[0] == t[1] || t[1] == t[2] || t[2] == t[0] || std::max({ t[0], t[1], t[2] }) >= mesh.vertexCount ? 1 : 0;
+			}
+		}
+		CHECK_EQ(wrong, 0);
+		CHECK_EQ(end, mesh.indices.size());
+	}
+
+	void ChainShrinksAndErrorsGrow() {
+		const auto original = MakeSphere(40u, 64u);
+		auto mesh = original;
+		MeshSimplifier::LodOptions options;
+		options.maxLods = 6u;
+		options.maxError = 1.0f;
+		MeshSimplifier::BuildLods(mesh, options);
+		//lod 0 is the mesh as it was, the vertex buffer is shared
+		CHECK(std::equal(original.indices.begin(), original.indices.end(), mesh.indices.begin()));
+		CHECK(mesh.streams == original.streams);
+		CHECK_EQ(mesh.lods.size(), options.maxLods);
+		const float diagonal = std::sqrt(12.0f);
+		CheckLodChain(mesh, original.indices.size(), options.maxError * diagonal);
+		CHECK(mesh.lods.back().error > 0.0f);
+
+		//the error bounds how far a coarse triangle strays from the sphere: its vertices are on it, its middle sinks in
+		int wrong = 0;
+		for(const auto& lod : mesh.lods) {
+			for(std::size_t i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i += 3u) {
+				const auto a = Position(mesh, mesh.indices[i]);
+				const auto b = Position(mesh, mesh.indices[i + 1u]);
+				const auto c = Position(mesh, mesh.indices[i + 2u]);
+				const rmath::Float3 centroid = { (a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f };
+				const float depth = 1.0f - std::sqrt(centroid.x * centroid.x + centroid.y * centroid.y + centroid.z * centroid.z);
+				wrong += depth > 4.0f * lod.error + 2.5e-3f ? 1 : 0;
+				//never turned inwards, collapses along a meridian can leave a sliver standing edge-on
+				const rmath::Float3 e1 = { b.x - a.x, b.y - a.y, b.z - a.z };
+				const rmath::Float3 e2 = { c.x - a.x, c.y - a.y, c.z - a.z };
+				const rmath::Float3 n = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+				const float facing = n.x * centroid.x + n.y * centroid.y + n.z * centroid.z;
+				wrong += facing > 1e-3f * std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z) ? 1 : 0;
+			}
+		}
+		CHECK_EQ(wrong, 0);
+
+		//a tight error limit stops the chain early, every lod stays below it
+		mesh = original;
+		options.maxError = 0.002f;
+		MeshSimplifier::BuildLods(mesh, options);
+		CHECK(mesh.lods.size() < options.maxLods);
+		CheckLodChain(mesh, original.indices.size(), options.maxError * diagonal);
+
+		//a small mesh stops at minTriangles
+		mesh = MakeSphere(4u, 6u);
+		options.maxError = 1.0f;
+		options.minTriangles = 12u;
+		MeshSimplifier::BuildLods(mesh, options);
+		for(const auto& lod : mesh.lods) {
+			CHECK(lod.indexCount >= 3u * options.minTriangles);
+		}
+	}
+
+	//the seamed grid's triangles in [pBegin, pEnd) still cover the square, keep the seam and did not tear it
+	void CheckSquare(const MeshOptimizer::Mesh& mesh, const std::uint32_t* pBegin, const std::uint32_t* pEnd) {
+		//no triangle flipped and the square is still covered exactly: the border kept its shape
+		float area = 0.0f;
+		int flipped = 0;
+		for(const std::uint32_t* t = pBegin; t < pEnd; t += 3) {
+			const float a = ClockwiseArea(mesh, t);
+			flipped += a <= 0.0f ? 1 : 0;
+			area += a;
+		}
+		CHECK_EQ(flipped, 0);
+		CHECK(std::abs(area * 0.5f - 4.0f) < 1e-3f);
+
+		//seam vertices never move
+		const std::set<std::uint32_t> used(pBegin, pEnd);
+		int moved = 0;
+		for(std::uint32_t v = 0u; v < mesh.vertexCount; v++) {
+			moved += Position(mesh, v).x == 0.0f && !used.count(v) ? 1 : 0;
+		}
+		CHECK_EQ(moved, 0);
+
+		//welded by position, edges used by one triangle only run along the outer border, so nothing tore at the seam
+		std::map<std::pair<std::pair<float, float>, std::pair<float, float>>, int> edges;
+		for(const std::uint32_t* t = pBegin; t < pEnd; t += 3) {
+			for(int k = 0; k < 3; k++) {
+				const auto a = Position(mesh, t[k]);
+				const auto b = Position(mesh, t[(k + 1) % 3]);
+				const std::pair<float, float> pa = { a.x, a.y };
+				const std::pair<float, float> pb = { b.x, b.y };
+				edges[{ std::min(pa, pb), std::max(pa, pb) }]++;
+			}
+		}
+		int torn = 0;
+		for(const auto& edge : edges) {
+			if(edge.second == 1) {
+				const auto& a = edge.first.first;
+				const auto& b = edge.first.second;
+				const bool onBorder = (a.first == b.first && std::abs(a.first) == 1.0f) || (a.second == b.second && std::abs(a.second) == 1.0f);
+				torn += onBorder ? 0 : 1;
+			}
+			else {
+				torn += edge.second == 2 ? 0 : 1;
+			}
+		}
+		CHECK_EQ(torn, 0);
+	}
+
+	void BordersAndSeamsHold() {
+		const auto original = MakeSeamedGrid();
+		auto mesh = original;
+		MeshSimplifier::LodOptions options;
+		options.maxLods = 5u;
+		options.maxError = 1.0f;
+		MeshSimplifier::BuildLods(mesh, options);
+		CheckLodChain(mesh, original.indices.size(), options.maxError * std::sqrt(8.0f));
+		CHECK(mesh.lods.size() >= 3u);
+		//a flat square simplifies without error
+		CHECK(mesh.lods.back().error < 1e-4f);
+		CHECK(mesh.lods.back().indexCount * 4u < original.indices.size());
+		for(const auto& lod : mesh.lods) {
+			CheckSquare(mesh, mesh.indices.data() + lod.firstIndex, mesh.indices.data() + lod.firstIndex + lod.indexCount);
+		}
+
+		//as far as it goes below the error of cutting a corner: what is left is held by the corners and the seam alone,
+		//one fan per half around the seam's locked vertices
+		std::vector<std::uint32_t> out(original.indices.size());
+		float error = -1.0f;
+		const std::size_t count = MeshSimplifier::Simplify(out.data(), original.indices.data(), original.indices.size(), original.streams[0].data(),
+			sizeof(rmath::Float3), original.vertexCount, 0u, 0.1f, &error);
+		CHECK_EQ(count, 3u * 2u * (gridSize + 1u));
+		CHECK(error < 1e-4f);
+		CheckSquare(original, out.data(), out.data() + count);
+	}
+
+	void SimplifyMeetsTargets() {
+		const auto sphere = MakeSphere(24u, 32u);
+		std::vector<std::uint32_t> out(sphere.indices.size());
+		float error = -1.0f;
+		std::size_t count = MeshSimplifier::Simplify(out.data(), sphere.indices.data(), sphere.indices.size(), sphere.streams[0].data(),
+			sizeof(rmath::Float3), sphere.vertexCount, sphere.indices.size() / 4u, 1.0f, &error);
+		CHECK(count <= sphere.indices.size() / 4u);
+		CHECK(count % 3u == 0u && count > 0u);
+		CHECK(error > 0.0f && error <= 1.0f);
+		//an error limit of 0 leaves a curved surface alone, in place works too
+		auto inPlace = sphere.indices;
+		count = MeshSimplifier::Simplify(inPlace.data(), inPlace.data(), inPlace.size(), sphere.streams[0].data(),
+			sizeof(rmath::Float3), sphere.vertexCount, 0u, 0.0f, &error);
+		CHECK_EQ(count, sphere.indices.size());
+		CHECK(error == 0.0f);
+	}
+
+	void BatchMatchesSingle() {
+		JobSystem jobs(3u);
+		std::vector<MeshOptimizer::Mesh> meshes = { MakeSphere(12u, 16u), MakeSeamedGrid(), MakeSphere(30u, 20u), MakeSphere(8u, 40u) };
+		auto batch = meshes;
+		MeshSimplifier::BuildLodsBatch(jobs, batch.data(), batch.size());
+		for(std::size_t i = 0u; i < meshes.size(); i++) {
+			auto single = meshes[i];
+			MeshSimplifier::BuildLods(single);
+			CHECK(batch[i].indices == single.indices);
+			CHECK_EQ(batch[i].lods.size(), single.lods.size());
+		}
+
+		const auto throws = [&](std::vector<MeshOptimizer::Mesh> bad) {
+			const auto before = bad;
+			try {
+				MeshSimplifier::BuildLodsBatch(jobs, bad.data(), bad.size());
+			}
+			catch(const MeshFile::Exception&) {
+				//nothing was touched
+				for(std::size_t i = 0u; i < bad.size(); i++) {
+					CHECK(bad[i].indices == before[i].indices);
+				}
+				return true;
+			}
+			return false;
+		};
+		auto bad = meshes;
+		bad[2].lods = { { 0u, 6u, 0.0f }, { 6u, 6u, 0.1f } };
+		CHECK(throws(bad));
+		bad = meshes;
+		bad[3].attributes[0].format = MeshFile::Format::SNorm16x4;
+		CHECK(throws(bad));
+		bad = meshes;
+		std::strcpy(bad[1].attributes[0].semantic, "NORMAL");
+		CHECK(throws(bad));
+		bad = meshes;
+		bad[0].indices[0] = bad[0].vertexCount;
+		CHECK(throws(bad));
+	}
+
+	void SelectLodCoarsensWithDistance() {
+		auto mesh = MakeSphere(40u, 64u);
+		MeshSimplifier::LodOptions options;
+		options.maxLods = 6u;
+		options.maxError = 1.0f;
+		MeshSimplifier::BuildLods(mesh, options);
+		const auto& lods = mesh.lods;
+		const float lodScale = MeshFile::GetLodScale(0.75f, 0.5f, 600.0f);
+		CHECK(std::abs(lodScale - 400.0f) < 1e-3f);
+
+		//at or behind the eye
+		for(float distance : { 0.0f, -0.0f, -1.0f, -std::numeric_limits<float>::infinity() }) {
+			CHECK_EQ(MeshFile::SelectLod(lods.data(), lods.size(), distance, lodScale), 0u);
+		}
+		CHECK_EQ(MeshFile::SelectLod(lods.data(), lods.size(), std::numeric_limits<float>::infinity(), lodScale), lods.size() - 1u);
+		CHECK_EQ(MeshFile::SelectLod(lods.data(), 1u, 1e6f, lodScale), 0u);
+
+		std::size_t previous = 0u;
+		std::size_t reached = 0u;
+		int wrong = 0;
+		for(float distance = 0.01f; distance < 1e5f; distance *= 1.05f) {
+			const std::size_t lod = MeshFile::SelectLod(lods.data(), lods.size(), distance, lodScale);
+			wrong += lod < previous ? 1 : 0;
+			//the coarsest whose error stays within a pixel
+			wrong += lods[lod].error * lodScale > distance && lod ? 1 : 0;
+			wrong += lod + 1u < lods.size() && lods[lod + 1u].error * lodScale <= distance ? 1 : 0;
+			//a looser pixel budget never picks a finer lod
+			wrong += MeshFile::SelectLod(lods.data(), lods.size(), distance, lodScale, 4.0f) < lod ? 1 : 0;
+			previous = lod;
+			reached = std::max(reached, lod);
+		}
+		CHECK_EQ(wrong, 0);
+		CHECK_EQ(reached, lods.size() - 1u);
+
+		//the file's own lod table gives the same answer
+		std::vector<std::uint16_t> narrow;
+		const auto image = MeshFile::Serialize(MeshOptimizer::MakeDesc(mesh, narrow));
+		const MeshFile file(image.data(), image.size());
+		CHECK_EQ(file.GetLodCount(), lods.size());
+		for(float distance : { -1.0f, 0.5f, 5.0f, 50.0f, 500.0f }) {
+			CHECK_EQ(file.SelectLod(distance, lodScale), MeshFile::SelectLod(lods.data(), lods.size(), distance, lodScale));
+		}
+	}
+}
+
+int main() {
+	ChainShrinksAndErrorsGrow();
+	BordersAndSeamsHold();
+	SimplifyMeetsTargets();
+	BatchMatchesSingle();
+	SelectLodCoarsensWithDistance();
+	return Check::Report("MeshSimplifierTest");
+}
@@ -0,0 +1,300 @@
+#include "Check.h"
+#include "Meshlets.h"
+#include "MeshOptimizer.h"
+#include "JobSystem.h"
+#include <vector>
+#include <array>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+	using Triangle = std::array<std::uint32_t, 3>;
+
+	struct Mesh {
+		std::vector<rmath::Float3> positions;
+		std::vector<std::uint32_t> indices;
+	};
+
+	//closed torus around z, clockwise seen from outside
+	Mesh MakeTorus(std::uint32_t segments, std::uint32_t rings) {
+		Mesh mesh;
+		for(std::uint32_t i = 0u; i < segments; i++) {
+			for(std::uint32_t j = 0u; j < rings; j++) {
+				const float u = 6.2831853f * float(i) / float(segments);
+				const float w = 6.2831853f * float(j) / float(rings);
+				const float r = 3.0f + 1.2f * std::cos(w);
+				mesh.positions.push_back({ r * std::cos(u), r * std::sin(u), 1.2f * std::sin(w) });
+			}
+		}
+		for(std::uint32_t i = 0u; i < segments; i++) {
+			for(std::uint32_t j = 0u; j < rings; j++) {
+				const std::uint32_t a0 = i * rings + j;
+				const std::uint32_t a1 = ((i + 1u) % segments) * rings + j;
+				const std::uint32_t a2 = i * rings + (j + 1u) % rings;
+				const std::uint32_t a3 = ((i + 1u) % segments) * rings + (j + 1u) % rings;
+				mesh.indices.insert(mesh.indices.end(), { a0, a2, a1, a2, a3, a1 });
+			}
+		}
+		return mesh;
+	}
+
+	//same triangles in random order
+	Mesh Shuffled(const Mesh& mesh) {
+		std::vector<Triangle> triangles;
+		for(std::size_t i = 0u; i < mesh.indices.size(); i += 3u) {
+			triangles.push_back({ mesh.indices[i], mesh.indices[i + 1u], mesh.indices[i + 2u] });
+		}
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937(1u));
+		Mesh shuffled = { mesh.positions, {} };
+		for(const auto& t : triangles) {
+			shuffled.indices.insert(shuffled.indices.end(), t.begin(), t.end());
+		}
+		return shuffled;
+	}
+
+	//rotated so the smallest index comes first, which keeps the winding
+	Triangle Canonical(const std::uint32_t* p) {
+		Triangle t = { p[0], p[1], p[2] };
+		std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+		return t;
+	}
+
+	std::vector<Triangle> TriangleSet(const std::vector<std::uint32_t>& indices) {
+		std::vector<Triangle> set;
+		for(std::size_t i = 0u; i < indices.size(); i += 3u) {
+			set.push_back(Canonical(&indices[i]));
+		}
+		std::sort(set.begin(), set.end());
+		return set;
+	}
+
+	std::vector<std::uint32_t> AllMeshlets(const Meshlets::Data& data) {
+		std::vector<std::uint32_t> all(data.meshlets.size());
+		for(std::size_t m = 0u; m < all.size(); m++) {
+			all[m] = std::uint32_t(m);
+		}
+		return all;
+	}
+
+	rmath::Float3 Corner(const Mesh& mesh, const Meshlets::Data& data, const Meshlets::Meshlet& meshlet, std::uint32_t triangle, int k) {
+		return mesh.positions[data.vertices[meshlet.vertexOffset + data.triangles[meshlet.triangleOffset + 3u * triangle + k]]];
+	}
+
+	//how much a triangle faces the eye, positive for front faces (clockwise), relative to its size and distance
+	float Facing(const rmath::Float3& a, const rmath::Float3& b, const rmath::Float3& c, const rmath::Float3& eye) {
+		const rmath::Float3 e1 = { b.x - a.x, b.y - a.y, b.z - a.z };
+		const rmath::Float3 e2 = { c.x - a.x, c.y - a.y, c.z - a.z };
+		const rmath::Float3 n = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+		const rmath::Float3 d = { a.x - eye.x, a.y - eye.y, a.z - eye.z };
+		const float length = std::sqrt((n.x * n.x + n.y * n.y + n.z * n.z) * (d.x * d.x + d.y * d.y + d.z * d.z));
+		return -(n.x * d.x + n.y * d.y + n.z * d.z) / length;
+	}
+
+	//checks the partition: every triangle exactly once with its winding, limits kept, spheres enclose their vertices
+	void CheckPartition(const Mesh& mesh, const Meshlets::Data& data, std::uint32_t vertexLimit, std::uint32_t triangleLimit) {
+		std::vector<std::uint32_t> indices;
+		const auto all = AllMeshlets(data);
+		CHECK_EQ(Meshlets::AppendIndices(data, all.data(), all.size(), indices), mesh.indices.size());
+		CHECK(TriangleSet(indices) == TriangleSet(mesh.indices));
+
+		int wrong = 0;
+		std::size_t vertexEnd = 0u;
+		std::size_t triangleEnd = 0u;
+		for(std::size_t m = 0u; m < data.meshlets.size(); m++) {
+			const auto& meshlet = data.meshlets[m];
+			wrong += meshlet.vertexCount == 0u || meshlet.vertexCount > vertexLimit ? 1 : 0;
+			wrong += meshlet.triangleCount == 0u || meshlet.triangleCount > triangleLimit ? 1 : 0;
+			wrong += meshlet.vertexOffset + meshlet.vertexCount > data.vertices.size() ? 1 : 0;
+			wrong += meshlet.triangleOffset + 3u * meshlet.triangleCount > data.triangles.size() ? 1 : 0;
+			if(wrong) {
+				break;
+			}
+			vertexEnd = std::max<std::size_t>(vertexEnd, meshlet.vertexOffset + meshlet.vertexCount);
+			triangleEnd = std::max<std::size_t>(triangleEnd, meshlet.triangleOffset + 3u * meshlet.triangleCount);
+			for(std::uint32_t t = 0u; t < 3u * meshlet.triangleCount; t++) {
+				wrong += data.triangles[meshlet.triangleOffset + t] >= meshlet.vertexCount ? 1 : 0;
+			}
+			for(std::uint32_t v = 0u; v < meshlet.vertexCount; v++) {
+				const auto& p = mesh.positions[data.vertices[meshlet.vertexOffset + v]];
+				const float dx = p.x - data.centerX[m];
+				const float dy = p.y - data.centerY[m];
+				const float dz = p.z - data.centerZ[m];
+				wrong += std::sqrt(dx * dx + dy * dy + dz * dz) > data.radius[m] * 1.0001f + 1e-6f ? 1 : 0;
+			}
+		}
+		CHECK_EQ(wrong, 0);
+		CHECK_EQ(vertexEnd, data.vertices.size());
+		CHECK_EQ(triangleEnd, data.triangles.size());
+		CHECK_EQ(data.cones.size(), data.meshlets.size());
+		CHECK_EQ(data.radius.size(), data.meshlets.size());
+	}
+
+	void PartitionKeepsEveryTriangleOnce() {
+		JobSystem jobs(3u);
+		auto mesh = MakeTorus(96u, 48u);
+		//triangles in random order leave the builder few adjacent triangles to grow over
+		const auto shuffled = Shuffled(mesh);
+		MeshOptimizer::OptimizeVertexCache(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.size());
+		for(const Mesh* pMesh : { &std::as_const(mesh), &shuffled }) {
+			const auto data = Meshlets::Build(pMesh->indices.data(), pMesh->indices.size(), pMesh->positions.data(), sizeof(rmath::Float3), pMesh->positions.size());
+			CheckPartition(*pMesh, data, Meshlets::maxVertices, Meshlets::maxTriangles);
+		}
+		const auto data = Meshlets::Build(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), sizeof(rmath::Float3), mesh.positions.size());
+		//a closed grid shares most vertices, far fewer meshlets than one per vertex limit worth of triangles
+		CHECK(data.meshlets.size() < mesh.indices.size() / 3u / 40u);
+
+		//the smallest and some odd limits
+		for(const auto& limits : { std::array<std::uint32_t, 2>{ 3u, 1u }, std::array<std::uint32_t, 2>{ 3u, 124u },
+			std::array<std::uint32_t, 2>{ 64u, 1u }, std::array<std::uint32_t, 2>{ 17u, 23u } })
+		{
+			const auto limited = Meshlets::Build(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), sizeof(rmath::Float3),
+				mesh.positions.size(), nullptr, limits[0], limits[1]);
+			CheckPartition(mesh, limited, limits[0], limits[1]);
+		}
+
+		//more than one chunk, the job build is identical to the single threaded one
+		const auto big = MakeTorus(320u, 120u);
+		const auto single = Meshlets::Build(big.indices.data(), big.indices.size(), big.positions.data(), sizeof(rmath::Float3), big.positions.size());
+		const auto parallel = Meshlets::Build(big.indices.data(), big.indices.size(), big.positions.data(), sizeof(rmath::Float3), big.positions.size(), &jobs);
+		CheckPartition(big, parallel, Meshlets::maxVertices, Meshlets::maxTriangles);
+		CHECK(single.vertices == parallel.vertices);
+		CHECK(single.triangles == parallel.triangles);
+		CHECK(single.radius == parallel.radius);
+		const auto all = AllMeshlets(parallel);
+		std::vector<std::uint32_t> serialIndices;
+		std::vector<std::uint32_t> jobIndices = { 7u };
+		Meshlets::AppendIndices(parallel, all.data(), all.size(), serialIndices);
+		CHECK_EQ(Meshlets::AppendIndices(parallel, all.data(), all.size(), jobIndices, &jobs), serialIndices.size());
+		CHECK_EQ(jobIndices.front(), 7u);
+		CHECK(std::equal(serialIndices.begin(), serialIndices.end(), jobIndices.begin() + 1));
+
+		//empty input
+		const auto empty = Meshlets::Build(nullptr, 0u, nullptr, sizeof(rmath::Float3), 0u);
+		CHECK(empty.meshlets.empty());
+	}
+
+	void RejectsBadInput() {
+		const auto mesh = MakeTorus(8u, 6u);
+		const auto throws = [&](std::vector<std::uint32_t> indices, std::uint32_t vertexLimit, std::uint32_t triangleLimit) {
+			try {
+				Meshlets::Build(indices.data(), indices.size(), mesh.positions.data(), sizeof(rmath::Float3), mesh.positions.size(),
+					nullptr, vertexLimit, triangleLimit);
+			}
+			catch(const MeshFile::Exception&) {
+				return true;
+			}
+			return false;
+		};
+		CHECK(!throws(mesh.indices, Meshlets::maxVertices, Meshlets::maxTriangles));
+		CHECK(throws(mesh.indices, 2u, 10u));
+		CHECK(throws(mesh.indices, Meshlets::maxVertices + 1u, 10u));
+		CHECK(throws(mesh.indices, 10u, 0u));
+		CHECK(throws(mesh.indices, 10u, Meshlets::maxTriangles + 1u));
+		auto indices = mesh.indices;
+		indices.pop_back();
+		CHECK(throws(indices, Meshlets::maxVertices, Meshlets::maxTriangles));
+		indices = mesh.indices;
+		indices[10] = std::uint32_t(mesh.positions.size());
+		CHECK(throws(indices, Meshlets::maxVertices, Meshlets::maxTriangles));
+	}
+
+	//the object is rotated and moved in front of a camera at the origin looking down +z
+	struct Pose {
+		float pitch;
+		float roll;
+		rmath::Float3 offset;
+	};
+
+	rmath::Mat4 World(const Pose& pose) {
+		return rmath::RotationX(pose.pitch) * rmath::RotationZ(pose.roll) * rmath::Translation(pose.offset.x, pose.offset.y, pose.offset.z);
+	}
+
+	//the camera in the object's space, the rotation's inverse is its transpose
+	rmath::Float3 Eye(const Pose& pose) {
+		const auto rotation = rmath::RotationX(pose.pitch) * rmath::RotationZ(pose.roll);
+		const float q[3] = { -pose.offset.x, -pose.offset.y, -pose.offset.z };
+		float eye[3];
+		for(int i = 0; i < 3; i++) {
+			eye[i] = q[0] * rotation.m[i][0] + q[1] * rotation.m[i][1] + q[2] * rotation.m[i][2];
+		}
+		return { eye[0], eye[1], eye[2] };
+	}
+
+	bool InsideClip(const rmath::Float3& p, const rmath::Mat4& transform) {
+		const auto c = rmath::TransformPoint(p, transform);
+		const float margin = 1e-3f;
+		return c.w > 0.0f && std::abs(c.x) < c.w * (1.0f - margin) && std::abs(c.y) < c.w * (1.0f - margin)
+			&& c.z > c.w * margin && c.z < c.w * (1.0f - margin);
+	}
+
+	void CullKeepsVisibleTriangles() {
+		auto mesh = MakeTorus(160u, 80u);
+		MeshOptimizer::OptimizeVertexCache(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(), mesh.positions.size());
+		const auto data = Meshlets::Build(mesh.indices.data(), mesh.indices.size(), mesh.positions.data(), sizeof(rmath::Float3), mesh.positions.size());
+		const auto proj = rmath::PerspectiveLH(1.0f, 0.75f, 0.5f, 40.0f);
+		std::vector<std::uint32_t> visible(data.meshlets.size());
+		std::vector<std::uint32_t> inFrustum(data.meshlets.size());
+		std::size_t coneCulled = 0u;
+		//in front, partly off screen, close enough that the near plane cuts it, and seen through the hole
+		for(const Pose& pose : { Pose{ 0.9f, 0.0f, { 1.5f, 0.5f, 7.0f } }, Pose{ -0.4f, 1.3f, { 4.0f, -2.0f, 6.0f } },
+			Pose{ 0.2f, 0.7f, { 0.0f, 0.0f, 2.0f } }, Pose{ 0.0f, 0.3f, { 0.0f, 0.0f, 12.0f } }, Pose{ 2.5f, -2.0f, { -1.0f, 1.0f, 9.0f } } })
+		{
+			const auto transform = World(pose) * proj;
+			const auto eye = Eye(pose);
+			const std::size_t count = Meshlets::Cull(data, transform, visible.data());
+			CHECK(count <= data.meshlets.size());
+			CHECK(std::is_sorted(visible.begin(), visible.begin() + count));
+			const std::size_t frustumCount = FrustumCull::Cull(FrustumCull::ExtractFrustum(transform), data.GetSpheres(), inFrustum.data());
+			coneCulled += frustumCount - count;
+
+			//no culled meshlet holds a triangle that faces the eye with a corner in view
+			int wrong = 0;
+			for(std::uint32_t m = 0u; m < data.meshlets.size(); m++) {
+				if(std::binary_search(visible.begin(), visible.begin() + count, m)) {
+					continue;
+				}
+				const auto& meshlet = data.meshlets[m];
+				for(std::uint32_t t = 0u; t < meshlet.triangleCount; t++) {
+					const auto a = Corner(mesh, data, meshlet, t, 0);
+					const auto b = Corner(mesh, data, meshlet, t, 1);
+					const auto c = Corner(mesh, data, meshlet, t, 2);
+					if(Facing(a, b, c, eye) > 1e-4f && (InsideClip(a, transform) || InsideClip(b, transform) || InsideClip(c, transform))) {
+						wrong++;
+					}
+				}
+			}
+			CHECK_EQ(wrong, 0);
+
+			//every meshlet IsBackFacing() reports has only back faces
+			wrong = 0;
+			for(std::uint32_t m = 0u; m < data.meshlets.size(); m++) {
+				if(!Meshlets::IsBackFacing(data, m, eye)) {
+					continue;
+				}
+				const auto& meshlet = data.meshlets[m];
+				for(std::uint32_t t = 0u; t < meshlet.triangleCount; t++) {
+					wrong += Facing(Corner(mesh, data, meshlet, t, 0), Corner(mesh, data, meshlet, t, 1), Corner(mesh, data, meshlet, t, 2), eye) > 0.0f ? 1 : 0;
+				}
+			}
+			CHECK_EQ(wrong, 0);
+		}
+		//the cone test does real work on these views
+		CHECK(coneCulled > data.meshlets.size() / 10u);
+
+		//orthographic projections have no eye, only the frustum test applies
+		const rmath::Mat4 ortho = { { { 0.2f, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.2f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.05f, 0.0f }, { 0.0f, 0.0f, 0.5f, 1.0f } } };
+		const auto transform = World({ 0.9f, 0.0f, { 1.5f, 0.5f, 7.0f } }) * ortho;
+		const std::size_t count = Meshlets::Cull(data, transform, visible.data());
+		CHECK_EQ(count, FrustumCull::Cull(FrustumCull::ExtractFrustum(transform), data.GetSpheres(), inFrustum.data()));
+		CHECK(std::equal(visible.begin(), visible.begin() + count, inFrustum.begin()));
+	}
+}
+
+int main() {
+	PartitionKeepsEveryTriangleOnce();
+	RejectsBadInput();
+	CullKeepsVisibleTriangles();
+	return Check::Report("MeshletsTest");
+}
@@ -0,0 +1,249 @@
+#include "Check.h"
+#include "OcclusionCuller.h"
+#include "TestCube.h"
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	const rmath::Mat4 proj = rmath::PerspectiveLH(1.0f, 0.75f, 0.5f, 100.0f);
+	//ground truth resolution, four times the culler's in each direction
+	constexpr unsigned int referenceWidth = 1024u;
+	constexpr unsigned int referenceHeight = 768u;
+
+	rmath::Mat4 BoxWorld(float x, float y, float z, float ex, float ey, float ez) {
+		return { { { ex, 0.0f, 0.0f, 0.0f }, { 0.0f, ey, 0.0f, 0.0f }, { 0.0f, 0.0f, ez, 0.0f }, { x, y, z, 1.0f } } };
+	}
+
+	struct Scene {
+		std::vector<rmath::Mat4> occluders;
+		std::vector<float> x, y, z, ex, ey, ez;
+		void AddBox(float bx, float by, float bz, float bex, float bey, float bez) {
+			x.push_back(bx);
+			y.push_back(by);
+			z.push_back(bz);
+			ex.push_back(bex);
+			ey.push_back(bey);
+			ez.push_back(bez);
+		}
+		FrustumCull::Boxes Boxes() const {
+			return { x.data(), y.data(), z.data(), ex.data(), ey.data(), ez.data(), x.size() };
+		}
+	};
+
+	//a checkerboard wall with gaps at z 15, one slab running off the right edge of the screen, one on the left
+	//crossing the near plane (only its inner side face survives clipping), and random boxes reaching past every screen edge
+	Scene MakeScene() {
+		Scene scene;
+		for(int i = -2; i <= 2; i++) {
+			for(int j = -1; j <= 1; j++) {
+				if((i + j) % 2 != 0) {
+					scene.occluders.push_back(BoxWorld(float(i) * 6.0f, float(j) * 6.0f, 15.0f, 3.0f, 3.0f, 0.5f));
+				}
+			}
+		}
+		scene.occluders.push_back(BoxWorld(14.0f, 1.0f, 25.0f, 8.0f, 2.0f, 0.5f));
+		scene.occluders.push_back(BoxWorld(-1.65f, 0.0f, 5.1f, 1.35f, 3.0f, 4.9f));
+
+		std::mt19937 rng(3u);
+		std::uniform_real_distribution<float> lateral(-1.3f, 1.3f);
+		std::uniform_real_distribution<float> depth(1.0f, 60.0f);
+		std::uniform_real_distribution<float> size(0.1f, 1.5f);
+		for(int i = 0; i < 500; i++) {
+			const float z = depth(rng);
+			scene.AddBox(lateral(rng) * z * 0.5f, lateral(rng) * z * 0.375f, z, size(rng), size(rng), size(rng));
+		}
+		return scene;
+	}
+
+	void AddOccluders(OcclusionCuller& culler, const Scene& scene, const rmath::Mat4& viewProj) {
+		for(const auto& world : scene.occluders) {
+			culler.AddOccluder(TestCube::vertices, sizeof(TestCube::Vertex), 8u, TestCube::indices, 36u, rmath::Transpose(world * viewProj));
+		}
+	}
+
+	//number of pixels of the box in front of every occluder at the reference resolution, the box's front faces
+	//give its nearest depth at every pixel it covers
+	class Reference {
+	public:
+		Reference(const Scene& scene, const rmath::Mat4& viewProj)
+			:
+			viewProj(viewProj),
+			occluders(referenceWidth, referenceHeight),
+			box(referenceWidth, referenceHeight)
+		{
+			occluders.ClearBuffer(0.0f, 0.0f, 0.0f);
+			for(const auto& world : scene.occluders) {
+				occluders.DrawIndexed(TestCube::vertices, sizeof(TestCube::Vertex), 8u, TestCube::indices, 36u, rmath::Transpose(world * viewProj));
+			}
+			occluderDepth.assign(occluders.GetDepthBuffer(), occluders.GetDepthBuffer() + referenceWidth * referenceHeight);
+		}
+		std::size_t VisiblePixels(float x, float y, float z, float ex, float ey, float ez) {
+			box.ClearBuffer(0.0f, 0.0f, 0.0f);
+			box.DrawIndexed(TestCube::vertices, sizeof(TestCube::Vertex), 8u, TestCube::indices, 36u, rmath::Transpose(BoxWorld(x, y, z, ex, ey, ez) * viewProj));
+			const float* pDepth = box.GetDepthBuffer();
+			std::size_t pixels = 0u;
+			for(std::size_t i = 0u; i < occluderDepth.size(); i++) {
+				pixels += pDepth[i] < occluderDepth[i] ? 1u : 0u;
+			}
+			return pixels;
+		}
+	private:
+		rmath::Mat4 viewProj;
+		SoftwareRasterizer occluders;
+		SoftwareRasterizer box;
+		std::vector<float> occluderDepth;
+	};
+
+	void NeverCullsVisibleBoxes() {
+		const Scene scene = MakeScene();
+		const auto boxes = scene.Boxes();
+		OcclusionCuller culler;
+		std::vector<std::uint32_t> visible(boxes.count);
+		//straight ahead, then moved and rolled so the same culler rebuilds everything for another view
+		for(const rmath::Mat4& view : { rmath::Identity(), rmath::Translation(0.7f, -0.4f, -2.0f) * rmath::RotationZ(0.15f) }) {
+			const auto viewProj = view * proj;
+			culler.BeginFrame(viewProj);
+			AddOccluders(culler, scene, viewProj);
+			const std::size_t count = culler.Cull(boxes, visible.data());
+			CHECK(std::is_sorted(visible.begin(), visible.begin() + count));
+			CHECK_EQ(culler.GetStats().tested, boxes.count);
+			CHECK_EQ(culler.GetStats().occluded, boxes.count - count);
+
+			Reference reference(scene, viewProj);
+			std::size_t hidden = 0u;
+			int wrong = 0;
+			int disagree = 0;
+			for(std::uint32_t i = 0u; i < boxes.count; i++) {
+				const bool kept = std::binary_search(visible.begin(), visible.begin() + count, i);
+				const std::size_t pixels = reference.VisiblePixels(scene.x[i], scene.y[i], scene.z[i], scene.ex[i], scene.ey[i], scene.ez[i]);
+				hidden += pixels == 0u ? 1u : 0u;
+				wrong += !kept && pixels ? 1 : 0;
+				disagree += culler.IsOccluded({ scene.x[i], scene.y[i], scene.z[i] }, { scene.ex[i], scene.ey[i], scene.ez[i] }) == kept ? 1 : 0;
+			}
+			CHECK_EQ(wrong, 0);
+			CHECK_EQ(disagree, 0);
+			//conservative but still useful: most hidden boxes are found
+			CHECK(hidden > boxes.count / 5u);
+			CHECK(boxes.count - count > hidden / 2u);
+		}
+	}
+
+	void NeverCullsVisibleSpheres() {
+		const Scene scene = MakeScene();
+		//the sphere around each box's smallest half size, a culled sphere must have its inscribed cube hidden
+		std::vector<float> radius(scene.x.size());
+		for(std::size_t i = 0u; i < radius.size(); i++) {
+			radius[i] = std::min({ scene.ex[i], scene.ey[i], scene.ez[i] });
+		}
+		const FrustumCull::Spheres spheres = { scene.x.data(), scene.y.data(), scene.z.data(), radius.data(), radius.size() };
+		OcclusionCuller culler;
+		culler.BeginFrame(proj);
+		AddOccluders(culler, scene, proj);
+		std::vector<std::uint32_t> visible(spheres.count);
+		const std::size_t count = culler.Cull(spheres, visible.data());
+		CHECK(count < spheres.count);
+		Reference reference(scene, proj);
+		int wrong = 0;
+		for(std::uint32_t i = 0u; i < spheres.count; i++) {
+			if(!std::binary_search(visible.begin(), visible.begin() + count, i)) {
+				const float inner = radius[i] / std::sqrt(3.0f);
+				wrong += reference.VisiblePixels(scene.x[i], scene.y[i], scene.z[i], inner, inner, inner) ? 1 : 0;
+			}
+		}
+		CHECK_EQ(wrong, 0);
+	}
+
+	void KeepsNearAndOffScreenBounds() {
+		const Scene scene = MakeScene();
+		OcclusionCuller culler;
+		culler.BeginFrame(proj);
+		AddOccluders(culler, scene, proj);
+		//in a gap of the wall, only the clipped occluder's side face hides it
+		CHECK(culler.IsOccluded({ -5.0f, 8.0f, 20.0f }, { 0.3f, 0.3f, 0.3f }));
+		//crossing the near plane inside the clipped occluder's screen area, behind the eye, and off every screen edge
+		CHECK(!culler.IsOccluded({ -0.2f, 0.0f, 0.5f }, { 0.05f, 0.05f, 0.2f }));
+		CHECK(!culler.IsOccluded({ -2.0f, 0.0f, 0.3f }, { 0.1f, 0.1f, 0.21f }));
+		CHECK(!culler.IsOccluded({ 0.0f, 0.0f, -5.0f }, { 1.0f, 1.0f, 1.0f }));
+		CHECK(!culler.IsOccluded({ 40.0f, 0.0f, 20.0f }, { 1.0f, 1.0f, 1.0f }));
+		CHECK(!culler.IsOccluded({ -40.0f, 0.0f, 20.0f }, { 1.0f, 1.0f, 1.0f }));
+		CHECK(!culler.IsOccluded({ 0.0f, 30.0f, 20.0f }, { 1.0f, 1.0f, 1.0f }));
+		CHECK(!culler.IsOccluded({ 0.0f, -30.0f, 20.0f }, { 1.0f, 1.0f, 1.0f }));
+		//behind the wall in the middle of a tile, and the same box reaching past the screen edge behind the wide slab
+		CHECK(culler.IsOccluded({ 6.0f * 20.0f / 15.0f, 0.0f, 20.0f }, { 0.5f, 0.5f, 0.5f }));
+		CHECK(culler.IsOccluded({ 16.0f, 1.0f, 30.0f }, { 2.0f, 0.5f, 0.5f }));
+		//beside the wall tile, in a gap
+		CHECK(!culler.IsOccluded({ 0.0f, 0.0f, 20.0f }, { 0.5f, 0.5f, 0.5f }));
+	}
+
+	void EdgesAreConservative() {
+		//boxes smaller than a culler pixel swept in small steps across the left and top edges of a wall tile,
+		//where the culler's pixel centers and the reference's finer pixels disagree about coverage
+		const Scene scene = MakeScene();
+		OcclusionCuller culler;
+		culler.BeginFrame(proj);
+		AddOccluders(culler, scene, proj);
+		Reference reference(scene, proj);
+		int wrong = 0;
+		std::size_t culled = 0u;
+		for(int i = 0; i < 300; i++) {
+			const float offset = float(i) * 0.004f;
+			const rmath::Float3 extent = { 0.05f, 0.05f, 0.05f };
+			const rmath::Float3 centers[] = { { 5.5f + offset, 1.0f, 30.0f }, { 12.0f, 6.7f - offset, 30.0f } };
+			for(const auto& center : centers) {
+				if(culler.IsOccluded(center, extent)) {
+					culled++;
+					wrong += reference.VisiblePixels(center.x, center.y, center.z, extent.x, extent.y, extent.z) ? 1 : 0;
+				}
+			}
+		}
+		CHECK_EQ(wrong, 0);
+		//and hides the ones well behind the tile
+		CHECK(culled > 100u);
+	}
+
+	void PyramidIsConservative() {
+		const Scene scene = MakeScene();
+		OcclusionCuller culler(250u, 190u);
+		culler.BeginFrame(proj);
+		AddOccluders(culler, scene, proj);
+		std::uint32_t dummy;
+		culler.Cull(FrustumCull::Boxes{ scene.x.data(), scene.y.data(), scene.z.data(), scene.ex.data(), scene.ey.data(), scene.ez.data(), 1u }, &dummy);
+		CHECK(culler.GetLevelCount() >= 8u);
+		int wrong = 0;
+		unsigned int width = culler.GetWidth();
+		unsigned int height = culler.GetHeight();
+		for(std::size_t level = 1u; level < culler.GetLevelCount(); level++) {
+			const unsigned int childWidth = width;
+			const unsigned int childHeight = height;
+			width = (width + 1u) / 2u;
+			height = (height + 1u) / 2u;
+			for(unsigned int y = 0u; y < height; y++) {
+				for(unsigned int x = 0u; x < width; x++) {
+					const float minDepth = culler.GetMinDepth(level, x, y);
+					const float maxDepth = culler.GetMaxDepth(level, x, y);
+					wrong += minDepth > maxDepth ? 1 : 0;
+					for(unsigned int cy = 2u * y; cy < std::min(2u * y + 2u, childHeight); cy++) {
+						for(unsigned int cx = 2u * x; cx < std::min(2u * x + 2u, childWidth); cx++) {
+							wrong += culler.GetMinDepth(level - 1u, cx, cy) < minDepth ? 1 : 0;
+							wrong += culler.GetMaxDepth(level - 1u, cx, cy) > maxDepth ? 1 : 0;
+						}
+					}
+				}
+			}
+		}
+		CHECK_EQ(wrong, 0);
+		CHECK_EQ(width, 1u);
+		CHECK_EQ(height, 1u);
+	}
+}
+
+int main() {
+	NeverCullsVisibleBoxes();
+	NeverCullsVisibleSpheres();
+	KeepsNearAndOffScreenBounds();
+	EdgesAreConservative();
+	PyramidIsConservative();
+	return Check::Report("OcclusionCullerTest");
+}
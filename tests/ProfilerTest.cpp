@@ -0,0 +1,292 @@
+#include "Check.h"
+#include "Profiler.h"
+#include <thread>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <set>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+
+namespace {
+	//scopes are keyed by pointer, every use of a name has to go through the same literal
+	const char* const outerName = "Outer";
+	const char* const innerName = "Inner";
+	const char* const wrapName = "Wrap";
+	const char* const windowName = "Window";
+	const char* const quotedName = "say \"hi\" to C:\\";
+
+	//one exported event, the exporter writes each on its own line
+	struct TraceEvent {
+		std::string name;
+		std::string ph;
+		unsigned long tid;
+		double ts;
+		double dur;
+		std::string threadName; //args of "M" events
+	};
+
+	std::string ReadString(const std::string& line, const char* key) {
+		const auto pos = line.find(key);
+		if(pos == std::string::npos) {
+			return {};
+		}
+		std::string value;
+		for(std::size_t i = pos + std::strlen(key); i < line.size() && line[i] != '"'; i++) {
+			if(line[i] == '\\') {
+				i++;
+			}
+			value += line[i];
+		}
+		return value;
+	}
+	double ReadNumber(const std::string& line, const char* key) {
+		const auto pos = line.find(key);
+		return pos == std::string::npos ? -1.0 : std::strtod(line.c_str() + pos + std::strlen(key), nullptr);
+	}
+
+	//writes the capture and parses it back, checking the framing of the JSON on the way
+	std::vector<TraceEvent> ExportTrace() {
+		const std::string path = (std::filesystem::temp_directory_path() / "hw3d_ProfilerTest.json").string();
+		CHECK(Profiler::WriteChromeTrace(path));
+		std::ifstream file(path);
+		std::vector<std::string> lines;
+		for(std::string line; std::getline(file, line);) {
+			lines.push_back(line);
+		}
+		std::filesystem::remove(path);
+		std::vector<TraceEvent> events;
+		CHECK(lines.size() >= 2u);
+		if(lines.size() < 2u) {
+			return events;
+		}
+		CHECK(lines.front().rfind("{\"traceEvents\":[", 0) == 0);
+		CHECK(lines.back() == "]}");
+		lines.front().erase(0, std::strlen("{\"traceEvents\":["));
+		for(std::size_t i = 0u; i + 1u < lines.size(); i++) {
+			const std::string& line = lines[i];
+			if(line.empty()) {
+				continue;
+			}
+			//every event but the last is followed by a comma
+			const bool last = i + 2u == lines.size();
+			CHECK(line.front() == '{');
+			CHECK(line.back() == (last ? '}' : ','));
+			TraceEvent e;
+			e.name = ReadString(line, "\"name\":\"");
+			e.ph = ReadString(line, "\"ph\":\"");
+			e.tid = (unsigned long)ReadNumber(line, "\"tid\":");
+			CHECK(line.find("\"pid\":0") != std::string::npos);
+			if(e.ph == "X") {
+				e.ts = ReadNumber(line, "\"ts\":");
+				e.dur = ReadNumber(line, "\"dur\":");
+				CHECK(e.ts >= 0.0 && e.dur >= 0.0);
+			} else {
+				CHECK(e.ph == "M");
+				CHECK(e.name == "thread_name");
+				e.threadName = ReadString(line, "\"args\":{\"name\":\"");
+			}
+			events.push_back(e);
+		}
+		return events;
+	}
+
+	//starts a new capture so only what is recorded from here on gets exported
+	void RestartCapture() {
+		Profiler::EndFrame();
+		Profiler::SetCapture(false);
+		Profiler::SetCapture(true);
+	}
+
+	const Profiler::ScopeStats* FindStats(const std::vector<Profiler::ScopeStats>& stats, const char* name) {
+		for(const auto& s : stats) {
+			if(s.name == name) {
+				return &s;
+			}
+		}
+		return nullptr;
+	}
+
+	void NestedScopesOnThreads() {
+		RestartCapture();
+		constexpr int threadCount = 3;
+		constexpr int outerCount = 20;
+		constexpr int innerPerOuter = 3;
+		const char* const threadNames[threadCount] = { "Worker 0", "Worker 1", "Worker 2" };
+		const auto work = [&](const char* threadName) {
+			Profiler::SetThreadName(threadName);
+			for(int i = 0; i < outerCount; i++) {
+				Profiler::Scope outer(outerName);
+				for(int j = 0; j < innerPerOuter; j++) {
+					Profiler::Scope inner(innerName);
+					//make the inner scopes measurably long
+					const auto start = Profiler::Now();
+					while(Profiler::Now() - start < 2000) {}
+				}
+			}
+		};
+		std::vector<std::thread> threads;
+		for(int t = 0; t < threadCount; t++) {
+			threads.emplace_back(work, threadNames[t]);
+		}
+		work("Main");
+		for(auto& thread : threads) {
+			thread.join();
+		}
+		Profiler::EndFrame();
+
+		const auto events = ExportTrace();
+		std::set<unsigned long> outerThreads;
+		std::set<std::string> names;
+		int outers = 0;
+		int inners = 0;
+		int nested = 0;
+		for(const auto& e : events) {
+			if(e.ph == "M") {
+				names.insert(e.threadName);
+			}
+			else if(e.name == outerName) {
+				outers++;
+				outerThreads.insert(e.tid);
+			}
+			else if(e.name == innerName) {
+				inners++;
+				//every inner scope lies inside an outer scope of the same thread (1 ns of slack for the rounding)
+				nested += std::any_of(events.begin(), events.end(), [&](const TraceEvent& o) {
+					return o.name == outerName && o.tid == e.tid && o.ts <= e.ts + 0.001 && e.ts + e.dur <= o.ts + o.dur + 0.001;
+				}) ? 1 : 0;
+			}
+		}
+		CHECK_EQ(outers, (threadCount + 1) * outerCount);
+		CHECK_EQ(inners, (threadCount + 1) * outerCount * innerPerOuter);
+		CHECK_EQ(nested, inners);
+		//threads recording at the same time never share a ring
+		CHECK_EQ(outerThreads.size(), std::size_t(threadCount + 1));
+		for(const char* name : threadNames) {
+			CHECK(names.count(name) == 1u);
+		}
+		CHECK(names.count("Main") == 1u);
+
+		const auto stats = Profiler::GetStats();
+		const auto* pOuter = FindStats(stats, outerName);
+		const auto* pInner = FindStats(stats, innerName);
+		CHECK(pOuter && pInner);
+		if(pOuter && pInner) {
+			CHECK_EQ(pOuter->count, std::size_t((threadCount + 1) * outerCount));
+			CHECK_EQ(pInner->count, std::size_t((threadCount + 1) * outerCount * innerPerOuter));
+			CHECK(pInner->minMs > 0.0);
+			//a preempted scope or two can pull the mean above p99, so both are only bounded below
+			CHECK(pInner->minMs <= pInner->avgMs && pInner->minMs <= pInner->p99Ms);
+			CHECK(pOuter->minMs <= pOuter->avgMs && pOuter->minMs <= pOuter->p99Ms);
+			//an outer scope holds three inner ones
+			CHECK(pOuter->minMs >= pInner->minMs * innerPerOuter);
+		}
+	}
+
+	void RingWrapsAndDrops() {
+		RestartCapture();
+		const std::size_t droppedBefore = Profiler::GetDroppedCount();
+		constexpr std::size_t overflow = 100u;
+		//synthetic timestamps, the event of index i starts at i * 1000 ticks
+		std::thread([] {
+			for(std::size_t i = 0u; i < Profiler::ringSize + overflow; i++) {
+				Profiler::Record(wrapName, std::int64_t(i) * 1000, std::int64_t(i) * 1000 + 10);
+			}
+		}).join();
+		Profiler::EndFrame();
+		//the oldest events were overwritten before the drain
+		CHECK_EQ(Profiler::GetDroppedCount() - droppedBefore, overflow);
+		auto events = ExportTrace();
+		std::vector<double> starts;
+		unsigned long wrapThread = 0u;
+		for(const auto& e : events) {
+			if(e.name == wrapName) {
+				starts.push_back(e.ts);
+				wrapThread = e.tid;
+			}
+		}
+		CHECK_EQ(starts.size(), Profiler::ringSize);
+		if(starts.size() == Profiler::ringSize) {
+			//what survived is the newest ringSize events, in order and evenly spaced
+			const double step = Profiler::TicksToNs(1000) / 1000.0;
+			CHECK(std::abs(starts.front()) < 0.01);
+			int wrong = 0;
+			for(std::size_t i = 1u; i < starts.size(); i++) {
+				wrong += std::abs(starts[i] - starts[i - 1u] - step) < 0.01 ? 0 : 1;
+			}
+			CHECK_EQ(wrong, 0);
+		}
+
+		//the drained ring is reused by the next thread and wraps past its end without losing anything
+		RestartCapture();
+		const std::size_t droppedMiddle = Profiler::GetDroppedCount();
+		std::thread([] {
+			for(std::size_t i = 0u; i < Profiler::ringSize - 1u; i++) {
+				Profiler::Record(wrapName, 0, 1);
+			}
+		}).join();
+		Profiler::EndFrame();
+		CHECK_EQ(Profiler::GetDroppedCount(), droppedMiddle);
+		events = ExportTrace();
+		CHECK_EQ(std::count_if(events.begin(), events.end(), [](const TraceEvent& e) { return e.name == wrapName; }),
+			std::ptrdiff_t(Profiler::ringSize - 1u));
+		CHECK(std::all_of(events.begin(), events.end(), [wrapThread](const TraceEvent& e) { return e.name != wrapName || e.tid == wrapThread; }));
+	}
+
+	void StatsUseTheLastSamples() {
+		Profiler::EndFrame();
+		//old samples are slow, the newest historySize are all 2000 ticks
+		for(std::size_t i = 0u; i < 500u; i++) {
+			Profiler::Record(windowName, 0, 1000000);
+		}
+		for(std::size_t i = 0u; i < Profiler::historySize; i++) {
+			Profiler::Record(windowName, 0, 2000);
+		}
+		Profiler::EndFrame();
+		const auto stats = Profiler::GetStats();
+		const auto* pWindow = FindStats(stats, windowName);
+		CHECK(pWindow != nullptr);
+		if(pWindow) {
+			const double expected = double(std::int64_t(Profiler::TicksToNs(2000))) / 1e6;
+			CHECK_EQ(pWindow->count, Profiler::historySize);
+			CHECK(std::abs(pWindow->minMs - expected) < 1e-9);
+			CHECK(std::abs(pWindow->avgMs - expected) < 1e-9);
+			CHECK(std::abs(pWindow->p99Ms - expected) < 1e-9);
+		}
+		//the frame scope is recorded by EndFrame() itself
+		CHECK(FindStats(stats, "Frame") != nullptr);
+		//GetStats() into a kept vector matches and keeps its storage
+		std::vector<Profiler::ScopeStats> kept;
+		Profiler::GetStats(kept);
+		const auto* pData = kept.data();
+		Profiler::GetStats(kept);
+		CHECK(kept.data() == pData);
+		CHECK_EQ(kept.size(), stats.size());
+	}
+
+	void NamesAreEscaped() {
+		RestartCapture();
+		Profiler::Record(quotedName, 0, 1);
+		Profiler::EndFrame();
+		const std::string path = (std::filesystem::temp_directory_path() / "hw3d_ProfilerTest.json").string();
+		CHECK(Profiler::WriteChromeTrace(path));
+		std::ifstream file(path);
+		const std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		file.close();
+		std::filesystem::remove(path);
+		CHECK(text.find("\"name\":\"say \\\"hi\\\" to C:\\\\\"") != std::string::npos);
+	}
+}
+
+int main() {
+	Profiler::SetThreadName("Main");
+	NestedScopesOnThreads();
+	RingWrapsAndDrops();
+	StatsUseTheLastSamples();
+	NamesAreEscaped();
+	Profiler::SetCapture(false);
+	return Check::Report("ProfilerTest");
+}
@@ -0,0 +1,72 @@
+#include "Check.h"
+#include "ResourceCache.h"
+#include <memory>
+#include <stdexcept>
+
+namespace {
+	//stands in for ID3D11Device, counts the objects it creates
+	struct MockDevice {
+		int creates = 0;
+		std::shared_ptr<int> CreateBuffer(int value) {
+			creates++;
+			return std::make_shared<int>(value);
+		}
+	};
+
+	void ResolveCreatesOnce() {
+		MockDevice device;
+		ResourceCache<std::shared_ptr<int>> cache;
+		const auto a = cache.Resolve("cube.vb", [&] { return device.CreateBuffer(1); });
+		const auto b = cache.Resolve("cube.ib", [&] { return device.CreateBuffer(2); });
+		for(int i = 0; i < 10; i++) {
+			CHECK_EQ(cache.Resolve("cube.vb", [&] { return device.CreateBuffer(-1); }), a);
+		}
+		CHECK(a != b);
+		CHECK_EQ(device.creates, 2);
+		CHECK_EQ(cache.GetCreateCount(), 2u);
+		CHECK_EQ(cache.GetReuseCount(), 10u);
+		CHECK_EQ(cache.Size(), 2u);
+		CHECK_EQ(*cache.Get(a), 1);
+		CHECK_EQ(*cache.Get(b), 2);
+		CHECK_EQ(cache.Find("cube.ib"), b);
+		CHECK_EQ(cache.Find("missing"), ResourceCache<std::shared_ptr<int>>::InvalidHandle);
+	}
+
+	void ThrowingFactoryLeavesCacheUntouched() {
+		ResourceCache<std::shared_ptr<int>> cache;
+		bool threw = false;
+		try {
+			cache.Resolve("bad", []() -> std::shared_ptr<int> { throw std::runtime_error("device lost"); });
+		} catch(const std::runtime_error&) {
+			threw = true;
+		}
+		CHECK(threw);
+		CHECK_EQ(cache.Size(), 0u);
+		CHECK_EQ(cache.GetCreateCount(), 0u);
+		CHECK_EQ(cache.Find("bad"), ResourceCache<std::shared_ptr<int>>::InvalidHandle);
+	}
+
+	void ClearStartsOver() {
+		MockDevice device;
+		ResourceCache<std::shared_ptr<int>> cache;
+		cache.Resolve("vs", [&] { return device.CreateBuffer(1); });
+		cache.Resolve("vs", [&] { return device.CreateBuffer(1); });
+		cache.Clear();
+		CHECK_EQ(cache.Size(), 0u);
+		CHECK_EQ(cache.GetCreateCount(), 0u);
+		CHECK_EQ(cache.GetReuseCount(), 0u);
+		//recreated after device removal, the counters describe the new device only
+		cache.Resolve("vs", [&] { return device.CreateBuffer(3); });
+		CHECK_EQ(device.creates, 2);
+		CHECK_EQ(cache.GetCreateCount(), 1u);
+		CHECK_EQ(cache.GetReuseCount(), 0u);
+		CHECK_EQ(*cache.Get(cache.Find("vs")), 3);
+	}
+}
+
+int main() {
+	ResolveCreatesOnce();
+	ThrowingFactoryLeavesCacheUntouched();
+	ClearStartsOver();
+	return Check::Report("ResourceCacheTest");
+}
@@ -0,0 +1,117 @@
+#include "Check.h"
+#include "ShaderStore.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <cstring>
+
+namespace {
+	const std::string directory = (std::filesystem::temp_directory_path() / "hw3d_ShaderStoreTest").string();
+
+	std::string WriteFile(const std::string& name, const std::string& contents) {
+		const std::string path = directory + "/" + name;
+		std::ofstream(path, std::ios::binary | std::ios::trunc).write(contents.data(), (std::streamsize)contents.size());
+		return path;
+	}
+
+	bool Holds(const ShaderStore& store, const std::string& name, const std::string& contents) {
+		const auto code = store.Get(name);
+		return code.size == contents.size() && std::memcmp(code.pData, contents.data(), code.size) == 0
+			&& code.hash == ShaderStore::Hash(contents.data(), contents.size());
+	}
+
+	template<typename F>
+	bool Throws(F&& f) {
+		try {
+			f();
+		} catch(const ShaderStore::Exception&) {
+			return true;
+		}
+		return false;
+	}
+
+	void LoadSharesIdenticalBytecode() {
+		const std::string vs = "DXBC vertex shader";
+		const std::string ps = "DXBC pixel shader";
+		ShaderStore store;
+		store.Load("VertexShader", WriteFile("VertexShader.cso", vs));
+		store.Load("PixelShader", WriteFile("PixelShader.cso", ps));
+		store.Load("VertexShaderCopy", WriteFile("VertexShaderCopy.cso", vs));
+		CHECK_EQ(store.Size(), 3u);
+		CHECK_EQ(store.GetFileReadCount(), 3u);
+		CHECK(Holds(store, "VertexShader", vs));
+		CHECK(Holds(store, "PixelShader", ps));
+		CHECK(store.Get("VertexShader").pData == store.Get("VertexShaderCopy").pData);
+		//views stay put however much the store grows afterwards
+		const void* pVertex = store.Get("VertexShader").pData;
+		for(int i = 0; i < 100; i++) {
+			store.Add("Generated" + std::to_string(i), &i, sizeof(i));
+		}
+		CHECK(store.Get("VertexShader").pData == pVertex);
+		CHECK(Throws([&] { store.Get("Missing"); }));
+		CHECK(Throws([&] { store.Load("Missing", directory + "/Missing.cso"); }));
+	}
+
+	void ArchiveRoundTrip() {
+		const std::string vs = "DXBC vertex shader";
+		const std::string ps(1000, 'p');
+		const std::string path = directory + "/Shaders.pak";
+		{
+			ShaderStore store;
+			store.Add("VertexShader", vs.data(), vs.size());
+			store.Add("PixelShader", ps.data(), ps.size());
+			store.Add("InstanceVertexShader", vs.data(), vs.size());
+			store.SaveArchive(path);
+		}
+		//shared bytecode is written once
+		CHECK(std::filesystem::file_size(path) < 16u + 3u * 32u + 64u + 2u * 16u + vs.size() + ps.size());
+		ShaderStore store;
+		store.LoadArchive(path);
+		CHECK_EQ(store.GetFileReadCount(), 1u);
+		CHECK_EQ(store.Size(), 3u);
+		CHECK(Holds(store, "VertexShader", vs));
+		CHECK(Holds(store, "PixelShader", ps));
+		CHECK(Holds(store, "InstanceVertexShader", vs));
+		CHECK(reinterpret_cast<std::uintptr_t>(store.Get("PixelShader").pData) % 16u == 0u);
+		//loose files fill in what the archive does not have
+		store.Load("Extra", WriteFile("Extra.cso", "extra"));
+		CHECK(Holds(store, "Extra", "extra"));
+	}
+
+	void BadArchivesAreRejected() {
+		const std::string path = directory + "/Bad.pak";
+		{
+			ShaderStore store;
+			const std::string blob(64, 'x');
+			store.Add("Shader", blob.data(), blob.size());
+			store.SaveArchive(path);
+		}
+		std::string file;
+		{
+			std::ifstream in(path, std::ios::binary);
+			file.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		}
+		ShaderStore store;
+		//flipped bytecode fails the hash check and leaves the store untouched
+		std::string corrupt = file;
+		corrupt.back() ^= 1;
+		CHECK(Throws([&] { store.LoadArchive(WriteFile("Corrupt.pak", corrupt)); }));
+		CHECK(Throws([&] { store.LoadArchive(WriteFile("Truncated.pak", file.substr(0, file.size() / 2u))); }));
+		CHECK(Throws([&] { store.LoadArchive(WriteFile("Tiny.pak", "USHA")); }));
+		std::string wrongMagic = file;
+		wrongMagic[0] = 'X';
+		CHECK(Throws([&] { store.LoadArchive(WriteFile("WrongMagic.pak", wrongMagic)); }));
+		CHECK_EQ(store.Size(), 0u);
+		store.LoadArchive(path);
+		CHECK(store.Contains("Shader"));
+	}
+}
+
+int main() {
+	std::filesystem::create_directories(directory);
+	LoadSharesIdenticalBytecode();
+	ArchiveRoundTrip();
+	BadArchivesAreRejected();
+	std::filesystem::remove_all(directory);
+	return Check::Report("ShaderStoreTest");
+}
@@ -0,0 +1,194 @@
+#include "Check.h"
+#include "ShadowState.h"
+#include <string>
+#include <vector>
+
+namespace {
+	//stands in for ID3D11DeviceContext, records the calls that reach it
+	struct MockContext {
+		std::vector<std::string> calls;
+		void Call(const char* name) {
+			calls.push_back(name);
+		}
+	};
+
+	//the pattern Graphics uses for every state call: ask the shadow, forward only if it says so
+	class Binder {
+	public:
+		explicit Binder(MockContext& context) noexcept
+			: context(context)
+		{}
+		void InputLayout(const void* p) {
+			if(shadow.SetInputLayout(p)) {
+				context.Call("IASetInputLayout");
+			}
+		}
+		void Topology(unsigned int t) {
+			if(shadow.SetTopology(t)) {
+				context.Call("IASetPrimitiveTopology");
+			}
+		}
+		void VertexBuffer(unsigned int slot, const void* p, unsigned int stride, unsigned int offset) {
+			if(shadow.SetVertexBuffer(slot, p, stride, offset)) {
+				context.Call("IASetVertexBuffers");
+			}
+		}
+		void IndexBuffer(const void* p, unsigned int format) {
+			if(shadow.SetIndexBuffer(p, format, 0u)) {
+				context.Call("IASetIndexBuffer");
+			}
+		}
+		void VertexShader(const void* p) {
+			if(shadow.SetVertexShader(p)) {
+				context.Call("VSSetShader");
+			}
+		}
+		void PixelShader(const void* p) {
+			if(shadow.SetPixelShader(p)) {
+				context.Call("PSSetShader");
+			}
+		}
+		void VSConstants(unsigned int slot, const void* p, unsigned int first, unsigned int num) {
+			if(shadow.SetVSConstantBuffer(slot, p, first, num)) {
+				context.Call("VSSetConstantBuffers1");
+			}
+		}
+		void PSConstants(unsigned int slot, const void* p) {
+			if(shadow.SetPSConstantBuffer(slot, p)) {
+				context.Call("PSSetConstantBuffers");
+			}
+		}
+		void Viewport(float width, float height) {
+			if(shadow.SetViewport({ 0.0f, 0.0f, width, height, 0.0f, 1.0f })) {
+				context.Call("RSSetViewports");
+			}
+		}
+		void Targets(const void* pTarget, const void* pDepth) {
+			if(shadow.SetRenderTarget(pTarget, pDepth)) {
+				context.Call("OMSetRenderTargets");
+			}
+		}
+		void DepthState(const void* p, unsigned int ref) {
+			if(shadow.SetDepthStencilState(p, ref)) {
+				context.Call("OMSetDepthStencilState");
+			}
+		}
+		//one draw of a test cube, everything it binds
+		void Cube(const void* pVs, const void* pVb, unsigned int firstConstant) {
+			Topology(4u);
+			InputLayout(&layout);
+			VertexBuffer(0u, pVb, 12u, 0u);
+			IndexBuffer(pVb, 57u);
+			VertexShader(pVs);
+			PixelShader(&pixelShader);
+			VSConstants(0u, &ring, firstConstant, 16u);
+			PSConstants(0u, &colors);
+			Viewport(800.0f, 600.0f);
+		}
+	public:
+		ShadowState shadow;
+		int layout = 0, pixelShader = 0, ring = 0, colors = 0;
+	private:
+		MockContext& context;
+	};
+
+	void RedundantCallsAreDropped() {
+		MockContext context;
+		Binder bind(context);
+		int vs = 0, vb = 0;
+		bind.Cube(&vs, &vb, 0u);
+		CHECK_EQ(context.calls.size(), 9u);
+		CHECK_EQ(bind.shadow.GetFrameStats().issued, 9u);
+		//the same cube again only changes its constants
+		context.calls.clear();
+		bind.Cube(&vs, &vb, 16u);
+		CHECK_EQ(context.calls.size(), 1u);
+		CHECK(context.calls.size() == 1u && context.calls[0] == "VSSetConstantBuffers1");
+		context.calls.clear();
+		bind.Cube(&vs, &vb, 16u);
+		CHECK(context.calls.empty());
+		CHECK_EQ(bind.shadow.GetFrameStats().issued, 10u);
+		CHECK_EQ(bind.shadow.GetFrameStats().elided, 17u);
+		//another vertex buffer rebinds the buffers, nothing else
+		int vb2 = 0;
+		context.calls.clear();
+		bind.Cube(&vs, &vb2, 16u);
+		CHECK_EQ(context.calls.size(), 2u);
+		CHECK(context.calls.size() == 2u && context.calls[0] == "IASetVertexBuffers" && context.calls[1] == "IASetIndexBuffer");
+	}
+
+	void EveryParameterCounts() {
+		MockContext context;
+		Binder bind(context);
+		int vb = 0;
+		bind.VertexBuffer(0u, &vb, 12u, 0u);
+		bind.VertexBuffer(0u, &vb, 16u, 0u); //stride
+		bind.VertexBuffer(0u, &vb, 16u, 4u); //offset
+		bind.VertexBuffer(1u, &vb, 16u, 4u); //other slot
+		bind.VertexBuffer(1u, &vb, 16u, 4u);
+		CHECK_EQ(context.calls.size(), 4u);
+		bind.Viewport(800.0f, 600.0f);
+		bind.Viewport(800.0f, 600.0f);
+		bind.Viewport(640.0f, 480.0f);
+		CHECK_EQ(context.calls.size(), 6u);
+		int target = 0, depth = 0, state = 0;
+		bind.Targets(&target, &depth);
+		bind.Targets(&target, nullptr);
+		bind.Targets(&target, nullptr);
+		bind.DepthState(&state, 0u);
+		bind.DepthState(&state, 1u);
+		bind.DepthState(&state, 1u);
+		CHECK_EQ(context.calls.size(), 10u);
+		//binding null is a real call the first time too
+		bind.PSConstants(3u, nullptr);
+		bind.PSConstants(3u, nullptr);
+		CHECK_EQ(context.calls.size(), 11u);
+	}
+
+	void InvalidateForcesTheNextCall() {
+		MockContext context;
+		Binder bind(context);
+		int vs = 0, vb = 0;
+		bind.Cube(&vs, &vb, 0u);
+		bind.Cube(&vs, &vb, 0u);
+		CHECK_EQ(context.calls.size(), 9u);
+		//after ClearState() the context holds nothing, every call has to go through again exactly once
+		bind.shadow.Invalidate();
+		context.calls.clear();
+		bind.Cube(&vs, &vb, 0u);
+		CHECK_EQ(context.calls.size(), 9u);
+		context.calls.clear();
+		bind.Cube(&vs, &vb, 0u);
+		CHECK(context.calls.empty());
+		//slots other than the ones used before are forced too
+		bind.shadow.Invalidate();
+		bind.VSConstants(5u, nullptr, 0u, 0u);
+		bind.VertexBuffer(15u, nullptr, 0u, 0u);
+		CHECK_EQ(context.calls.size(), 2u);
+	}
+
+	void FrameStatsRollOver() {
+		MockContext context;
+		Binder bind(context);
+		int vs = 0, vb = 0;
+		bind.Cube(&vs, &vb, 0u);
+		bind.Cube(&vs, &vb, 0u);
+		bind.shadow.NextFrame();
+		CHECK_EQ(bind.shadow.GetLastFrameStats().issued, 9u);
+		CHECK_EQ(bind.shadow.GetLastFrameStats().elided, 9u);
+		CHECK_EQ(bind.shadow.GetFrameStats().issued, 0u);
+		CHECK_EQ(bind.shadow.GetFrameStats().elided, 0u);
+		//a new frame keeps what is bound
+		bind.Cube(&vs, &vb, 0u);
+		CHECK_EQ(bind.shadow.GetFrameStats().issued, 0u);
+		CHECK_EQ(context.calls.size(), 9u);
+	}
+}
+
+int main() {
+	RedundantCallsAreDropped();
+	EveryParameterCounts();
+	InvalidateForcesTheNextCall();
+	FrameStatsRollOver();
+	return Check::Report("ShadowStateTest");
+}
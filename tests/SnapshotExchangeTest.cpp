@@ -0,0 +1,137 @@
+#include "Check.h"
+#include "SnapshotExchange.h"
+#include "Simulation.h"
+#include "Timer.h"
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <chrono>
+#include <iterator>
+#include <cstdint>
+
+namespace {
+	//every field derives from sequence, a snapshot mixing two publishes shows up as a mismatch
+	struct Payload {
+		std::uint64_t sequence;
+		std::uint64_t values[61];
+		std::uint64_t checksum;
+	};
+
+	void Fill(Payload& p, std::uint64_t sequence) {
+		p.sequence = sequence;
+		p.checksum = 0u;
+		for(std::size_t i = 0u; i < std::size(p.values); i++) {
+			p.values[i] = sequence * 1000003u + i;
+			p.checksum ^= p.values[i];
+		}
+	}
+
+	bool Intact(const Payload& p) {
+		std::uint64_t checksum = 0u;
+		for(std::size_t i = 0u; i < std::size(p.values); i++) {
+			if(p.values[i] != p.sequence * 1000003u + i) {
+				return false;
+			}
+			checksum ^= p.values[i];
+		}
+		return checksum == p.checksum;
+	}
+
+	//producer publishes as fast as it can, the consumer may skip snapshots but must never see a torn one,
+	//never go backwards and always end up with the last one
+	void FreeRunning() {
+		constexpr std::uint64_t count = 200000u;
+		SnapshotExchange<Payload> exchange;
+		Fill(exchange.Back(), 0u);
+		exchange.Publish();
+		std::thread producer([&] {
+			for(std::uint64_t s = 1u; s <= count; s++) {
+				Fill(exchange.Back(), s);
+				exchange.Publish();
+			}
+		});
+		std::uint64_t last = 0u;
+		std::size_t torn = 0u;
+		std::size_t backwards = 0u;
+		std::size_t distinct = 0u;
+		while(last < count) {
+			const Payload& p = exchange.Acquire();
+			torn += Intact(p) ? 0u : 1u;
+			backwards += p.sequence < last ? 1u : 0u;
+			distinct += p.sequence != last ? 1u : 0u;
+			last = p.sequence;
+		}
+		producer.join();
+		CHECK_EQ(torn, 0u);
+		CHECK_EQ(backwards, 0u);
+		CHECK(distinct > 0u);
+		CHECK_EQ(exchange.Acquire().sequence, count);
+		CHECK(!exchange.HasFresh());
+	}
+
+	//consumer acknowledges every snapshot before the next one is published, then none may be lost
+	void Lockstep() {
+		constexpr std::uint64_t count = 20000u;
+		SnapshotExchange<Payload> exchange;
+		std::atomic<std::uint64_t> acknowledged = 0u;
+		std::thread producer([&] {
+			for(std::uint64_t s = 1u; s <= count; s++) {
+				Fill(exchange.Back(), s);
+				exchange.Publish();
+				while(acknowledged.load(std::memory_order_acquire) != s) {
+					std::this_thread::yield();
+				}
+			}
+		});
+		std::size_t mismatched = 0u;
+		for(std::uint64_t s = 1u; s <= count; s++) {
+			while(!exchange.HasFresh()) {
+				std::this_thread::yield();
+			}
+			const Payload& p = exchange.Acquire();
+			mismatched += p.sequence == s && Intact(p) ? 0u : 1u;
+			acknowledged.store(s, std::memory_order_release);
+		}
+		producer.join();
+		CHECK_EQ(mismatched, 0u);
+	}
+
+	//the snapshot held by the consumer stays untouched while the producer keeps publishing
+	void HeldSnapshotIsStable() {
+		SnapshotExchange<Payload> exchange;
+		Fill(exchange.Back(), 7u);
+		exchange.Publish();
+		const Payload& held = exchange.Acquire();
+		for(std::uint64_t s = 8u; s < 100u; s++) {
+			Fill(exchange.Back(), s);
+			exchange.Publish();
+		}
+		CHECK_EQ(held.sequence, 7u);
+		CHECK(Intact(held));
+		CHECK_EQ(exchange.Acquire().sequence, 99u);
+	}
+
+	void SimulationInterpolates() {
+		const Simulation::Position positions[] = { { 1.0f, 2.0f, 3.0f }, { -1.0f, 0.0f, 5.0f } };
+		Simulation sim(positions, std::size(positions), 1000.0f);
+		Simulation::SceneState scene;
+		for(int frame = 0; frame < 200; frame++) {
+			const auto& snapshot = sim.Acquire();
+			CHECK_EQ(snapshot.current.angle.size(), 2u);
+			sim.Interpolate(snapshot, snapshot.tickTime + std::int64_t(sim.GetTickSeconds() * 0.5e9f), scene);
+			//angle runs with simulated time, halfway through a tick is halfway between the two states
+			CHECK(scene.angle[0] >= snapshot.previous.angle[0] && scene.angle[0] <= snapshot.current.angle[0]);
+			CHECK(scene.x[1] == -1.0f && scene.z[0] == 3.0f);
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		CHECK(sim.GetTickCount() > 0u);
+	}
+}
+
+int main() {
+	FreeRunning();
+	Lockstep();
+	HeldSnapshotIsStable();
+	SimulationInterpolates();
+	return Check::Report("SnapshotExchangeTest");
+}
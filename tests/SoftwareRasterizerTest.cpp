@@ -0,0 +1,343 @@
+#include "Check.h"
+#include "SoftwareRasterizer.h"
+#include "TestCube.h"
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	constexpr unsigned int width = 800u;
+	constexpr unsigned int height = 600u;
+
+	//same float -> B8G8R8A8_UNORM packing as the output merger
+	std::uint32_t Pack(float r, float g, float b, float a) {
+		const auto unorm = [](float v) {
+			v = std::min(std::max(v, 0.0f), 1.0f);
+			return std::uint32_t(v * 255.0f + 0.5f);
+		};
+		return (unorm(a) << 24) | (unorm(r) << 16) | (unorm(g) << 8) | unorm(b);
+	}
+
+	std::uint32_t FaceColor(int face) {
+		const auto& c = TestCube::faceColors.face_colors[face];
+		return Pack(c.r, c.g, c.b, c.a);
+	}
+
+	//the test cube pipeline exactly as Graphics::DrawTestCube builds it
+	rmath::Mat4 CubeRotation(float angle) {
+		return rmath::RotationZ(angle) * rmath::RotationX(angle);
+	}
+	rmath::Mat4 CubeTransform(float angle, float x, float y, float z) {
+		return rmath::Transpose(CubeRotation(angle) * rmath::Translation(x, y, z)
+			* rmath::PerspectiveLH(TestCube::projWidth, TestCube::projHeight, TestCube::nearZ, TestCube::farZ));
+	}
+
+	struct Hit {
+		int face = -1; //index into face_colors, -1 for background
+		float depth = 1.0f;
+	};
+
+	//ray cast through the pixel center against the [-1, 1] cube in object space
+	Hit TraceCube(float angle, float tx, float ty, float tz, unsigned int px, unsigned int py) {
+		const float ndcX = (float(px) + 0.5f) / float(width) * 2.0f - 1.0f;
+		const float ndcY = 1.0f - (float(py) + 0.5f) / float(height) * 2.0f;
+		//view space direction with z = 1, so the ray parameter is view space depth
+		const float d[3] = {
+			ndcX * TestCube::projWidth / (2.0f * TestCube::nearZ),
+			ndcY * TestCube::projHeight / (2.0f * TestCube::nearZ),
+			1.0f
+		};
+		const float t[3] = { tx, ty, tz };
+		//v_view = v_obj * R + t with R orthonormal, so v_obj = (v_view - t) * R^T
+		const auto r = CubeRotation(angle);
+		float o[3];
+		float dir[3];
+		for(int i = 0; i < 3; i++) {
+			o[i] = -(t[0] * r.m[i][0] + t[1] * r.m[i][1] + t[2] * r.m[i][2]);
+			dir[i] = d[0] * r.m[i][0] + d[1] * r.m[i][1] + d[2] * r.m[i][2];
+		}
+		//faces in index buffer order: -z, +x, +y, +z, -x, -y
+		const int minFace[3] = { 4, 5, 0 };
+		const int maxFace[3] = { 1, 2, 3 };
+		float enter = 0.0f;
+		float exit = 1e30f;
+		int face = -1;
+		for(int i = 0; i < 3; i++) {
+			if(std::abs(dir[i]) < 1e-12f) {
+				if(std::abs(o[i]) > 1.0f) {
+					return {};
+				}
+				continue;
+			}
+			float t0 = (-1.0f - o[i]) / dir[i];
+			float t1 = (1.0f - o[i]) / dir[i];
+			int entryFace = minFace[i];
+			if(t0 > t1) {
+				std::swap(t0, t1);
+				entryFace = maxFace[i];
+			}
+			if(t0 > enter) {
+				enter = t0;
+				face = entryFace;
+			}
+			exit = std::min(exit, t1);
+		}
+		if(face < 0 || enter > exit) {
+			return {};
+		}
+		const float range = TestCube::farZ / (TestCube::farZ - TestCube::nearZ);
+		return { face, range * (1.0f - TestCube::nearZ / enter) };
+	}
+
+	//draws one triangle given in pixel coordinates through an identity transform
+	struct PixelVertex {
+		float x, y;
+	};
+	void DrawScreenTriangle(SoftwareRasterizer& rasterizer, PixelVertex a, PixelVertex b, PixelVertex c, float z,
+		const SoftwareRasterizer::Color& tint = { 1.0f, 1.0f, 1.0f, 1.0f })
+	{
+		const auto toNdc = [z](PixelVertex v) {
+			return TestCube::Vertex{ { v.x / float(width) * 2.0f - 1.0f, 1.0f - v.y / float(height) * 2.0f, z } };
+		};
+		const TestCube::Vertex vertices[] = { toNdc(a), toNdc(b), toNdc(c) };
+		const unsigned short indices[] = { 0, 1, 2 };
+		rasterizer.DrawIndexed(vertices, sizeof(TestCube::Vertex), 3u, indices, 3u, rmath::Identity(), tint);
+	}
+
+	std::vector<bool> CoverageMask(SoftwareRasterizer& rasterizer, std::uint32_t background) {
+		const std::uint32_t* pColor = rasterizer.GetColorBuffer();
+		std::vector<bool> mask(std::size_t(width) * height);
+		for(std::size_t i = 0u; i < mask.size(); i++) {
+			mask[i] = pColor[i] != background;
+		}
+		return mask;
+	}
+
+	//overlapping cubes, some crossing the near plane or the screen edges, some drawn as one batch
+	void RenderScene(SoftwareRasterizer& rasterizer) {
+		rasterizer.SetFaceColors(reinterpret_cast<const SoftwareRasterizer::Color*>(TestCube::faceColors.face_colors), 6u);
+		rasterizer.ClearBuffer(0.2f, 0.3f, 1.0f);
+		rasterizer.ResetStats();
+		std::mt19937 rng(11u);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		for(int i = 0; i < 600; i++) {
+			const float angle = dist(rng) * 3.0f;
+			const float x = dist(rng) * 5.0f;
+			const float y = dist(rng) * 4.0f;
+			const float z = 5.0f + dist(rng) * 4.8f;
+			const SoftwareRasterizer::Color tint = { 0.5f + 0.5f * dist(rng), 1.0f, 0.5f - 0.5f * dist(rng), 1.0f };
+			rasterizer.DrawIndexed(TestCube::vertices, sizeof(TestCube::Vertex), std::size(TestCube::vertices),
+				TestCube::indices, std::size(TestCube::indices), CubeTransform(angle, x, y, z), tint);
+		}
+		rasterizer.Flush();
+	}
+
+	bool SameImage(SoftwareRasterizer& a, SoftwareRasterizer& b) {
+		const std::size_t pixels = std::size_t(width) * height;
+		return std::memcmp(a.GetColorBuffer(), b.GetColorBuffer(), pixels * sizeof(std::uint32_t)) == 0
+			&& std::memcmp(a.GetDepthBuffer(), b.GetDepthBuffer(), pixels * sizeof(float)) == 0;
+	}
+
+	void CubeMatchesRayCast() {
+		SoftwareRasterizer rasterizer(width, height);
+		rasterizer.SetFaceColors(reinterpret_cast<const SoftwareRasterizer::Color*>(TestCube::faceColors.face_colors), 6u);
+		const std::uint32_t background = Pack(0.2f, 0.3f, 1.0f, 1.0f);
+		bool faceSeen[6] = {};
+		std::size_t compared = 0u;
+		struct Pose {
+			float angle, x, y, z;
+		};
+		//every face shows up in at least one pose, the last one is partly off screen
+		for(const Pose& pose : { Pose{ 0.0f, 0.0f, 0.0f, 4.0f }, Pose{ 0.6f, -0.5f, 0.3f, 5.0f }, Pose{ 2.4f, 0.4f, -0.2f, 4.5f },
+			Pose{ 4.0f, 0.0f, 0.0f, 3.5f }, Pose{ 0.0f, -2.0f, 0.0f, 4.0f }, Pose{ 1.1f, 2.2f, 1.0f, 4.0f } })
+		{
+			rasterizer.ClearBuffer(0.2f, 0.3f, 1.0f);
+			rasterizer.DrawIndexed(TestCube::vertices, sizeof(TestCube::Vertex), std::size(TestCube::vertices),
+				TestCube::indices, std::size(TestCube::indices), CubeTransform(pose.angle, pose.x, pose.y, pose.z));
+			std::vector<Hit> expected(std::size_t(width) * height);
+			for(unsigned int y = 0u; y < height; y++) {
+				for(unsigned int x = 0u; x < width; x++) {
+					expected[std::size_t(y) * width + x] = TraceCube(pose.angle, pose.x, pose.y, pose.z, x, y);
+				}
+			}
+			const std::uint32_t* pColor = rasterizer.GetColorBuffer();
+			const float* pDepth = rasterizer.GetDepthBuffer();
+			int mismatches = 0;
+			for(unsigned int y = 1u; y + 1u < height; y++) {
+				for(unsigned int x = 1u; x + 1u < width; x++) {
+					const std::size_t i = std::size_t(y) * width + x;
+					//pixels next to an edge or silhouette depend on snapping, compare the interiors only
+					bool interior = true;
+					for(int dy = -1; dy <= 1; dy++) {
+						for(int dx = -1; dx <= 1; dx++) {
+							interior = interior && expected[i + dy * std::ptrdiff_t(width) + dx].face == expected[i].face;
+						}
+					}
+					if(!interior) {
+						continue;
+					}
+					compared++;
+					const Hit& hit = expected[i];
+					const std::uint32_t color = hit.face < 0 ? background : FaceColor(hit.face);
+					if(pColor[i] != color || std::abs(pDepth[i] - hit.depth) > 1e-4f) {
+						mismatches++;
+					}
+					if(hit.face >= 0) {
+						faceSeen[hit.face] = true;
+					}
+				}
+			}
+			CHECK_EQ(mismatches, 0);
+		}
+		for(bool seen : faceSeen) {
+			CHECK(seen);
+		}
+		CHECK(compared > std::size_t(width) * height * 4u);
+	}
+
+	void DepthTestIsLess(SoftwareRasterizer::Kernel kernel) {
+		SoftwareRasterizer rasterizer(width, height);
+		rasterizer.SetKernel(kernel);
+		const SoftwareRasterizer::Color white = { 1.0f, 1.0f, 1.0f, 1.0f };
+		rasterizer.SetFaceColors(&white, 1u);
+		const SoftwareRasterizer::Color red = { 1.0f, 0.0f, 0.0f, 1.0f };
+		const SoftwareRasterizer::Color green = { 0.0f, 1.0f, 0.0f, 1.0f };
+		const SoftwareRasterizer::Color blue = { 0.0f, 0.0f, 1.0f, 1.0f };
+		const auto quad = [&](float z, const SoftwareRasterizer::Color& tint) {
+			DrawScreenTriangle(rasterizer, { 100.0f, 100.0f }, { 300.0f, 100.0f }, { 300.0f, 250.0f }, z, tint);
+			DrawScreenTriangle(rasterizer, { 100.0f, 100.0f }, { 300.0f, 250.0f }, { 100.0f, 250.0f }, z, tint);
+		};
+		const auto quadIs = [&](std::uint32_t color, float depth) {
+			int wrong = 0;
+			for(unsigned int y = 100u; y < 250u; y++) {
+				for(unsigned int x = 100u; x < 300u; x++) {
+					const std::size_t i = std::size_t(y) * width + x;
+					if(rasterizer.GetColorBuffer()[i] != color || rasterizer.GetDepthBuffer()[i] != depth) {
+						wrong++;
+					}
+				}
+			}
+			return wrong;
+		};
+
+		//far then near, the near quad replaces it
+		rasterizer.ClearBuffer(0.0f, 0.0f, 0.0f);
+		quad(0.6f, red);
+		CHECK_EQ(quadIs(Pack(1.0f, 0.0f, 0.0f, 1.0f), 0.6f), 0);
+		quad(0.4f, green);
+		CHECK_EQ(quadIs(Pack(0.0f, 1.0f, 0.0f, 1.0f), 0.4f), 0);
+		//farther fails
+		quad(0.6f, blue);
+		CHECK_EQ(quadIs(Pack(0.0f, 1.0f, 0.0f, 1.0f), 0.4f), 0);
+		//equal fails too, LESS and not LESS_EQUAL
+		quad(0.4f, blue);
+		CHECK_EQ(quadIs(Pack(0.0f, 1.0f, 0.0f, 1.0f), 0.4f), 0);
+		//near then far keeps the near one
+		rasterizer.ClearBuffer(0.0f, 0.0f, 0.0f);
+		quad(0.4f, green);
+		quad(0.6f, red);
+		CHECK_EQ(quadIs(Pack(0.0f, 1.0f, 0.0f, 1.0f), 0.4f), 0);
+		//nothing outside the quad was touched
+		CHECK_EQ(rasterizer.GetPixel(99u, 100u), Pack(0.0f, 0.0f, 0.0f, 1.0f));
+		CHECK_EQ(rasterizer.GetPixel(300u, 249u), Pack(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+
+	void FillRuleCoversEveryPixelOnce(SoftwareRasterizer::Kernel kernel) {
+		SoftwareRasterizer rasterizer(width, height);
+		rasterizer.SetKernel(kernel);
+		const SoftwareRasterizer::Color white = { 1.0f, 1.0f, 1.0f, 1.0f };
+		rasterizer.SetFaceColors(&white, 1u);
+		const std::uint32_t background = Pack(0.0f, 0.0f, 0.0f, 1.0f);
+		//rectangle edges run exactly through pixel centers: left and top are in, right and bottom are out
+		const PixelVertex corners[4] = { { 10.5f, 20.5f }, { 30.5f, 20.5f }, { 30.5f, 36.5f }, { 10.5f, 36.5f } };
+		//fan around an interior point, the shared edges have odd slopes and hit pixel centers too
+		for(const PixelVertex center : { PixelVertex{ 17.25f, 29.75f }, PixelVertex{ 20.5f, 28.5f }, PixelVertex{ 12.5f, 22.5f } }) {
+			std::vector<int> coverage(std::size_t(width) * height);
+			for(int i = 0; i < 4; i++) {
+				rasterizer.ClearBuffer(0.0f, 0.0f, 0.0f);
+				DrawScreenTriangle(rasterizer, center, corners[i], corners[(i + 1) % 4], 0.5f);
+				const auto mask = CoverageMask(rasterizer, background);
+				for(std::size_t p = 0u; p < mask.size(); p++) {
+					coverage[p] += mask[p] ? 1 : 0;
+				}
+			}
+			int wrong = 0;
+			for(unsigned int y = 0u; y < height; y++) {
+				for(unsigned int x = 0u; x < width; x++) {
+					const int expected = x >= 10u && x < 30u && y >= 20u && y < 36u ? 1 : 0;
+					if(coverage[std::size_t(y) * width + x] != expected) {
+						wrong++;
+					}
+				}
+			}
+			CHECK_EQ(wrong, 0);
+		}
+
+		//counter clockwise is back facing and culled
+		rasterizer.ClearBuffer(0.0f, 0.0f, 0.0f);
+		rasterizer.ResetStats();
+		DrawScreenTriangle(rasterizer, corners[0], corners[2], corners[1], 0.5f);
+		CHECK_EQ(rasterizer.GetStats().trianglesCulled, 1u);
+		CHECK_EQ(rasterizer.GetStats().pixelsWritten, 0u);
+	}
+
+	void KernelsMatchScalar() {
+		SoftwareRasterizer reference(width, height);
+		reference.SetKernel(SoftwareRasterizer::Kernel::Scalar);
+		RenderScene(reference);
+		for(auto kernel : { SoftwareRasterizer::Kernel::SSE2, SoftwareRasterizer::Kernel::AVX2 }) {
+			SoftwareRasterizer rasterizer(width, height);
+			rasterizer.SetKernel(kernel);
+			if(rasterizer.GetKernel() != kernel) {
+				std::printf("kernel %d not supported by this CPU, skipped\n", int(kernel));
+				continue;
+			}
+			RenderScene(rasterizer);
+			CHECK(SameImage(rasterizer, reference));
+			CHECK_EQ(rasterizer.GetStats().pixelsWritten, reference.GetStats().pixelsWritten);
+		}
+	}
+
+	void TiledMatchesSingleThreaded() {
+		SoftwareRasterizer reference(width, height);
+		RenderScene(reference);
+		const auto referenceStats = reference.GetStats();
+		CHECK(referenceStats.pixelsWritten > 0u);
+		CHECK(referenceStats.trianglesCulled > 0u);
+		for(unsigned int threads = 1u; threads <= 8u; threads++) {
+			SoftwareRasterizer rasterizer(width, height);
+			rasterizer.SetThreadCount(threads);
+			//twice, the second frame reuses the workers and bins of the first
+			for(int frame = 0; frame < 2; frame++) {
+				RenderScene(rasterizer);
+				CHECK(SameImage(rasterizer, reference));
+				CHECK_EQ(rasterizer.GetStats().pixelsWritten, referenceStats.pixelsWritten);
+				CHECK_EQ(rasterizer.GetStats().trianglesRasterized, referenceStats.trianglesRasterized);
+			}
+		}
+		//a render target that is not a whole number of tiles
+		SoftwareRasterizer odd(width - 13u, height - 37u);
+		SoftwareRasterizer oddTiled(width - 13u, height - 37u);
+		oddTiled.SetThreadCount(3u);
+		RenderScene(odd);
+		RenderScene(oddTiled);
+		CHECK(std::memcmp(odd.GetColorBuffer(), oddTiled.GetColorBuffer(), std::size_t(width - 13u) * (height - 37u) * 4u) == 0);
+	}
+}
+
+int main() {
+	CubeMatchesRayCast();
+	//the fixed function checks hold for every scan conversion kernel the CPU has
+	for(auto kernel : { SoftwareRasterizer::Kernel::Scalar, SoftwareRasterizer::Kernel::SSE2, SoftwareRasterizer::Kernel::AVX2 }) {
+		if(int(kernel) <= int(SoftwareRasterizer::GetBestKernel())) {
+			DepthTestIsLess(kernel);
+			FillRuleCoversEveryPixelOnce(kernel);
+		}
+	}
+	KernelsMatchScalar();
+	TiledMatchesSingleThreaded();
+	return Check::Report("SoftwareRasterizerTest");
+}
@@ -0,0 +1,114 @@
+#include "Check.h"
+#include "TransformBatch.h"
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	//laid out like Graphics::CubeInstance, the transform followed by a color nothing may overwrite
+	struct Instance {
+		rmath::Mat4 transform;
+		float color[4];
+	};
+
+	struct Objects {
+		std::vector<float> angles, xs, ys, zs;
+		explicit Objects(std::size_t count, float range = 20.0f) {
+			std::mt19937 rng(unsigned(count) + 3u);
+			std::uniform_real_distribution<float> dist(-range, range);
+			for(std::size_t i = 0u; i < count; i++) {
+				angles.push_back(dist(rng));
+				xs.push_back(dist(rng));
+				ys.push_back(dist(rng));
+				zs.push_back(dist(rng));
+			}
+		}
+		TransformBatch::Input Input() const {
+			return { angles.data(), xs.data(), ys.data(), zs.data(), angles.size() };
+		}
+	};
+
+	//relative difference, the matrices mix entries near 1 with translations up to the input range
+	float MaxError(const rmath::Mat4& a, const rmath::Mat4& b) {
+		float error = 0.0f;
+		for(int r = 0; r < 4; r++) {
+			for(int c = 0; c < 4; c++) {
+				error = std::max(error, std::abs(a.m[r][c] - b.m[r][c]) / (1.0f + std::abs(b.m[r][c])));
+			}
+		}
+		return error;
+	}
+
+	const rmath::Mat4 viewProj = rmath::PerspectiveLH(1.0f, 0.75f, 0.5f, 10.0f);
+
+	void SimdMatchesScalar() {
+		//every tail length of the 4 wide loop, and a few larger batches
+		for(std::size_t count : { 0u, 1u, 2u, 3u, 4u, 5u, 6u, 7u, 8u, 9u, 13u, 16u, 31u, 1000u, 1027u }) {
+			const Objects objects(count);
+			std::vector<rmath::Mat4> simd(count + 1u), scalar(count + 1u);
+			//one sentinel past the end catches a tail that writes a whole vector
+			std::memset(&simd[count], 0x7F, sizeof(rmath::Mat4));
+			TransformBatch::Build(objects.Input(), viewProj, simd.data(), sizeof(rmath::Mat4));
+			TransformBatch::BuildScalar(objects.Input(), viewProj, scalar.data(), sizeof(rmath::Mat4));
+			float maxError = 0.0f;
+			for(std::size_t i = 0u; i < count; i++) {
+				maxError = std::max(maxError, MaxError(simd[i], scalar[i]));
+			}
+			CHECK(maxError <= 1e-5f);
+			const auto* pSentinel = reinterpret_cast<const unsigned char*>(&simd[count]);
+			CHECK(std::all_of(pSentinel, pSentinel + sizeof(rmath::Mat4), [](unsigned char b) { return b == 0x7F; }));
+		}
+	}
+
+	void MatchesMatrixChain() {
+		const Objects objects(257u, 6.0f);
+		std::vector<rmath::Mat4> batched(257u);
+		TransformBatch::Build(objects.Input(), viewProj, batched.data(), sizeof(rmath::Mat4));
+		float maxError = 0.0f;
+		for(std::size_t i = 0u; i < batched.size(); i++) {
+			const auto expected = rmath::Transpose(rmath::RotationZ(objects.angles[i]) * rmath::RotationX(objects.angles[i])
+				* rmath::Translation(objects.xs[i], objects.ys[i], objects.zs[i]) * viewProj);
+			maxError = std::max(maxError, MaxError(batched[i], expected));
+		}
+		//sin/cos come from a polynomial instead of the C library
+		CHECK(maxError <= 1e-4f);
+	}
+
+	void StrideLeavesTheRestAlone() {
+		for(std::size_t count : { 3u, 4u, 7u, 21u }) {
+			const Objects objects(count);
+			std::vector<Instance> instances(count);
+			for(auto& instance : instances) {
+				std::fill(std::begin(instance.color), std::end(instance.color), 0.25f);
+			}
+			std::vector<rmath::Mat4> packed(count);
+			TransformBatch::Build(objects.Input(), viewProj, instances.data(), sizeof(Instance));
+			TransformBatch::BuildScalar(objects.Input(), viewProj, packed.data(), sizeof(rmath::Mat4));
+			for(std::size_t i = 0u; i < count; i++) {
+				CHECK(MaxError(instances[i].transform, packed[i]) <= 1e-5f);
+				CHECK(std::all_of(std::begin(instances[i].color), std::end(instances[i].color), [](float c) { return c == 0.25f; }));
+			}
+		}
+	}
+
+	void SinCosAccuracy() {
+		float maxError = 0.0f;
+		for(float angle = -100.0f; angle <= 100.0f; angle += 0.0137f) {
+			float s, c;
+			TransformBatch::SinCos(angle, s, c);
+			maxError = std::max(maxError, float(std::abs(double(s) - std::sin(double(angle)))));
+			maxError = std::max(maxError, float(std::abs(double(c) - std::cos(double(angle)))));
+		}
+		CHECK(maxError <= 1e-5f);
+	}
+}
+
+int main() {
+	SimdMatchesScalar();
+	MatchesMatrixChain();
+	StrideLeavesTheRestAlone();
+	SinCosAccuracy();
+	return Check::Report("TransformBatchTest");
+}
@@ -0,0 +1,166 @@
+#include "Check.h"
+#include "VertexQuantization.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	float Length(const rmath::Float3& v) {
+		return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+	}
+
+	void SNorm16() {
+		CHECK_EQ(VertexQuantization::EncodeSNorm16(1.0f), 32767);
+		CHECK_EQ(VertexQuantization::EncodeSNorm16(-1.0f), -32767);
+		CHECK_EQ(VertexQuantization::EncodeSNorm16(2.0f), 32767);
+		CHECK_EQ(VertexQuantization::EncodeSNorm16(0.0f), 0);
+		//-32768 is the one value past -1, D3D clamps it
+		CHECK(VertexQuantization::DecodeSNorm16(-32768) == -1.0f);
+		float maxError = 0.0f;
+		for(int i = -10000; i <= 10000; i++) {
+			const float v = float(i) / 10000.0f;
+			maxError = std::max(maxError, std::fabs(VertexQuantization::DecodeSNorm16(VertexQuantization::EncodeSNorm16(v)) - v));
+		}
+		CHECK(maxError <= 0.5f / 32767.0f + 1e-7f);
+	}
+
+	void Half() {
+		//bit patterns from the IEEE 754 binary16 definition
+		CHECK_EQ(VertexQuantization::EncodeHalf(1.0f), 0x3C00u);
+		CHECK_EQ(VertexQuantization::EncodeHalf(-2.0f), 0xC000u);
+		CHECK_EQ(VertexQuantization::EncodeHalf(65504.0f), 0x7BFFu);
+		CHECK_EQ(VertexQuantization::EncodeHalf(1e6f), 0x7C00u);
+		CHECK_EQ(VertexQuantization::EncodeHalf(std::ldexp(1.0f, -24)), 0x0001u);
+		CHECK(VertexQuantization::DecodeHalf(0x3555u) == 0.333251953125f);
+		CHECK(VertexQuantization::DecodeHalf(0x0001u) == std::ldexp(1.0f, -24));
+		//every finite half survives a round trip
+		std::size_t wrong = 0u;
+		for(std::uint32_t h = 0u; h < 0x10000u; h++) {
+			if((h & 0x7C00u) != 0x7C00u) {
+				wrong += VertexQuantization::EncodeHalf(VertexQuantization::DecodeHalf(std::uint16_t(h))) == h ? 0u : 1u;
+			}
+		}
+		CHECK_EQ(wrong, 0u);
+		//and floats in the normal range land within half a unit in the last place
+		std::mt19937 rng(5u);
+		std::uniform_real_distribution<float> value(-1000.0f, 1000.0f);
+		float maxRelative = 0.0f;
+		for(int i = 0; i < 100000; i++) {
+			const float v = value(rng);
+			if(std::fabs(v) >= 1e-4f) {
+				maxRelative = std::max(maxRelative, std::fabs(VertexQuantization::DecodeHalf(VertexQuantization::EncodeHalf(v)) - v) / std::fabs(v));
+			}
+		}
+		CHECK(maxRelative <= std::ldexp(1.0f, -11));
+	}
+
+	void Octahedral() {
+		std::mt19937 rng(7u);
+		std::normal_distribution<float> component;
+		float maxAngle = 0.0f;
+		float maxLengthError = 0.0f;
+		for(int i = 0; i < 100000; i++) {
+			const rmath::Float3 n = { component(rng), component(rng), component(rng) };
+			std::int16_t encoded[2];
+			VertexQuantization::EncodeOctahedral(n, encoded);
+			const auto d = VertexQuantization::DecodeOctahedral(encoded[0], encoded[1]);
+			//atan2 of the cross and dot products stays accurate for tiny angles, acos of the dot product does not
+			const rmath::Float3 cross = { n.y * d.z - n.z * d.y, n.z * d.x - n.x * d.z, n.x * d.y - n.y * d.x };
+			maxAngle = std::max(maxAngle, std::atan2(Length(cross), n.x * d.x + n.y * d.y + n.z * d.z));
+			maxLengthError = std::max(maxLengthError, std::fabs(Length(d) - 1.0f));
+		}
+		//16 bits per component keep every direction within a hundredth of a degree
+		CHECK(maxAngle <= 0.01f * 3.14159265f / 180.0f);
+		CHECK(maxLengthError <= 1e-5f);
+	}
+
+	//torus with float position, normal and uv, compressed and decoded on the CPU against the float reference
+	void MeshDecodesToReference() {
+		MeshOptimizer::Mesh mesh;
+		MeshFile::Attribute attribute = {};
+		std::strcpy(attribute.semantic, "POSITION");
+		attribute.format = MeshFile::Format::Float3;
+		mesh.attributes.push_back(attribute);
+		std::strcpy(attribute.semantic, "NORMAL");
+		attribute.offset = 12u;
+		mesh.attributes.push_back(attribute);
+		std::strcpy(attribute.semantic, "TEXCOORD");
+		attribute.format = MeshFile::Format::Float2;
+		attribute.offset = 24u;
+		mesh.attributes.push_back(attribute);
+		constexpr std::uint32_t segments = 64u;
+		constexpr std::uint32_t rings = 32u;
+		std::vector<float> vertices;
+		for(std::uint32_t i = 0u; i < segments; i++) {
+			for(std::uint32_t j = 0u; j < rings; j++) {
+				const float u = 6.2831853f * float(i) / float(segments);
+				const float w = 6.2831853f * float(j) / float(rings);
+				const float r = 3.0f + 1.2f * std::cos(w);
+				vertices.insert(vertices.end(), {
+					r * std::cos(u) + 10.0f, r * std::sin(u) - 4.0f, 1.2f * std::sin(w),
+					std::cos(w) * std::cos(u), std::cos(w) * std::sin(u), std::sin(w),
+					float(i) / float(segments), float(j) / float(rings)
+				});
+			}
+		}
+		for(std::uint32_t i = 0u; i < segments; i++) {
+			for(std::uint32_t j = 0u; j < rings; j++) {
+				const std::uint32_t a = i * rings + j;
+				const std::uint32_t b = (i + 1u) % segments * rings + j;
+				const std::uint32_t c = i * rings + (j + 1u) % rings;
+				const std::uint32_t d = (i + 1u) % segments * rings + (j + 1u) % rings;
+				mesh.indices.insert(mesh.indices.end(), { a, b, c, c, b, d });
+			}
+		}
+		mesh.vertexCount = segments * rings;
+		mesh.strides.push_back(32u);
+		const auto* pBytes = reinterpret_cast<const unsigned char*>(vertices.data());
+		mesh.streams.emplace_back(pBytes, pBytes + vertices.size() * sizeof(float));
+
+		const auto compressed = VertexQuantization::Compress(mesh);
+		CHECK_EQ(compressed.strides.size(), 1u);
+		CHECK_EQ(compressed.strides[0], 16u);
+		CHECK(compressed.indices == mesh.indices);
+		//through a mesh file like at runtime
+		std::vector<std::uint16_t> narrow;
+		const auto image = MeshFile::Serialize(MeshOptimizer::MakeDesc(compressed, narrow));
+		const MeshFile file(image.data(), image.size());
+		const auto& dequantization = file.GetDequantization();
+		CHECK(file.FindAttribute("POSITION") != nullptr && file.FindAttribute("POSITION")->format == MeshFile::Format::SNorm16x4);
+
+		const float positionStep = std::max({ dequantization.scale.x, dequantization.scale.y, dequantization.scale.z }) / 32767.0f;
+		const MeshFile::Dequantization identity = { { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f } };
+		const char* semantics[] = { "POSITION", "NORMAL", "TEXCOORD" };
+		//half a quantization step for positions, about a hundredth of a degree for normals, half precision for uvs
+		const float tolerances[] = { positionStep * 0.5f + 1e-5f, 2e-4f, 1.0f / 4096.0f };
+		std::vector<rmath::Float4> reference(mesh.vertexCount);
+		std::vector<rmath::Float4> decoded(mesh.vertexCount);
+		for(std::size_t k = 0u; k < std::size(semantics); k++) {
+			const auto* pReference = &mesh.attributes[k];
+			const auto* pCompressed = file.FindAttribute(semantics[k]);
+			CHECK(pCompressed != nullptr);
+			if(pCompressed == nullptr) {
+				continue;
+			}
+			const auto stream = file.GetStream(pCompressed->stream);
+			VertexQuantization::Decode(vertices.data(), 32u, mesh.vertexCount, *pReference, identity, reference.data());
+			VertexQuantization::Decode(stream.pData, stream.stride, mesh.vertexCount, *pCompressed, dequantization, decoded.data());
+			float maxError = 0.0f;
+			for(std::size_t i = 0u; i < reference.size(); i++) {
+				maxError = std::max({ maxError, std::fabs(reference[i].x - decoded[i].x), std::fabs(reference[i].y - decoded[i].y),
+					std::fabs(reference[i].z - decoded[i].z), std::fabs(reference[i].w - decoded[i].w) });
+			}
+			CHECK(maxError <= tolerances[k]);
+		}
+	}
+}
+
+int main() {
+	SNorm16();
+	Half();
+	Octahedral();
+	MeshDecodesToReference();
+	return Check::Report("VertexQuantizationTest");
+}
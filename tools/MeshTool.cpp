@@ -0,0 +1,153 @@
+#include "MeshSimplifier.h"
+#include "VertexQuantization.h"
+#include "TestCube.h"
+#include <iostream>
+#include <iomanip>
+#include <iterator>
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+//Writes TestCube.mesh, the mesh Graphics::CreateTestCube() loads from the project directory instead of its
+//built in arrays.
+//	MeshTool [--lods] [--compress] <output.mesh>
+//--lods writes a rounded cube dense enough to simplify and a lod chain for it from MeshSimplifier::BuildLods(),
+//without it the mesh is the built in cube.
+//The mesh goes through MeshOptimizer::Optimize() and the vertex cache statistics before and after are printed.
+//--compress stores it with VertexQuantization::Compress().
+//The checked in TestCube.mesh is made with --lods --compress.
+namespace {
+	constexpr const char* usage = "usage: MeshTool [--lods] [--compress] <output.mesh>";
+	//every face of the test cube split into divisions x divisions quads, shared vertices along the edges,
+	//then pulled part of the way towards the unit sphere so the faces curve and simplifying costs something;
+	//every point stays inside the -1..1 box the culling radius of the test cube is based on
+	constexpr std::uint32_t divisions = 8u;
+	constexpr float rounding = 0.15f;
+
+	MeshOptimizer::Mesh MakeCube() {
+		MeshOptimizer::Mesh mesh;
+		MeshFile::Attribute position = {};
+		std::strcpy(position.semantic, "POSITION");
+		position.format = MeshFile::Format::Float3;
+		mesh.attributes.push_back(position);
+		const auto* pVertices = reinterpret_cast<const unsigned char*>(TestCube::vertices);
+		mesh.streams.emplace_back(pVertices, pVertices + sizeof(TestCube::vertices));
+		mesh.strides.push_back(sizeof(TestCube::Vertex));
+		mesh.indices.assign(std::begin(TestCube::indices), std::end(TestCube::indices));
+		mesh.vertexCount = (std::uint32_t)std::size(TestCube::vertices);
+		return mesh;
+	}
+
+	MeshOptimizer::Mesh MakeRoundedCube() {
+		constexpr std::uint32_t n = divisions + 1u;
+		MeshOptimizer::Mesh mesh = MakeCube();
+		std::vector<TestCube::Vertex> vertices;
+		//lattice point to vertex, only the surface ones are used
+		std::vector<std::uint32_t> lattice(n * n * n, ~0u);
+		const auto vertex = [&](std::uint32_t x, std::uint32_t y, std::uint32_t z) {
+			std::uint32_t& index = lattice[(z * n + y) * n + x];
+			if(index == ~0u) {
+				const float cube[3] = { float(x) / float(divisions) * 2.0f - 1.0f, float(y) / float(divisions) * 2.0f - 1.0f,
+					float(z) / float(divisions) * 2.0f - 1.0f };
+				const float length = std::sqrt(cube[0] * cube[0] + cube[1] * cube[1] + cube[2] * cube[2]);
+				float p[3];
+				for(int i = 0; i < 3; i++) {
+					p[i] = cube[i] + (cube[i] / length - cube[i]) * rounding;
+				}
+				index = (std::uint32_t)vertices.size();
+				vertices.push_back({ { p[0], p[1], p[2] } });
+			}
+			return index;
+		};
+		//front faces are clockwise like the built in cube: (b - a) x (c - a) points out of the cube
+		const auto triangle = [&](std::uint32_t a, std::uint32_t b, std::uint32_t c) {
+			const auto& pa = vertices[a].pos;
+			const auto& pb = vertices[b].pos;
+			const auto& pc = vertices[c].pos;
+			const float e1[3] = { pb.x - pa.x, pb.y - pa.y, pb.z - pa.z };
+			const float e2[3] = { pc.x - pa.x, pc.y - pa.y, pc.z - pa.z };
+			const float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			if(normal[0] * pa.x + normal[1] * pa.y + normal[2] * pa.z < 0.0f) {
+				std::swap(b, c);
+			}
+			mesh.indices.insert(mesh.indices.end(), { a, b, c });
+		};
+		mesh.indices.clear();
+		for(std::uint32_t axis = 0u; axis < 3u; axis++) {
+			for(std::uint32_t side = 0u; side < 2u; side++) {
+				for(std::uint32_t v = 0u; v < divisions; v++) {
+					for(std::uint32_t u = 0u; u < divisions; u++) {
+						std::uint32_t corners[4];
+						for(std::uint32_t k = 0u; k < 4u; k++) {
+							std::uint32_t c[3];
+							c[axis] = side * divisions;
+							c[(axis + 1u) % 3u] = u + (k & 1u);
+							c[(axis + 2u) % 3u] = v + (k >> 1u);
+							corners[k] = vertex(c[0], c[1], c[2]);
+						}
+						triangle(corners[0], corners[1], corners[2]);
+						triangle(corners[2], corners[1], corners[3]);
+					}
+				}
+			}
+		}
+		const auto* pVertices = reinterpret_cast<const unsigned char*>(vertices.data());
+		mesh.streams[0].assign(pVertices, pVertices + vertices.size() * sizeof(TestCube::Vertex));
+		mesh.vertexCount = (std::uint32_t)vertices.size();
+		return mesh;
+	}
+}
+
+int main(int argc, char** argv) {
+	if(argc < 2) {
+		std::cerr << usage << std::endl;
+		return 2;
+	}
+	bool lods = false;
+	bool compress = false;
+	for(int i = 1; i < argc - 1; i++) {
+		if(std::strcmp(argv[i], "--lods") == 0) {
+			lods = true;
+		} else if(std::strcmp(argv[i], "--compress") == 0) {
+			compress = true;
+		} else {
+			std::cerr << usage << std::endl;
+			return 2;
+		}
+	}
+	const char* pPath = argv[argc - 1];
+	try {
+		MeshOptimizer::Mesh mesh = lods ? MakeRoundedCube() : MakeCube();
+		if(lods) {
+			MeshSimplifier::BuildLods(mesh);
+		}
+
+		const auto report = MeshOptimizer::Optimize(mesh);
+		std::cout << std::fixed << std::setprecision(3) << "ACMR " << report.before.acmr << " -> " << report.after.acmr
+			<< ", ATVR " << report.before.atvr << " -> " << report.after.atvr << ", " << report.vertexCountBefore
+			<< " -> " << report.vertexCountAfter << " vertices, " << report.indexSize << " byte indices" << std::endl;
+		if(compress) {
+			const std::uint32_t strideBefore = mesh.strides[0];
+			mesh = VertexQuantization::Compress(mesh);
+			std::cout << "compressed " << strideBefore << " -> " << mesh.strides[0] << " bytes per vertex" << std::endl;
+		}
+
+		std::vector<std::uint16_t> narrowIndices;
+		MeshFile::Write(pPath, MeshOptimizer::MakeDesc(mesh, narrowIndices));
+		//read it back the way Graphics does
+		const MeshFile file(pPath);
+		std::cout << "wrote " << pPath << ": " << file.GetVertexCount() << " vertices, " << file.GetIndices().count
+			<< " indices, " << file.GetLodCount() << " lod(s), " << file.GetSize() << " bytes" << std::endl;
+		//how far away each lod takes over in the app, where an error of one pixel is allowed
+		const float lodScale = MeshFile::GetLodScale(TestCube::projHeight, TestCube::nearZ, 600.0f);
+		for(std::size_t i = 0u; i < file.GetLodCount(); i++) {
+			const auto& lod = file.GetLod(i);
+			std::cout << "lod " << i << ": " << lod.indexCount / 3u << " triangles, error " << lod.error
+				<< ", from distance " << lod.error * lodScale << " at 600 pixels" << std::endl;
+		}
+	} catch(const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
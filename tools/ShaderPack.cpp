@@ -0,0 +1,27 @@
+#include "ShaderStore.h"
+#include <filesystem>
+#include <iostream>
+
+//Packs compiled shaders into the archive Graphics::LoadShaders() reads at startup.
+//	ShaderPack <archive> <shader.cso>...
+//Every shader is stored under its file name without the extension, which is the name Graphics asks for.
+//hw3d.vcxproj runs it in the project directory after every build when it finds the CMake build of it
+//(ShaderPackPath); without it the post build step deletes any old archive and the loose .cso files are loaded instead.
+int main(int argc, char** argv) {
+	if(argc < 3) {
+		std::cerr << "usage: ShaderPack <archive> <shader.cso>..." << std::endl;
+		return 2;
+	}
+	try {
+		ShaderStore store;
+		for(int i = 2; i < argc; i++) {
+			store.Load(std::filesystem::path(argv[i]).stem().string(), argv[i]);
+		}
+		store.SaveArchive(argv[1]);
+		std::cout << "packed " << store.Size() << " shader(s) into " << argv[1] << std::endl;
+	} catch(const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}